@@ -0,0 +1,39 @@
+#ifndef ADC_DECODE_H
+#define ADC_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * adc_decode: ADC 生データ [LH, LL, RH, RL]（16bit 符号付き, ビッグエンディアン）→ float
+ * ・バイトスワップ / 符号化 / L,R 分離 / DC除去 / ゲインを1パスで行う
+ * ・x86: SSE2（常時）/ AVX2（CPU が対応していれば実行時に選択）
+ *   ARM: NEON（__ARM_NEON のとき）/ それ以外はスカラー
+ * ・端数フレーム（nbytes % 4）は無視する
+ */
+
+typedef struct {
+    float gain;   /* 出力 = (x - dc) * gain。0 は 1 とみなす */
+    float dc_l;   /* L から差し引くDC（前ピングの mean_l を入れると追従する） */
+    float dc_r;
+} adc_decode_opt_t;
+
+typedef struct {
+    double mean_l;   /* 今回の生サンプル平均（DC除去前） */
+    double mean_r;
+} adc_decode_stat_t;
+
+/* planar 出力：L[i], R[i]（各 nbytes/4 点）
+   opt, st は NULL 可。戻り値はフレーム数 */
+size_t adc_decode_planar(const uint8_t* raw, size_t nbytes, float* L, float* R,
+                         const adc_decode_opt_t* opt, adc_decode_stat_t* st);
+
+/* interleaved 出力：LR[2i]=L, LR[2i+1]=R
+   （xcorr_stereo_input() にそのまま書ける = 複素 L+jR の並び） */
+size_t adc_decode_interleaved(const uint8_t* raw, size_t nbytes, float* LR,
+                              const adc_decode_opt_t* opt, adc_decode_stat_t* st);
+
+/* 実際に使われる実装名（"avx2" / "sse2" / "neon" / "scalar"） */
+const char* adc_decode_impl(void);
+
+#endif /* ADC_DECODE_H */
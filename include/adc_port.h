@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "serial_setup.h"
+#include "rt_thread.h"
+
 typedef struct adc_port adc_port_t;
 
 typedef enum {
@@ -14,9 +17,24 @@ typedef enum {
 adc_port_t* adc_open(const char* devpath, int baudrate);
 void adc_close(adc_port_t* adc);
 
+/* 開いたときに設定できたシリアル設定（baud / low_latency / FTDI latency） */
+const serial_info_t* adc_serial_info(const adc_port_t* adc);
+
+/* ファイルディスクリプタ（io_reactor などで待ち受ける用） */
+int adc_fd(const adc_port_t* adc);
+
 /* 受信（最大lenバイト）。timeout_msで待つ。戻り値は読めたバイト数、失敗は-1 */
 int adc_read(adc_port_t* adc, uint8_t* buf, size_t len, int timeout_ms);
 
+/* 指定バイト数を「開始待ち + 活動タイムアウト」で読み切る
+   戻り値: want(成功) / 0..want-1(途中まで) / -1(エラー) */
+int adc_read_exact(adc_port_t* adc, uint8_t* buf, size_t want,
+                   int start_timeout_ms, int idle_timeout_ms);
+
+/* read の間隔（データが来た read から次にデータが来た read まで）を h に記録する（NULL で止める）。
+   adc_read_exact は最初の read（開始待ち）を数えない */
+void adc_set_gap_hist(adc_port_t* adc, rt_hist_t* h);
+
 /* 入力バッファを捨てる（残ゴミ対策） */
 adc_result_t adc_flush(adc_port_t* adc);
 
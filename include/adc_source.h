@@ -0,0 +1,93 @@
+#ifndef ADC_SOURCE_H
+#define ADC_SOURCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "adc_port.h"
+
+/*
+ * adc_source: ADC 生データ [LH, LL, RH, RL] の取り出し口を差し替えられるようにする
+ * ・tty   : 実機（adc_port）。今までどおり
+ * ・file  : output/adc_data/ の .bin を mmap して再生（実時間 or 全速）
+ * ・synth : 参照チャープのエコー（遅延・振幅・左右差）+ 雑音を生成（seed 固定で再現可能）
+ *
+ * 使い方は adc_read_exact と同じ：
+ *   adc_source_begin(src)   … 1ピング分の受信を始める（file/synth は次の1ピングを用意）
+ *   adc_source_read_exact() … want バイト読む（開始待ち + 活動タイムアウト）
+ *   adc_source_read()       … 届いている分だけ読む（受信しながら処理するとき）
+ * file / synth は begin からの経過時間 × bytes_per_s までしか読ませない（0 = 全速）。
+ * ベンチマーク（tools/pipeline_bench）は file / synth を全速で回せば実機なしで再現できる。
+ */
+
+typedef struct adc_source adc_source_t;
+
+/* 1MHz × 4byte = 実機と同じ速度 */
+#define ADC_SOURCE_REALTIME_BPS 4000000.0
+
+/* ---- tty ---- */
+adc_source_t* adc_source_open_tty(const char* devpath, int baudrate);
+
+/* ---- file 再生 ----
+   capture_bytes ごとに1ピング（ファイルに複数ピングが連結されていてもよい）
+   loop = 1 なら末尾で先頭に戻る / 0 なら終わり（read は 0 を返す） */
+adc_source_t* adc_source_open_file(const char* path, size_t capture_bytes,
+                                   double bytes_per_s, int loop);
+
+/* ---- synth ---- */
+typedef struct {
+    double delay_s;   /* L のエコー遅延（送信からの時間） */
+    double itd_s;     /* R の追加遅延（左右差, 負も可） */
+    double amp_l;     /* 振幅 [ADC カウント]（chirp のピーク 1.0 に対して） */
+    double amp_r;
+    double v_mps;     /* 視線方向の速さ（近づく = 正）。0 なら Doppler なし */
+} adc_synth_echo_t;
+
+#define ADC_SYNTH_MAX_ECHOES 8
+
+typedef struct {
+    const float* chirp;      /* 参照波形（fs でサンプル済み, 呼び出し側が保持） */
+    size_t       chirp_len;
+    double       fs;         /* ADC サンプリング周波数 */
+    size_t       capture_bytes;
+    adc_synth_echo_t echo[ADC_SYNTH_MAX_ECHOES];
+    int          n_echo;
+    double       snr_db;     /* 一番強いエコーの RMS と雑音 RMS の比 */
+    double       dc;         /* 直流オフセット [カウント] */
+    uint64_t     seed;       /* 0 なら固定の既定値 */
+    double       bytes_per_s;
+} adc_synth_cfg_t;
+
+adc_source_t* adc_source_open_synth(const adc_synth_cfg_t* cfg);
+
+/* ---- 共通 ---- */
+void adc_source_close(adc_source_t* src);
+
+/* 種類名（"tty" / "file" / "synth"） */
+const char* adc_source_name(const adc_source_t* src);
+
+/* tty のときの adc_port（serial 設定の確認など）。それ以外は NULL */
+adc_port_t* adc_source_port(adc_source_t* src);
+
+/* 入力を捨てる（tty のみ意味がある。他は何もしない） */
+adc_result_t adc_source_flush(adc_source_t* src);
+
+/* 1ピング分の受信を始める（パルス送信の直前 / 直後に呼ぶ） */
+adc_result_t adc_source_begin(adc_source_t* src);
+
+/* adc_read_exact と同じ戻り値：want / 0..want-1（途中まで）/ -1 */
+int adc_source_read_exact(adc_source_t* src, uint8_t* buf, size_t want,
+                          int start_timeout_ms, int idle_timeout_ms);
+
+/* 届いている分だけ読む（最大 len, adc_read と同じ）。timeout_ms まで最初のデータを待つ
+   戻り値: 読めたバイト数 / 0（タイムアウト・再生終わり）/ -1
+   受信しながら処理する（ping_loop が spsc_ring へ少しずつ公開する）ときに使う */
+int adc_source_read(adc_source_t* src, uint8_t* buf, size_t len, int timeout_ms);
+
+/* read の間隔を h に記録（tty のみ。adc_set_gap_hist と同じ。begin ごとに起点を戻す。他は何もしない） */
+void adc_source_set_gap_hist(adc_source_t* src, rt_hist_t* h);
+
+/* epoll 等で待てる fd（tty のみ。他は -1） */
+int adc_source_fd(const adc_source_t* src);
+
+#endif /* ADC_SOURCE_H */
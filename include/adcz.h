@@ -0,0 +1,95 @@
+#ifndef ADCZ_H
+#define ADCZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * adcz: 16bit ステレオ ADC 録音の可逆圧縮（.adcz）
+ * ・チャンネルごとに線形予測：固定係数（次数 0〜3）か、ブロックごとの量子化 LPC
+ *   （ADCZ_LPC_ORDER 次, 係数は 16bit でブロックに入れる）の |残差| が小さい方
+ * ・残差は zigzag → Rice 符号（ADCZ_RICE_PARTITION 点ごとに k を選ぶ）。大きな残差は escape
+ * ・ブロック（ADCZ_BLOCK_FRAMES フレーム）は単独で復号できる（予測の初期値もブロック内）
+ * ・末尾にブロック索引。索引が無い（書き込み中に落ちた）ファイルは先頭から辿り直す
+ * ・縮まないブロックは生の 16bit で持つ（最悪でも元の大きさ + ヘッダ）
+ *
+ * ファイル（数値はすべてリトルエンディアン）:
+ *   ヘッダ 32B: "ADCZ" | u16 版 | u16 ch数(2) | u32 block_frames | u32 fs
+ *              | u64 total_frames | u64 index_offset（0 = 索引なし）
+ *   ブロック : u32 n_frames | u32 payload_bytes | payload
+ *   索引     : "AIDX" | u32 n_blocks | u64 offset × n_blocks
+ *
+ * サンプルは int16 の L/R 交互（L0 R0 L1 R1 ...）。.bin の [LH, LL, RH, RL] とは
+ * adcz_raw_to_i16 / adcz_i16_to_raw で相互に変換する。
+ */
+
+#define ADCZ_VERSION 1
+
+/* ---- .bin（ビッグエンディアン [LH, LL, RH, RL]）⇔ int16 L/R ---- */
+void adcz_raw_to_i16(const uint8_t* raw, size_t n_frames, int16_t* lr);
+void adcz_i16_to_raw(const int16_t* lr, size_t n_frames, uint8_t* raw);
+
+/* ---- 1ブロック（インメモリ） ---- */
+
+/* n_frames を符号化したときの最大バイト数 */
+size_t adcz_block_bound(size_t n_frames);
+
+/* 戻り値：payload のバイト数（0 = 失敗 / cap 不足） */
+size_t adcz_encode_block(const int16_t* lr, size_t n_frames, uint8_t* out, size_t cap);
+
+/* 作業領域（x, u とも n_frames 個）を呼び出し側が持つ版。ブロックごとの malloc をしない */
+size_t adcz_encode_block_ws(const int16_t* lr, size_t n_frames, uint8_t* out, size_t cap,
+                            int32_t* x, uint32_t* u);
+
+/* 0: OK / -1: 壊れている */
+int adcz_decode_block(const uint8_t* in, size_t len, size_t n_frames, int16_t* lr);
+
+/* ---- ストリーミング書き込み ---- */
+typedef struct adcz_writer adcz_writer_t;
+
+typedef struct {
+    uint64_t frames;      /* 入力フレーム数 */
+    uint64_t in_bytes;    /* 入力（.bin 換算 = frames × 4） */
+    uint64_t out_bytes;   /* ファイルに書いた量（ヘッダ・索引込み） */
+    uint64_t blocks;
+    uint64_t verbatim;    /* 生のまま持ったチャンネル・ブロック数 */
+    uint64_t dropped;     /* close で捨てた端数（push_raw の最後の 4 バイト未満） */
+} adcz_stats_t;
+
+/* block_frames: 0 なら ADCZ_BLOCK_FRAMES */
+adcz_writer_t* adcz_writer_open(const char* path, uint32_t sample_rate, uint32_t block_frames);
+
+/* .bin の生バイト（任意長。端数フレームは次回に持ち越す）/ int16 L/R。0: OK / -1: NG */
+int adcz_writer_push_raw(adcz_writer_t* w, const uint8_t* raw, size_t nbytes);
+int adcz_writer_push_i16(adcz_writer_t* w, const int16_t* lr, size_t n_frames);
+
+void adcz_writer_get_stats(const adcz_writer_t* w, adcz_stats_t* st);
+
+/* 残りのブロック・索引を書いてヘッダを確定し、閉じる（w, st とも NULL 可）
+   st には索引まで含めた最終の統計が入る。0: OK / -1: NG
+   push_raw の端数フレームが残っていたら、ファイルは確定したうえで -1（st->dropped にバイト数） */
+int adcz_writer_close(adcz_writer_t* w, adcz_stats_t* st);
+
+/* ---- 読み出し（mmap） ---- */
+typedef struct adcz_reader adcz_reader_t;
+
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t block_frames;
+    uint64_t total_frames;
+    size_t   n_blocks;
+    int      indexed;     /* 1: 末尾の索引を使った / 0: 先頭から辿った */
+} adcz_info_t;
+
+adcz_reader_t* adcz_reader_open(const char* path);
+void adcz_reader_close(adcz_reader_t* r);
+
+void adcz_reader_get_info(const adcz_reader_t* r, adcz_info_t* info);
+
+/* i 番目のブロックを lr（block_frames × 2 個）へ。戻り値：フレーム数 / -1 */
+int adcz_reader_block(adcz_reader_t* r, size_t i, int16_t* lr);
+
+/* frame0 から n_frames を .bin の並びで raw（n_frames × 4 バイト）へ。戻り値：フレーム数 */
+size_t adcz_reader_read_raw(adcz_reader_t* r, uint64_t frame0, size_t n_frames, uint8_t* raw);
+
+#endif /* ADCZ_H */
@@ -0,0 +1,54 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * arena: セッション（起動〜終了）で1回だけ確保する作業メモリ
+ * ・create 時に mmap して全ページを触っておく → 受信中・処理中に malloc もページフォルトも起きない
+ * ・ARENA_HUGEPAGES：hugetlbfs のページ（MAP_HUGETLB）を試し、無ければ THP（madvise）を頼む
+ *   どちらもダメなら普通のページ（arena_stats_t.pages で分かる）
+ * ・確保は先頭から詰めるだけ（境界指定あり）。個別の free も巻き戻しも無い
+ *   セッションの間ずっと使うもの（パルス・受信・デコード・FFT のバッファ）を最初に取ったまま使う
+ *   （ピングごとの使い回しは ping_loop のリングと、各モジュールが create で持つ作業領域）
+ * ・足りなければ NULL（failed に数える）。high_water を見て ARENA_*_BYTES を決める
+ * ・スレッド安全ではない（確保は1スレッドから。取った領域はどのスレッドで使ってもよい）
+ */
+
+typedef struct arena arena_t;
+
+#define ARENA_HUGEPAGES 1u   /* 大きいページを試す */
+
+typedef enum {
+    ARENA_PAGES_NORMAL  = 0,
+    ARENA_PAGES_THP     = 1,   /* madvise(MADV_HUGEPAGE)（カーネルが出来るときに 2MB にまとめる） */
+    ARENA_PAGES_HUGETLB = 2    /* MAP_HUGETLB（/proc/sys/vm/nr_hugepages の予約から） */
+} arena_pages_t;
+
+typedef struct {
+    size_t   size;         /* 確保した大きさ */
+    size_t   used;         /* 今使っている量 */
+    size_t   high_water;   /* used の最大 */
+    uint64_t n_alloc;      /* 成功した確保の回数 */
+    uint64_t n_failed;     /* 足りなかった回数 */
+    arena_pages_t pages;
+} arena_stats_t;
+
+/* 失敗は NULL */
+arena_t* arena_create(size_t bytes, unsigned flags);
+void arena_destroy(arena_t* a);
+
+/* align（2の累乗, 0 = 64）境界で n バイト。巻き戻さないので中身は 0（create で触ったまま）。足りなければ NULL */
+void* arena_alloc(arena_t* a, size_t n, size_t align);
+
+/* p がこの arena の中か（arena から取ったか malloc 等かを destroy 側で見分ける） */
+int arena_owns(const arena_t* a, const void* p);
+
+void arena_get_stats(const arena_t* a, arena_stats_t* st);
+
+/* "arena(name): used=...KB high=...KB / size=...KB allocs=... failed=... pages=..." の1行 */
+void arena_print(FILE* f, const char* name, const arena_t* a);
+
+#endif /* ARENA_H */
@@ -0,0 +1,68 @@
+#ifndef BOARD_SIM_H
+#define BOARD_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * board_sim: 基板（ADC / PULSE / CTRL の3ポート）をプロセス内で真似る
+ * ・openpty で3組の pty を作り、スレーブ側のパスを返す（symlink も張れる）
+ * ・CTRL : ENQ→ACK, "g N"（保持のみ）, "f" / "f N", "e"（"pulse_err adc_err"）
+ * ・PULSE: 書かれたバイトは読み捨てて数える
+ * ・ADC  : 指定レートで 4byte フレームを流す（連続 / パルス受信ごとに capture_bytes）
+ *          フレーム = 32bit 通し番号（ビッグエンディアン）なので、読み手は欠けを数えられる
+ * ・わざと止める（stall）/ フレームを飛ばす（drop）を周期で入れられる
+ * ・読み手が遅くて pty が一杯になった分も捨てて overrun に数える（実機の FIFO あふれ相当）
+ *
+ * 送受信は内部スレッド1本（poll + 1ms 刻みの送出）。
+ */
+
+typedef struct board_sim board_sim_t;
+
+typedef enum {
+    BOARD_SIM_ADC = 0,
+    BOARD_SIM_PULSE = 1,
+    BOARD_SIM_CTRL = 2
+} board_sim_port_t;
+
+typedef struct {
+    double   adc_bytes_per_s;    /* 例: 4e6（0 = 4e6） */
+    size_t   capture_bytes;      /* 0 = 連続で流す / >0 = PULSE を受けるたびにこの長さ */
+    uint32_t sampling_hz;        /* "f" の返答（0 = 1000000） */
+
+    int      stall_every_ms;     /* >0 なら この周期ごとに stall_ms 止める */
+    int      stall_ms;
+    size_t   drop_every_bytes;   /* >0 なら この量ごとに drop_bytes 飛ばす（4 の倍数に丸める） */
+    size_t   drop_bytes;
+
+    const char* adc_link;        /* 例: "/tmp/ADC_A"（NULL = 張らない） */
+    const char* pulse_link;      /*     "/tmp/PULSE_A"（pulse_write の安全ゲートを通る名前） */
+    const char* ctrl_link;       /*     "/tmp/CTRL_A" */
+} board_sim_cfg_t;
+
+typedef struct {
+    uint64_t adc_bytes;          /* 実際に pty へ書いた */
+    uint64_t adc_dropped;        /* drop 設定で飛ばした */
+    uint64_t adc_overrun;        /* pty が一杯で捨てた */
+    uint64_t stalls;             /* 入れた stall の回数 */
+    uint64_t pulse_bytes;        /* PULSE で受けた */
+    uint64_t pulses;             /* パルスとして数えた回数（capture_bytes > 0 のとき） */
+    uint64_t ctrl_cmds;          /* 解釈した CTRL コマンド */
+    uint32_t gain;               /* 最後に受けた "g N" */
+} board_sim_stats_t;
+
+board_sim_t* board_sim_start(const board_sim_cfg_t* cfg);
+void board_sim_stop(board_sim_t* sim);
+
+/* クライアントが開くパス（symlink を張ったならそのパス） */
+const char* board_sim_path(const board_sim_t* sim, board_sim_port_t port);
+
+void board_sim_get_stats(board_sim_t* sim, board_sim_stats_t* st);
+
+/* 4byte フレームの通し番号（読み手側の検査用） */
+static inline uint32_t board_sim_frame_seq(const uint8_t* f)
+{
+    return ((uint32_t)f[0] << 24) | ((uint32_t)f[1] << 16) | ((uint32_t)f[2] << 8) | (uint32_t)f[3];
+}
+
+#endif /* BOARD_SIM_H */
@@ -0,0 +1,112 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "pulse_port.h"
+
+/*
+ * capture: 1ファイルに多数のピングを入れる録音コンテナ（.tpcap）
+ * ・ヘッダ（セッション情報）+ パルス定義 + ピングごとのレコード + 末尾の索引
+ * ・ピングのレコード：パルス番号・ゲイン・CTRL エラーカウンタ（前後）・CLOCK_MONOTONIC の時刻・受信データ
+ * ・受信データは生の .bin の並び、または adcz ブロック（compress = 1）
+ * ・パルスは定義（種類・周波数・duty など）と RLE（無ければ展開したバイト列）を1回だけ持ち、
+ *   ピングは番号で参照する（同じパルスを何度も書かない）
+ * ・読み出しは mmap。索引から K 番目のピングへ直接飛ぶ（生データは map を指すだけでコピーしない）
+ * ・索引の無いファイル（書き込み中に止まった）は先頭からチャンクを辿って読む
+ *
+ * チャンク（数値はリトルエンディアン, 8バイト境界）:
+ *   tag[4] | u32 0 | u64 len | payload[len] | 0 埋め
+ *   "HEAD"（先頭, 固定長）/ "PULS" / "PING" / "INDX"（close で書き、HEAD から位置を指す）
+ */
+
+/* ---- セッション（HEAD） ---- */
+typedef struct {
+    double   fs_adc;          /* ADC サンプリング周波数 */
+    uint32_t capture_bytes;   /* 1ピングの受信バイト数（予定） */
+    int      compress;        /* 1 = 受信データを adcz で圧縮して持つ */
+    uint64_t t_open_ns;       /* 開いた時刻（CLOCK_MONOTONIC。ピングの時刻と同じ基準） */
+    int64_t  t_open_unix_ns;  /* 開いた時刻（CLOCK_REALTIME） */
+    char     note[64];        /* 自由記述（例 "FM 95k->50k 2ms duty40"） */
+} capture_session_t;
+
+/* ---- パルス（PULS） ---- */
+typedef enum {
+    CAPTURE_PULSE_CF = 0,
+    CAPTURE_PULSE_FM = 1
+} capture_pulse_kind_t;
+
+typedef struct {
+    capture_pulse_kind_t kind;
+    double   fs_bit;          /* ビットクロック（10MHz） */
+    double   dur_s;
+    double   f_start_hz;      /* CF はこちらだけ */
+    double   f_end_hz;
+    int      duty_percent;
+    size_t   n_bytes;         /* 展開したときのバイト数 */
+    /* 波形：RLE（runs が NULL でなければこちらを保存）か、展開したバイト列 */
+    const pulse_run_t* runs;
+    size_t   n_runs;
+    const uint8_t* bytes;
+} capture_pulse_t;
+
+/* ---- ピング（PING） ---- */
+typedef struct {
+    uint64_t seq;
+    int      pulse_id;        /* capture_writer_add_pulse の戻り値（-1 = なし） */
+    int      gain;            /* -1 = 不明 */
+    int      ok;              /* 1 = capture_bytes 読み切った */
+    int      have_err_before, have_err_after;
+    uint32_t err_before_pulse, err_before_adc;   /* CTRL "e" の値 */
+    uint32_t err_after_pulse,  err_after_adc;
+    uint64_t t_pulse_ns;      /* パルス送信開始（CLOCK_MONOTONIC） */
+    uint64_t t_done_ns;       /* 受信完了 */
+
+    /* 以下は reader が埋める（writer では無視） */
+    size_t         raw_bytes;   /* 受信バイト数 */
+    int            compressed;
+    const uint8_t* data;        /* map の中（compressed = 0 なら .bin の並びそのまま） */
+    size_t         data_len;
+} capture_ping_t;
+
+/* ---- 書き込み ---- */
+typedef struct capture_writer capture_writer_t;
+
+/* compress なら圧縮の作業領域と出力（sess->capture_bytes 分）をここで確保する。
+   それより長いピングは圧縮せずに生のまま書く */
+capture_writer_t* capture_writer_open(const char* path, const capture_session_t* sess);
+
+/* 戻り値：パルス番号（0〜）/ -1 */
+int capture_writer_add_pulse(capture_writer_t* w, const capture_pulse_t* p);
+
+/* raw: [LH, LL, RH, RL] の受信データ（nbytes は 4 の倍数でなくてよい）。0: OK / -1: NG */
+int capture_writer_add_ping(capture_writer_t* w, const capture_ping_t* rec,
+                            const uint8_t* raw, size_t nbytes);
+
+uint64_t capture_writer_pings(const capture_writer_t* w);
+
+/* 索引を書いて HEAD を確定し、閉じる（NULL 可）。0: OK / -1: NG */
+int capture_writer_close(capture_writer_t* w);
+
+/* ---- 読み出し（mmap） ---- */
+typedef struct capture_reader capture_reader_t;
+
+capture_reader_t* capture_reader_open(const char* path);
+void capture_reader_close(capture_reader_t* r);
+
+void capture_reader_session(const capture_reader_t* r, capture_session_t* sess);
+size_t capture_reader_pings(const capture_reader_t* r);
+size_t capture_reader_pulses(const capture_reader_t* r);
+int capture_reader_indexed(const capture_reader_t* r);   /* 1: 索引を使った / 0: 辿った */
+
+/* K 番目のピング（レコード + map の中のデータ）。0: OK / -1: NG */
+int capture_reader_ping(const capture_reader_t* r, size_t k, capture_ping_t* out);
+
+/* K 番目の受信データを .bin の並びで dst へ（圧縮なら展開）。戻り値：バイト数 / 0 */
+size_t capture_reader_ping_raw(const capture_reader_t* r, size_t k, uint8_t* dst, size_t cap);
+
+/* パルス定義。runs / bytes は reader を閉じるまで有効。0: OK / -1: NG */
+int capture_reader_pulse(const capture_reader_t* r, int id, capture_pulse_t* out);
+
+#endif /* CAPTURE_H */
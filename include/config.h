@@ -5,6 +5,12 @@
 // #define ADC_DEVICE_PATH    "/tmp/ADC_A" //仮想socatポート
 #define ADC_BAUDRATE       115200
 
+/* 1ピングの受信バイト数。基板側の設定（read_bytes等）と合わせる
+   （相関の点数 = ADC_READ_BYTES/4。xcorr_wisdom の既定サイズもここから決まる） */
+#ifndef ADC_READ_BYTES
+#define ADC_READ_BYTES (256000)     /* 64ms @ 1MHz, 4byte/sample -> 256000 bytes */
+#endif
+
 // #define PULSE_DEVICE_PATH  "/dev/tmp/PULSE_A"//仮想socatポート
 #define PULSE_DEVICE_PATH  "/dev/ttyUSB0"//実機
 #define PULSE_BAUDRATE     115200
@@ -16,7 +22,92 @@
 /* ===== 通信設定 バウンドレート ===== */
 #define CTRL_BAUDRATE      115200
 
+/* ===== シリアル共通（serial_setup） ===== */
+#define SERIAL_LOW_LATENCY      1   /* ASYNC_LOW_LATENCY を立てる */
+#define SERIAL_FTDI_LATENCY_MS  1   /* FTDI latency_timer（既定16ms → 1ms）。0 = 触らない */
+
 /* ===== 制御系の制限 ===== */
 #define CTRL_TIMEOUT_MS    1000
+#define CTRL_SESSION_DEPTH 16    /* ctrl_session で同時に返答待ちできるコマンド数 */
+
+/* ===== 連続ピング（main loop モード） ===== */
+#define PING_PERIOD_MS     100   /* ピング周期（64ms 受信 + 余裕） */
+#define PING_POOL_SLOTS    4     /* 受信バッファ数（受信中1 + 処理待ち） */
+#define PING_RING_MIRROR   1     /* 1 = 受信リング（spsc_ring）を二重 map して、末尾をまたぐピングも連続に */
+
+/* ===== 実時間モード（rt_thread, 連続ピングの送信・受信スレッド） ===== */
+#define RT_ENABLE          0     /* 1 = SCHED_FIFO + CPU 固定 + mlockall（要 CAP_SYS_NICE / memlock） */
+#define RT_PRIO_ADC        80    /* 受信を送信より上に */
+#define RT_PRIO_PULSE      70
+#define RT_CPU_ADC         3     /* 固定する CPU（-1 = 固定しない）。Pi 4 なら 0 番は割り込みに残す */
+#define RT_CPU_PULSE       2
+#define RT_HIST_PATH       "output/rt_hist.csv"  /* セッションごとに遅延ヒストグラムを追記（"" = 書かない） */
+
+/* ===== 作業メモリ（arena: 起動時に1回だけ確保して全ページを触る） ===== */
+#define ARENA_LOOP_BYTES    (32u << 20)  /* 連続ピング：パルス・デコード・相関 / TDOA / Doppler の FFT（使うのは DDC_DECIM=8 で約 2.8MB, 1 で約 14MB） */
+#define ARENA_SHOT_BYTES    (1u << 20)   /* 1回計測：パルス + 受信 256KB */
+#define ARENA_USE_HUGEPAGES 1            /* 1 = 大きいページを試す（hugetlb の予約 → 無ければ THP） */
+
+/* ===== トレース（trace: 送信・受信・DSP の各段の時刻 → Chrome trace JSON） ===== */
+#define TRACE_ENABLE            0                    /* 1 = 記録して終了時に TRACE_PATH へ書き出す */
+#define TRACE_EVENTS_PER_THREAD (1u << 17)           /* スレッドごとのリング（24byte/個。受信は read 1回で2個、溢れたら古い順に消える） */
+#define TRACE_PATH              "output/trace.json"  /* chrome://tracing / ui.perfetto.dev で開く */
+
+/* ===== 擬似エコー（"loop N synth" / adc_source synth の既定） ===== */
+#define SYNTH_ECHO_DELAY_S  0.0058   /* 往復 5.8ms ≒ 1m */
+#define SYNTH_ECHO_ITD_S    50e-6    /* R 側の追加遅延 */
+#define SYNTH_ECHO_AMP      2000.0   /* ADC カウント */
+#define SYNTH_SNR_DB        10.0
+
+/* ===== io_reactor（epoll で ADC/PULSE をまとめて待つ） ===== */
+#define IO_REACTOR_MAX_BOARDS  4       /* 登録できる基板（ADC / PULSE の組）の数 */
+#define IO_REACTOR_ADC_RING    (1u << 20)  /* ADC リング既定サイズ（2の累乗に切り上げ） */
+
+/* ===== 基板シミュレータ（board_sim） ===== */
+#define BOARD_SIM_FIFO_BYTES   (256u * 1024u) /* 送れずに溜められる量（超えたら overrun） */
+#define BOARD_SIM_PULSE_GAP_MS 5              /* PULSE 受信がこれ以上空いたら次のパルス */
+
+/* ===== 録音の可逆圧縮（adcz） ===== */
+#define ADCZ_BLOCK_FRAMES   4096    /* 単独で復号できる単位（4ms @ 1MHz） */
+#define ADCZ_RICE_PARTITION 256     /* Rice の k を選び直す間隔（2のべき） */
+#define ADCZ_LPC_ORDER      8       /* ブロックごとの LPC 次数（0 = 固定係数だけ, 最大 15） */
+
+/* ===== 録音コンテナ（capture, .tpcap） ===== */
+#define CAPTURE_DIR         "output/adc_data"  /* cap_YYYYmmdd_HHMMSS.tpcap を作る */
+#define CAPTURE_COMPRESS    1       /* 1 = 受信データを adcz ブロックで持つ */
+#define CAPTURE_LOOP_SAVE   1       /* 1 = 連続ピングも全ピングを記録する */
+
+/* ===== WAV 書き出し（wav_writer） ===== */
+#define WAV_SAVE            1       /* 1 = 1回計測の受信を cap_YYYYmmdd_HHMMSS.wav にも書く */
+#define WAV_LOOP_SAVE       0       /* 1 = 連続ピングを1本の WAV につないで書く */
+#define WAV_PREVIEW_DECIM   20      /* プレビュー WAV の間引き（1MHz/20 = 50kHz, 0 = 書かない） */
+
+/* ===== 相互相関（FFTW） ===== */
+#define XCORR_WISDOM_PATH  "output/xcorr_wisdom.dat"  /* tools/xcorr_wisdom で事前生成 */
+#define XCORR_PLAN_MODE    XCORR_PLAN_MEASURE
+#define XCORR_HPF_HZ       20000.0  /* これ未満の帯域は相関に使わない */
+
+/* ===== ベースバンド（DDC: ミックスダウン + 間引き） ===== */
+#define DDC_DECIM          8        /* 1 = 使わない（従来どおり 1MHz 実数で相関） */
+#define DDC_CENTER_HZ      72500.0  /* チャープ 50〜95kHz の中央 */
+#define DDC_CUTOFF_HZ      46000.0  /* ±22.5kHz を平坦に通し、折り返す 125k-22.5k より十分手前で落とす */
+#define DDC_TAPS_PER_PHASE 24       /* 全 192 タップ（1MHz で遷移帯 約 30kHz） */
+
+/* ===== エコー検出（CFAR） ===== */
+#define SOUND_SPEED_MPS    343.0    /* 20℃ */
+#define DETECT_GUARD       32       /* 片側ガード（相関の主ローブ ≈ 1/帯域 の数倍） */
+#define DETECT_TRAIN       128      /* 片側の訓練セル */
+#define DETECT_THR_DB      15.0     /* 雑音推定 + 15dB で検出（12dB だとレンジサイドローブを拾う） */
+#define DETECT_MIN_SEP     100      /* 0.1ms（約 1.7cm）以内の山は1つにまとめる */
+#define DETECT_MAX_ECHOES  8
+
+/* ===== 左右の到達時間差（GCC-PHAT） ===== */
+#define TDOA_WIN           2048     /* エコー周りの窓（参照チャープ 2ms が入る長さ） */
+#define TDOA_MAX_LAG       200      /* ±200us（左右マイク間隔 約 6.9cm まで） */
+
+/* ===== Doppler フィルタバンク ===== */
+#define DOPPLER_BINS       11       /* 速度の行数（-VMAX..+VMAX を等分） */
+#define DOPPLER_VMAX_MPS   5.0
+#define DOPPLER_THREADS    2        /* 逆 FFT を分けるスレッド数（1 = 呼び出し元だけ） */
 
 #endif /* CONFIG_H */
@@ -2,6 +2,9 @@
 #define CROSSCORR_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -9,7 +12,23 @@ extern "C" {
 
 typedef struct xcorr_ctx xcorr_ctx_t;
 
+/* FFTW のプラン作成モード（ESTIMATE: 速いが遅いプラン / MEASURE, PATIENT: 遅いが速いプラン） */
+typedef enum {
+    XCORR_PLAN_ESTIMATE = 0,
+    XCORR_PLAN_MEASURE  = 1,
+    XCORR_PLAN_PATIENT  = 2
+} xcorr_plan_mode_t;
+
+typedef struct {
+    xcorr_plan_mode_t plan_mode;
+    int wisdom_only;   /* 1: wisdom に無いサイズは測定せず ESTIMATE に落とす（起動時間優先） */
+    arena_t* arena;    /* FFT バッファの確保先（NULL = fftwf_malloc）。足りなければ fftwf_malloc に戻る。
+                          destroy しても arena には返らないので、create はセッションの最初に1回だけ */
+} xcorr_opts_t;
+
+/* xcorr_create は ESTIMATE 固定（従来どおり） */
 xcorr_ctx_t* xcorr_create(int N, double fs_hz, double hpf_hz);
+xcorr_ctx_t* xcorr_create_ex(int N, double fs_hz, double hpf_hz, const xcorr_opts_t* opt);
 void xcorr_destroy(xcorr_ctx_t* c);
 
 /* 参照信号（時間領域, N点）をセットして内部でFFTして保持 */
@@ -18,6 +37,67 @@ int xcorr_set_call_time(xcorr_ctx_t* c, const float* call_time_N);
 /* 受信信号（時間領域, N点）から相互相関エンベロープを計算 */
 int xcorr_run_envelope(xcorr_ctx_t* c, const float* rec_time_N, float* env_out_N);
 
+/* 入力バッファ（N点 float, FFT 用に境界合わせ済み）。ここへ直接書いて
+   xcorr_run_envelope(c, xcorr_input(c), env) とすればコピーが省ける */
+float* xcorr_input(xcorr_ctx_t* c);
+
+/* 受信信号 L/R（時間領域, 各N点）の相互相関エンベロープを一度に計算
+   （L+jR を1本の複素FFTに詰めて順変換を1回で済ませる） */
+int xcorr_run_envelope_stereo(xcorr_ctx_t* c, const float* rec_L_N, const float* rec_R_N,
+                               float* env_L_N, float* env_R_N);
+
+/* ステレオ入力バッファ（2N点 float, L0 R0 L1 R1 ...）。adc_decode_interleaved で直接書き、
+   xcorr_run_envelope_stereo_packed で相関する（L/R の詰め直しが不要） */
+float* xcorr_stereo_input(xcorr_ctx_t* c);
+int xcorr_run_envelope_stereo_packed(xcorr_ctx_t* c, float* env_L_N, float* env_R_N);
+
+/* ===== 複素ベースバンド（ddc の出力） =====
+ * 入力も参照も I0 Q0 I1 Q1 ... の複素 N 点。ddc で同じように間引いたもの同士を相関する。
+ * N は間引き後の点数で作る（xcorr_create_ex(N/D, fs/D, 0, opt)）。HPF は掛からない。 */
+
+/* 参照（複素 N点）をセットして内部でFFTして保持（初回だけ N点の複素バッファを確保） */
+int xcorr_set_call_complex(xcorr_ctx_t* c, const float* call_iq_N);
+
+/* 複素入力バッファ（2N点 float）。ddc_process で直接書けばコピーが省ける
+   （xcorr_stereo_input と同じ領域なので、ステレオ実数と同時には使えない） */
+float* xcorr_complex_input(xcorr_ctx_t* c);
+
+/* 受信（複素 N点）の相互相関エンベロープ |Σ x[n+l] conj(call[n])| */
+int xcorr_run_envelope_complex(xcorr_ctx_t* c, const float* rec_iq_N, float* env_out_N);
+
+/* ===== ストリーミング（overlap-save） =====
+ * 長い録音を任意長のブロックで push すると、相関エンベロープを少しずつ cb で返す。
+ * 内部は nfft 点の xcorr_ctx を1つ持つだけなので、録音長に関係なくメモリは一定。
+ * 1回のFFTで進むのは step = nfft - call_len + 1 点。
+ * ※ ヒルベルト変換はブロック単位なので、ブロック端は一括計算と僅かに違う */
+typedef struct xcorr_stream xcorr_stream_t;
+
+/* pos: env[0] のラグ（受信サンプル通し番号）, n: 今回の点数 */
+typedef void (*xcorr_stream_cb)(void* user, uint64_t pos, const float* env, size_t n);
+
+/* call: 参照（時間領域, call_len点）
+   nfft: 0 なら call_len の4倍以上の2のべき（最小1024）を自動で選ぶ */
+xcorr_stream_t* xcorr_stream_create(const float* call, int call_len,
+                                    double fs_hz, double hpf_hz, int nfft,
+                                    const xcorr_opts_t* opt,
+                                    xcorr_stream_cb cb, void* user);
+void xcorr_stream_destroy(xcorr_stream_t* s);
+
+/* 受信サンプルを追加（n は任意長）。0: OK / -1: NG */
+int xcorr_stream_push(xcorr_stream_t* s, const float* x, size_t n);
+
+/* 録音終わり：残りを0埋めで出し切り、次の録音用に状態を戻す */
+int xcorr_stream_flush(xcorr_stream_t* s);
+
+/* 1回のFFTで出る点数（step） */
+size_t xcorr_stream_step(const xcorr_stream_t* s);
+
+/* FFTW wisdom（測定済みプラン）をファイルから読む / ファイルへ書く
+   import は xcorr_create_ex より前に呼ぶ。0: OK / -1: NG（ファイル無しを含む）
+   ※ FFTW のプラン作成はスレッドセーフではないので、create/wisdom は同じスレッドから呼ぶ */
+int xcorr_wisdom_import(const char* path);
+int xcorr_wisdom_export(const char* path);
+
 /* 配列の最大値インデックス */
 size_t xcorr_argmax_range(const float* x, size_t n, size_t i0, size_t i1);
 
@@ -0,0 +1,23 @@
+#ifndef CROSSCORR_INTERNAL_H
+#define CROSSCORR_INTERNAL_H
+
+#include <stddef.h>
+#include <fftw3.h>
+
+#include "crosscorr.h"
+
+/*
+ * crosscorr の内部（crosscorr.c / tdoa.c / doppler.c だけが使う。公開 API ではない）
+ * ・プラン：wisdom_only のときは wisdom から作れなければ ESTIMATE で作り直す（xcorr と同じ方針）
+ * ・バッファ：arena があればそこから（64byte 境界 = fftwf_malloc 以上）、無い / 足りなければ fftwf_malloc
+ */
+
+fftwf_plan xcorr_plan_r2c(int N, float* in, fftwf_complex* out, const xcorr_opts_t* o);
+fftwf_plan xcorr_plan_c2r(int N, fftwf_complex* in, float* out, const xcorr_opts_t* o);
+/* 長さ N の in-place c2c を howmany 本（行は N 点ずつ連続）まとめて1プランで */
+fftwf_plan xcorr_plan_many_c2c(int N, int howmany, fftwf_complex* io, int sign, const xcorr_opts_t* o);
+
+void* xcorr_buf_alloc(arena_t* a, size_t bytes);
+void  xcorr_buf_free(arena_t* a, void* p);
+
+#endif /* CROSSCORR_INTERNAL_H */
@@ -70,6 +70,9 @@ typedef enum {
     CTRL_ERR = -1
 } ctrl_result_t;
 
+/* ファイルディスクリプタ（io_reactor などで待ち受ける用） */
+int ctrl_fd(const ctrl_port_t* ctrl);
+
 ctrl_result_t ctrl_enq(ctrl_port_t* ctrl);
 
 ctrl_result_t ctrl_get_sampling_hz(ctrl_port_t* ctrl, uint32_t* hz_out);
@@ -0,0 +1,88 @@
+#ifndef CTRL_SESSION_H
+#define CTRL_SESSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * ctrl_session: 開きっぱなしの CTRL ポートでコマンドをパイプライン送信する
+ * ・fd は起動時に1回だけ開く（tcflush も1回だけ）
+ * ・submit は送信キューに積むだけで返答を待たない
+ * ・返答は送った順に届く前提で、古い要求から順に割り当てる
+ *     CTRL_EXPECT_NONE : 書き終わった時点で完了（g, b, t など）
+ *     CTRL_EXPECT_LINE : 1行（'\n' まで）で完了（e, f）
+ *     CTRL_EXPECT_ACK  : 0x06 を1byte受けて完了（ENQ）
+ * ・完了はコールバック、または ctrl_session_take() で受け取る
+ * ・返答待ちがタイムアウトしたら、その要求を失敗にして受信途中の行を捨てる
+ *   （期限は「その要求が先頭になってから」数える。前の返答待ちは含めない）
+ * ・返答の有無（expect）を間違えると以降の割り当てがずれるので注意
+ *
+ * スレッド：1つの session は1スレッドから使う（内部でロックしない）
+ */
+
+typedef struct ctrl_session ctrl_session_t;
+
+typedef enum {
+    CTRL_EXPECT_NONE = 0,
+    CTRL_EXPECT_LINE = 1,
+    CTRL_EXPECT_ACK  = 2
+} ctrl_expect_t;
+
+#define CTRL_REPLY_MAX 128
+
+typedef struct {
+    uint32_t id;
+    int      status;                  /* 0 = OK / -1 = タイムアウト・エラー */
+    char     line[CTRL_REPLY_MAX];    /* EXPECT_LINE の返答（改行なし） */
+    uint64_t t_submit_ns;
+    uint64_t t_done_ns;
+} ctrl_reply_t;
+
+typedef void (*ctrl_session_cb)(void* user, const ctrl_reply_t* rep);
+
+/* ===== ライフサイクル ===== */
+ctrl_session_t* ctrl_session_open(const char* devpath, int baudrate);
+void ctrl_session_close(ctrl_session_t* s);
+
+/* poll / epoll で待つ用（読み込み可能になったら ctrl_session_process を呼ぶ） */
+int ctrl_session_fd(const ctrl_session_t* s);
+
+/* ===== 送信 ===== */
+/**
+ * コマンドを積む（返答は待たない）
+ * @param cmd 例: "g 300\n", "e\n"
+ * @param timeout_ms 返答待ち上限（<=0 で CTRL_TIMEOUT_MS）
+ * @param cb NULL なら ctrl_session_take() で受け取る
+ * @return 要求ID（1以上） / 失敗時 0（キュー満杯など）
+ */
+uint32_t ctrl_session_submit(ctrl_session_t* s, const char* cmd, ctrl_expect_t expect,
+                             int timeout_ms, ctrl_session_cb cb, void* user);
+
+/* ===== 進める ===== */
+/* ブロックしない：書ける分を書き、読める分を読み、タイムアウトを判定
+   戻り値：今回完了した要求数 / エラー -1 */
+int ctrl_session_process(ctrl_session_t* s);
+
+/* 最大 timeout_ms だけ fd を待ってから process */
+int ctrl_session_poll(ctrl_session_t* s, int timeout_ms);
+
+/* 未完了の要求数 */
+int ctrl_session_pending(const ctrl_session_t* s);
+
+/* ===== 結果の受け取り（コールバックなしの要求） ===== */
+/* 1 = 完了（out に結果）/ 0 = まだ / -1 = 不明な ID（CTRL_SESSION_DEPTH 件以上前など） */
+int ctrl_session_take(ctrl_session_t* s, uint32_t id, ctrl_reply_t* out);
+
+/* take できるまで poll を回す（1 / 0=時間切れ / -1） */
+int ctrl_session_wait(ctrl_session_t* s, uint32_t id, ctrl_reply_t* out, int timeout_ms);
+
+/* ===== よく使うコマンド ===== */
+uint32_t ctrl_session_set_gain(ctrl_session_t* s, uint32_t gain);
+uint32_t ctrl_session_req_errors(ctrl_session_t* s, ctrl_session_cb cb, void* user);
+uint32_t ctrl_session_req_sampling_hz(ctrl_session_t* s, ctrl_session_cb cb, void* user);
+
+/* 返答行の解釈（0 / -1） */
+int ctrl_parse_errors(const char* line, uint32_t* pulse_err, uint32_t* adc_err);
+int ctrl_parse_hz(const char* line, uint32_t* hz_out);
+
+#endif /* CTRL_SESSION_H */
@@ -0,0 +1,47 @@
+#ifndef DDC_H
+#define DDC_H
+
+#include <stddef.h>
+
+/*
+ * ddc: 実信号 → 複素ベースバンド（ミックスダウン + 間引き FIR）
+ * ・y[m] = Σ h[k] x[mD-k] e^{-jω(mD-k)}
+ *   ミキサは係数側に畳み込んである（h_c[k] = h[k] e^{jωk}）ので、入力1点ごとの掛け算はなく、
+ *   残す出力だけ実数×複素係数の内積を計算して、最後に e^{-jωmD} を1回掛ける
+ *   （polyphase 分解と同じ演算量: 出力1点あたり taps 回）
+ * ・内積は AVX2（実行時に選択）/ NEON / スカラー
+ * ・h は Blackman 窓の sinc（DC 利得 1）。参照も同じ ddc を通せば、群遅延は相関で打ち消し合う
+ * ・出力は複素 interleaved（I0 Q0 I1 Q1 ...）= xcorr_complex_input() にそのまま書ける
+ *
+ * 1つの ddc は1スレッドから使う（作業バッファを持つ）。
+ */
+
+typedef struct ddc ddc_t;
+
+typedef struct {
+    double fs;              /* 入力サンプリング周波数 */
+    double f_center;        /* ベースバンドの 0Hz に持ってくる周波数 */
+    double cutoff_hz;       /* 低域通過のカットオフ（片側, -6dB） */
+    int    decim;           /* 間引き率 D */
+    int    taps_per_phase;  /* 1相あたりのタップ数（全タップ = D × これ） */
+} ddc_cfg_t;
+
+/* config.h の既定値（DDC_*）で埋める */
+void ddc_cfg_default(ddc_cfg_t* cfg, double fs);
+
+/* max_in: 1回に入れる最大入力点数 */
+ddc_t* ddc_create(const ddc_cfg_t* cfg, size_t max_in);
+void ddc_destroy(ddc_t* d);
+
+/* 出力点数（n_in / D） */
+size_t ddc_out_len(const ddc_t* d, size_t n_in);
+int ddc_decim(const ddc_t* d);
+
+/* x: 入力（n 点, stride 飛び。ステレオ詰めの L なら x=lr, stride=2, R なら x=lr+1）
+   iq_out: 2 × ddc_out_len 個。戻り値：出力点数 */
+size_t ddc_process(ddc_t* d, const float* x, size_t n, size_t stride, float* iq_out);
+
+/* 実際に使われる内積の実装名（"avx2" / "sse" / "neon" / "scalar"） */
+const char* ddc_impl(void);
+
+#endif /* DDC_H */
@@ -0,0 +1,60 @@
+#ifndef DETECT_H
+#define DETECT_H
+
+#include <stddef.h>
+
+/*
+ * detect: 相関エンベロープから複数エコーを拾う CFAR 検出器
+ * ・CA（cell averaging）: 両側の訓練セルの平均を雑音とみなす。累積和で O(N)
+ * ・OS（ordered statistic）: 訓練セルの rank 番目の値を雑音とみなす
+ *   （強いエコーが並んでも雑音推定が引きずられにくい。guard/2 点ごとに quickselect して間は保持）
+ * ・閾値を超えた連続区間ごとに山を1つ → 放物線補間でサブサンプル位置と振幅
+ * ・min_sep 以内の山は強いほうだけ残し、振幅上位 max_echoes 個を距離順で返す
+ *
+ * 作業領域は detect_create で確保済み（ピングごとの malloc なし）。
+ * 1つの detector は1スレッドから使う。
+ */
+
+typedef struct detector detector_t;
+
+typedef enum {
+    DETECT_CA = 0,
+    DETECT_OS = 1
+} detect_mode_t;
+
+typedef struct {
+    detect_mode_t mode;
+    int    guard;        /* 注目セルの片側ガード（主ローブ分） */
+    int    train;        /* 片側の訓練セル数（OS は detect_create 時の上限以下） */
+    int    os_rank;      /* OS: 2*train 個中の順位（0 = 3/4 の位置） */
+    double thr_db;       /* 閾値 = 雑音 × 10^(thr_db/20)（エンベロープは振幅なので 20log） */
+    int    min_sep;      /* これより近い山は1つにまとめる（サンプル） */
+    size_t i0, i1;       /* 探す範囲 [i0, i1)（i1 = 0 なら最後まで） */
+    int    max_echoes;   /* 返す最大数（detect_create 時の上限以下） */
+} detect_cfg_t;
+
+typedef struct {
+    double index;        /* サブサンプル位置（ラグ） */
+    double t_s;          /* index / fs */
+    double range_m;      /* 往復なので c * t / 2 */
+    float  amp;          /* 補間後のピーク振幅 */
+    float  noise;        /* その位置の雑音推定 */
+    float  snr_db;       /* 20 log10(amp / noise) */
+} detect_echo_t;
+
+/* CFG を config.h の既定値で埋める */
+void detect_cfg_default(detect_cfg_t* cfg);
+
+/* n: エンベロープ長の上限, max_echoes: 返す数の上限, max_train: 片側訓練セル数の上限（OS の作業領域 2*max_train） */
+detector_t* detect_create(size_t n, int max_echoes, int max_train);
+void detect_destroy(detector_t* d);
+
+/* env（n 点）からエコーを検出して out に距離順で書く。戻り値：個数 / -1（OS で train > max_train も -1）
+   fs: エンベロープのサンプリング周波数, c_mps: 音速 */
+int detect_run(detector_t* d, const detect_cfg_t* cfg, const float* env, size_t n,
+               double fs, double c_mps, detect_echo_t* out);
+
+/* 直前の detect_run の閾値列（n 点, 範囲外は 0）。表示・保存用 */
+const float* detect_threshold(const detector_t* d);
+
+#endif /* DETECT_H */
@@ -0,0 +1,61 @@
+#ifndef DOPPLER_H
+#define DOPPLER_H
+
+#include <stddef.h>
+
+#include "crosscorr.h"
+#include "ddc.h"
+
+/*
+ * doppler: 速度ごとに時間伸縮した参照で相関する Doppler 整合フィルタバンク
+ * ・FM チャープは広帯域なので周波数シフトではなく時間伸縮 eta = (c+v)/(c-v) で参照を作る
+ * ・K 本の参照スペクトルは create 時に1回だけ作って連続に並べて持つ
+ * ・受信は r2c を1回だけ。各参照と掛けて、逆 FFT は fftwf_plan_many で行をまとめて実行
+ *   （n_threads > 1 なら行をスレッドに分ける。ワーカーは create で起こして待たせておく）
+ * ・出力は range-Doppler マップ（K 行 × N ラグのエンベロープ）と、エコーごとの最良速度
+ * ・doppler_bank_create_ddc は受信と同じ DDC の後の複素ベースバンド（N/D 点）で回す
+ *   （参照は入力レートで伸縮してから同じ DDC を通す。受信は c2c を1回、ラグは 1/D 単位）
+ *
+ * エンベロープの作り方（HPF・解析信号・1/N）は crosscorr と同じ。
+ * プランは crosscorr と同じ方針（plan_mode / wisdom_only）。run は1スレッドから呼ぶ。
+ */
+
+typedef struct doppler_bank doppler_bank_t;
+
+typedef struct {
+    int    bin;        /* 一番合った行 */
+    double v_mps;      /* その行の速度 */
+    double v_interp;   /* 隣の行と放物線補間した速度 */
+    float  amp;        /* その行のエンベロープ値 */
+    size_t lag;        /* 最大だったラグ */
+} doppler_best_t;
+
+/* call: 参照（call_len 点）, v_mps: 各行の速度（K 個, 近づく = 正）, c_mps: 音速 */
+doppler_bank_t* doppler_bank_create(int N, double fs_hz, double hpf_hz,
+                                    const float* call, size_t call_len,
+                                    const double* v_mps, int K, double c_mps,
+                                    int n_threads, const xcorr_opts_t* opt);
+/* n_in: DDC に入れる点数（入力レート）。行の長さは ddc_out_len(ddc, n_in)。
+   ddc は create の間だけ使う（受信の DDC と同じものを渡す。create 中は他から使わないこと） */
+doppler_bank_t* doppler_bank_create_ddc(int n_in, ddc_t* ddc,
+                                        const float* call, size_t call_len,
+                                        const double* v_mps, int K, double c_mps,
+                                        int n_threads, const xcorr_opts_t* opt);
+void doppler_bank_destroy(doppler_bank_t* b);
+
+/* -vmax..+vmax を K 等分した速度列（K >= 2） */
+void doppler_velocities(double vmax, int K, double* v_out);
+
+/* 受信（N 点, stride 飛び。ステレオ詰めなら stride = 2）から range-Doppler マップを作る */
+int doppler_bank_run(doppler_bank_t* b, const float* x, size_t stride);
+/* create_ddc のバンク用：DDC 出力（I0 Q0 I1 Q1 ..., N 点） */
+int doppler_bank_run_complex(doppler_bank_t* b, const float* iq);
+
+/* マップ（K 行 × N, 行 = 速度）。次の run まで有効 */
+const float* doppler_bank_map(const doppler_bank_t* b);
+int doppler_bank_rows(const doppler_bank_t* b);
+
+/* lag ± halfwidth の範囲で全行を比べて一番合った速度 */
+int doppler_bank_best(const doppler_bank_t* b, size_t lag, int halfwidth, doppler_best_t* out);
+
+#endif /* DOPPLER_H */
@@ -0,0 +1,62 @@
+#ifndef IO_REACTOR_H
+#define IO_REACTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "adc_port.h"
+#include "pulse_port.h"
+
+/*
+ * io_reactor: ADC / PULSE を1つの epoll でまとめて面倒を見る
+ * ・登録した fd は O_NONBLOCK + エッジトリガ（EPOLLET）にする
+ *   （destroy で元のフラグに戻す。ポート自体は閉じない）
+ * ・ADC : 読めるだけ readv でリングバッファへ（EAGAIN まで）
+ *         リングが満杯のぶんは読み捨てて dropped に数える
+ * ・PULSE: submit したバイト列 / RLE を書ける分だけ書き、
+ *          EAGAIN になったら EPOLLOUT で続きを書く（RLE はチャンク展開）
+ * ・基板（ADC / PULSE の組）は IO_REACTOR_MAX_BOARDS まで。どちらも NULL 可
+ * ・CTRL は扱わない（ctrl_session が開きっぱなしの fd で送受信する）
+ *
+ * 使う所：単発モード（main）と tools/board_stress。連続ピング（ping_loop）は adc_source の受信スレッドで読む
+ *
+ * スレッド：1つの reactor は1スレッドから使う（内部でロックしない）
+ */
+
+typedef struct io_reactor io_reactor_t;
+
+io_reactor_t* io_reactor_create(void);
+void io_reactor_destroy(io_reactor_t* r);
+
+/* 基板を登録。adc_ring_bytes = 0 なら IO_REACTOR_ADC_RING
+   戻り値：基板番号（0..）/ 失敗 -1 */
+int io_reactor_add_board(io_reactor_t* r, adc_port_t* adc, pulse_port_t* pulse,
+                         size_t adc_ring_bytes);
+
+/* イベントを1回待って処理する（timeout_ms < 0 で無期限）
+   戻り値：処理したイベント数 / エラー -1 */
+int io_reactor_poll(io_reactor_t* r, int timeout_ms);
+
+/* ---- PULSE ---- */
+/* 安全ゲート（pulse_check）を通してから送信開始。data は送信完了まで呼び出し側が保持
+   送信中に再 submit すると失敗（-1） */
+int io_reactor_pulse_submit(io_reactor_t* r, int board, const uint8_t* data, size_t len);
+int io_reactor_pulse_submit_rle(io_reactor_t* r, int board, const pulse_rle_t* rle);
+/* 1 = 送信中, 0 = 完了, -1 = 直前の送信が書き込みエラーで中断 */
+int io_reactor_pulse_busy(io_reactor_t* r, int board);
+
+/* ---- ADC ---- */
+size_t   io_reactor_adc_available(io_reactor_t* r, int board);
+/* リングから最大 n バイト取り出す（戻り値：取り出したバイト数） */
+size_t   io_reactor_adc_read(io_reactor_t* r, int board, uint8_t* dst, size_t n);
+/* リングを空にする（送信前の古いデータ捨て） */
+void     io_reactor_adc_discard(io_reactor_t* r, int board);
+uint64_t io_reactor_adc_total(io_reactor_t* r, int board);    /* 受信した総バイト数 */
+uint64_t io_reactor_adc_dropped(io_reactor_t* r, int board);  /* リング満杯で捨てた数 */
+
+/* リングに want バイト貯まるまで poll を回す（adc_read_exact と同じタイムアウト意味）
+   戻り値：貯まっているバイト数（want 未満ならタイムアウト）/ エラー -1 */
+int io_reactor_adc_wait(io_reactor_t* r, int board, size_t want,
+                        int start_timeout_ms, int idle_timeout_ms);
+
+#endif /* IO_REACTOR_H */
@@ -0,0 +1,101 @@
+#ifndef PING_LOOP_H
+#define PING_LOOP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "adc_source.h"
+#include "pulse_port.h"
+#include "rt_thread.h"
+
+/*
+ * ping_loop: 連続ピング（一定周期で PULSE 送信 → ADC 受信）
+ * ・ADC（adc_source: tty / file / synth）/ PULSE ポートは開きっぱなしで使い回す
+ * ・受信バッファは create 時にまとめて確保（ピング毎の malloc なし）。中身は spsc_ring で、
+ *   受信スレッドが read(2) で直接書き、読めた分ずつ公開する（ping_loop_peek で受信途中から処理できる）
+ *   cfg.ring_mirror = 1 なら二重 map でリング末尾をまたぐピングも連続（できなければ詰め物で連続にする）
+ * ・送信スレッド / 受信スレッドは start 時に1回だけ作る
+ * ・ピングN+1 を受信している間に、呼び出し側がピングN を処理できる
+ *
+ * 受信スロットは リング順（送信順 = 受信順 = 処理順）で回る。
+ * 空きスロットが無い周期は送信を見送る（skipped に数える）。
+ *
+ * 実時間モード（cfg.rt_adc / rt_pulse, 既定はオフ）：各スレッドが開始時に自分を SCHED_FIFO・CPU 固定にし、
+ * スタックを先に触る。受信バッファは create 時に実ページまで割り当て済み（mlockall は呼び出し側）。
+ * 遅延は常に記録する（ping_loop_get_rt）：送信スレッドの起床遅れ・受信スレッドの起床遅れ・read の間隔。
+ */
+
+typedef struct ping_loop ping_loop_t;
+
+typedef struct {
+    size_t capture_bytes;     /* 1ピングの受信バイト数（例: 256000） */
+    int    n_slots;           /* 受信バッファ数（2以上） */
+    int    period_ms;         /* ピング周期 */
+    int    start_timeout_ms;  /* 最初の1byte待ち */
+    int    idle_timeout_ms;   /* 途中で途切れたら失敗 */
+    long   max_pings;         /* 0 = ping_loop_stop() まで続ける */
+    int    ring_mirror;       /* 1 = 受信リングを二重 map する（spsc_ring の SPSC_RING_MIRROR） */
+    rt_sched_t rt_adc;        /* 受信スレッド（0 埋めなら通常のスレッド） */
+    rt_sched_t rt_pulse;      /* 送信スレッド */
+} ping_loop_cfg_t;
+
+/* 受信済みピング（acquire で受け取り、release で返す） */
+typedef struct {
+    uint64_t       seq;         /* ピング番号（0始まり） */
+    const uint8_t* data;        /* [LH, LL, RH, RL] の生データ */
+    size_t         got;         /* 受信できたバイト数 */
+    int            ok;          /* 1 = capture_bytes 読み切った */
+    uint64_t       t_pulse_ns;  /* パルス送信開始（CLOCK_MONOTONIC） */
+    uint64_t       t_done_ns;   /* 受信完了 */
+} ping_frame_t;
+
+typedef struct {
+    uint64_t fired;        /* 送信したピング数 */
+    uint64_t captured;     /* 受信を終えたピング数 */
+    uint64_t incomplete;   /* 途中で途切れた / エラー */
+    uint64_t skipped;      /* 空きスロットが無く送信を見送った周期 */
+    uint64_t pulse_errors; /* pulse_send_rle 失敗 */
+    uint64_t late_ns_max;  /* 予定時刻からの送信遅れ（最大） */
+    size_t   ring_bytes;    /* 受信リングの大きさ */
+    int      ring_mirrored; /* 1 = 二重 map できた */
+} ping_loop_stats_t;
+
+typedef struct {
+    int rt_adc, rt_pulse;     /* 1 = 適用できた / 0 = 指定なし / -1 = 一部できなかった（その分は通常のまま） */
+    rt_hist_t pulse_wake;     /* 送信予定時刻 → 送信スレッドが起きるまで */
+    rt_hist_t adc_wake;       /* 送信（受信の合図）→ 待っていた受信スレッドが起きるまで */
+    rt_hist_t read_gap;       /* 1ピングの受信中の read 間隔（tty のみ） */
+} ping_loop_rt_t;
+
+/* ポート / 受信元は呼び出し側が開いて渡す（close も呼び出し側）。
+   pulse_rle は create で1回だけ安全チェックする（通らなければ NULL）。ping_loop_destroy() まで書き換えずに保持しておくこと。
+   pulse = NULL なら送信せずに受信だけ回す（adc_source の file / synth 再生用） */
+ping_loop_t* ping_loop_create(adc_source_t* adc, pulse_port_t* pulse,
+                              const pulse_rle_t* pulse_rle,
+                              const ping_loop_cfg_t* cfg);
+void ping_loop_destroy(ping_loop_t* pl);
+
+/* 送信・受信スレッドを開始。0: OK / -1: NG */
+int ping_loop_start(ping_loop_t* pl);
+
+/* 停止要求（受信中のピングは読み終わるまで待つ） */
+void ping_loop_stop(ping_loop_t* pl);
+
+/* 受信済みピングを1つ取り出す
+   戻り値: 1 = 取得 / 0 = タイムアウト / -1 = 終了（もう来ない） */
+int ping_loop_acquire(ping_loop_t* pl, ping_frame_t* out, int timeout_ms);
+
+/* acquire したピングのバッファを返却（acquire した順に返す） */
+void ping_loop_release(ping_loop_t* pl, const ping_frame_t* f);
+
+/* 受信中（または受信済みで未 release）のピング seq の先頭を *data に入れ、今届いているバイト数を返す。
+   done（NULL 可）には受信を終えたら 1。まだ受信が始まっていない / 返却済みなら 0 バイト。
+   データは acquire と同じくリング上のもの（コピーなし）。acquire と同じスレッドから呼ぶこと */
+size_t ping_loop_peek(ping_loop_t* pl, uint64_t seq, const uint8_t** data, int* done);
+
+void ping_loop_get_stats(ping_loop_t* pl, ping_loop_stats_t* st);
+
+/* 実時間モードの結果と遅延ヒストグラム（stop の後 / acquire が -1 を返した後に読む） */
+void ping_loop_get_rt(ping_loop_t* pl, ping_loop_rt_t* rt);
+
+#endif /* PING_LOOP_H */
@@ -21,6 +21,12 @@ pulse_result_t pulse_write_locked(pulse_port_t* p, const uint8_t* data, size_t l
 /* 安全ゲート付き送信（is_safe_devpath() の許可先のみ送信） */
 pulse_result_t pulse_write(pulse_port_t* p, const uint8_t* data, size_t len);
 
+/* pulse_write と同じ安全ゲートだけを通す（送信は別経路: io_reactor など） */
+pulse_result_t pulse_check(const pulse_port_t* p, const uint8_t* data, size_t len);
+
+/* ファイルディスクリプタ（io_reactor などで待ち受ける用） */
+int pulse_fd(const pulse_port_t* p);
+
 /* 矩形波生成：freq_khz(1..5000), duty_percent(0..99)
    10MHz基準: 1bit=0.1us, LSB first */
 size_t pulse_gen_pfd(uint8_t* out, size_t out_bytes, int freq_khz, int duty_percent);
@@ -32,4 +38,72 @@ size_t pulse_gen_exp_chirp(uint8_t* out, size_t out_bytes,
                            double f_start_hz, double f_end_hz,
                            int duty_percent);
 
+/* 送信前チェック用の統計（1パスで計算） */
+typedef struct {
+    size_t bits;            /* 全ビット数 */
+    size_t ones;            /* High のビット数 */
+    double duty_percent;    /* 全体の duty */
+    int    max_run;         /* 連続 High の最長（bit） */
+    double max_local_duty;  /* 窓ごとの duty の最大（%） */
+} pulse_stats_t;
+
+/* duty・連続 High 最長・窓ごとの duty を1パスで求める（LSB first）
+   window_bits は 64bit 単位に切り上げ、0 なら全体で1窓。末尾の半端な窓は後ろを Low とみなす */
+void pulse_analyze(const uint8_t* data, size_t len, size_t window_bits, pulse_stats_t* st);
+
+/* ===== RLE パルス（On/Off の長さの列, 10MHz ビット単位） =====
+ * 波形は「High on ビット → Low off ビット」の繰り返しなので、周期の数だけの配列で表せる。
+ * 生成・安全チェックは周期数 O(n) で済み、バイト列への展開は送信時にチャンクごとに行う。 */
+typedef struct {
+    uint32_t on;    /* High のビット数 */
+    uint32_t off;   /* 続く Low のビット数 */
+} pulse_run_t;
+
+typedef struct {
+    pulse_run_t* runs;
+    size_t n;           /* 使用数 */
+    size_t cap;         /* 確保数（足りなければ生成時に広げる） */
+    size_t total_bits;  /* Σ(on + off) */
+} pulse_rle_t;
+
+/* 展開の途中位置（チャンク送信用） */
+typedef struct {
+    const pulse_rle_t* rle;
+    size_t run;      /* 今の run 番号 */
+    size_t in_run;   /* run の中で何ビット進んだか */
+} pulse_rle_cursor_t;
+
+/* rle は 0 初期化しておけばよい。使い終わったら pulse_rle_free */
+void pulse_rle_free(pulse_rle_t* rle);
+
+/* バイト版 pulse_gen_pfd / pulse_gen_exp_chirp と同じ波形（total_bits = out_bytes*8 相当）
+   0: OK / -1: NG */
+int pulse_rle_gen_pfd(pulse_rle_t* rle, size_t total_bits, int freq_khz, int duty_percent);
+int pulse_rle_gen_exp_chirp(pulse_rle_t* rle, size_t total_bits,
+                            double fs_bit, double dur_s,
+                            double f_start_hz, double f_end_hz,
+                            int duty_percent);
+
+/* pulse_analyze と同じ統計を RLE のまま O(周期数) で求める（High の無い窓は飛ばす） */
+void pulse_rle_analyze(const pulse_rle_t* rle, size_t window_bits, pulse_stats_t* st);
+
+/* 展開：cursor の位置から out_bytes 分のバイト列（LSB first）を書く。
+   戻り値は書いたバイト数（末尾で out_bytes 未満, 終わりなら 0） */
+void pulse_rle_cursor_init(pulse_rle_cursor_t* cur, const pulse_rle_t* rle);
+size_t pulse_rle_expand(pulse_rle_cursor_t* cur, uint8_t* out, size_t out_bytes);
+
+/* RLE のまま安全チェックし、送信しながらチャンクごとに展開して書く */
+pulse_result_t pulse_write_rle(pulse_port_t* p, const pulse_rle_t* rle);
+pulse_result_t pulse_check_rle(const pulse_port_t* p, const pulse_rle_t* rle);
+
+/* 同じ RLE を繰り返し送る用：pulse_check_rle が PULSE_OK を返した rle（その後書き換えていないもの）だけを渡す。
+   統計は取り直さない（ポートと長さの確認だけ） */
+pulse_result_t pulse_send_rle(pulse_port_t* p, const pulse_rle_t* rle);
+
+/* パルスのビット列（LSB first）を相関の参照波形にする
+   bits_per_sample ビットずつ平均（例: 10MHz → 1MHz なら 10）して DC を除く。
+   out_len に満たない分は 0 埋め。戻り値は波形のあるサンプル数 */
+size_t pulse_bits_to_wave(const uint8_t* bits, size_t nbytes, int bits_per_sample,
+                          float* out, size_t out_len);
+
 #endif /* PULSE_PORT_H */
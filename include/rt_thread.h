@@ -0,0 +1,58 @@
+#ifndef RT_THREAD_H
+#define RT_THREAD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * rt_thread: 受信・送信スレッドの実時間化と、遅延の記録
+ * ・rt_thread_apply : 呼んだスレッドを SCHED_FIFO（優先度）+ CPU 固定にする
+ *                     権限が無い（CAP_SYS_NICE / rtprio の制限）ときは理由を出して -1（止めはしない）
+ * ・rt_lock_memory  : mlockall（今あるページ + これから確保するページ）。スワップ・遅延割り当てを防ぐ
+ * ・rt_prefault     : バッファ / スタックを先に触ってページフォルトを受信前に済ませる
+ * ・rt_hist         : 遅延のヒストグラム（1us〜 の2倍刻み）。固定長なので埋め込んで使える
+ *                     1つのヒストグラムは1スレッドだけが書く（読むのはスレッドが止まってから）
+ */
+
+/* ---- スケジューリング ---- */
+typedef struct {
+    int      prio;       /* SCHED_FIFO 優先度 1〜99（0 = 通常のまま） */
+    uint64_t cpu_mask;   /* 固定する CPU のビット（0 = 固定しない） */
+} rt_sched_t;
+
+/* 呼んだスレッドに適用。name はメッセージ用。0: OK（何もしない場合も）/ -1: 一部できなかった */
+int rt_thread_apply(const char* name, const rt_sched_t* s);
+
+/* mlockall(MCL_CURRENT | MCL_FUTURE)。0: OK / -1: NG */
+int rt_lock_memory(void);
+
+/* ページごとに1バイト書いて実ページを割り当てておく（中身は変えない） */
+void rt_prefault(void* p, size_t n);
+
+/* 呼んだスレッドのスタックを bytes だけ先に触る */
+void rt_prefault_stack(size_t bytes);
+
+/* ---- ヒストグラム ---- */
+#define RT_HIST_BUCKETS 32   /* 0: <1us, i: [2^(i-1), 2^i) us, 最後は上限なし */
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns, max_ns;
+    uint64_t bucket[RT_HIST_BUCKETS];
+} rt_hist_t;
+
+void rt_hist_reset(rt_hist_t* h);
+void rt_hist_add(rt_hist_t* h, uint64_t ns);
+
+/* q（0〜1）の点が入っているビンの上端（max_ns を超えない）。空なら 0 */
+uint64_t rt_hist_quantile_ns(const rt_hist_t* h, double q);
+
+/* 1行の要約 + 空でないビンの一覧 */
+void rt_hist_print(FILE* f, const char* name, const rt_hist_t* h);
+
+/* CSV（session,name,lo_us,hi_us,count）で空でないビンを追記。header = 1 なら見出し行から */
+void rt_hist_write_csv(FILE* f, int header, const char* session, const char* name, const rt_hist_t* h);
+
+#endif /* RT_THREAD_H */
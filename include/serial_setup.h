@@ -0,0 +1,45 @@
+#ifndef SERIAL_SETUP_H
+#define SERIAL_SETUP_H
+
+/*
+ * serial_setup: ADC / PULSE / CTRL 共通のシリアル設定
+ * ・raw 8N1, VMIN=0/VTIME=0（待ちは select / poll / epoll 側で行う）
+ * ・標準レート（B9600..B4000000）は termios、それ以外は termios2 + BOTHER
+ * ・ASYNC_LOW_LATENCY（TIOCSSERIAL。pty などで非対応なら -1 と報告）
+ * ・FTDI の latency_timer（/sys/class/tty/<名前>/device/latency_timer があれば）
+ * ・xmit_fifo_size（TIOCSSERIAL で受け付けるドライバのみ）
+ *
+ * カーネルの tty 受信バッファ（flip buffer）自体はユーザから変えられないので、
+ * 受信側は読み手（io_reactor のリング等）を速く回して吸収する。
+ * 設定結果は serial_info_t に読み戻して報告する（要求どおりか確認する用）。
+ */
+
+typedef struct {
+    int baudrate;          /* 例: 115200, 4000000, 3333333 */
+    int low_latency;       /* 1 = ASYNC_LOW_LATENCY を立てる */
+    int ftdi_latency_ms;   /* 1..255 = sysfs に書く / 0 = 触らない */
+    int xmit_fifo_size;    /* >0 = TIOCSSERIAL で要求 / 0 = 触らない */
+} serial_cfg_t;
+
+typedef struct {
+    int baud_actual;       /* 読み戻した速度（不明なら 0） */
+    int custom_baud;       /* 1 = BOTHER で設定した */
+    int low_latency;       /* 1 = 有効 / 0 = 無効 / -1 = 非対応 */
+    int ftdi_latency_ms;   /* 読み戻した値 / -1 = sysfs なし（FTDI 以外, pty） */
+    int xmit_fifo_size;    /* 読み戻した値 / -1 = 非対応 */
+} serial_info_t;
+
+/* ポート用の既定値（config.h の SERIAL_* を使う） */
+void serial_cfg_default(serial_cfg_t* cfg, int baudrate);
+
+/* 開いて設定する（O_RDWR | O_NOCTTY）。info は NULL 可
+   戻り値: fd / 失敗 -1 */
+int serial_open(const char* devpath, const serial_cfg_t* cfg, serial_info_t* info);
+
+/* 開いている fd を設定し直す（0 / -1）。devpath は FTDI sysfs を探す用（NULL 可） */
+int serial_configure(int fd, const char* devpath, const serial_cfg_t* cfg, serial_info_t* info);
+
+/* 1行で報告（例: "ADC /dev/ttyUSB1: baud=4000000(custom) low_latency=on ftdi_latency=1ms"） */
+void serial_info_print(const char* name, const char* devpath, const serial_info_t* info);
+
+#endif /* SERIAL_SETUP_H */
@@ -0,0 +1,60 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+/*
+ * spsc_ring: 書き手1スレッド・読み手1スレッドのバイトリング（ロックなし）
+ * ・大きさは2の累乗（ミラー時はページの倍数にも切り上げ）
+ * ・head（書いた総バイト数, 書き手だけが書く）/ tail（読み終えた総バイト数, 読み手だけが書く）は
+ *   別々のキャッシュラインに置く（互いの書き込みで相手のラインを無効にしない）
+ * ・ミラー（SPSC_RING_MIRROR）：同じ実メモリを仮想アドレス上で2回続けて map する。
+ *   末尾をまたぐ領域も1本の連続したポインタで読み書きできる（フレームを詰め直すコピーが要らない）
+ *   map できない環境では普通の確保に戻る（spsc_ring_mirrored で確認、そのときは2つに分かれる）
+ *
+ * 書き手：spsc_ring_write_space → そこへ直接書く（read(2) / readv(2) の行き先にする）→ spsc_ring_commit
+ * 読み手：spsc_ring_read_avail  → その場で読む（コピーなし）                      → spsc_ring_consume
+ * commit / consume はそれぞれ release で公開し、相手は acquire で読むので、
+ * commit 済みのバイトは読み手から必ず見える。
+ *
+ * 位置は 0 から増え続ける 64bit のストリーム位置（折り返さない）。
+ * spsc_ring_at(pos) でその位置のポインタを得られる（ミラー時は pos から size バイト連続）。
+ */
+
+typedef struct spsc_ring spsc_ring_t;
+
+#define SPSC_RING_MIRROR 1u   /* 二重 map を試みる */
+
+/* bytes 以上の2の累乗で作る（中身は 0 で埋めて実ページまで割り当てる）。失敗は NULL */
+spsc_ring_t* spsc_ring_create(size_t bytes, unsigned flags);
+void spsc_ring_destroy(spsc_ring_t* r);
+
+size_t spsc_ring_size(const spsc_ring_t* r);
+int    spsc_ring_mirrored(const spsc_ring_t* r);   /* 1 = 二重 map できている */
+
+/* ---- 書き手 ---- */
+/* 空きバイト数を返し、書ける場所を iov[0..1] に入れる（ミラー時 / 折り返さないときは iov[1].iov_len = 0） */
+size_t spsc_ring_write_space(spsc_ring_t* r, struct iovec iov[2]);
+/* n バイト書いたことを公開する */
+void spsc_ring_commit(spsc_ring_t* r, size_t n);
+/* コピーして書く（入った分を返す。空きが足りなければ途中まで） */
+size_t spsc_ring_write(spsc_ring_t* r, const void* src, size_t n);
+
+/* ---- 読み手 ---- */
+/* 読めるバイト数を返し、その場所を iov[0..1] に入れる（書き換えないこと） */
+size_t spsc_ring_read_avail(spsc_ring_t* r, struct iovec iov[2]);
+/* 先頭から n バイト読み終えた（書き手に空きとして返す） */
+void spsc_ring_consume(spsc_ring_t* r, size_t n);
+/* ストリーム位置 pos より前を全部読み終えた（間の詰め物ごと返す用。pos は今の tail 以上） */
+void spsc_ring_consume_to(spsc_ring_t* r, uint64_t pos);
+/* コピーして読む（読めた分を返す） */
+size_t spsc_ring_read(spsc_ring_t* r, void* dst, size_t n);
+
+/* ---- 位置 ---- */
+uint64_t spsc_ring_head(const spsc_ring_t* r);   /* 書いた総バイト数（どちらのスレッドからでも読める） */
+uint64_t spsc_ring_tail(const spsc_ring_t* r);   /* 読み終えた総バイト数 */
+uint8_t* spsc_ring_at(const spsc_ring_t* r, uint64_t pos);
+
+#endif /* SPSC_RING_H */
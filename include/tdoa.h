@@ -0,0 +1,50 @@
+#ifndef TDOA_H
+#define TDOA_H
+
+#include <stddef.h>
+
+#include "crosscorr.h"
+
+/*
+ * tdoa: L/R の到達時間差（R - L）を GCC（一般化相互相関）で求める
+ * ・エコーの周りの窓（win 点, Hann）だけを FFT する（全長 FFT はしない）
+ * ・重み：PHAT（位相だけ, 残響に強い）/ PLAIN（普通の相互相関）
+ * ・粗い最大値（±max_lag）→ 放物線補間 or スペクトルから直接 sinc 補間（帯域制限の厳密補間）
+ * ・FFTW プランは crosscorr と同じ方針（plan_mode / wisdom_only, 同じ wisdom ファイル）
+ *
+ * 1つの ctx は1スレッドから使う。
+ */
+
+typedef struct tdoa_ctx tdoa_ctx_t;
+
+typedef enum {
+    TDOA_PHAT  = 0,
+    TDOA_PLAIN = 1
+} tdoa_weight_t;
+
+typedef enum {
+    TDOA_INTERP_SINC      = 0,
+    TDOA_INTERP_PARABOLIC = 1
+} tdoa_interp_t;
+
+typedef struct {
+    double delay_samples;  /* R - L（正 = R が遅い） */
+    double delay_s;
+    float  peak;           /* 正規化した相関の高さ（0..1 目安, 低いと当てにならない） */
+    size_t start;          /* 実際に使った窓の先頭 */
+} tdoa_result_t;
+
+/* win: 窓の点数, fs: サンプリング周波数, f_lo/f_hi: 使う帯域（f_hi <= 0 なら fs/2）
+   opt: NULL なら ESTIMATE */
+tdoa_ctx_t* tdoa_create(int win, double fs, double f_lo, double f_hi, const xcorr_opts_t* opt);
+void tdoa_destroy(tdoa_ctx_t* t);
+
+/* FFT 長（2*win 以上の 2 のべき）。xcorr_wisdom で wisdom を作るとき用 */
+int tdoa_nfft(const tdoa_ctx_t* t);
+
+/* lr: ステレオ（L0 R0 L1 R1 ..., n_frames 組）, center: 窓の中心フレーム
+   max_lag: 探す範囲（±サンプル）。0: OK / -1: NG */
+int tdoa_run(tdoa_ctx_t* t, const float* lr, size_t n_frames, size_t center, int max_lag,
+             tdoa_weight_t w, tdoa_interp_t interp, tdoa_result_t* out);
+
+#endif /* TDOA_H */
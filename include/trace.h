@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * trace: 処理の時刻をスレッドごとのリングに記録し、Chrome trace（JSON）で書き出す
+ * ・記録は自分のスレッドのリングに書くだけ（ロックなし・printf なし・確保なし）。止めている間は1分岐だけ
+ * ・リングが一杯になったら古いものから上書き（最後の events_per_thread 個が残る。dropped で分かる）
+ * ・B / E：同じスレッドの中の区間（入れ子にしてよい）
+ *   b / e：スレッドをまたぐ区間（id で対応。送信 → 最初の受信バイト など）
+ *   i    ：瞬間
+ * ・name はイベント名（文字列リテラル。ポインタだけ覚えるので、書き出すまで残っていること）
+ *   JSON にはそのまま出すので " や \ を含めない
+ * ・書き出した JSON は chrome://tracing か https://ui.perfetto.dev で開く
+ *
+ * 使い方：trace_start → 各スレッドの最初に trace_thread_name（ここでリングを確保して触る）
+ *         → 記録 → スレッドを止めてから trace_write_json → trace_shutdown
+ * trace_thread_name を呼ばないスレッドは最初の記録のときにリングを確保する（そのときだけ malloc）
+ */
+
+/* 記録を始める（前のリングは捨てる）。0: OK / -1: NG */
+int  trace_start(size_t events_per_thread);
+/* 記録を止める（リングは残るので書き出せる） */
+void trace_stop(void);
+int  trace_enabled(void);
+
+/* 呼んだスレッドの名前（"adc" など）。記録中ならリングもここで用意する */
+void trace_thread_name(const char* name);
+
+/* arg は JSON の args.arg に出す（seq・バイト数など） */
+void trace_begin(const char* name, uint32_t arg);
+void trace_end(const char* name, uint32_t arg);
+void trace_instant(const char* name, uint32_t arg);
+void trace_async_begin(const char* name, uint32_t id);
+void trace_async_end(const char* name, uint32_t id);
+
+/* 結果を見てから区間にするかを決める用（EAGAIN の read を残さない など）
+   t0 = trace_now() で始まりを取り、残すときだけ trace_span で B（t0）/ E（今）を書く。止めている間 trace_now は 0 */
+uint64_t trace_now(void);
+void trace_span(const char* name, uint64_t t0, uint32_t arg);
+
+/* 全スレッドのリングを1つの JSON に。書いたイベント数 / -1。記録しているスレッドが止まってから呼ぶ */
+long trace_write_json(const char* path);
+/* 上書きで消えたイベントの数（全スレッドの合計） */
+uint64_t trace_dropped(void);
+
+/* 止めてリングを全部解放する（記録しているスレッドが止まってから） */
+void trace_shutdown(void);
+
+#endif /* TRACE_H */
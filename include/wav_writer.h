@@ -0,0 +1,36 @@
+#ifndef WAV_WRITER_H
+#define WAV_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * wav_writer: 16bit ステレオ WAV のストリーミング書き込み（tools/bin2wav.py の置き換え）
+ * ・受信データ（.bin の [LH, LL, RH, RL]）を届いた分ずつ push → バイト順を入れ替えながら
+ *   ファイルの mmap へ直接書く（中間バッファも、書いた後の読み直しもない）
+ * ・ファイルは reserve_frames 分を先に確保（posix_fallocate）。足りなくなったら倍に広げて張り直す
+ * ・ヘッダは open で仮に書き、close で RIFF / data の大きさを確定して余りを切り詰める
+ * ・確認用のプレビュー（1/D に間引いた WAV）を同時に書ける：D 点平均で間引く簡易なもの
+ *   （帯域外は折り返すので、聞いて様子を見る・波形を眺める用途）
+ *
+ * 1つの writer は1スレッドから使う。
+ */
+
+typedef struct wav_writer wav_writer_t;
+
+/* reserve_frames: 先に確保するフレーム数（0 = 1秒分）。NULL: 失敗 */
+wav_writer_t* wav_writer_open(const char* path, uint32_t sample_rate, uint64_t reserve_frames);
+
+/* プレビューを追加（sample_rate / decim で書く, decim ≥ 2）。最初の push より前に呼ぶ。0: OK / -1: NG */
+int wav_writer_add_preview(wav_writer_t* w, const char* path, uint32_t decim);
+
+/* .bin の生バイト（任意長。端数フレームは次回に持ち越す）/ int16 L/R。0: OK / -1: NG */
+int wav_writer_push_raw(wav_writer_t* w, const uint8_t* raw, size_t nbytes);
+int wav_writer_push_i16(wav_writer_t* w, const int16_t* lr, size_t n_frames);
+
+uint64_t wav_writer_frames(const wav_writer_t* w);
+
+/* ヘッダを確定して閉じる（プレビューも, NULL 可）。0: OK / -1: NG */
+int wav_writer_close(wav_writer_t* w);
+
+#endif /* WAV_WRITER_H */
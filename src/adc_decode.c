@@ -0,0 +1,239 @@
+#include "adc_decode.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ADC_DECODE_X86 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ADC_DECODE_NEON 1
+#endif
+
+/* 1ブロックのフレーム数（int32 の部分和があふれないように区切る: 4096 * 32768 < 2^31） */
+#define SUM_BLOCK_FRAMES 4096u
+
+typedef struct {
+    float g;        /* ゲイン */
+    float bl, br;   /* -dc * gain */
+    int interleaved;
+} dec_param_t;
+
+/* スカラー版（SIMD の端数処理にも使う） */
+static void decode_scalar(const uint8_t* raw, size_t n, float* a, float* b,
+                          const dec_param_t* p, int64_t* sum_l, int64_t* sum_r)
+{
+    int64_t sl = 0, sr = 0;
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t* f = raw + 4*i;
+        int16_t l = (int16_t)(uint16_t)(((unsigned)f[0] << 8) | f[1]);
+        int16_t r = (int16_t)(uint16_t)(((unsigned)f[2] << 8) | f[3]);
+        sl += l;
+        sr += r;
+        float lf = (float)l * p->g + p->bl;
+        float rf = (float)r * p->g + p->br;
+        if (p->interleaved) { a[2*i] = lf; a[2*i+1] = rf; }
+        else                { a[i] = lf;   b[i] = rf; }
+    }
+    *sum_l += sl;
+    *sum_r += sr;
+}
+
+#if defined(ADC_DECODE_X86)
+
+/* SSE2: 16byte = 4フレームずつ */
+static size_t decode_sse2(const uint8_t* raw, size_t n, float* a, float* b,
+                          const dec_param_t* p, int64_t* sum_l, int64_t* sum_r)
+{
+    const __m128 g  = _mm_set1_ps(p->g);
+    const __m128 bl = _mm_set1_ps(p->bl);
+    const __m128 br = _mm_set1_ps(p->br);
+    size_t i = 0;
+
+    while (i + 4 <= n) {
+        size_t end = i + SUM_BLOCK_FRAMES;
+        if (end > n) end = n;
+        __m128i accl = _mm_setzero_si128(), accr = _mm_setzero_si128();
+
+        for (; i + 4 <= end; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(raw + 4*i));
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));   /* BE -> LE */
+            /* 32bit レーン = [L(下位16) | R(上位16)] */
+            __m128i l32 = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+            __m128i r32 = _mm_srai_epi32(v, 16);
+            accl = _mm_add_epi32(accl, l32);
+            accr = _mm_add_epi32(accr, r32);
+
+            __m128 lf = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(l32), g), bl);
+            __m128 rf = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(r32), g), br);
+            if (p->interleaved) {
+                _mm_storeu_ps(a + 2*i,     _mm_unpacklo_ps(lf, rf));
+                _mm_storeu_ps(a + 2*i + 4, _mm_unpackhi_ps(lf, rf));
+            } else {
+                _mm_storeu_ps(a + i, lf);
+                _mm_storeu_ps(b + i, rf);
+            }
+        }
+
+        int32_t tl[4], tr[4];
+        _mm_storeu_si128((__m128i*)tl, accl);
+        _mm_storeu_si128((__m128i*)tr, accr);
+        *sum_l += (int64_t)tl[0] + tl[1] + tl[2] + tl[3];
+        *sum_r += (int64_t)tr[0] + tr[1] + tr[2] + tr[3];
+    }
+    return i;
+}
+
+/* AVX2: 32byte = 8フレームずつ（対応CPUのときだけ呼ぶ） */
+__attribute__((target("avx2")))
+static size_t decode_avx2(const uint8_t* raw, size_t n, float* a, float* b,
+                          const dec_param_t* p, int64_t* sum_l, int64_t* sum_r)
+{
+    const __m256 g  = _mm256_set1_ps(p->g);
+    const __m256 bl = _mm256_set1_ps(p->bl);
+    const __m256 br = _mm256_set1_ps(p->br);
+    const __m256i swap = _mm256_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14,
+                                          1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+    size_t i = 0;
+
+    while (i + 8 <= n) {
+        size_t end = i + SUM_BLOCK_FRAMES;
+        if (end > n) end = n;
+        __m256i accl = _mm256_setzero_si256(), accr = _mm256_setzero_si256();
+
+        for (; i + 8 <= end; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(raw + 4*i));
+            v = _mm256_shuffle_epi8(v, swap);
+            __m256i l32 = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+            __m256i r32 = _mm256_srai_epi32(v, 16);
+            accl = _mm256_add_epi32(accl, l32);
+            accr = _mm256_add_epi32(accr, r32);
+
+            __m256 lf = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(l32), g), bl);
+            __m256 rf = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(r32), g), br);
+            if (p->interleaved) {
+                /* unpack は128bit レーン単位なので最後にレーンを並べ替える */
+                __m256 lo = _mm256_unpacklo_ps(lf, rf);
+                __m256 hi = _mm256_unpackhi_ps(lf, rf);
+                _mm256_storeu_ps(a + 2*i,     _mm256_permute2f128_ps(lo, hi, 0x20));
+                _mm256_storeu_ps(a + 2*i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+            } else {
+                _mm256_storeu_ps(a + i, lf);
+                _mm256_storeu_ps(b + i, rf);
+            }
+        }
+
+        int32_t tl[8], tr[8];
+        _mm256_storeu_si256((__m256i*)tl, accl);
+        _mm256_storeu_si256((__m256i*)tr, accr);
+        for (int k = 0; k < 8; k++) { *sum_l += tl[k]; *sum_r += tr[k]; }
+    }
+    return i;
+}
+
+#elif defined(ADC_DECODE_NEON)
+
+/* NEON: 32byte = 8フレームずつ（vld2 で L/R を分けて読む） */
+static size_t decode_neon(const uint8_t* raw, size_t n, float* a, float* b,
+                          const dec_param_t* p, int64_t* sum_l, int64_t* sum_r)
+{
+    const float32x4_t g  = vdupq_n_f32(p->g);
+    const float32x4_t bl = vdupq_n_f32(p->bl);
+    const float32x4_t br = vdupq_n_f32(p->br);
+    size_t i = 0;
+
+    while (i + 8 <= n) {
+        size_t end = i + SUM_BLOCK_FRAMES;
+        if (end > n) end = n;
+        int32x4_t accl = vdupq_n_s32(0), accr = vdupq_n_s32(0);
+
+        for (; i + 8 <= end; i += 8) {
+            uint16x8x2_t v = vld2q_u16((const uint16_t*)(raw + 4*i));
+            int16x8_t l16 = vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_u16(v.val[0])));
+            int16x8_t r16 = vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_u16(v.val[1])));
+            accl = vpadalq_s16(accl, l16);
+            accr = vpadalq_s16(accr, r16);
+
+            float32x4_t l0 = vmlaq_f32(bl, vcvtq_f32_s32(vmovl_s16(vget_low_s16(l16))),  g);
+            float32x4_t l1 = vmlaq_f32(bl, vcvtq_f32_s32(vmovl_s16(vget_high_s16(l16))), g);
+            float32x4_t r0 = vmlaq_f32(br, vcvtq_f32_s32(vmovl_s16(vget_low_s16(r16))),  g);
+            float32x4_t r1 = vmlaq_f32(br, vcvtq_f32_s32(vmovl_s16(vget_high_s16(r16))), g);
+            if (p->interleaved) {
+                float32x4x2_t o0 = { { l0, r0 } };
+                float32x4x2_t o1 = { { l1, r1 } };
+                vst2q_f32(a + 2*i,     o0);
+                vst2q_f32(a + 2*i + 8, o1);
+            } else {
+                vst1q_f32(a + i,     l0);
+                vst1q_f32(a + i + 4, l1);
+                vst1q_f32(b + i,     r0);
+                vst1q_f32(b + i + 4, r1);
+            }
+        }
+
+        int32_t tl[4], tr[4];
+        vst1q_s32(tl, accl);
+        vst1q_s32(tr, accr);
+        *sum_l += (int64_t)tl[0] + tl[1] + tl[2] + tl[3];
+        *sum_r += (int64_t)tr[0] + tr[1] + tr[2] + tr[3];
+    }
+    return i;
+}
+
+#endif
+
+const char* adc_decode_impl(void)
+{
+#if defined(ADC_DECODE_X86)
+    return __builtin_cpu_supports("avx2") ? "avx2" : "sse2";
+#elif defined(ADC_DECODE_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+static size_t decode(const uint8_t* raw, size_t nbytes, float* a, float* b, int interleaved,
+                     const adc_decode_opt_t* opt, adc_decode_stat_t* st)
+{
+    size_t n = nbytes / 4u;
+
+    dec_param_t p;
+    p.g  = (opt && opt->gain != 0.0f) ? opt->gain : 1.0f;
+    p.bl = opt ? -opt->dc_l * p.g : 0.0f;
+    p.br = opt ? -opt->dc_r * p.g : 0.0f;
+    p.interleaved = interleaved;
+
+    int64_t sl = 0, sr = 0;
+    size_t done = 0;
+
+#if defined(ADC_DECODE_X86)
+    if (__builtin_cpu_supports("avx2")) done = decode_avx2(raw, n, a, b, &p, &sl, &sr);
+    else                                done = decode_sse2(raw, n, a, b, &p, &sl, &sr);
+#elif defined(ADC_DECODE_NEON)
+    done = decode_neon(raw, n, a, b, &p, &sl, &sr);
+#endif
+
+    if (done < n) {
+        if (interleaved) decode_scalar(raw + 4*done, n - done, a + 2*done, NULL, &p, &sl, &sr);
+        else             decode_scalar(raw + 4*done, n - done, a + done, b + done, &p, &sl, &sr);
+    }
+
+    if (st) {
+        st->mean_l = n ? (double)sl / (double)n : 0.0;
+        st->mean_r = n ? (double)sr / (double)n : 0.0;
+    }
+    return n;
+}
+
+size_t adc_decode_planar(const uint8_t* raw, size_t nbytes, float* L, float* R,
+                         const adc_decode_opt_t* opt, adc_decode_stat_t* st)
+{
+    if (!raw || !L || !R) return 0;
+    return decode(raw, nbytes, L, R, 0, opt, st);
+}
+
+size_t adc_decode_interleaved(const uint8_t* raw, size_t nbytes, float* LR,
+                              const adc_decode_opt_t* opt, adc_decode_stat_t* st)
+{
+    if (!raw || !LR) return 0;
+    return decode(raw, nbytes, LR, NULL, 1, opt, st);
+}
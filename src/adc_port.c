@@ -1,63 +1,44 @@
 #include "adc_port.h"
+#include "serial_setup.h"
 
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <termios.h>
 #include <sys/select.h>
+#include <time.h>
 
 struct adc_port {
     int fd;
+    serial_info_t info;   /* 実際に設定できた内容（serial_setup） */
+    rt_hist_t* gap;       /* NULL = 記録しない */
+    uint64_t   t_last;    /* 前にデータが来た時刻（0 = 無し） */
 };
 
-static speed_t baud_to_flag(int baudrate)
+static uint64_t now_ns(void)
 {
-    switch (baudrate) {
-    case 115200: return B115200; 
-    default:     return 0;
-    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
 }
 
 adc_port_t* adc_open(const char* devpath, int baudrate)
 {
     if (!devpath) return NULL;
 
-    speed_t sp = baud_to_flag(baudrate);
-    if (sp == 0) return NULL;
-
-    int fd = open(devpath, O_RDWR | O_NOCTTY );
+    serial_cfg_t cfg;
+    serial_cfg_default(&cfg, baudrate);
+    serial_info_t info;
+    int fd = serial_open(devpath, &cfg, &info);
     if (fd < 0) return NULL;
 
-    struct termios tio;
-    if (tcgetattr(fd, &tio) != 0) {
-        close(fd);
-        return NULL;
-    }
-
-    cfmakeraw(&tio);
-    cfsetispeed(&tio, sp);
-    cfsetospeed(&tio, sp);
-
-    tio.c_cflag |= (CLOCAL | CREAD);
-    tio.c_cflag &= ~PARENB;
-    tio.c_cflag &= ~CSTOPB;
-    tio.c_cflag &= ~CSIZE;
-    tio.c_cflag |= CS8;
-
-    tio.c_cc[VMIN] = 0;
-    tio.c_cc[VTIME] = 0;
-
-    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
-        close(fd);
-        return NULL;
-    }
-
-    adc_port_t* adc = (adc_port_t*)malloc(sizeof(adc_port_t));
+    adc_port_t* adc = (adc_port_t*)calloc(1, sizeof(adc_port_t));
     if (!adc) {
         close(fd);
         return NULL;
     }
     adc->fd = fd;
+    adc->info = info;
     return adc;
 }
 
@@ -68,6 +49,23 @@ void adc_close(adc_port_t* adc)
     free(adc);
 }
 
+const serial_info_t* adc_serial_info(const adc_port_t* adc)
+{
+    return adc ? &adc->info : NULL;
+}
+
+int adc_fd(const adc_port_t* adc)
+{
+    return adc ? adc->fd : -1;
+}
+
+void adc_set_gap_hist(adc_port_t* adc, rt_hist_t* h)
+{
+    if (!adc) return;
+    adc->gap = h;
+    adc->t_last = 0;
+}
+
 adc_result_t adc_flush(adc_port_t* adc)
 {
     if (!adc || adc->fd < 0) return ADC_ERR;
@@ -99,7 +97,37 @@ int adc_read(adc_port_t* adc, uint8_t* buf, size_t len, int timeout_ms)
         if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
         return -1;
     }
+    if (n > 0 && adc->gap) {
+        uint64_t t = now_ns();
+        if (adc->t_last) rt_hist_add(adc->gap, t - adc->t_last);
+        adc->t_last = t;
+    }
     return (int)n;
 }
 
 
+
+int adc_read_exact(adc_port_t* adc, uint8_t* buf, size_t want,
+                   int start_timeout_ms, int idle_timeout_ms)
+{
+    if (!adc || !buf || want == 0) return -1;
+
+    size_t got = 0;
+    adc->t_last = 0;   /* 前のピングからの空きは間隔に数えない */
+
+    /* 1) 開始待ち：最初のデータが来るまで */
+    int n = adc_read(adc, buf, want, start_timeout_ms);
+    if (n < 0) return -1;
+    if (n == 0) return 0;          /* 何も来なかった */
+    got += (size_t)n;
+
+    /* 2) 活動タイムアウト：データが来ている間は継続、途切れたら終了 */
+    while (got < want) {
+        int m = adc_read(adc, buf + got, want - got, idle_timeout_ms);
+        if (m < 0) return -1;
+        if (m == 0) return (int)got;  /* 途中で途切れた */
+        got += (size_t)m;
+    }
+
+    return (int)got;
+}
@@ -0,0 +1,426 @@
+#include "adc_source.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* 実装ごとの関数表 */
+typedef struct {
+    const char* name;
+    void (*close)(adc_source_t* s);
+    adc_result_t (*flush)(adc_source_t* s);
+    adc_result_t (*begin)(adc_source_t* s);
+    int (*read_exact)(adc_source_t* s, uint8_t* buf, size_t want, int start_ms, int idle_ms);
+    int (*read)(adc_source_t* s, uint8_t* buf, size_t len, int timeout_ms);
+    int (*fd)(const adc_source_t* s);
+} adc_source_ops_t;
+
+struct adc_source {
+    const adc_source_ops_t* ops;
+
+    /* tty */
+    adc_port_t* adc;
+    rt_hist_t*  gap;       /* read 間隔の記録先（begin ごとに起点をリセット） */
+
+    /* file / synth 共通：今のピング（メモリ上）と読み出し位置 */
+    const uint8_t* cur;
+    size_t   cur_len;
+    size_t   pos;
+    uint64_t t_begin_ns;
+    double   bps;          /* 0 = 全速 */
+
+    /* file */
+    uint8_t* map;
+    size_t   map_len;
+    size_t   capture_bytes;
+    size_t   next_off;
+    int      loop;
+
+    /* synth */
+    adc_synth_cfg_t syn;
+    float*   clean;        /* エコーだけの波形（L,R 交互, 1回だけ作る） */
+    uint8_t* frame;        /* 今のピングの生データ */
+    float*   noise;        /* 雑音表（NOISE_TABLE_PINGS ピング分, open 時に1回だけ作る） */
+    size_t   noise_len;
+    uint64_t rng;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until_ns(uint64_t t)
+{
+    struct timespec ts;
+    ts.tv_sec  = (time_t)(t / 1000000000ull);
+    ts.tv_nsec = (long)(t % 1000000000ull);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+}
+
+/* ===== tty ===== */
+
+static void tty_close(adc_source_t* s)        { adc_close(s->adc); }
+static adc_result_t tty_flush(adc_source_t* s) { return adc_flush(s->adc); }
+static int tty_fd(const adc_source_t* s)       { return adc_fd(s->adc); }
+
+/* 前のピングからの空きを read 間隔に数えない（adc_read_exact と同じ扱い） */
+static adc_result_t tty_begin(adc_source_t* s)
+{
+    if (s->gap) adc_set_gap_hist(s->adc, s->gap);
+    return ADC_OK;
+}
+
+static int tty_read_exact(adc_source_t* s, uint8_t* buf, size_t want, int start_ms, int idle_ms)
+{
+    return adc_read_exact(s->adc, buf, want, start_ms, idle_ms);
+}
+
+static int tty_read(adc_source_t* s, uint8_t* buf, size_t len, int timeout_ms)
+{
+    return adc_read(s->adc, buf, len, timeout_ms);
+}
+
+static const adc_source_ops_t TTY_OPS = {
+    "tty", tty_close, tty_flush, tty_begin, tty_read_exact, tty_read, tty_fd
+};
+
+adc_source_t* adc_source_open_tty(const char* devpath, int baudrate)
+{
+    adc_port_t* adc = adc_open(devpath, baudrate);
+    if (!adc) return NULL;
+
+    adc_source_t* s = (adc_source_t*)calloc(1, sizeof(*s));
+    if (!s) {
+        adc_close(adc);
+        return NULL;
+    }
+    s->ops = &TTY_OPS;
+    s->adc = adc;
+    return s;
+}
+
+/* ===== メモリ上のピング（file / synth 共通） ===== */
+
+static adc_result_t mem_flush(adc_source_t* s) { (void)s; return ADC_OK; }
+static int mem_fd(const adc_source_t* s)       { (void)s; return -1; }
+
+/* bps > 0 なら「begin から経過した時間分だけ届いている」ように待ってから渡す */
+static int mem_read_exact(adc_source_t* s, uint8_t* buf, size_t want, int start_ms, int idle_ms)
+{
+    (void)start_ms;
+    (void)idle_ms;
+    if (!buf || want == 0) return -1;
+    if (!s->cur || s->pos >= s->cur_len) return 0;   /* 再生終わり */
+
+    size_t n = s->cur_len - s->pos;
+    if (n > want) n = want;
+    if (s->bps > 0.0)
+        sleep_until_ns(s->t_begin_ns + (uint64_t)((double)(s->pos + n) * 1e9 / s->bps));
+
+    memcpy(buf, s->cur + s->pos, n);
+    s->pos += n;
+    return (int)n;
+}
+
+/* 今までに届いている分だけ渡す。まだ何も無ければ MEM_READ_CHUNK 分届くまで待つ
+   （tty の read が USB の転送単位ごとに返るのに合わせる） */
+#define MEM_READ_CHUNK 4096u
+
+static int mem_read(adc_source_t* s, uint8_t* buf, size_t len, int timeout_ms)
+{
+    (void)timeout_ms;
+    if (!buf || len == 0) return -1;
+    if (!s->cur || s->pos >= s->cur_len) return 0;
+
+    size_t n = s->cur_len - s->pos;
+    if (n > len) n = len;
+    if (s->bps > 0.0) {
+        double arrived = (double)(now_ns() - s->t_begin_ns) * 1e-9 * s->bps;
+        size_t have = (arrived > (double)s->pos) ? (size_t)(arrived - (double)s->pos) : 0;
+        if (have == 0) {
+            have = (n < MEM_READ_CHUNK) ? n : MEM_READ_CHUNK;
+            sleep_until_ns(s->t_begin_ns + (uint64_t)((double)(s->pos + have) * 1e9 / s->bps));
+        }
+        if (n > have) n = have;
+    }
+
+    memcpy(buf, s->cur + s->pos, n);
+    s->pos += n;
+    return (int)n;
+}
+
+/* ===== file ===== */
+
+static void file_close(adc_source_t* s)
+{
+    if (s->map) munmap(s->map, s->map_len);
+}
+
+static adc_result_t file_begin(adc_source_t* s)
+{
+    if (s->next_off >= s->map_len) {
+        if (!s->loop) {
+            s->cur = NULL;
+            return ADC_ERR;
+        }
+        s->next_off = 0;
+    }
+    size_t n = s->map_len - s->next_off;
+    if (n > s->capture_bytes) n = s->capture_bytes;
+
+    s->cur = s->map + s->next_off;
+    s->cur_len = n;
+    s->pos = 0;
+    s->next_off += n;
+    s->t_begin_ns = now_ns();
+    return ADC_OK;
+}
+
+static const adc_source_ops_t FILE_OPS = {
+    "file", file_close, mem_flush, file_begin, mem_read_exact, mem_read, mem_fd
+};
+
+adc_source_t* adc_source_open_file(const char* path, size_t capture_bytes,
+                                   double bytes_per_s, int loop)
+{
+    if (!path || capture_bytes == 0) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 4) {
+        fprintf(stderr, "adc_source: %s is empty\n", path);
+        close(fd);
+        return NULL;
+    }
+    size_t len = (size_t)st.st_size;
+    void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    adc_source_t* s = (adc_source_t*)calloc(1, sizeof(*s));
+    if (!s) {
+        munmap(map, len);
+        return NULL;
+    }
+    s->ops = &FILE_OPS;
+    s->map = (uint8_t*)map;
+    s->map_len = len;
+    s->capture_bytes = capture_bytes;
+    s->bps = bytes_per_s;
+    s->loop = loop;
+    return s;
+}
+
+/* ===== synth ===== */
+
+/* xorshift64*（seed 固定で毎回同じ列） */
+static uint64_t rng_next(uint64_t* x)
+{
+    *x ^= *x >> 12;
+    *x ^= *x << 25;
+    *x ^= *x >> 27;
+    return *x * 2685821657736338717ull;
+}
+
+static double rng_uniform(uint64_t* x)
+{
+    return ((double)(rng_next(x) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+/* clean[2*i + ch] に遅延 d（サンプル, 小数可）・時間伸縮 eta（近づくと > 1 で縮む）でチャープを足す（線形補間） */
+static void add_echo(float* clean, size_t n, int ch, const float* chirp, size_t clen,
+                     double d, double amp, double eta)
+{
+    if (amp == 0.0 || d < 0.0 || eta <= 0.0) return;
+    size_t d0 = (size_t)d;
+    double fr = d - (double)d0;
+    for (size_t k = 0; d0 + k < n; k++) {
+        double u = ((double)k - fr) * eta;   /* チャープ上の位置 */
+        double fi = floor(u);
+        if (fi >= (double)clen) break;
+        long i = (long)fi;
+        double f = u - fi;
+        double a = (i >= 0 && (size_t)i < clen) ? chirp[i] : 0.0;
+        double b = (i + 1 >= 0 && (size_t)(i + 1) < clen) ? chirp[i + 1] : 0.0;
+        clean[2 * (d0 + k) + (size_t)ch] += (float)(amp * ((1.0 - f) * a + f * b));
+    }
+}
+
+/* 雑音表の長さ（ピング数）。毎ピング乱数オフセットで切り出すので、
+   Box-Muller をピングごとに回さずに済む（実時間の 4MB/s を軽く超える） */
+#define NOISE_TABLE_PINGS 4
+
+static int16_t clamp16(double v)
+{
+    if (v > 32767.0) return 32767;
+    if (v < -32768.0) return -32768;
+    return (int16_t)lrint(v);
+}
+
+static void synth_close(adc_source_t* s)
+{
+    free(s->clean);
+    free(s->noise);
+    free(s->frame);
+}
+
+/* エコー（固定）+ 雑音表の乱数位置から切り出した雑音で1ピング分を作る */
+static adc_result_t synth_begin(adc_source_t* s)
+{
+    const size_t n = s->syn.capture_bytes / 4u;
+    uint8_t* out = s->frame;
+
+    const float* nz = NULL;
+    if (s->noise) {
+        size_t span = s->noise_len - 2 * n;
+        nz = s->noise + (size_t)(rng_next(&s->rng) % (span + 1)) / 2u * 2u;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        double nl = nz ? nz[2*i]     : 0.0;
+        double nr = nz ? nz[2*i + 1] : 0.0;
+        uint16_t l = (uint16_t)clamp16(s->syn.dc + s->clean[2*i]     + nl);
+        uint16_t rr = (uint16_t)clamp16(s->syn.dc + s->clean[2*i + 1] + nr);
+        out[4*i + 0] = (uint8_t)(l >> 8);
+        out[4*i + 1] = (uint8_t)l;
+        out[4*i + 2] = (uint8_t)(rr >> 8);
+        out[4*i + 3] = (uint8_t)rr;
+    }
+
+    s->cur = s->frame;
+    s->cur_len = n * 4u;
+    s->pos = 0;
+    s->t_begin_ns = now_ns();
+    return ADC_OK;
+}
+
+static const adc_source_ops_t SYNTH_OPS = {
+    "synth", synth_close, mem_flush, synth_begin, mem_read_exact, mem_read, mem_fd
+};
+
+adc_source_t* adc_source_open_synth(const adc_synth_cfg_t* cfg)
+{
+    if (!cfg || !cfg->chirp || cfg->chirp_len == 0 || cfg->fs <= 0.0) return NULL;
+    if (cfg->capture_bytes < 4 || cfg->n_echo < 0 || cfg->n_echo > ADC_SYNTH_MAX_ECHOES) return NULL;
+
+    adc_source_t* s = (adc_source_t*)calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->ops = &SYNTH_OPS;
+    s->syn = *cfg;
+    s->bps = cfg->bytes_per_s;
+    s->rng = cfg->seed ? cfg->seed : 0x9E3779B97F4A7C15ull;
+
+    const size_t n = cfg->capture_bytes / 4u;
+    s->clean = (float*)calloc(2 * n, sizeof(float));
+    s->frame = (uint8_t*)malloc(n * 4u);
+    if (!s->clean || !s->frame) {
+        synth_close(s);
+        free(s);
+        return NULL;
+    }
+
+    double e2 = 0.0;
+    for (size_t k = 0; k < cfg->chirp_len; k++) e2 += (double)cfg->chirp[k] * cfg->chirp[k];
+    double chirp_rms = sqrt(e2 / (double)cfg->chirp_len);
+
+    double amp_max = 0.0;
+    for (int e = 0; e < cfg->n_echo; e++) {
+        const adc_synth_echo_t* ec = &cfg->echo[e];
+        double eta = (SOUND_SPEED_MPS + ec->v_mps) / (SOUND_SPEED_MPS - ec->v_mps);
+        add_echo(s->clean, n, 0, cfg->chirp, cfg->chirp_len, ec->delay_s * cfg->fs, ec->amp_l, eta);
+        add_echo(s->clean, n, 1, cfg->chirp, cfg->chirp_len, (ec->delay_s + ec->itd_s) * cfg->fs, ec->amp_r, eta);
+        if (fabs(ec->amp_l) > amp_max) amp_max = fabs(ec->amp_l);
+        if (fabs(ec->amp_r) > amp_max) amp_max = fabs(ec->amp_r);
+    }
+    double sigma = (amp_max > 0.0) ? amp_max * chirp_rms / pow(10.0, cfg->snr_db / 20.0) : 0.0;
+    if (sigma <= 0.0) return s;
+
+    /* 雑音表（Box-Muller：1回で2つ） */
+    s->noise_len = 2 * n * NOISE_TABLE_PINGS;
+    s->noise = (float*)malloc(sizeof(float) * s->noise_len);
+    if (!s->noise) {
+        synth_close(s);
+        free(s);
+        return NULL;
+    }
+    for (size_t i = 0; i + 1 < s->noise_len; i += 2) {
+        double u1 = rng_uniform(&s->rng), u2 = rng_uniform(&s->rng);
+        double r = sigma * sqrt(-2.0 * log(u1));
+        s->noise[i]     = (float)(r * cos(2.0 * M_PI * u2));
+        s->noise[i + 1] = (float)(r * sin(2.0 * M_PI * u2));
+    }
+    return s;
+}
+
+/* ===== 共通 ===== */
+
+void adc_source_close(adc_source_t* src)
+{
+    if (!src) return;
+    src->ops->close(src);
+    free(src);
+}
+
+const char* adc_source_name(const adc_source_t* src)
+{
+    return src ? src->ops->name : "none";
+}
+
+adc_port_t* adc_source_port(adc_source_t* src)
+{
+    return src ? src->adc : NULL;
+}
+
+adc_result_t adc_source_flush(adc_source_t* src)
+{
+    return src ? src->ops->flush(src) : ADC_ERR;
+}
+
+adc_result_t adc_source_begin(adc_source_t* src)
+{
+    return src ? src->ops->begin(src) : ADC_ERR;
+}
+
+int adc_source_read_exact(adc_source_t* src, uint8_t* buf, size_t want,
+                          int start_timeout_ms, int idle_timeout_ms)
+{
+    if (!src) return -1;
+    return src->ops->read_exact(src, buf, want, start_timeout_ms, idle_timeout_ms);
+}
+
+int adc_source_read(adc_source_t* src, uint8_t* buf, size_t len, int timeout_ms)
+{
+    if (!src) return -1;
+    return src->ops->read(src, buf, len, timeout_ms);
+}
+
+int adc_source_fd(const adc_source_t* src)
+{
+    return src ? src->ops->fd(src) : -1;
+}
+
+void adc_source_set_gap_hist(adc_source_t* src, rt_hist_t* h)
+{
+    if (!src || !src->adc) return;
+    src->gap = h;
+    adc_set_gap_hist(src->adc, h);
+}
@@ -0,0 +1,757 @@
+#include "adcz.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define HDR_BYTES    32u
+#define BLK_HDR      8u    /* u32 n_frames | u32 payload_bytes */
+#define ORDER_LPC    4u    /* 3bit の次数欄：量子化 LPC（0〜3 は固定係数） */
+#define ORDER_RAW    7u    /* 3bit の次数欄：生の 16bit */
+#define LPC_MAX      15    /* 4bit の次数欄 */
+#define RICE_ESC_Q   24u   /* 商がこれ以上なら escape（0 が 24 個 + 1 + 生の残差） */
+#define RICE_ESC_BITS 20   /* 3次の残差 |r| <= 8·32768 → zigzag は 20bit に収まる */
+#define RICE_MAX_K   20u
+
+/* ---------------- LE ---------------- */
+
+static void wr32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static void wr64(uint8_t* p, uint64_t v)
+{
+    wr32(p, (uint32_t)v);
+    wr32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t rd32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t rd64(const uint8_t* p)
+{
+    return (uint64_t)rd32(p) | ((uint64_t)rd32(p + 4) << 32);
+}
+
+/* ---------------- .bin ⇔ int16 ---------------- */
+
+void adcz_raw_to_i16(const uint8_t* raw, size_t n_frames, int16_t* lr)
+{
+    for (size_t i = 0; i < n_frames; i++) {
+        const uint8_t* f = raw + 4 * i;
+        lr[2 * i]     = (int16_t)(uint16_t)(((unsigned)f[0] << 8) | f[1]);
+        lr[2 * i + 1] = (int16_t)(uint16_t)(((unsigned)f[2] << 8) | f[3]);
+    }
+}
+
+void adcz_i16_to_raw(const int16_t* lr, size_t n_frames, uint8_t* raw)
+{
+    for (size_t i = 0; i < n_frames; i++) {
+        uint16_t l = (uint16_t)lr[2 * i], r = (uint16_t)lr[2 * i + 1];
+        uint8_t* f = raw + 4 * i;
+        f[0] = (uint8_t)(l >> 8); f[1] = (uint8_t)l;
+        f[2] = (uint8_t)(r >> 8); f[3] = (uint8_t)r;
+    }
+}
+
+/* ---------------- ビット書き込み（MSB から） ---------------- */
+
+typedef struct {
+    uint8_t* p;
+    size_t   pos, cap;
+    uint64_t acc;
+    int      n;      /* acc に溜まっているビット数（< 8） */
+    int      err;
+} bw_t;
+
+static inline void bw_put(bw_t* b, uint32_t v, int len)   /* len <= 32 */
+{
+    b->acc = (b->acc << len) | v;
+    b->n += len;
+    while (b->n >= 8) {
+        b->n -= 8;
+        if (b->pos < b->cap) b->p[b->pos++] = (uint8_t)(b->acc >> b->n);
+        else b->err = 1;
+    }
+}
+
+static inline void bw_rice(bw_t* b, uint32_t u, unsigned k)
+{
+    uint32_t q = u >> k;
+    if (q >= RICE_ESC_Q) {
+        bw_put(b, 1u, (int)RICE_ESC_Q + 1);
+        bw_put(b, u, RICE_ESC_BITS);
+        return;
+    }
+    /* 0 が q 個 → 1 → 下位 k ビット（q+1+k <= 45 なので2回に分ける） */
+    bw_put(b, 1u, (int)q + 1);
+    if (k) bw_put(b, u & ((1u << k) - 1u), (int)k);
+}
+
+static void bw_align(bw_t* b)
+{
+    if (b->n) bw_put(b, 0, 8 - b->n);
+}
+
+/* ---------------- ビット読み出し ---------------- */
+
+typedef struct {
+    const uint8_t* p;
+    size_t   pos, len;
+    uint64_t cache;  /* 上位から cb ビットが有効 */
+    int      cb;
+} br_t;
+
+static inline void br_fill(br_t* b)
+{
+    while (b->cb <= 56) {
+        uint64_t v = (b->pos < b->len) ? b->p[b->pos] : 0u;
+        b->pos++;
+        b->cache |= v << (56 - b->cb);
+        b->cb += 8;
+    }
+}
+
+static inline uint32_t br_get(br_t* b, int len)   /* 1 <= len <= 32 */
+{
+    br_fill(b);
+    uint32_t v = (uint32_t)(b->cache >> (64 - len));
+    b->cache <<= len;
+    b->cb -= len;
+    return v;
+}
+
+static inline int br_rice(br_t* b, unsigned k, uint32_t* u)
+{
+    br_fill(b);
+    if (b->cache == 0) return -1;
+    unsigned z = (unsigned)__builtin_clzll(b->cache);
+    if (z > RICE_ESC_Q) return -1;
+    b->cache <<= z + 1;
+    b->cb -= (int)z + 1;
+    if (z == RICE_ESC_Q) *u = br_get(b, RICE_ESC_BITS);
+    else                 *u = (z << k) | (k ? br_get(b, (int)k) : 0u);
+    return 0;
+}
+
+/* 読んだ位置がデータの中に収まっているか */
+static int br_ok(const br_t* b)
+{
+    return (b->pos * 8u - (size_t)b->cb) <= b->len * 8u;
+}
+
+/* ---------------- 予測 ---------------- */
+
+static inline uint32_t zigzag(int32_t r)   { return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31); }
+static inline int32_t  unzigzag(uint32_t u) { return (int32_t)(u >> 1) ^ -(int32_t)(u & 1u); }
+
+/* 固定係数：1次 x-x1, 2次 x-2x1+x2, 3次 x-3x1+3x2-x3 */
+static inline int32_t predict(unsigned order, const int32_t* x, size_t i)
+{
+    switch (order) {
+    case 1:  return x[i - 1];
+    case 2:  return 2 * x[i - 1] - x[i - 2];
+    case 3:  return 3 * x[i - 1] - 3 * x[i - 2] + x[i - 3];
+    default: return 0;
+    }
+}
+
+/* ブロックの自己相関から Levinson-Durbin で p 次の係数を作り、16bit に量子化する
+   （予測 = Σ c[j]·x[i-1-j] >> shift）。作れなければ -1 */
+static int lpc_design(const int32_t* x, size_t n, int p, int16_t* c, unsigned* shift)
+{
+    double R[LPC_MAX + 1], a[LPC_MAX + 1], t[LPC_MAX + 1];
+    for (int k = 0; k <= p; k++) {
+        double acc = 0.0;
+        for (size_t i = (size_t)k; i < n; i++) acc += (double)x[i] * (double)x[i - (size_t)k];
+        R[k] = acc;
+    }
+    if (R[0] <= 0.0) return -1;
+    R[0] *= 1.0 + 1e-9;   /* 白色雑音を少し足して条件を良くする */
+
+    double e = R[0];
+    memset(a, 0, sizeof(a));
+    for (int i = 1; i <= p; i++) {
+        double acc = R[i];
+        for (int j = 1; j < i; j++) acc -= a[j] * R[i - j];
+        double k = acc / e;
+        memcpy(t, a, sizeof(a));
+        for (int j = 1; j < i; j++) a[j] = t[j] - k * t[i - j];
+        a[i] = k;
+        e *= 1.0 - k * k;
+        if (e <= 0.0) return -1;
+    }
+
+    double amax = 0.0;
+    for (int j = 1; j <= p; j++) amax = fmax(amax, fabs(a[j]));
+    unsigned s = 15;
+    while (s > 0 && amax * (double)(1u << s) >= 32767.0) s--;
+    if (amax * (double)(1u << s) >= 32767.0) return -1;
+    for (int j = 0; j < p; j++) c[j] = (int16_t)lrint(a[j + 1] * (double)(1u << s));
+    *shift = s;
+    return 0;
+}
+
+static inline int32_t lpc_predict(const int16_t* c, int p, unsigned shift, const int32_t* x, size_t i)
+{
+    int64_t acc = 0;
+    for (int j = 0; j < p; j++) acc += (int64_t)c[j] * x[i - 1 - (size_t)j];
+    return (int32_t)(acc >> shift);
+}
+
+static unsigned part_log2(void)
+{
+    unsigned p2 = 0;
+    while ((1u << (p2 + 1)) <= (unsigned)ADCZ_RICE_PARTITION && p2 < 15) p2++;
+    return p2;
+}
+
+/* 1チャンネル分。戻り値：1 = 生のまま持った */
+static int encode_channel(bw_t* b, const int16_t* lr, size_t n, int32_t* x, uint32_t* u, unsigned p2)
+{
+    for (size_t i = 0; i < n; i++) x[i] = lr[2 * i];
+
+    /* 次数ごとの |残差| の和（差分を重ねるだけなので1パス） */
+    uint64_t sum[4] = { 0, 0, 0, 0 };
+    int32_t d1p = 0, d2p = 0;
+    for (size_t i = 0; i < n; i++) {
+        int32_t d0 = x[i];
+        int32_t d1 = (i >= 1) ? d0 - x[i - 1] : 0;
+        int32_t d2 = (i >= 2) ? d1 - d1p : 0;
+        int32_t d3 = (i >= 3) ? d2 - d2p : 0;
+        if (i >= 3) {
+            sum[0] += zigzag(d0);
+            sum[1] += zigzag(d1);
+            sum[2] += zigzag(d2);
+            sum[3] += zigzag(d3);
+        }
+        d1p = d1;
+        d2p = d2;
+    }
+    unsigned order = 0;
+    for (unsigned o = 1; o < 4; o++)
+        if (sum[o] < sum[order]) order = o;
+    if (n <= order) order = 0;
+
+    /* LPC の方が |残差| の和が小さければそちら（帯域の狭いチャープは固定係数では取り切れない） */
+    int16_t c[LPC_MAX];
+    unsigned shift = 0;
+    int p = (ADCZ_LPC_ORDER > LPC_MAX) ? LPC_MAX : ADCZ_LPC_ORDER;
+    int use_lpc = 0;
+    if (p > 0 && n >= 64 && lpc_design(x, n, p, c, &shift) == 0) {
+        uint64_t sl = 0;
+        use_lpc = 1;
+        for (size_t i = (size_t)p; i < n && use_lpc; i++) {
+            int32_t r = x[i] - lpc_predict(c, p, shift, x, i);
+            if (r <= -(1 << 19) || r >= (1 << 19)) use_lpc = 0;   /* escape に入らない */
+            u[i] = zigzag(r);
+            sl += u[i];
+        }
+        /* 係数欄の分（p × 16bit）も見込む */
+        if (use_lpc && sl + (uint64_t)p * 16u >= sum[order]) use_lpc = 0;
+    }
+
+    bw_t save = *b;
+    if (use_lpc) {
+        bw_put(b, ORDER_LPC, 3);
+        bw_put(b, (uint32_t)p, 4);
+        bw_put(b, shift, 4);
+        for (int j = 0; j < p; j++) bw_put(b, (uint16_t)c[j], 16);
+        order = (unsigned)p;
+    } else {
+        bw_put(b, order, 3);
+        for (size_t i = order; i < n; i++) u[i] = zigzag(x[i] - predict(order, x, i));
+    }
+    for (size_t i = 0; i < order; i++) bw_put(b, (uint16_t)x[i], 16);
+
+    const size_t P = (size_t)1 << p2;
+    for (size_t s = 0; s < n; s += P) {
+        size_t e = (s + P < n) ? s + P : n;
+        size_t s0 = (s < order) ? order : s;
+        uint64_t acc = 0;
+        for (size_t i = s0; i < e; i++) acc += u[i];
+        size_t cnt = (e > s0) ? e - s0 : 0;
+        /* 平均 ≒ 2^(k+1) になる k（FLAC と同じ見積もり） */
+        unsigned k = 0;
+        while (k < RICE_MAX_K && ((uint64_t)cnt << (k + 1)) < acc) k++;
+        bw_put(b, k, 5);
+        for (size_t i = s0; i < e; i++) bw_rice(b, u[i], k);
+    }
+
+    /* 縮まなかったら（雑音だけ・飽和など）生の 16bit で書き直す */
+    size_t used = (b->pos - save.pos) * 8u + (size_t)b->n - (size_t)save.n;
+    if (!b->err && used <= 3u + 16u * n) return 0;
+    int err = save.err;
+    *b = save;
+    b->err = err;
+    bw_put(b, ORDER_RAW, 3);
+    for (size_t i = 0; i < n; i++) bw_put(b, (uint16_t)x[i], 16);
+    return 1;
+}
+
+static size_t encode_block_ex(const int16_t* lr, size_t n, uint8_t* out, size_t cap,
+                              int32_t* x, uint32_t* u, unsigned* n_raw)
+{
+    bw_t b = { out, 0, cap, 0, 0, 0 };
+    unsigned p2 = part_log2();
+    bw_put(&b, p2, 4);
+    unsigned nr = encode_channel(&b, lr, n, x, u, p2);
+    nr += encode_channel(&b, lr + 1, n, x, u, p2);
+    bw_align(&b);
+    if (n_raw) *n_raw = nr;
+    return b.err ? 0 : b.pos;
+}
+
+size_t adcz_block_bound(size_t n_frames)
+{
+    /* 生の 16bit × 2ch + 次数欄・分割の k 欄 + 余裕 */
+    return 4u * n_frames + 16u;
+}
+
+size_t adcz_encode_block(const int16_t* lr, size_t n_frames, uint8_t* out, size_t cap)
+{
+    if (!lr || !out || n_frames == 0) return 0;
+    int32_t* x = (int32_t*)malloc(sizeof(int32_t) * n_frames);
+    uint32_t* u = (uint32_t*)malloc(sizeof(uint32_t) * n_frames);
+    size_t r = (x && u) ? encode_block_ex(lr, n_frames, out, cap, x, u, NULL) : 0;
+    free(x);
+    free(u);
+    return r;
+}
+
+size_t adcz_encode_block_ws(const int16_t* lr, size_t n_frames, uint8_t* out, size_t cap,
+                            int32_t* x, uint32_t* u)
+{
+    if (!lr || !out || !x || !u || n_frames == 0) return 0;
+    return encode_block_ex(lr, n_frames, out, cap, x, u, NULL);
+}
+
+static int decode_lpc(br_t* b, size_t n, unsigned p2, int16_t* out)
+{
+    int p = (int)br_get(b, 4);
+    unsigned shift = br_get(b, 4);
+    if (p == 0 || (size_t)p >= n) return -1;
+    int16_t c[LPC_MAX];
+    for (int j = 0; j < p; j++) c[j] = (int16_t)(uint16_t)br_get(b, 16);
+    for (int i = 0; i < p; i++) out[2 * i] = (int16_t)(uint16_t)br_get(b, 16);
+
+    /* 履歴は出力（stride 2）をそのまま使う */
+    const size_t P = (size_t)1 << p2;
+    for (size_t s = 0; s < n; s += P) {
+        size_t e = (s + P < n) ? s + P : n;
+        size_t s0 = (s < (size_t)p) ? (size_t)p : s;
+        unsigned k = br_get(b, 5);
+        if (k > RICE_MAX_K) return -1;
+        for (size_t i = s0; i < e; i++) {
+            uint32_t uu;
+            if (br_rice(b, k, &uu) != 0) return -1;
+            int64_t acc = 0;
+            for (int j = 0; j < p; j++) acc += (int64_t)c[j] * out[2 * (i - 1 - (size_t)j)];
+            out[2 * i] = (int16_t)((int32_t)(acc >> shift) + unzigzag(uu));
+        }
+    }
+    return 0;
+}
+
+static int decode_channel(br_t* b, size_t n, unsigned p2, int16_t* out)
+{
+    unsigned order = br_get(b, 3);
+    if (order == ORDER_RAW) {
+        for (size_t i = 0; i < n; i++) out[2 * i] = (int16_t)(uint16_t)br_get(b, 16);
+        return 0;
+    }
+    if (order == ORDER_LPC) return decode_lpc(b, n, p2, out);
+    if (order > 3) return -1;
+
+    /* 予測は直前 3 点だけ使うので int32 の小さな窓で回す */
+    int32_t x1 = 0, x2 = 0, x3 = 0;
+    size_t w = (order < n) ? order : n;
+    for (size_t i = 0; i < w; i++) {
+        int32_t v = (int16_t)(uint16_t)br_get(b, 16);
+        out[2 * i] = (int16_t)v;
+        x3 = x2; x2 = x1; x1 = v;
+    }
+
+    const size_t P = (size_t)1 << p2;
+    for (size_t s = 0; s < n; s += P) {
+        size_t e = (s + P < n) ? s + P : n;
+        size_t s0 = (s < order) ? order : s;
+        unsigned k = br_get(b, 5);
+        if (k > RICE_MAX_K) return -1;
+        for (size_t i = s0; i < e; i++) {
+            uint32_t uu;
+            if (br_rice(b, k, &uu) != 0) return -1;
+            int32_t p;
+            switch (order) {
+            case 1:  p = x1; break;
+            case 2:  p = 2 * x1 - x2; break;
+            case 3:  p = 3 * x1 - 3 * x2 + x3; break;
+            default: p = 0; break;
+            }
+            int32_t v = p + unzigzag(uu);
+            out[2 * i] = (int16_t)v;
+            x3 = x2; x2 = x1; x1 = v;
+        }
+    }
+    return 0;
+}
+
+int adcz_decode_block(const uint8_t* in, size_t len, size_t n_frames, int16_t* lr)
+{
+    if (!in || !lr || len == 0 || n_frames == 0) return -1;
+    br_t b = { in, 0, len, 0, 0 };
+    unsigned p2 = br_get(&b, 4);
+    if (decode_channel(&b, n_frames, p2, lr) != 0) return -1;
+    if (decode_channel(&b, n_frames, p2, lr + 1) != 0) return -1;
+    return br_ok(&b) ? 0 : -1;
+}
+
+/* ---------------- writer ---------------- */
+
+struct adcz_writer {
+    FILE*    f;
+    uint32_t fs, bf;
+    int16_t* buf;       /* bf × 2 */
+    size_t   have;      /* buf に溜まったフレーム数 */
+    uint8_t  carry[4];  /* push_raw の端数フレーム */
+    size_t   ncarry;
+    uint8_t* out;
+    size_t   out_cap;
+    int32_t* x;
+    uint32_t* u;
+    uint64_t* idx;
+    size_t   n_idx, idx_cap;
+    uint64_t off;       /* 次に書く位置 */
+    adcz_stats_t st;
+    int      err;
+};
+
+static void write_header(uint8_t* h, uint32_t bf, uint32_t fs, uint64_t total, uint64_t idx_off)
+{
+    memcpy(h, "ADCZ", 4);
+    h[4] = ADCZ_VERSION; h[5] = 0;
+    h[6] = 2; h[7] = 0;
+    wr32(h + 8, bf);
+    wr32(h + 12, fs);
+    wr64(h + 16, total);
+    wr64(h + 24, idx_off);
+}
+
+adcz_writer_t* adcz_writer_open(const char* path, uint32_t sample_rate, uint32_t block_frames)
+{
+    if (!path) return NULL;
+    if (block_frames == 0) block_frames = ADCZ_BLOCK_FRAMES;
+
+    adcz_writer_t* w = (adcz_writer_t*)calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->fs = sample_rate;
+    w->bf = block_frames;
+    w->out_cap = adcz_block_bound(block_frames);
+    w->buf = (int16_t*)malloc(sizeof(int16_t) * 2 * block_frames);
+    w->out = (uint8_t*)malloc(w->out_cap);
+    w->x   = (int32_t*)malloc(sizeof(int32_t) * block_frames);
+    w->u   = (uint32_t*)malloc(sizeof(uint32_t) * block_frames);
+    w->f   = fopen(path, "wb");
+    if (!w->buf || !w->out || !w->x || !w->u || !w->f) {
+        if (!w->f) perror(path);
+        if (w->f) fclose(w->f);
+        free(w->buf); free(w->out); free(w->x); free(w->u);
+        free(w);
+        return NULL;
+    }
+
+    uint8_t h[HDR_BYTES];
+    write_header(h, w->bf, w->fs, 0, 0);   /* 確定は close で（落ちても先頭から辿れる） */
+    if (fwrite(h, 1, sizeof(h), w->f) != sizeof(h)) w->err = 1;
+    w->off = HDR_BYTES;
+    w->st.out_bytes = HDR_BYTES;
+    return w;
+}
+
+static void flush_block(adcz_writer_t* w)
+{
+    if (w->have == 0) return;
+    unsigned nr = 0;
+    size_t pl = encode_block_ex(w->buf, w->have, w->out, w->out_cap, w->x, w->u, &nr);
+    if (pl == 0) { w->err = 1; w->have = 0; return; }
+
+    if (w->n_idx == w->idx_cap) {
+        size_t nc = w->idx_cap ? w->idx_cap * 2 : 256;
+        uint64_t* ni = (uint64_t*)realloc(w->idx, sizeof(uint64_t) * nc);
+        if (!ni) { w->err = 1; w->have = 0; return; }
+        w->idx = ni;
+        w->idx_cap = nc;
+    }
+    w->idx[w->n_idx++] = w->off;
+
+    uint8_t bh[BLK_HDR];
+    wr32(bh, (uint32_t)w->have);
+    wr32(bh + 4, (uint32_t)pl);
+    if (fwrite(bh, 1, BLK_HDR, w->f) != BLK_HDR || fwrite(w->out, 1, pl, w->f) != pl) w->err = 1;
+
+    w->off += BLK_HDR + pl;
+    w->st.out_bytes += BLK_HDR + pl;
+    w->st.blocks++;
+    w->st.verbatim += nr;
+    w->have = 0;
+}
+
+int adcz_writer_push_i16(adcz_writer_t* w, const int16_t* lr, size_t n_frames)
+{
+    if (!w || (!lr && n_frames)) return -1;
+    while (n_frames > 0) {
+        size_t take = w->bf - w->have;
+        if (take > n_frames) take = n_frames;
+        memcpy(w->buf + 2 * w->have, lr, sizeof(int16_t) * 2 * take);
+        w->have += take;
+        lr += 2 * take;
+        n_frames -= take;
+        w->st.frames += take;
+        w->st.in_bytes += 4u * take;
+        if (w->have == w->bf) flush_block(w);
+    }
+    return w->err ? -1 : 0;
+}
+
+int adcz_writer_push_raw(adcz_writer_t* w, const uint8_t* raw, size_t nbytes)
+{
+    if (!w || (!raw && nbytes)) return -1;
+
+    /* 前回の端数フレームを埋める */
+    while (w->ncarry > 0 && nbytes > 0) {
+        w->carry[w->ncarry++] = *raw++;
+        nbytes--;
+        if (w->ncarry == 4) {
+            int16_t f[2];
+            adcz_raw_to_i16(w->carry, 1, f);
+            w->ncarry = 0;
+            if (adcz_writer_push_i16(w, f, 1) != 0) return -1;
+        }
+    }
+    /* ブロックの空きへ直接変換 */
+    size_t frames = nbytes / 4u;
+    while (frames > 0) {
+        size_t take = w->bf - w->have;
+        if (take > frames) take = frames;
+        adcz_raw_to_i16(raw, take, w->buf + 2 * w->have);
+        w->have += take;
+        raw += 4u * take;
+        frames -= take;
+        w->st.frames += take;
+        w->st.in_bytes += 4u * take;
+        if (w->have == w->bf) flush_block(w);
+    }
+    for (size_t i = 0; i < nbytes % 4u; i++) w->carry[w->ncarry++] = raw[i];
+    return w->err ? -1 : 0;
+}
+
+void adcz_writer_get_stats(const adcz_writer_t* w, adcz_stats_t* st)
+{
+    if (!w || !st) return;
+    *st = w->st;
+}
+
+int adcz_writer_close(adcz_writer_t* w, adcz_stats_t* st)
+{
+    if (!w) return 0;
+    flush_block(w);
+
+    /* 4 バイトに満たない端数はフレームにならないので書けない → 捨てたことを返す */
+    w->st.dropped = w->ncarry;
+    if (w->ncarry > 0) w->err = 1;
+
+    /* 索引 → ヘッダ確定 */
+    uint64_t idx_off = w->off;
+    uint8_t ih[8];
+    memcpy(ih, "AIDX", 4);
+    wr32(ih + 4, (uint32_t)w->n_idx);
+    if (fwrite(ih, 1, sizeof(ih), w->f) != sizeof(ih)) w->err = 1;
+    for (size_t i = 0; i < w->n_idx; i++) {
+        uint8_t o[8];
+        wr64(o, w->idx[i]);
+        if (fwrite(o, 1, sizeof(o), w->f) != sizeof(o)) w->err = 1;
+    }
+    uint8_t h[HDR_BYTES];
+    write_header(h, w->bf, w->fs, w->st.frames, idx_off);
+    if (fseek(w->f, 0, SEEK_SET) != 0 || fwrite(h, 1, sizeof(h), w->f) != sizeof(h)) w->err = 1;
+    if (fclose(w->f) != 0) w->err = 1;
+    w->st.out_bytes += sizeof(ih) + 8u * w->n_idx;
+    if (st) *st = w->st;
+
+    int rc = w->err ? -1 : 0;
+    free(w->buf);
+    free(w->out);
+    free(w->x);
+    free(w->u);
+    free(w->idx);
+    free(w);
+    return rc;
+}
+
+/* ---------------- reader ---------------- */
+
+struct adcz_reader {
+    uint8_t*  map;
+    size_t    len;
+    adcz_info_t info;
+    uint64_t* off;      /* ブロック先頭（ブロックヘッダの位置） */
+    int16_t*  tmp;      /* read_raw 用：最後に復号したブロック */
+    size_t    tmp_blk;
+    int       tmp_n;
+};
+
+/* 索引が使えるか確かめて読む */
+static int load_index(adcz_reader_t* r, uint64_t io)
+{
+    if (io < HDR_BYTES || io + 8 > r->len || memcmp(r->map + io, "AIDX", 4) != 0) return -1;
+    uint32_t nb = rd32(r->map + io + 4);
+    if ((uint64_t)nb * 8u > r->len - io - 8) return -1;
+    r->off = (uint64_t*)malloc(sizeof(uint64_t) * (nb ? nb : 1));
+    if (!r->off) return -1;
+    for (uint32_t i = 0; i < nb; i++) {
+        uint64_t o = rd64(r->map + io + 8 + 8u * i);
+        if (o + BLK_HDR > io) { free(r->off); r->off = NULL; return -1; }
+        r->off[i] = o;
+    }
+    r->info.n_blocks = nb;
+    r->info.indexed = 1;
+    return 0;
+}
+
+/* 索引なし：ブロックヘッダを先頭から辿る（最後の書きかけブロックは捨てる） */
+static int scan_blocks(adcz_reader_t* r)
+{
+    size_t cap = 256, n = 0;
+    r->off = (uint64_t*)malloc(sizeof(uint64_t) * cap);
+    if (!r->off) return -1;
+    uint64_t o = HDR_BYTES;
+    while (o + BLK_HDR <= r->len) {
+        uint32_t nf = rd32(r->map + o), pl = rd32(r->map + o + 4);
+        if (nf == 0 || nf > r->info.block_frames || pl == 0 || o + BLK_HDR + pl > r->len) break;
+        if (n == cap) {
+            uint64_t* no = (uint64_t*)realloc(r->off, sizeof(uint64_t) * cap * 2);
+            if (!no) return -1;
+            r->off = no;
+            cap *= 2;
+        }
+        r->off[n++] = o;
+        o += BLK_HDR + pl;
+    }
+    r->info.n_blocks = n;
+    r->info.indexed = 0;
+    return 0;
+}
+
+adcz_reader_t* adcz_reader_open(const char* path)
+{
+    if (!path) return NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < HDR_BYTES) {
+        fprintf(stderr, "adcz: %s is too short\n", path);
+        close(fd);
+        return NULL;
+    }
+    size_t len = (size_t)st.st_size;
+    void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+
+    const uint8_t* h = (const uint8_t*)map;
+    uint32_t bf = rd32(h + 8);
+    if (memcmp(h, "ADCZ", 4) != 0 || h[4] != ADCZ_VERSION || h[6] != 2 || bf == 0) {
+        fprintf(stderr, "adcz: %s is not an adcz v%d file\n", path, ADCZ_VERSION);
+        munmap(map, len);
+        return NULL;
+    }
+
+    adcz_reader_t* r = (adcz_reader_t*)calloc(1, sizeof(*r));
+    if (!r) {
+        munmap(map, len);
+        return NULL;
+    }
+    r->map = (uint8_t*)map;
+    r->len = len;
+    r->info.block_frames = bf;
+    r->info.sample_rate = rd32(h + 12);
+    r->tmp_blk = (size_t)-1;
+
+    if (load_index(r, rd64(h + 24)) != 0 && scan_blocks(r) != 0) {
+        adcz_reader_close(r);
+        return NULL;
+    }
+    for (size_t i = 0; i < r->info.n_blocks; i++)
+        r->info.total_frames += rd32(r->map + r->off[i]);
+
+    r->tmp = (int16_t*)malloc(sizeof(int16_t) * 2 * bf);
+    if (!r->tmp) {
+        adcz_reader_close(r);
+        return NULL;
+    }
+    return r;
+}
+
+void adcz_reader_close(adcz_reader_t* r)
+{
+    if (!r) return;
+    if (r->map) munmap(r->map, r->len);
+    free(r->off);
+    free(r->tmp);
+    free(r);
+}
+
+void adcz_reader_get_info(const adcz_reader_t* r, adcz_info_t* info)
+{
+    if (!r || !info) return;
+    *info = r->info;
+}
+
+int adcz_reader_block(adcz_reader_t* r, size_t i, int16_t* lr)
+{
+    if (!r || !lr || i >= r->info.n_blocks) return -1;
+    uint64_t o = r->off[i];
+    uint32_t nf = rd32(r->map + o), pl = rd32(r->map + o + 4);
+    if (nf == 0 || nf > r->info.block_frames || o + BLK_HDR + pl > r->len) return -1;
+    if (adcz_decode_block(r->map + o + BLK_HDR, pl, nf, lr) != 0) return -1;
+    return (int)nf;
+}
+
+size_t adcz_reader_read_raw(adcz_reader_t* r, uint64_t frame0, size_t n_frames, uint8_t* raw)
+{
+    if (!r || !raw) return 0;
+    const uint64_t bf = r->info.block_frames;
+    size_t done = 0;
+    while (done < n_frames && frame0 < r->info.total_frames) {
+        /* 最後以外のブロックは満杯なので、ブロック番号は割り算で決まる */
+        size_t bi = (size_t)(frame0 / bf);
+        size_t in = (size_t)(frame0 % bf);
+        if (bi != r->tmp_blk) {
+            r->tmp_n = adcz_reader_block(r, bi, r->tmp);
+            r->tmp_blk = (r->tmp_n > 0) ? bi : (size_t)-1;
+            if (r->tmp_n <= 0) break;
+        }
+        if (in >= (size_t)r->tmp_n) break;
+        size_t take = (size_t)r->tmp_n - in;
+        if (take > n_frames - done) take = n_frames - done;
+        adcz_i16_to_raw(r->tmp + 2 * in, take, raw + 4 * done);
+        done += take;
+        frame0 += take;
+    }
+    return done;
+}
@@ -0,0 +1,117 @@
+#define _GNU_SOURCE   /* MAP_HUGETLB / MADV_HUGEPAGE */
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define ARENA_ALIGN_DEFAULT 64u
+#define HUGE_PAGE_BYTES     (2u * 1024u * 1024u)
+
+struct arena {
+    uint8_t* base;
+    size_t   map_len;   /* munmap する長さ */
+    size_t   size;      /* 使える長さ */
+    size_t   used;
+    size_t   high_water;
+    uint64_t n_alloc;
+    uint64_t n_failed;
+    arena_pages_t pages;
+};
+
+static size_t round_up(size_t n, size_t unit)
+{
+    return (n + unit - 1) / unit * unit;
+}
+
+arena_t* arena_create(size_t bytes, unsigned flags)
+{
+    if (bytes == 0) return NULL;
+    arena_t* a = (arena_t*)calloc(1, sizeof(*a));
+    if (!a) return NULL;
+
+    void* m = MAP_FAILED;
+    size_t len = 0;
+#ifdef MAP_HUGETLB
+    if (flags & ARENA_HUGEPAGES) {
+        /* 予約が無い（既定）と ENOMEM で失敗するので、そのときは黙って次へ */
+        len = round_up(bytes, HUGE_PAGE_BYTES);
+        m = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (m != MAP_FAILED) a->pages = ARENA_PAGES_HUGETLB;
+    }
+#endif
+    if (m == MAP_FAILED) {
+        long pg = sysconf(_SC_PAGESIZE);
+        len = round_up(bytes, pg > 0 ? (size_t)pg : 4096u);
+        m = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED) {
+            perror("arena: mmap");
+            free(a);
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        if ((flags & ARENA_HUGEPAGES) && madvise(m, len, MADV_HUGEPAGE) == 0) a->pages = ARENA_PAGES_THP;
+#endif
+    }
+    a->base = (uint8_t*)m;
+    a->map_len = len;
+    a->size = len;
+    /* 全ページを触って実ページを割り当てておく（mmap の無名ページは 0 なので中身は変わらない） */
+    memset(a->base, 0, len);
+    return a;
+}
+
+void arena_destroy(arena_t* a)
+{
+    if (!a) return;
+    munmap(a->base, a->map_len);
+    free(a);
+}
+
+void* arena_alloc(arena_t* a, size_t n, size_t align)
+{
+    if (!a) return NULL;
+    if (align == 0) align = ARENA_ALIGN_DEFAULT;
+    if (align & (align - 1)) return NULL;
+
+    uintptr_t p = ((uintptr_t)a->base + a->used + (align - 1)) & ~(uintptr_t)(align - 1);
+    size_t off = (size_t)(p - (uintptr_t)a->base);
+    if (off > a->size || n > a->size - off) {
+        a->n_failed++;
+        return NULL;
+    }
+    a->used = off + n;
+    if (a->used > a->high_water) a->high_water = a->used;
+    a->n_alloc++;
+    return (void*)p;
+}
+
+int arena_owns(const arena_t* a, const void* p)
+{
+    if (!a || !p) return 0;
+    const uint8_t* q = (const uint8_t*)p;
+    return q >= a->base && q < a->base + a->size;
+}
+
+void arena_get_stats(const arena_t* a, arena_stats_t* st)
+{
+    if (!st) return;
+    memset(st, 0, sizeof(*st));
+    if (!a) return;
+    st->size = a->size;
+    st->used = a->used;
+    st->high_water = a->high_water;
+    st->n_alloc = a->n_alloc;
+    st->n_failed = a->n_failed;
+    st->pages = a->pages;
+}
+
+void arena_print(FILE* f, const char* name, const arena_t* a)
+{
+    if (!f || !a) return;
+    static const char* const PAGES[] = { "normal", "thp", "hugetlb" };
+    fprintf(f, "arena(%s): used=%zuKB high=%zuKB / size=%zuKB allocs=%llu failed=%llu pages=%s\n",
+            name ? name : "?", a->used / 1024u, a->high_water / 1024u, a->size / 1024u,
+            (unsigned long long)a->n_alloc, (unsigned long long)a->n_failed, PAGES[a->pages]);
+}
@@ -0,0 +1,362 @@
+#include "board_sim.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <pthread.h>
+
+#define SIM_CHUNK 16384u   /* 1回の write でまとめて作るフレーム量（バイト） */
+
+struct board_sim {
+    board_sim_cfg_t cfg;
+    int  master[3];
+    int  slave[3];
+    char name[3][64];      /* /dev/pts/N */
+    char link[3][128];     /* symlink（張っていなければ空） */
+
+    pthread_t th;
+    pthread_mutex_t mu;
+    int started;
+    int stop;
+
+    /* ADC 生成（スレッド内だけで触る） */
+    uint64_t seq;          /* 次に作るフレーム番号 */
+    uint64_t budget;       /* ここまで作ってよい（フレーム数, 連続モードは UINT64_MAX） */
+    uint64_t base;         /* t0 の時点で作り終えていたフレーム数 */
+    uint64_t t0_ns;
+    uint64_t next_drop;    /* 次に drop を入れるフレーム番号 */
+    uint64_t next_stall_ns;
+    uint64_t stall_until_ns;
+    uint64_t pulse_last_ns;
+    uint8_t  chunk[SIM_CHUNK];
+    size_t   chunk_off, chunk_len;
+
+    /* CTRL */
+    char     line[128];
+    size_t   line_len;
+    uint32_t sampling_hz;
+
+    board_sim_stats_t st;  /* mu で保護 */
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int set_nonblock(int fd)
+{
+    int fl = fcntl(fd, F_GETFL, 0);
+    if (fl < 0) return -1;
+    return fcntl(fd, F_SETFL, fl | O_NONBLOCK);
+}
+
+static int make_pty(board_sim_t* sim, int k, const char* link)
+{
+    if (openpty(&sim->master[k], &sim->slave[k], sim->name[k], NULL, NULL) != 0) {
+        perror("openpty");
+        return -1;
+    }
+
+    /* 生バイトで通す（エコー・改行変換なし） */
+    struct termios tio;
+    if (tcgetattr(sim->slave[k], &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(sim->slave[k], TCSANOW, &tio);
+    }
+    if (set_nonblock(sim->master[k]) != 0) return -1;
+
+    if (link && *link) {
+        unlink(link);
+        if (symlink(sim->name[k], link) != 0) {
+            perror(link);
+            return -1;
+        }
+        snprintf(sim->link[k], sizeof(sim->link[k]), "%s", link);
+    }
+    return 0;
+}
+
+/* ---------------- ADC ---------------- */
+
+static uint64_t frames_due(board_sim_t* sim, uint64_t t)
+{
+    double bps = sim->cfg.adc_bytes_per_s;
+    uint64_t due = sim->base + (uint64_t)((double)(t - sim->t0_ns) * 1e-9 * bps / 4.0);
+    return (due < sim->budget) ? due : sim->budget;
+}
+
+/* seq から n フレームを飛ばす（drop / overrun 共通） */
+static void skip_frames(board_sim_t* sim, uint64_t n, uint64_t* counter)
+{
+    sim->seq += n;
+    pthread_mutex_lock(&sim->mu);
+    *counter += n * 4u;
+    pthread_mutex_unlock(&sim->mu);
+}
+
+/* chunk を作る: next_drop をまたがない範囲で最大 SIM_CHUNK */
+static void fill_chunk(board_sim_t* sim, uint64_t due)
+{
+    const board_sim_cfg_t* c = &sim->cfg;
+    uint64_t drop_every = c->drop_every_bytes / 4u;
+    uint64_t drop_n = (c->drop_bytes + 3u) / 4u;
+
+    if (drop_every > 0 && drop_n > 0 && sim->seq >= sim->next_drop) {
+        skip_frames(sim, drop_n, &sim->st.adc_dropped);
+        sim->next_drop += drop_every + drop_n;
+    }
+
+    uint64_t n = (due > sim->seq) ? due - sim->seq : 0;
+    if (n > SIM_CHUNK / 4u) n = SIM_CHUNK / 4u;
+    if (drop_every > 0 && drop_n > 0 && sim->seq + n > sim->next_drop)
+        n = sim->next_drop - sim->seq;
+
+    for (uint64_t i = 0; i < n; i++) {
+        uint32_t v = (uint32_t)(sim->seq + i);
+        uint8_t* f = sim->chunk + 4u * i;
+        f[0] = (uint8_t)(v >> 24);
+        f[1] = (uint8_t)(v >> 16);
+        f[2] = (uint8_t)(v >> 8);
+        f[3] = (uint8_t)v;
+    }
+    sim->seq += n;
+    sim->chunk_off = 0;
+    sim->chunk_len = (size_t)n * 4u;
+}
+
+static void adc_pump(board_sim_t* sim, uint64_t t)
+{
+    const board_sim_cfg_t* c = &sim->cfg;
+
+    /* 止めている間も時間は進む（あとでまとめて出る / FIFO を超えた分は捨てる） */
+    if (c->stall_every_ms > 0 && c->stall_ms > 0 && t >= sim->next_stall_ns) {
+        sim->stall_until_ns = t + (uint64_t)c->stall_ms * 1000000ull;
+        sim->next_stall_ns = t + (uint64_t)c->stall_every_ms * 1000000ull;
+        pthread_mutex_lock(&sim->mu);
+        sim->st.stalls++;
+        pthread_mutex_unlock(&sim->mu);
+    }
+    if (t < sim->stall_until_ns) return;
+
+    uint64_t due = frames_due(sim, t);
+    for (;;) {
+        if (sim->chunk_off == sim->chunk_len) {
+            /* 溜まりすぎた分は基板側 FIFO あふれとして古い順に捨てる */
+            uint64_t fifo = BOARD_SIM_FIFO_BYTES / 4u;
+            if (due > sim->seq + fifo) skip_frames(sim, due - sim->seq - fifo, &sim->st.adc_overrun);
+            if (due <= sim->seq) return;
+            fill_chunk(sim, due);
+            if (sim->chunk_len == 0) continue;
+        }
+
+        ssize_t w = write(sim->master[BOARD_SIM_ADC], sim->chunk + sim->chunk_off,
+                          sim->chunk_len - sim->chunk_off);
+        if (w <= 0) return;   /* EAGAIN: pty が一杯 → 次の tick */
+        sim->chunk_off += (size_t)w;
+        pthread_mutex_lock(&sim->mu);
+        sim->st.adc_bytes += (uint64_t)w;
+        pthread_mutex_unlock(&sim->mu);
+    }
+}
+
+/* ---------------- PULSE ---------------- */
+
+static void pulse_drain(board_sim_t* sim, uint64_t t)
+{
+    uint8_t buf[4096];
+    for (;;) {
+        ssize_t n = read(sim->master[BOARD_SIM_PULSE], buf, sizeof(buf));
+        if (n <= 0) break;
+
+        int new_pulse = (t - sim->pulse_last_ns) >= (uint64_t)BOARD_SIM_PULSE_GAP_MS * 1000000ull;
+        sim->pulse_last_ns = t;
+        if (new_pulse && sim->cfg.capture_bytes > 0) {
+            /* 生成中でなければ今から数え直す */
+            if (frames_due(sim, t) >= sim->budget) {
+                sim->base = sim->budget;
+                sim->t0_ns = t;
+            }
+            sim->budget += sim->cfg.capture_bytes / 4u;
+        }
+
+        pthread_mutex_lock(&sim->mu);
+        sim->st.pulse_bytes += (uint64_t)n;
+        if (new_pulse && sim->cfg.capture_bytes > 0) sim->st.pulses++;
+        pthread_mutex_unlock(&sim->mu);
+    }
+}
+
+/* ---------------- CTRL ---------------- */
+
+static void ctrl_reply(board_sim_t* sim, const char* s)
+{
+    size_t len = strlen(s);
+    if (write(sim->master[BOARD_SIM_CTRL], s, len) != (ssize_t)len)
+        fprintf(stderr, "board_sim: ctrl reply dropped\n");
+}
+
+static void ctrl_command(board_sim_t* sim, char* line)
+{
+    while (*line == ' ') line++;
+    if (*line == '\0') return;
+
+    char out[64];
+    unsigned long v = 0;
+    int has_arg = (sscanf(line + 1, "%lu", &v) == 1);
+
+    pthread_mutex_lock(&sim->mu);
+    sim->st.ctrl_cmds++;
+    switch (line[0]) {
+    case 'g':   /* 返答なし */
+        if (has_arg) sim->st.gain = (uint32_t)v;
+        out[0] = '\0';
+        break;
+    case 'f':
+        if (has_arg && v > 0) sim->sampling_hz = (uint32_t)v;
+        snprintf(out, sizeof(out), "%u\r\n", sim->sampling_hz);
+        break;
+    case 'e':   /* "pulse_err adc_err"（adc_err = 捨てたフレーム数 drop + overrun） */
+        snprintf(out, sizeof(out), "0 %llu\r\n",
+                 (unsigned long long)((sim->st.adc_overrun + sim->st.adc_dropped) / 4u));
+        break;
+    default:    /* b / t などは受け流す */
+        out[0] = '\0';
+        break;
+    }
+    pthread_mutex_unlock(&sim->mu);
+
+    if (out[0]) ctrl_reply(sim, out);
+}
+
+static void ctrl_drain(board_sim_t* sim)
+{
+    char buf[256];
+    for (;;) {
+        ssize_t n = read(sim->master[BOARD_SIM_CTRL], buf, sizeof(buf));
+        if (n <= 0) break;
+
+        for (ssize_t i = 0; i < n; i++) {
+            char ch = buf[i];
+            if ((unsigned char)ch == 0x05) {   /* ENQ → ACK（行の途中でも即答） */
+                ctrl_reply(sim, "\x06");
+                continue;
+            }
+            if (ch == '\r' || ch == '\n') {
+                sim->line[sim->line_len] = '\0';
+                ctrl_command(sim, sim->line);
+                sim->line_len = 0;
+                continue;
+            }
+            if (sim->line_len + 1 < sizeof(sim->line)) sim->line[sim->line_len++] = ch;
+        }
+    }
+}
+
+/* ---------------- thread ---------------- */
+
+static void* sim_main(void* arg)
+{
+    board_sim_t* sim = (board_sim_t*)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&sim->mu);
+        int stop = sim->stop;
+        pthread_mutex_unlock(&sim->mu);
+        if (stop) break;
+
+        /* ADC が書けない（pty 一杯）間は POLLOUT で起きる。それ以外は 1ms 刻み */
+        struct pollfd pfd[3];
+        pfd[0].fd = sim->master[BOARD_SIM_ADC];
+        pfd[0].events = (sim->chunk_off < sim->chunk_len) ? POLLOUT : 0;
+        pfd[1].fd = sim->master[BOARD_SIM_PULSE];
+        pfd[1].events = POLLIN;
+        pfd[2].fd = sim->master[BOARD_SIM_CTRL];
+        pfd[2].events = POLLIN;
+        if (poll(pfd, 3, 1) < 0 && errno != EINTR) break;
+
+        uint64_t t = now_ns();
+        if (pfd[1].revents & POLLIN) pulse_drain(sim, t);
+        if (pfd[2].revents & POLLIN) ctrl_drain(sim);
+        adc_pump(sim, t);
+    }
+    return NULL;
+}
+
+board_sim_t* board_sim_start(const board_sim_cfg_t* cfg)
+{
+    if (!cfg) return NULL;
+
+    board_sim_t* sim = (board_sim_t*)calloc(1, sizeof(*sim));
+    if (!sim) return NULL;
+    sim->cfg = *cfg;
+    if (sim->cfg.adc_bytes_per_s <= 0.0) sim->cfg.adc_bytes_per_s = 4e6;
+    sim->sampling_hz = cfg->sampling_hz ? cfg->sampling_hz : 1000000u;
+    for (int k = 0; k < 3; k++) sim->master[k] = sim->slave[k] = -1;
+    pthread_mutex_init(&sim->mu, NULL);
+
+    const char* links[3] = { cfg->adc_link, cfg->pulse_link, cfg->ctrl_link };
+    for (int k = 0; k < 3; k++) {
+        if (make_pty(sim, k, links[k]) != 0) {
+            board_sim_stop(sim);
+            return NULL;
+        }
+    }
+
+    uint64_t t = now_ns();
+    sim->t0_ns = t;
+    sim->budget = (cfg->capture_bytes > 0) ? 0 : UINT64_MAX;
+    sim->next_drop = cfg->drop_every_bytes / 4u;
+    sim->next_stall_ns = t + (uint64_t)cfg->stall_every_ms * 1000000ull;
+
+    if (pthread_create(&sim->th, NULL, sim_main, sim) != 0) {
+        board_sim_stop(sim);
+        return NULL;
+    }
+    sim->started = 1;
+    return sim;
+}
+
+void board_sim_stop(board_sim_t* sim)
+{
+    if (!sim) return;
+
+    if (sim->started) {
+        pthread_mutex_lock(&sim->mu);
+        sim->stop = 1;
+        pthread_mutex_unlock(&sim->mu);
+        pthread_join(sim->th, NULL);
+    }
+
+    for (int k = 0; k < 3; k++) {
+        if (sim->link[k][0]) unlink(sim->link[k]);
+        if (sim->master[k] >= 0) close(sim->master[k]);
+        if (sim->slave[k] >= 0) close(sim->slave[k]);
+    }
+    pthread_mutex_destroy(&sim->mu);
+    free(sim);
+}
+
+const char* board_sim_path(const board_sim_t* sim, board_sim_port_t port)
+{
+    if (!sim || port < BOARD_SIM_ADC || port > BOARD_SIM_CTRL) return NULL;
+    return sim->link[port][0] ? sim->link[port] : sim->name[port];
+}
+
+void board_sim_get_stats(board_sim_t* sim, board_sim_stats_t* st)
+{
+    if (!sim || !st) return;
+    pthread_mutex_lock(&sim->mu);
+    *st = sim->st;
+    pthread_mutex_unlock(&sim->mu);
+}
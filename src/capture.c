@@ -0,0 +1,591 @@
+#include "capture.h"
+#include "adcz.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CAP_MAGIC     "TPCAP01"   /* HEAD の先頭 8 バイト（NUL 込み） */
+#define CHUNK_HDR     16u
+#define HEAD_LEN      136u
+#define PULS_FIXED    64u
+#define PING_FIXED    72u
+#define HEAD_NPINGS   48u         /* HEAD payload 内の位置（close で書き直す） */
+
+#define PING_F_OK       0x1u
+#define PING_F_BEFORE   0x2u
+#define PING_F_AFTER    0x4u
+#define PING_F_ADCZ     0x8u
+
+/* ---------------- LE ---------------- */
+
+static void wr32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static void wr64(uint8_t* p, uint64_t v)
+{
+    wr32(p, (uint32_t)v);
+    wr32(p + 4, (uint32_t)(v >> 32));
+}
+
+static void wrf64(uint8_t* p, double v)
+{
+    uint64_t u;
+    memcpy(&u, &v, sizeof(u));
+    wr64(p, u);
+}
+
+static uint32_t rd32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t rd64(const uint8_t* p)
+{
+    return (uint64_t)rd32(p) | ((uint64_t)rd32(p + 4) << 32);
+}
+
+static double rdf64(const uint8_t* p)
+{
+    uint64_t u = rd64(p);
+    double v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+static uint64_t pad8(uint64_t n) { return (n + 7u) & ~(uint64_t)7u; }
+
+/* ---------------- writer ---------------- */
+
+struct capture_writer {
+    FILE*     f;
+    uint64_t  off;         /* 次のチャンクの位置 */
+    int       compress;
+    uint64_t* pings;       /* PING チャンクの位置 */
+    size_t    n_pings, cap_pings;
+    uint64_t* pulses;
+    size_t    n_pulses, cap_pulses;
+    int16_t*  lr;          /* adcz 用 */
+    int32_t*  zx;          /* adcz の作業領域（ADCZ_BLOCK_FRAMES 個ずつ, open 時に1回だけ確保） */
+    uint32_t* zu;
+    uint8_t*  z;           /* 1ピング分の圧縮データ（capture_bytes 分, open 時に1回だけ確保） */
+    size_t    z_cap;
+    int       err;
+};
+
+static int push_off(uint64_t** a, size_t* n, size_t* cap, uint64_t v)
+{
+    if (*n == *cap) {
+        size_t nc = *cap ? *cap * 2 : 256;
+        uint64_t* na = (uint64_t*)realloc(*a, sizeof(uint64_t) * nc);
+        if (!na) return -1;
+        *a = na;
+        *cap = nc;
+    }
+    (*a)[(*n)++] = v;
+    return 0;
+}
+
+/* チャンク = ヘッダ + 固定部 + 可変部 + 0 埋め */
+static int write_chunk(capture_writer_t* w, const char tag[4], const uint8_t* fixed, size_t flen,
+                       const uint8_t* var, size_t vlen)
+{
+    static const uint8_t zero[8] = { 0 };
+    uint8_t h[CHUNK_HDR];
+    memcpy(h, tag, 4);
+    wr32(h + 4, 0);
+    wr64(h + 8, (uint64_t)(flen + vlen));
+    size_t pad = (size_t)(pad8(flen + vlen) - (flen + vlen));
+    if (fwrite(h, 1, sizeof(h), w->f) != sizeof(h) ||
+        (flen && fwrite(fixed, 1, flen, w->f) != flen) ||
+        (vlen && fwrite(var, 1, vlen, w->f) != vlen) ||
+        (pad && fwrite(zero, 1, pad, w->f) != pad)) {
+        w->err = 1;
+        return -1;
+    }
+    w->off += CHUNK_HDR + pad8(flen + vlen);
+    return 0;
+}
+
+static void head_payload(uint8_t* p, const capture_session_t* s, uint64_t n_pings, uint64_t idx_off)
+{
+    memset(p, 0, HEAD_LEN);
+    memcpy(p, CAP_MAGIC, 8);
+    wr32(p + 8, s->capture_bytes);
+    wr32(p + 12, s->compress ? 1u : 0u);
+    wrf64(p + 16, s->fs_adc);
+    wr64(p + 24, s->t_open_ns);
+    wr64(p + 32, (uint64_t)s->t_open_unix_ns);
+    wr64(p + 40, 0);
+    wr64(p + HEAD_NPINGS, n_pings);
+    wr64(p + HEAD_NPINGS + 8, idx_off);
+    memcpy(p + 64, s->note, sizeof(s->note));
+    p[64 + sizeof(s->note) - 1] = 0;
+}
+
+/* nbytes の受信を adcz ブロック列にしたときの最大長 */
+static size_t z_bound(size_t nbytes)
+{
+    size_t blocks = (nbytes / 4u + ADCZ_BLOCK_FRAMES - 1) / ADCZ_BLOCK_FRAMES;
+    return blocks * (8u + adcz_block_bound(ADCZ_BLOCK_FRAMES)) + 4u;
+}
+
+capture_writer_t* capture_writer_open(const char* path, const capture_session_t* sess)
+{
+    if (!path || !sess) return NULL;
+    capture_writer_t* w = (capture_writer_t*)calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->compress = sess->compress;
+    if (w->compress) {
+        w->lr = (int16_t*)malloc(sizeof(int16_t) * 2 * ADCZ_BLOCK_FRAMES);
+        w->zx = (int32_t*)malloc(sizeof(int32_t) * ADCZ_BLOCK_FRAMES);
+        w->zu = (uint32_t*)malloc(sizeof(uint32_t) * ADCZ_BLOCK_FRAMES);
+        w->z_cap = z_bound(sess->capture_bytes);
+        w->z = (uint8_t*)malloc(w->z_cap);
+    }
+    w->f = fopen(path, "wb");
+    if (!w->f || (w->compress && (!w->lr || !w->zx || !w->zu || !w->z))) {
+        if (!w->f) perror(path);
+        if (w->f) fclose(w->f);
+        free(w->lr);
+        free(w->zx);
+        free(w->zu);
+        free(w->z);
+        free(w);
+        return NULL;
+    }
+
+    uint8_t p[HEAD_LEN];
+    head_payload(p, sess, 0, 0);   /* 件数・索引は close で（落ちても辿って読める） */
+    write_chunk(w, "HEAD", p, sizeof(p), NULL, 0);
+    if (w->err) {
+        capture_writer_close(w);
+        return NULL;
+    }
+    return w;
+}
+
+int capture_writer_add_pulse(capture_writer_t* w, const capture_pulse_t* p)
+{
+    if (!w || !p || (!p->runs && !p->bytes)) return -1;
+    int id = (int)w->n_pulses;
+
+    uint8_t fx[PULS_FIXED];
+    memset(fx, 0, sizeof(fx));
+    wr32(fx, (uint32_t)id);
+    wr32(fx + 4, (uint32_t)p->kind);
+    wrf64(fx + 8, p->fs_bit);
+    wrf64(fx + 16, p->dur_s);
+    wrf64(fx + 24, p->f_start_hz);
+    wrf64(fx + 32, p->f_end_hz);
+    wr32(fx + 40, (uint32_t)p->duty_percent);
+    wr32(fx + 44, p->runs ? 0u : 1u);   /* 0 = RLE, 1 = バイト列 */
+    wr64(fx + 48, (uint64_t)p->n_bytes);
+    wr64(fx + 56, p->runs ? (uint64_t)p->n_runs : 0u);
+
+    uint8_t* var = NULL;
+    size_t vlen;
+    if (p->runs) {
+        vlen = 8u * p->n_runs;
+        var = (uint8_t*)malloc(vlen ? vlen : 1);
+        if (!var) return -1;
+        for (size_t i = 0; i < p->n_runs; i++) {
+            wr32(var + 8 * i, p->runs[i].on);
+            wr32(var + 8 * i + 4, p->runs[i].off);
+        }
+    } else {
+        vlen = p->n_bytes;
+    }
+
+    uint64_t at = w->off;
+    int rc = write_chunk(w, "PULS", fx, sizeof(fx), p->runs ? var : p->bytes, vlen);
+    free(var);
+    if (rc != 0 || push_off(&w->pulses, &w->n_pulses, &w->cap_pulses, at) != 0) return -1;
+    return id;
+}
+
+/* 受信データを adcz ブロック列に：[u32 n_frames | u32 len | payload]... + 端数バイト */
+static size_t compress_ping(capture_writer_t* w, const uint8_t* raw, size_t nbytes)
+{
+    size_t frames = nbytes / 4u;
+    if (z_bound(nbytes) > w->z_cap) return 0;   /* capture_bytes より長い受信は生のまま */
+    size_t o = 0;
+    for (size_t f0 = 0; f0 < frames; f0 += ADCZ_BLOCK_FRAMES) {
+        size_t n = (frames - f0 < ADCZ_BLOCK_FRAMES) ? frames - f0 : ADCZ_BLOCK_FRAMES;
+        adcz_raw_to_i16(raw + 4 * f0, n, w->lr);
+        size_t len = adcz_encode_block_ws(w->lr, n, w->z + o + 8, w->z_cap - o - 8, w->zx, w->zu);
+        if (len == 0) return 0;
+        wr32(w->z + o, (uint32_t)n);
+        wr32(w->z + o + 4, (uint32_t)len);
+        o += 8 + len;
+    }
+    memcpy(w->z + o, raw + 4 * frames, nbytes % 4u);
+    return o + nbytes % 4u;
+}
+
+int capture_writer_add_ping(capture_writer_t* w, const capture_ping_t* rec,
+                            const uint8_t* raw, size_t nbytes)
+{
+    if (!w || !rec || (!raw && nbytes)) return -1;
+
+    const uint8_t* data = raw;
+    size_t dlen = nbytes;
+    int z = 0;
+    if (w->compress && nbytes >= 4) {
+        size_t zl = compress_ping(w, raw, nbytes);
+        if (zl > 0 && zl < nbytes) {
+            data = w->z;
+            dlen = zl;
+            z = 1;
+        }
+    }
+
+    uint32_t flags = (rec->ok ? PING_F_OK : 0u) | (rec->have_err_before ? PING_F_BEFORE : 0u) |
+                     (rec->have_err_after ? PING_F_AFTER : 0u) | (z ? PING_F_ADCZ : 0u);
+    uint8_t fx[PING_FIXED];
+    memset(fx, 0, sizeof(fx));
+    wr64(fx, rec->seq);
+    wr32(fx + 8, (uint32_t)rec->pulse_id);
+    wr32(fx + 12, (uint32_t)rec->gain);
+    wr32(fx + 16, flags);
+    wr32(fx + 20, rec->err_before_pulse);
+    wr32(fx + 24, rec->err_before_adc);
+    wr32(fx + 28, rec->err_after_pulse);
+    wr32(fx + 32, rec->err_after_adc);
+    wr64(fx + 40, rec->t_pulse_ns);
+    wr64(fx + 48, rec->t_done_ns);
+    wr64(fx + 56, (uint64_t)nbytes);
+    wr64(fx + 64, (uint64_t)dlen);
+
+    uint64_t at = w->off;
+    if (write_chunk(w, "PING", fx, sizeof(fx), data, dlen) != 0) return -1;
+    return push_off(&w->pings, &w->n_pings, &w->cap_pings, at);
+}
+
+uint64_t capture_writer_pings(const capture_writer_t* w)
+{
+    return w ? (uint64_t)w->n_pings : 0;
+}
+
+int capture_writer_close(capture_writer_t* w)
+{
+    if (!w) return 0;
+
+    /* INDX：件数 + PING の位置 + PULS の位置 */
+    uint64_t idx_off = w->off;
+    size_t vlen = 8u * (w->n_pings + w->n_pulses);
+    uint8_t fx[16];
+    wr64(fx, (uint64_t)w->n_pings);
+    wr64(fx + 8, (uint64_t)w->n_pulses);
+    uint8_t* var = (uint8_t*)malloc(vlen ? vlen : 1);
+    if (var) {
+        for (size_t i = 0; i < w->n_pings; i++)  wr64(var + 8 * i, w->pings[i]);
+        for (size_t i = 0; i < w->n_pulses; i++) wr64(var + 8 * (w->n_pings + i), w->pulses[i]);
+        write_chunk(w, "INDX", fx, sizeof(fx), var, vlen);
+        free(var);
+
+        /* HEAD の件数と索引の位置だけ書き直す */
+        uint8_t t[16];
+        wr64(t, (uint64_t)w->n_pings);
+        wr64(t + 8, idx_off);
+        if (fseek(w->f, (long)(CHUNK_HDR + HEAD_NPINGS), SEEK_SET) != 0 ||
+            fwrite(t, 1, sizeof(t), w->f) != sizeof(t))
+            w->err = 1;
+    } else {
+        w->err = 1;
+    }
+    if (fclose(w->f) != 0) w->err = 1;
+
+    int rc = w->err ? -1 : 0;
+    free(w->pings);
+    free(w->pulses);
+    free(w->lr);
+    free(w->zx);
+    free(w->zu);
+    free(w->z);
+    free(w);
+    return rc;
+}
+
+/* ---------------- reader ---------------- */
+
+struct capture_reader {
+    uint8_t*  map;
+    size_t    len;
+    capture_session_t sess;
+    uint64_t* pings;
+    size_t    n_pings;
+    capture_pulse_t* pulses;
+    pulse_run_t**    runs;   /* パルスごとの RLE（LE から読み直したもの） */
+    size_t    n_pulses;
+    int       indexed;
+};
+
+/* off のチャンクが丸ごと map に入っているか。payload と長さを返す */
+static const uint8_t* chunk_at(const capture_reader_t* r, uint64_t off, const char* tag, uint64_t* len)
+{
+    if (off + CHUNK_HDR > r->len || off % 8u) return NULL;
+    const uint8_t* h = r->map + off;
+    uint64_t l = rd64(h + 8);
+    if (l > r->len - off - CHUNK_HDR) return NULL;
+    if (tag && memcmp(h, tag, 4) != 0) return NULL;
+    *len = l;
+    return h + CHUNK_HDR;
+}
+
+static int load_index(capture_reader_t* r, uint64_t io)
+{
+    uint64_t len;
+    const uint8_t* p = (io != 0) ? chunk_at(r, io, "INDX", &len) : NULL;
+    if (!p || len < 16) return -1;
+    uint64_t np = rd64(p), nu = rd64(p + 8);
+    if (np > (len - 16) / 8u || nu > (len - 16) / 8u - np) return -1;
+    r->pings = (uint64_t*)malloc(sizeof(uint64_t) * (np ? np : 1));
+    uint64_t* pu = (uint64_t*)malloc(sizeof(uint64_t) * (nu ? nu : 1));
+    if (!r->pings || !pu) {
+        free(pu);
+        return -1;
+    }
+    for (uint64_t i = 0; i < np; i++) r->pings[i] = rd64(p + 16 + 8 * i);
+    for (uint64_t i = 0; i < nu; i++) pu[i] = rd64(p + 16 + 8 * (np + i));
+    r->n_pings = (size_t)np;
+    r->n_pulses = (size_t)nu;
+    r->pulses = (capture_pulse_t*)pu;   /* 位置を一旦ここに置き、load_pulses で読み替える */
+    r->indexed = 1;
+    return 0;
+}
+
+/* 索引なし：HEAD の後ろからチャンクを辿る（途中で切れていたらそこまで） */
+static int scan_chunks(capture_reader_t* r, uint64_t first)
+{
+    size_t cp = 256, cu = 16;
+    r->pings = (uint64_t*)malloc(sizeof(uint64_t) * cp);
+    uint64_t* pu = (uint64_t*)malloc(sizeof(uint64_t) * cu);
+    if (!r->pings || !pu) {
+        free(pu);
+        return -1;
+    }
+    uint64_t off = first, len;
+    const uint8_t* p;
+    while ((p = chunk_at(r, off, NULL, &len)) != NULL) {
+        const uint8_t* tag = p - CHUNK_HDR;
+        if (memcmp(tag, "PING", 4) == 0 && len >= PING_FIXED) {
+            if (push_off(&r->pings, &r->n_pings, &cp, off) != 0) break;
+        } else if (memcmp(tag, "PULS", 4) == 0 && len >= PULS_FIXED) {
+            if (push_off(&pu, &r->n_pulses, &cu, off) != 0) break;
+        }
+        off += CHUNK_HDR + pad8(len);
+    }
+    r->pulses = (capture_pulse_t*)pu;
+    r->indexed = 0;
+    return 0;
+}
+
+/* パルスの位置（一時的に r->pulses に入っている）から定義を読み出す */
+static int load_pulses(capture_reader_t* r)
+{
+    uint64_t* at = (uint64_t*)r->pulses;
+    size_t n = r->n_pulses;
+    r->pulses = (capture_pulse_t*)calloc(n ? n : 1, sizeof(capture_pulse_t));
+    r->runs = (pulse_run_t**)calloc(n ? n : 1, sizeof(pulse_run_t*));
+    if (!r->pulses || !r->runs) {
+        free(at);
+        return -1;
+    }
+    int rc = 0;
+    for (size_t i = 0; i < n && rc == 0; i++) {
+        uint64_t len;
+        const uint8_t* p = chunk_at(r, at[i], "PULS", &len);
+        if (!p || len < PULS_FIXED || rd32(p) != (uint32_t)i) { rc = -1; break; }
+        capture_pulse_t* q = &r->pulses[i];
+        q->kind = (capture_pulse_kind_t)rd32(p + 4);
+        q->fs_bit = rdf64(p + 8);
+        q->dur_s = rdf64(p + 16);
+        q->f_start_hz = rdf64(p + 24);
+        q->f_end_hz = rdf64(p + 32);
+        q->duty_percent = (int)rd32(p + 40);
+        q->n_bytes = (size_t)rd64(p + 48);
+        if (rd32(p + 44) == 0) {
+            uint64_t nr = rd64(p + 56);
+            if (nr > (len - PULS_FIXED) / 8u) { rc = -1; break; }
+            r->runs[i] = (pulse_run_t*)malloc(sizeof(pulse_run_t) * (nr ? nr : 1));
+            if (!r->runs[i]) { rc = -1; break; }
+            for (uint64_t k = 0; k < nr; k++) {
+                r->runs[i][k].on  = rd32(p + PULS_FIXED + 8 * k);
+                r->runs[i][k].off = rd32(p + PULS_FIXED + 8 * k + 4);
+            }
+            q->runs = r->runs[i];
+            q->n_runs = (size_t)nr;
+        } else {
+            if (q->n_bytes > len - PULS_FIXED) { rc = -1; break; }
+            q->bytes = p + PULS_FIXED;
+        }
+    }
+    free(at);
+    return rc;
+}
+
+capture_reader_t* capture_reader_open(const char* path)
+{
+    if (!path) return NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < CHUNK_HDR + HEAD_LEN) {
+        fprintf(stderr, "capture: %s is too short\n", path);
+        close(fd);
+        return NULL;
+    }
+    size_t len = (size_t)st.st_size;
+    void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+
+    capture_reader_t* r = (capture_reader_t*)calloc(1, sizeof(*r));
+    if (!r) {
+        munmap(map, len);
+        return NULL;
+    }
+    r->map = (uint8_t*)map;
+    r->len = len;
+
+    uint64_t hl;
+    const uint8_t* h = chunk_at(r, 0, "HEAD", &hl);
+    if (!h || hl < HEAD_LEN || memcmp(h, CAP_MAGIC, 8) != 0) {
+        fprintf(stderr, "capture: %s is not a capture file\n", path);
+        capture_reader_close(r);
+        return NULL;
+    }
+    r->sess.capture_bytes = rd32(h + 8);
+    r->sess.compress = (int)rd32(h + 12);
+    r->sess.fs_adc = rdf64(h + 16);
+    r->sess.t_open_ns = rd64(h + 24);
+    r->sess.t_open_unix_ns = (int64_t)rd64(h + 32);
+    memcpy(r->sess.note, h + 64, sizeof(r->sess.note));
+    r->sess.note[sizeof(r->sess.note) - 1] = 0;
+
+    if (load_index(r, rd64(h + HEAD_NPINGS + 8)) != 0) {
+        free(r->pings);
+        free(r->pulses);
+        r->pings = NULL;
+        r->pulses = NULL;
+        r->n_pings = r->n_pulses = 0;
+        if (scan_chunks(r, CHUNK_HDR + pad8(hl)) != 0) {
+            capture_reader_close(r);
+            return NULL;
+        }
+    }
+    if (load_pulses(r) != 0) {
+        fprintf(stderr, "capture: %s has a broken pulse definition\n", path);
+        capture_reader_close(r);
+        return NULL;
+    }
+    return r;
+}
+
+void capture_reader_close(capture_reader_t* r)
+{
+    if (!r) return;
+    if (r->map) munmap(r->map, r->len);
+    if (r->runs)
+        for (size_t i = 0; i < r->n_pulses; i++) free(r->runs[i]);
+    free(r->runs);
+    free(r->pulses);
+    free(r->pings);
+    free(r);
+}
+
+void capture_reader_session(const capture_reader_t* r, capture_session_t* sess)
+{
+    if (!r || !sess) return;
+    *sess = r->sess;
+}
+
+size_t capture_reader_pings(const capture_reader_t* r)  { return r ? r->n_pings : 0; }
+size_t capture_reader_pulses(const capture_reader_t* r) { return r ? r->n_pulses : 0; }
+int capture_reader_indexed(const capture_reader_t* r)   { return r ? r->indexed : 0; }
+
+int capture_reader_ping(const capture_reader_t* r, size_t k, capture_ping_t* out)
+{
+    if (!r || !out || k >= r->n_pings) return -1;
+    uint64_t len;
+    const uint8_t* p = chunk_at(r, r->pings[k], "PING", &len);
+    if (!p || len < PING_FIXED) return -1;
+    uint64_t dlen = rd64(p + 64);
+    if (dlen > len - PING_FIXED) return -1;
+
+    uint32_t flags = rd32(p + 16);
+    memset(out, 0, sizeof(*out));
+    out->seq = rd64(p);
+    out->pulse_id = (int)rd32(p + 8);
+    out->gain = (int)rd32(p + 12);
+    out->ok = (flags & PING_F_OK) != 0;
+    out->have_err_before = (flags & PING_F_BEFORE) != 0;
+    out->have_err_after = (flags & PING_F_AFTER) != 0;
+    out->err_before_pulse = rd32(p + 20);
+    out->err_before_adc = rd32(p + 24);
+    out->err_after_pulse = rd32(p + 28);
+    out->err_after_adc = rd32(p + 32);
+    out->t_pulse_ns = rd64(p + 40);
+    out->t_done_ns = rd64(p + 48);
+    out->raw_bytes = (size_t)rd64(p + 56);
+    out->compressed = (flags & PING_F_ADCZ) != 0;
+    out->data = p + PING_FIXED;
+    out->data_len = (size_t)dlen;
+    return 0;
+}
+
+size_t capture_reader_ping_raw(const capture_reader_t* r, size_t k, uint8_t* dst, size_t cap)
+{
+    capture_ping_t pg;
+    if (!dst || capture_reader_ping(r, k, &pg) != 0 || cap < pg.raw_bytes) return 0;
+    if (!pg.compressed) {
+        if (pg.data_len != pg.raw_bytes) return 0;
+        memcpy(dst, pg.data, pg.raw_bytes);
+        return pg.raw_bytes;
+    }
+
+    size_t frames = pg.raw_bytes / 4u, done = 0, o = 0;
+    int16_t* lr = NULL;
+    size_t lr_cap = 0;
+    while (done < frames) {
+        if (o + 8 > pg.data_len) break;
+        size_t n = rd32(pg.data + o), len = rd32(pg.data + o + 4);
+        if (n == 0 || n > frames - done || len > pg.data_len - o - 8) break;
+        if (n > lr_cap) {
+            int16_t* nl = (int16_t*)realloc(lr, sizeof(int16_t) * 2 * n);
+            if (!nl) break;
+            lr = nl;
+            lr_cap = n;
+        }
+        if (adcz_decode_block(pg.data + o + 8, len, n, lr) != 0) break;
+        adcz_i16_to_raw(lr, n, dst + 4 * done);
+        done += n;
+        o += 8 + len;
+    }
+    free(lr);
+    size_t tail = pg.raw_bytes % 4u;
+    if (done != frames || o + tail != pg.data_len) return 0;
+    memcpy(dst + 4 * frames, pg.data + o, tail);
+    return pg.raw_bytes;
+}
+
+int capture_reader_pulse(const capture_reader_t* r, int id, capture_pulse_t* out)
+{
+    if (!r || !out || id < 0 || (size_t)id >= r->n_pulses) return -1;
+    *out = r->pulses[id];
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "crosscorr.h"
+#include "crosscorr_internal.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -7,18 +8,22 @@
 
 struct xcorr_ctx {
     int N;
+    int NH;            /* r2c の片側スペクトル長 N/2+1 */
     double fs, hpf;
     int hpf_bin;
 
-    fftwf_complex *call_in, *call_out;
-    fftwf_complex *rec_in,  *rec_out;
-    fftwf_complex *mix_in,  *mix_out;
-    fftwf_complex *hil_in,  *hil_out;
+    float*         rec_in;    /* 時間領域（実数, N点）。参照信号のFFTにも使い回す */
+    fftwf_complex* call_out;  /* 参照スペクトル（片側, NH点） */
+    fftwf_complex* rec_out;   /* 受信スペクトル（片側, NH点）。ステレオ時は L */
+    fftwf_complex* rec2_out;  /* ステレオ時の R スペクトル（片側, NH点） */
+    fftwf_complex* ana;       /* 解析信号スペクトル → 逆FFT後は I+jQ（N点, in-place） */
+    fftwf_complex* call_cpx;  /* 複素ベースバンド参照のスペクトル（両側, N点）。set_call_complex で確保 */
 
-    fftwf_plan p_call_fwd;
-    fftwf_plan p_rec_fwd;
-    fftwf_plan p_mix_inv;
-    fftwf_plan p_hil_inv;
+    fftwf_plan p_fwd;      /* r2c: rec_in -> rec_out（参照は new-array execute で call_out へ） */
+    fftwf_plan p_ana_inv;  /* c2c backward: ana -> ana */
+    fftwf_plan p_pack_fwd; /* c2c forward: ana -> ana（ステレオ L+jR 詰め込み用） */
+
+    arena_t* arena;        /* バッファの確保先（NULL = fftwf_malloc） */
 };
 
 static inline void conj_mul(const fftwf_complex a, const fftwf_complex b, fftwf_complex y)
@@ -29,47 +34,121 @@ static inline void conj_mul(const fftwf_complex a, const fftwf_complex b, fftwf_
     y[1] = -ai*br + ar*bi;
 }
 
+static unsigned plan_flags(xcorr_plan_mode_t mode)
+{
+    switch (mode) {
+    case XCORR_PLAN_MEASURE: return FFTW_MEASURE;
+    case XCORR_PLAN_PATIENT: return FFTW_PATIENT;
+    default:                 return FFTW_ESTIMATE;
+    }
+}
+
+/* FFT 用バッファ・プラン（tdoa.c / doppler.c も crosscorr_internal.h 経由で同じものを使う） */
+void* xcorr_buf_alloc(arena_t* a, size_t bytes)
+{
+    void* p = a ? arena_alloc(a, bytes, 64) : NULL;
+    return p ? p : fftwf_malloc(bytes);
+}
+
+void xcorr_buf_free(arena_t* a, void* p)
+{
+    if (p && !arena_owns(a, p)) fftwf_free(p);
+}
+
+fftwf_plan xcorr_plan_r2c(int N, float* in, fftwf_complex* out, const xcorr_opts_t* o)
+{
+    fftwf_plan p = NULL;
+    if (o->wisdom_only && o->plan_mode != XCORR_PLAN_ESTIMATE)
+        p = fftwf_plan_dft_r2c_1d(N, in, out, plan_flags(o->plan_mode) | FFTW_WISDOM_ONLY);
+    if (!p)
+        p = fftwf_plan_dft_r2c_1d(N, in, out, o->wisdom_only ? FFTW_ESTIMATE : plan_flags(o->plan_mode));
+    return p;
+}
+
+fftwf_plan xcorr_plan_c2r(int N, fftwf_complex* in, float* out, const xcorr_opts_t* o)
+{
+    fftwf_plan p = NULL;
+    if (o->wisdom_only && o->plan_mode != XCORR_PLAN_ESTIMATE)
+        p = fftwf_plan_dft_c2r_1d(N, in, out, plan_flags(o->plan_mode) | FFTW_WISDOM_ONLY);
+    if (!p)
+        p = fftwf_plan_dft_c2r_1d(N, in, out, o->wisdom_only ? FFTW_ESTIMATE : plan_flags(o->plan_mode));
+    return p;
+}
+
+fftwf_plan xcorr_plan_many_c2c(int N, int howmany, fftwf_complex* io, int sign, const xcorr_opts_t* o)
+{
+    fftwf_plan p = NULL;
+    if (o->wisdom_only && o->plan_mode != XCORR_PLAN_ESTIMATE)
+        p = fftwf_plan_many_dft(1, &N, howmany, io, NULL, 1, N, io, NULL, 1, N, sign,
+                                plan_flags(o->plan_mode) | FFTW_WISDOM_ONLY);
+    if (!p)
+        p = fftwf_plan_many_dft(1, &N, howmany, io, NULL, 1, N, io, NULL, 1, N, sign,
+                                o->wisdom_only ? FFTW_ESTIMATE : plan_flags(o->plan_mode));
+    return p;
+}
+
+static fftwf_plan plan_c2c(int N, fftwf_complex* in, fftwf_complex* out, int sign, const xcorr_opts_t* o)
+{
+    fftwf_plan p = NULL;
+    if (o->wisdom_only && o->plan_mode != XCORR_PLAN_ESTIMATE)
+        p = fftwf_plan_dft_1d(N, in, out, sign, plan_flags(o->plan_mode) | FFTW_WISDOM_ONLY);
+    if (!p)
+        p = fftwf_plan_dft_1d(N, in, out, sign, o->wisdom_only ? FFTW_ESTIMATE : plan_flags(o->plan_mode));
+    return p;
+}
+
 xcorr_ctx_t* xcorr_create(int N, double fs_hz, double hpf_hz)
+{
+    return xcorr_create_ex(N, fs_hz, hpf_hz, NULL);
+}
+
+xcorr_ctx_t* xcorr_create_ex(int N, double fs_hz, double hpf_hz, const xcorr_opts_t* opt)
 {
     if (N <= 0) return NULL;
 
+    xcorr_opts_t o;
+    memset(&o, 0, sizeof(o));
+    if (opt) o = *opt;
+
     xcorr_ctx_t* c = (xcorr_ctx_t*)calloc(1, sizeof(*c));
     if (!c) return NULL;
 
     c->N = N;
+    c->NH = N/2 + 1;
     c->fs = fs_hz;
     c->hpf = hpf_hz;
+    c->arena = o.arena;
 
     c->hpf_bin = (int)ceil((hpf_hz * (double)N) / fs_hz);
     if (c->hpf_bin < 0) c->hpf_bin = 0;
     if (c->hpf_bin > N/2) c->hpf_bin = N/2;
 
     size_t sz = (size_t)N;
-    c->call_in  = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*sz);
-    c->call_out = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*sz);
-    c->rec_in   = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*sz);
-    c->rec_out  = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*sz);
-    c->mix_in   = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*sz);
-    c->mix_out  = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*sz);
-    c->hil_in   = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*sz);
-    c->hil_out  = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*sz);
-
-    if (!c->call_in || !c->call_out || !c->rec_in || !c->rec_out ||
-        !c->mix_in  || !c->mix_out  || !c->hil_in || !c->hil_out) {
+    size_t nh = (size_t)c->NH;
+    c->rec_in   = (float*)xcorr_buf_alloc(c->arena, sizeof(float)*sz);
+    c->call_out = (fftwf_complex*)xcorr_buf_alloc(c->arena, sizeof(fftwf_complex)*nh);
+    c->rec_out  = (fftwf_complex*)xcorr_buf_alloc(c->arena, sizeof(fftwf_complex)*nh);
+    c->rec2_out = (fftwf_complex*)xcorr_buf_alloc(c->arena, sizeof(fftwf_complex)*nh);
+    c->ana      = (fftwf_complex*)xcorr_buf_alloc(c->arena, sizeof(fftwf_complex)*sz);
+
+    if (!c->rec_in || !c->call_out || !c->rec_out || !c->rec2_out || !c->ana) {
         xcorr_destroy(c);
         return NULL;
     }
 
-    c->p_call_fwd = fftwf_plan_dft_1d(N, c->call_in, c->call_out, FFTW_FORWARD, FFTW_ESTIMATE);
-    c->p_rec_fwd  = fftwf_plan_dft_1d(N, c->rec_in,  c->rec_out,  FFTW_FORWARD, FFTW_ESTIMATE);
-    c->p_mix_inv  = fftwf_plan_dft_1d(N, c->mix_in,  c->mix_out,  FFTW_BACKWARD, FFTW_ESTIMATE);
-    c->p_hil_inv  = fftwf_plan_dft_1d(N, c->hil_in,  c->hil_out,  FFTW_BACKWARD, FFTW_ESTIMATE);
+    /* MEASURE/PATIENT は配列を書き潰すので、プラン作成は中身を入れる前に行う */
+    c->p_fwd      = xcorr_plan_r2c(N, c->rec_in, c->rec_out, &o);
+    c->p_ana_inv  = plan_c2c(N, c->ana, c->ana, FFTW_BACKWARD, &o);
+    c->p_pack_fwd = plan_c2c(N, c->ana, c->ana, FFTW_FORWARD, &o);
 
-    if (!c->p_call_fwd || !c->p_rec_fwd || !c->p_mix_inv || !c->p_hil_inv) {
+    if (!c->p_fwd || !c->p_ana_inv || !c->p_pack_fwd) {
         xcorr_destroy(c);
         return NULL;
     }
 
+    /* 参照未設定でも run できるように 0 で埋めておく */
+    memset(c->call_out, 0, sizeof(fftwf_complex)*nh);
+
     return c;
 }
 
@@ -77,83 +156,183 @@ void xcorr_destroy(xcorr_ctx_t* c)
 {
     if (!c) return;
 
-    if (c->p_call_fwd) fftwf_destroy_plan(c->p_call_fwd);
-    if (c->p_rec_fwd)  fftwf_destroy_plan(c->p_rec_fwd);
-    if (c->p_mix_inv)  fftwf_destroy_plan(c->p_mix_inv);
-    if (c->p_hil_inv)  fftwf_destroy_plan(c->p_hil_inv);
+    if (c->p_fwd)     fftwf_destroy_plan(c->p_fwd);
+    if (c->p_ana_inv) fftwf_destroy_plan(c->p_ana_inv);
+    if (c->p_pack_fwd) fftwf_destroy_plan(c->p_pack_fwd);
 
-    if (c->call_in)  fftwf_free(c->call_in);
-    if (c->call_out) fftwf_free(c->call_out);
-    if (c->rec_in)   fftwf_free(c->rec_in);
-    if (c->rec_out)  fftwf_free(c->rec_out);
-    if (c->mix_in)   fftwf_free(c->mix_in);
-    if (c->mix_out)  fftwf_free(c->mix_out);
-    if (c->hil_in)   fftwf_free(c->hil_in);
-    if (c->hil_out)  fftwf_free(c->hil_out);
+    xcorr_buf_free(c->arena, c->rec_in);
+    xcorr_buf_free(c->arena, c->call_out);
+    xcorr_buf_free(c->arena, c->rec_out);
+    xcorr_buf_free(c->arena, c->rec2_out);
+    xcorr_buf_free(c->arena, c->ana);
+    xcorr_buf_free(c->arena, c->call_cpx);
 
     free(c);
 }
 
+int xcorr_wisdom_import(const char* path)
+{
+    if (!path) return -1;
+    return fftwf_import_wisdom_from_filename(path) ? 0 : -1;
+}
+
+int xcorr_wisdom_export(const char* path)
+{
+    if (!path) return -1;
+    return fftwf_export_wisdom_to_filename(path) ? 0 : -1;
+}
+
 int xcorr_set_call_time(xcorr_ctx_t* c, const float* call_time_N)
 {
     if (!c || !call_time_N) return -1;
 
-    for (int i=0;i<c->N;i++) {
-        c->call_in[i][0] = call_time_N[i];
-        c->call_in[i][1] = 0.0f;
-    }
-    fftwf_execute(c->p_call_fwd);
+    if (call_time_N != c->rec_in)
+        memcpy(c->rec_in, call_time_N, sizeof(float)*(size_t)c->N);
+    /* 同じ r2c プランを出力先だけ変えて実行（配列は同じ xcorr_buf_alloc 由来 = 同じ境界） */
+    fftwf_execute_dft_r2c(c->p_fwd, c->rec_in, c->call_out);
     return 0;
 }
 
+/* spec（片側, NH点）× conj(call) → 解析信号スペクトルを作って逆FFTし、|I+jQ| を出す */
+static void envelope_from_half_spectrum(xcorr_ctx_t* c, const fftwf_complex* spec, float* env_out_N)
+{
+    const int N = c->N;
+    const int h = c->hpf_bin;
+    const int half = N/2;
+
+    /* 片側スペクトル Z: Z[0]=M[0], Z[k]=2M[k] (0<k<N/2), Z[N/2]=M[N/2]（N偶数）, 負周波数=0
+       逆FFTの実部 = 相互相関 I、虚部 = そのヒルベルト変換 Q（旧 mix/hil 2本の逆FFTと同値） */
+    for (int k=0;k<=half;k++) {
+        if (k < h) { c->ana[k][0]=0.0f; c->ana[k][1]=0.0f; continue; }
+
+        fftwf_complex mixk;
+        conj_mul(c->call_out[k], spec[k], mixk);
+
+        float w = (k == 0 || (2*k == N)) ? 1.0f : 2.0f;
+        c->ana[k][0] = w * mixk[0];
+        c->ana[k][1] = w * mixk[1];
+    }
+    if (half + 1 < N) memset(c->ana + half + 1, 0, sizeof(fftwf_complex)*(size_t)(N - half - 1));
+
+    fftwf_execute(c->p_ana_inv);
+
+    /* FFTWの逆変換は 1/N が掛からないので正規化 */
+    const float invN = 1.0f / (float)N;
+    for (int i=0;i<N;i++) {
+        float I = c->ana[i][0] * invN;
+        float Q = c->ana[i][1] * invN;
+        env_out_N[i] = sqrtf(I*I + Q*Q);
+    }
+}
+
 int xcorr_run_envelope(xcorr_ctx_t* c, const float* rec_time_N, float* env_out_N)
 {
     if (!c || !rec_time_N || !env_out_N) return -1;
 
+    if (rec_time_N != c->rec_in)
+        memcpy(c->rec_in, rec_time_N, sizeof(float)*(size_t)c->N);
+    fftwf_execute(c->p_fwd);
+
+    envelope_from_half_spectrum(c, c->rec_out, env_out_N);
+    return 0;
+}
+
+float* xcorr_input(xcorr_ctx_t* c)
+{
+    return c ? c->rec_in : NULL;
+}
+
+float* xcorr_stereo_input(xcorr_ctx_t* c)
+{
+    return c ? (float*)c->ana : NULL;
+}
+
+int xcorr_run_envelope_stereo(xcorr_ctx_t* c, const float* rec_L_N, const float* rec_R_N,
+                               float* env_L_N, float* env_R_N)
+{
+    if (!c || !rec_L_N || !rec_R_N || !env_L_N || !env_R_N) return -1;
+
     const int N = c->N;
 
+    /* 2実数を1本の複素FFTで： z = L + jR */
     for (int i=0;i<N;i++) {
-        c->rec_in[i][0] = rec_time_N[i];
-        c->rec_in[i][1] = 0.0f;
+        c->ana[i][0] = rec_L_N[i];
+        c->ana[i][1] = rec_R_N[i];
     }
-    fftwf_execute(c->p_rec_fwd);
+    return xcorr_run_envelope_stereo_packed(c, env_L_N, env_R_N);
+}
 
-    const int h = c->hpf_bin;
+int xcorr_run_envelope_stereo_packed(xcorr_ctx_t* c, float* env_L_N, float* env_R_N)
+{
+    if (!c || !env_L_N || !env_R_N) return -1;
 
-    for (int k=0;k<N;k++) {
-        int pass = (k >= h) && (k <= N - h);
+    const int N = c->N;
 
-        fftwf_complex spc;
-        if (!pass) { spc[0]=0.0f; spc[1]=0.0f; }
-        else { spc[0]=c->rec_out[k][0]; spc[1]=c->rec_out[k][1]; }
+    fftwf_execute(c->p_pack_fwd);
 
-        fftwf_complex mixk;
-        conj_mul(c->call_out[k], spc, mixk);
-
-        c->mix_in[k][0] = mixk[0];
-        c->mix_in[k][1] = mixk[1];
-
-        /* Goと同じ Hilbertペア生成 */
-        if (k <= N/2) {
-            c->hil_in[k][0] =  mixk[1];
-            c->hil_in[k][1] = -mixk[0];
-        } else {
-            c->hil_in[k][0] = -mixk[1];
-            c->hil_in[k][1] =  mixk[0];
-        }
+    /* 分離： L[k] = (Z[k] + conj(Z[N-k]))/2,  R[k] = (Z[k] - conj(Z[N-k]))/(2j) */
+    for (int k=0;k<c->NH;k++) {
+        int nk = (k == 0) ? 0 : N - k;
+        float zr = c->ana[k][0],  zi = c->ana[k][1];
+        float yr = c->ana[nk][0], yi = c->ana[nk][1];
+
+        c->rec_out[k][0]  = 0.5f * (zr + yr);
+        c->rec_out[k][1]  = 0.5f * (zi - yi);
+        c->rec2_out[k][0] = 0.5f * (zi + yi);
+        c->rec2_out[k][1] = 0.5f * (yr - zr);
     }
 
-    fftwf_execute(c->p_mix_inv);
-    fftwf_execute(c->p_hil_inv);
+    /* 参照スペクトル call_out は L/R で共通 */
+    envelope_from_half_spectrum(c, c->rec_out,  env_L_N);
+    envelope_from_half_spectrum(c, c->rec2_out, env_R_N);
+    return 0;
+}
+
+int xcorr_set_call_complex(xcorr_ctx_t* c, const float* call_iq_N)
+{
+    if (!c || !call_iq_N) return -1;
+
+    if (!c->call_cpx) {
+        c->call_cpx = (fftwf_complex*)xcorr_buf_alloc(c->arena, sizeof(fftwf_complex)*(size_t)c->N);
+        if (!c->call_cpx) return -1;
+    }
+    /* 受信と同じ c2c 順変換（ana in-place）を使って、結果を控える */
+    if (call_iq_N != (const float*)c->ana)
+        memcpy(c->ana, call_iq_N, sizeof(fftwf_complex)*(size_t)c->N);
+    fftwf_execute(c->p_pack_fwd);
+    memcpy(c->call_cpx, c->ana, sizeof(fftwf_complex)*(size_t)c->N);
+    return 0;
+}
+
+float* xcorr_complex_input(xcorr_ctx_t* c)
+{
+    return c ? (float*)c->ana : NULL;
+}
+
+int xcorr_run_envelope_complex(xcorr_ctx_t* c, const float* rec_iq_N, float* env_out_N)
+{
+    if (!c || !rec_iq_N || !env_out_N || !c->call_cpx) return -1;
+
+    const int N = c->N;
+    if (rec_iq_N != (const float*)c->ana)
+        memcpy(c->ana, rec_iq_N, sizeof(fftwf_complex)*(size_t)N);
+    fftwf_execute(c->p_pack_fwd);
+
+    /* 入力がもう解析信号なので、両側そのまま conj(call) を掛けて逆FFT（HPF・2倍は不要） */
+    for (int k=0;k<N;k++) {
+        fftwf_complex y;
+        conj_mul(c->call_cpx[k], c->ana[k], y);
+        c->ana[k][0] = y[0];
+        c->ana[k][1] = y[1];
+    }
+    fftwf_execute(c->p_ana_inv);
 
-    /* FFTWの逆変換は 1/N が掛からないので正規化 */
     const float invN = 1.0f / (float)N;
     for (int i=0;i<N;i++) {
-        float I = c->mix_out[i][0] * invN;
-        float Q = c->hil_out[i][0] * invN;
+        float I = c->ana[i][0] * invN;
+        float Q = c->ana[i][1] * invN;
         env_out_N[i] = sqrtf(I*I + Q*Q);
     }
-
     return 0;
 }
 
@@ -171,3 +350,121 @@ size_t xcorr_argmax_range(const float* x, size_t n, size_t i0, size_t i1)
     }
     return mi;
 }
+
+/* ===== ストリーミング（overlap-save） ===== */
+
+struct xcorr_stream {
+    xcorr_ctx_t* c;      /* nfft 点。入力履歴は c->rec_in に直接ためる */
+    int nfft;
+    size_t step;         /* nfft - call_len + 1 */
+    size_t fill;         /* rec_in にたまっている点数 */
+    uint64_t pos;        /* 次に出すラグ */
+    uint64_t total_in;   /* push された総点数 */
+    float* env;          /* nfft 点 */
+    xcorr_stream_cb cb;
+    void* user;
+};
+
+static int pick_nfft(int call_len)
+{
+    int n = 1024;
+    while (n < 4 * call_len) n *= 2;
+    return n;
+}
+
+xcorr_stream_t* xcorr_stream_create(const float* call, int call_len,
+                                    double fs_hz, double hpf_hz, int nfft,
+                                    const xcorr_opts_t* opt,
+                                    xcorr_stream_cb cb, void* user)
+{
+    if (!call || call_len <= 0 || !cb) return NULL;
+    if (nfft <= 0) nfft = pick_nfft(call_len);
+    if (nfft < call_len) return NULL;
+
+    xcorr_stream_t* s = (xcorr_stream_t*)calloc(1, sizeof(*s));
+    if (!s) return NULL;
+
+    s->nfft = nfft;
+    s->step = (size_t)(nfft - call_len + 1);
+    s->cb = cb;
+    s->user = user;
+    s->c = xcorr_create_ex(nfft, fs_hz, hpf_hz, opt);
+    s->env = (float*)malloc(sizeof(float) * (size_t)nfft);
+    if (!s->c || !s->env) {
+        xcorr_stream_destroy(s);
+        return NULL;
+    }
+
+    /* 参照を nfft 点に0埋めしてスペクトルをキャッシュ */
+    float* in = s->c->rec_in;
+    memcpy(in, call, sizeof(float) * (size_t)call_len);
+    memset(in + call_len, 0, sizeof(float) * (size_t)(nfft - call_len));
+    xcorr_set_call_time(s->c, in);
+    s->fill = 0;
+    return s;
+}
+
+void xcorr_stream_destroy(xcorr_stream_t* s)
+{
+    if (!s) return;
+    xcorr_destroy(s->c);
+    free(s->env);
+    free(s);
+}
+
+size_t xcorr_stream_step(const xcorr_stream_t* s)
+{
+    return s ? s->step : 0;
+}
+
+/* rec_in が nfft 点たまった → 1ブロック相関して先頭 emit 点を出し、step 点ずらす */
+static void stream_run_block(xcorr_stream_t* s, size_t emit)
+{
+    float* in = s->c->rec_in;
+
+    /* r2c（out-of-place）は入力を壊さないので、rec_in をそのまま履歴として使える */
+    xcorr_run_envelope(s->c, in, s->env);
+    if (emit > 0) s->cb(s->user, s->pos, s->env, emit);
+    s->pos += emit;
+
+    memmove(in, in + s->step, sizeof(float) * ((size_t)s->nfft - s->step));
+    s->fill -= s->step;
+}
+
+int xcorr_stream_push(xcorr_stream_t* s, const float* x, size_t n)
+{
+    if (!s || (!x && n > 0)) return -1;
+
+    float* in = s->c->rec_in;
+    while (n > 0) {
+        size_t take = (size_t)s->nfft - s->fill;
+        if (take > n) take = n;
+        memcpy(in + s->fill, x, sizeof(float) * take);
+        s->fill += take;
+        s->total_in += take;
+        x += take;
+        n -= take;
+
+        if (s->fill == (size_t)s->nfft) stream_run_block(s, s->step);
+    }
+    return 0;
+}
+
+int xcorr_stream_flush(xcorr_stream_t* s)
+{
+    if (!s) return -1;
+
+    float* in = s->c->rec_in;
+    while (s->pos < s->total_in) {
+        memset(in + s->fill, 0, sizeof(float) * ((size_t)s->nfft - s->fill));
+        s->fill = (size_t)s->nfft;
+
+        uint64_t left = s->total_in - s->pos;
+        stream_run_block(s, (left < s->step) ? (size_t)left : s->step);
+    }
+
+    s->fill = 0;
+    s->pos = 0;
+    s->total_in = 0;
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "ctrl_port.h"
+#include "serial_setup.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -15,51 +16,16 @@ struct ctrl_port {
     char devpath[256];
 };
 
-/* ボーレート変換 受け取ったbaudrateを通信速度として設定 */
-static speed_t baud_to_flag(int baudrate)
-{
-    switch (baudrate) {
-    case 115200: return B115200;
-    default:     return 0;  /* 未対応 */
-    }
-}
-
 ctrl_port_t* ctrl_open(const char* devpath, int baudrate)
 {
     if (!devpath) return NULL;
 
-    speed_t sp = baud_to_flag(baudrate);
-    if (sp == 0) return NULL;
-
     /* PortC: コマンド送受信用なのでノンブロッキングにしない方が扱いやすい */
-    int fd = open(devpath, O_RDWR | O_NOCTTY);
+    serial_cfg_t cfg;
+    serial_cfg_default(&cfg, baudrate);
+    int fd = serial_open(devpath, &cfg, NULL);
     if (fd < 0) return NULL;
 
-    struct termios tio;
-    if (tcgetattr(fd, &tio) != 0) {
-        close(fd);
-        return NULL;
-    }
-
-    cfmakeraw(&tio);
-    cfsetispeed(&tio, sp);
-    cfsetospeed(&tio, sp);
-
-    tio.c_cflag |= (CLOCAL | CREAD);
-    tio.c_cflag &= ~PARENB;
-    tio.c_cflag &= ~CSTOPB;
-    tio.c_cflag &= ~CSIZE;
-    tio.c_cflag |= CS8;
-
-    /* 受信待ちは select() で制御するので 0/0 でOK */
-    tio.c_cc[VMIN]  = 0;
-    tio.c_cc[VTIME] = 0;
-
-    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
-        close(fd);
-        return NULL;
-    }
-
     ctrl_port_t* c = (ctrl_port_t*)malloc(sizeof(ctrl_port_t));
     if (!c) {
         close(fd);
@@ -77,6 +43,11 @@ void ctrl_close(ctrl_port_t* ctrl)
     free(ctrl);
 }
 
+int ctrl_fd(const ctrl_port_t* ctrl)
+{
+    return ctrl ? ctrl->fd : -1;
+}
+
 /* 文字列コマンドを送る（例: "g 300\n", "e\n", "?\n"） */
 ctrl_result_t ctrl_send_line(ctrl_port_t* ctrl, const char* line)
 {
@@ -0,0 +1,334 @@
+#include "ctrl_session.h"
+#include "ctrl_port.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+
+#define TXQ_BYTES 1024
+
+enum { SLOT_FREE = 0, SLOT_PENDING, SLOT_DONE };
+
+typedef struct {
+    int           state;
+    ctrl_expect_t expect;
+    uint64_t      tx_end;       /* この要求の最後の byte が書き終わる tx 累積位置 */
+    uint64_t      timeout_ns;
+    uint64_t      deadline_ns;  /* 先頭になった時刻 + timeout（前の返答待ちの時間は含めない） */
+    ctrl_session_cb cb;
+    void*         user;
+    ctrl_reply_t  rep;
+} slot_t;
+
+struct ctrl_session {
+    ctrl_port_t* port;
+    int fd;
+
+    /* 要求リング（head = 一番古い未完了, tail = 次に積む位置。単調増加） */
+    slot_t   slot[CTRL_SESSION_DEPTH];
+    uint64_t head, tail;
+
+    /* 送信キュー（tx_total = 積んだ累積, tx_written = 書いた累積） */
+    char     txq[TXQ_BYTES];
+    size_t   txq_len;
+    uint64_t tx_total, tx_written;
+
+    /* 受信途中の行 */
+    char   rx_line[CTRL_REPLY_MAX];
+    size_t rx_len;
+
+    uint64_t unsolicited;   /* 要求なしで届いた行（捨てた数） */
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+ctrl_session_t* ctrl_session_open(const char* devpath, int baudrate)
+{
+    ctrl_port_t* port = ctrl_open(devpath, baudrate);
+    if (!port) return NULL;
+
+    int fd = ctrl_fd(port);
+    int fl = fcntl(fd, F_GETFL);
+    if (fl < 0 || fcntl(fd, F_SETFL, fl | O_NONBLOCK) < 0) {
+        ctrl_close(port);
+        return NULL;
+    }
+    /* 残りゴミは開いたときに1回だけ捨てる（以降は返答を取りこぼさない） */
+    tcflush(fd, TCIFLUSH);
+
+    ctrl_session_t* s = (ctrl_session_t*)calloc(1, sizeof(*s));
+    if (!s) {
+        ctrl_close(port);
+        return NULL;
+    }
+    s->port = port;
+    s->fd = fd;
+    return s;
+}
+
+void ctrl_session_close(ctrl_session_t* s)
+{
+    if (!s) return;
+    /* 積んだコマンドは書き切ってから閉じる（g などを落とさない） */
+    uint64_t limit = now_ns() + (uint64_t)CTRL_TIMEOUT_MS * 1000000ull;
+    while (s->txq_len > 0 && now_ns() < limit) {
+        if (ctrl_session_poll(s, 10) < 0) break;
+    }
+    ctrl_close(s->port);
+    free(s);
+}
+
+int ctrl_session_fd(const ctrl_session_t* s)
+{
+    return s ? s->fd : -1;
+}
+
+int ctrl_session_pending(const ctrl_session_t* s)
+{
+    return s ? (int)(s->tail - s->head) : 0;
+}
+
+uint32_t ctrl_session_submit(ctrl_session_t* s, const char* cmd, ctrl_expect_t expect,
+                             int timeout_ms, ctrl_session_cb cb, void* user)
+{
+    if (!s || !cmd) return 0;
+    size_t len = strlen(cmd);
+    if (len == 0 || len > TXQ_BYTES - s->txq_len) return 0;
+    if (s->tail - s->head >= CTRL_SESSION_DEPTH) return 0;
+
+    uint64_t t0 = now_ns();
+    if (timeout_ms <= 0) timeout_ms = CTRL_TIMEOUT_MS;
+
+    memcpy(s->txq + s->txq_len, cmd, len);
+    s->txq_len += len;
+    s->tx_total += len;
+
+    uint32_t id = (uint32_t)(s->tail + 1);
+    slot_t* sl = &s->slot[s->tail % CTRL_SESSION_DEPTH];
+    memset(sl, 0, sizeof(*sl));
+    sl->state = SLOT_PENDING;
+    sl->expect = expect;
+    sl->tx_end = s->tx_total;
+    sl->timeout_ns = (uint64_t)timeout_ms * 1000000ull;
+    if (s->head == s->tail) sl->deadline_ns = t0 + sl->timeout_ns;
+    sl->cb = cb;
+    sl->user = user;
+    sl->rep.id = id;
+    sl->rep.status = -1;
+    sl->rep.t_submit_ns = t0;
+    s->tail++;
+
+    /* すぐ書けるなら書いておく（返答は待たない） */
+    ctrl_session_process(s);
+    return id;
+}
+
+/* 先頭の要求を完了させる（コールバック中の submit も可） */
+static void complete_head(ctrl_session_t* s, int status, const char* line)
+{
+    slot_t* sl = &s->slot[s->head % CTRL_SESSION_DEPTH];
+    sl->rep.status = status;
+    sl->rep.t_done_ns = now_ns();
+    if (line) snprintf(sl->rep.line, sizeof(sl->rep.line), "%s", line);
+    sl->state = SLOT_DONE;
+    s->head++;
+    if (s->head < s->tail) {
+        slot_t* nx = &s->slot[s->head % CTRL_SESSION_DEPTH];
+        nx->deadline_ns = sl->rep.t_done_ns + nx->timeout_ns;
+    }
+
+    if (sl->cb) {
+        ctrl_reply_t rep = sl->rep;
+        sl->state = SLOT_FREE;
+        sl->cb(sl->user, &rep);
+    }
+}
+
+static slot_t* head_slot(ctrl_session_t* s)
+{
+    return (s->head < s->tail) ? &s->slot[s->head % CTRL_SESSION_DEPTH] : NULL;
+}
+
+/* 返答不要で、もう書き終わった要求を先頭から片付ける */
+static int complete_written(ctrl_session_t* s)
+{
+    int n = 0;
+    slot_t* sl;
+    while ((sl = head_slot(s)) && sl->expect == CTRL_EXPECT_NONE && s->tx_written >= sl->tx_end) {
+        complete_head(s, 0, NULL);
+        n++;
+    }
+    return n;
+}
+
+static int flush_tx(ctrl_session_t* s)
+{
+    size_t off = 0;
+    while (off < s->txq_len) {
+        ssize_t w = write(s->fd, s->txq + off, s->txq_len - off);
+        if (w > 0) { off += (size_t)w; continue; }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        perror("ctrl write");
+        return -1;
+    }
+    memmove(s->txq, s->txq + off, s->txq_len - off);
+    s->txq_len -= off;
+    s->tx_written += off;
+    return 0;
+}
+
+/* 受信1byte分の処理（返答は古い要求から順に割り当てる） */
+static int on_rx_byte(ctrl_session_t* s, char ch)
+{
+    int n = complete_written(s);
+    slot_t* sl = head_slot(s);
+
+    if ((unsigned char)ch == 0x06 && sl && sl->expect == CTRL_EXPECT_ACK) {
+        complete_head(s, 0, NULL);
+        return n + 1;
+    }
+    if (ch == '\r') return n;
+    if (ch != '\n') {
+        if (s->rx_len + 1 < sizeof(s->rx_line)) s->rx_line[s->rx_len++] = ch;
+        return n;
+    }
+
+    s->rx_line[s->rx_len] = '\0';
+    s->rx_len = 0;
+    if (sl && sl->expect == CTRL_EXPECT_LINE) {
+        complete_head(s, 0, s->rx_line);
+        return n + 1;
+    }
+    s->unsolicited++;
+    return n;
+}
+
+int ctrl_session_process(ctrl_session_t* s)
+{
+    if (!s) return -1;
+    int done = 0;
+
+    if (s->txq_len > 0 && flush_tx(s) != 0) return -1;
+    done += complete_written(s);
+
+    char tmp[256];
+    for (;;) {
+        ssize_t n = read(s->fd, tmp, sizeof(tmp));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n; i++) done += on_rx_byte(s, tmp[i]);
+    }
+    done += complete_written(s);
+
+    /* 返答が来ないまま期限切れ：失敗にして、遅れて来る途中の行は捨てる */
+    uint64_t t = now_ns();
+    slot_t* sl;
+    while ((sl = head_slot(s)) && t >= sl->deadline_ns) {
+        s->rx_len = 0;
+        complete_head(s, -1, NULL);
+        done++;
+    }
+    return done;
+}
+
+int ctrl_session_poll(ctrl_session_t* s, int timeout_ms)
+{
+    if (!s) return -1;
+
+    /* 先頭の期限を越えて寝ない（タイムアウトを遅れずに判定する） */
+    slot_t* sl = head_slot(s);
+    if (sl) {
+        uint64_t t = now_ns();
+        int left = (sl->deadline_ns > t) ? (int)((sl->deadline_ns - t + 999999ull) / 1000000ull) : 0;
+        if (timeout_ms < 0 || left < timeout_ms) timeout_ms = left;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = s->fd;
+    pfd.events = (short)(POLLIN | (s->txq_len > 0 ? POLLOUT : 0));
+    pfd.revents = 0;
+    int r = poll(&pfd, 1, timeout_ms);
+    if (r < 0 && errno != EINTR) {
+        perror("ctrl poll");
+        return -1;
+    }
+    return ctrl_session_process(s);
+}
+
+int ctrl_session_take(ctrl_session_t* s, uint32_t id, ctrl_reply_t* out)
+{
+    if (!s || id == 0) return -1;
+    slot_t* sl = &s->slot[(id - 1) % CTRL_SESSION_DEPTH];
+    if (sl->rep.id != id || sl->state == SLOT_FREE) return -1;
+    if (sl->state == SLOT_PENDING) return 0;
+
+    if (out) *out = sl->rep;
+    sl->state = SLOT_FREE;
+    return 1;
+}
+
+int ctrl_session_wait(ctrl_session_t* s, uint32_t id, ctrl_reply_t* out, int timeout_ms)
+{
+    uint64_t limit = now_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ull;
+    for (;;) {
+        int r = ctrl_session_take(s, id, out);
+        if (r != 0) return r;
+
+        uint64_t t = now_ns();
+        if (t >= limit) return 0;
+        if (ctrl_session_poll(s, (int)((limit - t + 999999ull) / 1000000ull)) < 0) return -1;
+    }
+}
+
+/* ===== よく使うコマンド ===== */
+
+uint32_t ctrl_session_set_gain(ctrl_session_t* s, uint32_t gain)
+{
+    char cmd[32];
+    snprintf(cmd, sizeof(cmd), "g %u\n", gain);
+    return ctrl_session_submit(s, cmd, CTRL_EXPECT_NONE, 0, NULL, NULL);
+}
+
+uint32_t ctrl_session_req_errors(ctrl_session_t* s, ctrl_session_cb cb, void* user)
+{
+    return ctrl_session_submit(s, "e\n", CTRL_EXPECT_LINE, 0, cb, user);
+}
+
+uint32_t ctrl_session_req_sampling_hz(ctrl_session_t* s, ctrl_session_cb cb, void* user)
+{
+    return ctrl_session_submit(s, "f\n", CTRL_EXPECT_LINE, 0, cb, user);
+}
+
+/* 例: "0 0" */
+int ctrl_parse_errors(const char* line, uint32_t* pulse_err, uint32_t* adc_err)
+{
+    if (!line || !pulse_err || !adc_err) return -1;
+    unsigned long pe = 0, ae = 0;
+    if (sscanf(line, "%lu %lu", &pe, &ae) != 2) return -1;
+    *pulse_err = (uint32_t)pe;
+    *adc_err   = (uint32_t)ae;
+    return 0;
+}
+
+/* 例: "1000000" */
+int ctrl_parse_hz(const char* line, uint32_t* hz_out)
+{
+    if (!line || !hz_out) return -1;
+    unsigned long v = strtoul(line, NULL, 10);
+    if (v == 0) return -1;
+    *hz_out = (uint32_t)v;
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include "ddc.h"
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DDC_X86 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DDC_NEON 1
+#endif
+
+struct ddc {
+    ddc_cfg_t cfg;
+    int    taps;      /* 8 の倍数に切り上げ（後ろの係数は 0） */
+    float* rr;        /* 逆順の複素係数（実部） */
+    float* ri;        /* 逆順の複素係数（虚部） */
+    float* buf;       /* (taps-1) 個の 0 + 入力（stride を詰めたもの） */
+    size_t max_in;
+    double w_out;     /* 出力1点ごとの LO 回転 ω·D */
+};
+
+void ddc_cfg_default(ddc_cfg_t* cfg, double fs)
+{
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->fs             = fs;
+    cfg->f_center       = DDC_CENTER_HZ;
+    cfg->cutoff_hz      = DDC_CUTOFF_HZ;
+    cfg->decim          = DDC_DECIM;
+    cfg->taps_per_phase = DDC_TAPS_PER_PHASE;
+}
+
+/* ---------------- 内積（実 x と 複素係数 2本） ---------------- */
+
+#if defined(DDC_X86)
+
+static void dot2_sse(const float* x, const float* a, const float* b, int n, float* sa, float* sb)
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        s0 = _mm_add_ps(s0, _mm_mul_ps(v, _mm_loadu_ps(a + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(v, _mm_loadu_ps(b + i)));
+    }
+    float t0[4], t1[4];
+    _mm_storeu_ps(t0, s0);
+    _mm_storeu_ps(t1, s1);
+    *sa = (t0[0] + t0[1]) + (t0[2] + t0[3]);
+    *sb = (t1[0] + t1[1]) + (t1[2] + t1[3]);
+}
+
+__attribute__((target("avx2")))
+static void dot2_avx2(const float* x, const float* a, const float* b, int n, float* sa, float* sb)
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(v, _mm256_loadu_ps(a + i)));
+        s1 = _mm256_add_ps(s1, _mm256_mul_ps(v, _mm256_loadu_ps(b + i)));
+    }
+    float t0[8], t1[8];
+    _mm256_storeu_ps(t0, s0);
+    _mm256_storeu_ps(t1, s1);
+    *sa = ((t0[0] + t0[1]) + (t0[2] + t0[3])) + ((t0[4] + t0[5]) + (t0[6] + t0[7]));
+    *sb = ((t1[0] + t1[1]) + (t1[2] + t1[3])) + ((t1[4] + t1[5]) + (t1[6] + t1[7]));
+}
+
+#elif defined(DDC_NEON)
+
+static void dot2_neon(const float* x, const float* a, const float* b, int n, float* sa, float* sb)
+{
+    float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+    for (int i = 0; i < n; i += 4) {
+        float32x4_t v = vld1q_f32(x + i);
+        s0 = vmlaq_f32(s0, v, vld1q_f32(a + i));
+        s1 = vmlaq_f32(s1, v, vld1q_f32(b + i));
+    }
+    float t0[4], t1[4];
+    vst1q_f32(t0, s0);
+    vst1q_f32(t1, s1);
+    *sa = (t0[0] + t0[1]) + (t0[2] + t0[3]);
+    *sb = (t1[0] + t1[1]) + (t1[2] + t1[3]);
+}
+
+#else
+
+static void dot2_scalar(const float* x, const float* a, const float* b, int n, float* sa, float* sb)
+{
+    float s0 = 0.0f, s1 = 0.0f;
+    for (int i = 0; i < n; i++) {
+        s0 += x[i] * a[i];
+        s1 += x[i] * b[i];
+    }
+    *sa = s0;
+    *sb = s1;
+}
+
+#endif
+
+typedef void (*dot2_fn)(const float*, const float*, const float*, int, float*, float*);
+
+static dot2_fn pick_dot2(void)
+{
+#if defined(DDC_X86)
+    return __builtin_cpu_supports("avx2") ? dot2_avx2 : dot2_sse;
+#elif defined(DDC_NEON)
+    return dot2_neon;
+#else
+    return dot2_scalar;
+#endif
+}
+
+const char* ddc_impl(void)
+{
+#if defined(DDC_X86)
+    return __builtin_cpu_supports("avx2") ? "avx2" : "sse";
+#elif defined(DDC_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+/* ---------------- create / process ---------------- */
+
+ddc_t* ddc_create(const ddc_cfg_t* cfg, size_t max_in)
+{
+    if (!cfg || cfg->fs <= 0.0 || cfg->decim < 1 || cfg->taps_per_phase < 1 ||
+        cfg->cutoff_hz <= 0.0 || cfg->cutoff_hz >= cfg->fs * 0.5 || max_in == 0)
+        return NULL;
+
+    ddc_t* d = (ddc_t*)calloc(1, sizeof(*d));
+    if (!d) return NULL;
+    d->cfg = *cfg;
+    d->max_in = max_in;
+
+    int T = cfg->decim * cfg->taps_per_phase;
+    d->taps = (T + 7) & ~7;
+    d->rr  = (float*)calloc((size_t)d->taps, sizeof(float));
+    d->ri  = (float*)calloc((size_t)d->taps, sizeof(float));
+    d->buf = (float*)calloc((size_t)d->taps - 1 + max_in, sizeof(float));
+    if (!d->rr || !d->ri || !d->buf) {
+        ddc_destroy(d);
+        return NULL;
+    }
+
+    /* Blackman 窓 sinc（DC 利得 1）× e^{jωk}。内積を前向きに回せるよう逆順で持つ */
+    double w  = 2.0 * M_PI * cfg->f_center / cfg->fs;
+    double fc = cfg->cutoff_hz / cfg->fs;
+    double mid = 0.5 * (double)(T - 1), sum = 0.0;
+    double* h = (double*)malloc(sizeof(double) * (size_t)T);
+    if (!h) {
+        ddc_destroy(d);
+        return NULL;
+    }
+    for (int k = 0; k < T; k++) {
+        double t = (double)k - mid;
+        double sinc = (t == 0.0) ? 2.0 * fc : sin(2.0 * M_PI * fc * t) / (M_PI * t);
+        double win = (T > 1) ? 0.42 - 0.5 * cos(2.0 * M_PI * k / (T - 1)) + 0.08 * cos(4.0 * M_PI * k / (T - 1)) : 1.0;
+        h[k] = sinc * win;
+        sum += h[k];
+    }
+    for (int k = 0; k < T; k++) {
+        double hk = h[k] / sum;
+        d->rr[d->taps - 1 - k] = (float)(hk * cos(w * k));
+        d->ri[d->taps - 1 - k] = (float)(hk * sin(w * k));
+    }
+    free(h);
+
+    d->w_out = w * (double)cfg->decim;
+    return d;
+}
+
+void ddc_destroy(ddc_t* d)
+{
+    if (!d) return;
+    free(d->rr);
+    free(d->ri);
+    free(d->buf);
+    free(d);
+}
+
+size_t ddc_out_len(const ddc_t* d, size_t n_in)
+{
+    return d ? n_in / (size_t)d->cfg.decim : 0;
+}
+
+int ddc_decim(const ddc_t* d)
+{
+    return d ? d->cfg.decim : 0;
+}
+
+size_t ddc_process(ddc_t* d, const float* x, size_t n, size_t stride, float* iq_out)
+{
+    if (!d || !x || !iq_out || stride == 0) return 0;
+    if (n > d->max_in) n = d->max_in;
+
+    /* 先頭 taps-1 個は 0（キャプチャの前は無音とみなす）のまま、後ろに詰めて並べる */
+    float* xb = d->buf + d->taps - 1;
+    for (size_t i = 0; i < n; i++) xb[i] = x[i * stride];
+
+    const size_t D = (size_t)d->cfg.decim;
+    const size_t m_out = n / D;
+    dot2_fn dot2 = pick_dot2();
+
+    /* 出力 m は入力 mD までを使う：buf[mD .. mD+taps) */
+    double cr = 1.0, ci = 0.0;                          /* e^{-jωmD} */
+    const double wr = cos(d->w_out), wi = -sin(d->w_out);
+    for (size_t m = 0; m < m_out; m++) {
+        float a, b;
+        dot2(d->buf + m * D, d->rr, d->ri, d->taps, &a, &b);
+        iq_out[2 * m]     = (float)(cr * a - ci * b);
+        iq_out[2 * m + 1] = (float)(cr * b + ci * a);
+
+        double nr = cr * wr - ci * wi;
+        ci = cr * wi + ci * wr;
+        cr = nr;
+        if ((m & 1023u) == 1023u) {   /* 漸化式の誤差で振幅がずれないように戻す */
+            double g = 1.0 / sqrt(cr * cr + ci * ci);
+            cr *= g;
+            ci *= g;
+        }
+    }
+    return m_out;
+}
@@ -0,0 +1,254 @@
+#include "detect.h"
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef struct {
+    size_t i;
+    float  v;
+} peak_t;
+
+struct detector {
+    size_t  cap;
+    int     max_echoes;
+    double* csum;     /* cap+1: 累積和（CA） */
+    float*  thr;      /* cap: 閾値 */
+    float*  win;      /* 2*max_train: 訓練セルの作業用（OS） */
+    int     max_train;
+    peak_t* cand;     /* 閾値越え区間ごとの山 */
+    peak_t* top;      /* max_echoes */
+};
+
+void detect_cfg_default(detect_cfg_t* cfg)
+{
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->mode       = DETECT_CA;
+    cfg->guard      = DETECT_GUARD;
+    cfg->train      = DETECT_TRAIN;
+    cfg->thr_db     = DETECT_THR_DB;
+    cfg->min_sep    = DETECT_MIN_SEP;
+    cfg->max_echoes = DETECT_MAX_ECHOES;
+}
+
+detector_t* detect_create(size_t n, int max_echoes, int max_train)
+{
+    if (n < 3 || max_echoes <= 0 || max_train <= 0) return NULL;
+
+    detector_t* d = (detector_t*)calloc(1, sizeof(*d));
+    if (!d) return NULL;
+    d->cap = n;
+    d->max_echoes = max_echoes;
+    d->max_train = max_train;
+    d->csum = (double*)malloc(sizeof(double) * (n + 1));
+    d->thr  = (float*)malloc(sizeof(float) * n);
+    d->cand = (peak_t*)malloc(sizeof(peak_t) * (n / 2 + 1));
+    d->top  = (peak_t*)malloc(sizeof(peak_t) * (size_t)max_echoes);
+    d->win  = (float*)malloc(sizeof(float) * 2 * (size_t)max_train);
+    if (!d->csum || !d->thr || !d->cand || !d->top || !d->win) {
+        detect_destroy(d);
+        return NULL;
+    }
+    return d;
+}
+
+void detect_destroy(detector_t* d)
+{
+    if (!d) return;
+    free(d->csum);
+    free(d->thr);
+    free(d->win);
+    free(d->cand);
+    free(d->top);
+    free(d);
+}
+
+const float* detect_threshold(const detector_t* d)
+{
+    return d ? d->thr : NULL;
+}
+
+/* ---------------- 雑音推定 ---------------- */
+
+/* 訓練セル [a, b) を [0, n) に切り詰める */
+static void clip(long a, long b, long n, long* ca, long* cb)
+{
+    if (a < 0) a = 0;
+    if (b > n) b = n;
+    if (b < a) b = a;
+    *ca = a;
+    *cb = b;
+}
+
+static void noise_ca(detector_t* d, const float* env, size_t n, int g, int T,
+                     size_t i0, size_t i1, float k)
+{
+    double s = 0.0;
+    d->csum[0] = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        s += env[i];
+        d->csum[i + 1] = s;
+    }
+
+    for (size_t i = i0; i < i1; i++) {
+        long la, lb, ra, rb;
+        clip((long)i - g - T, (long)i - g, (long)n, &la, &lb);
+        clip((long)i + g + 1, (long)i + g + 1 + T, (long)n, &ra, &rb);
+        long cnt = (lb - la) + (rb - ra);
+        if (cnt <= 0) {
+            d->thr[i] = INFINITY;
+            continue;
+        }
+        double sum = (d->csum[lb] - d->csum[la]) + (d->csum[rb] - d->csum[ra]);
+        d->thr[i] = (float)(sum / (double)cnt) * k;
+    }
+}
+
+/* w[0..cnt) の小さいほうから r 番目（0 始まり）。w は並べ替わる */
+static float quickselect(float* w, int cnt, int r)
+{
+    int lo = 0, hi = cnt - 1;
+    while (lo < hi) {
+        float pv = w[(lo + hi) / 2];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (w[i] < pv) i++;
+            while (w[j] > pv) j--;
+            if (i <= j) {
+                float t = w[i]; w[i] = w[j]; w[j] = t;
+                i++;
+                j--;
+            }
+        }
+        if (r <= j)      hi = j;
+        else if (r >= i) lo = i;
+        else             break;
+    }
+    return w[r];
+}
+
+/* OS は stride 点ごとに選び、その間は同じ値を使う（雑音はゆっくりしか変わらない） */
+static int noise_os(detector_t* d, const float* env, size_t n, int g, int T, int rank,
+                    size_t i0, size_t i1, float k)
+{
+    if (T > d->max_train) return -1;   /* 作業領域は create で 2*max_train 確保済み */
+    if (rank <= 0 || rank > 2 * T) rank = (3 * 2 * T) / 4;
+    size_t stride = (g >= 2) ? (size_t)(g / 2) : 1;
+
+    for (size_t i = i0; i < i1; i += stride) {
+        long la, lb, ra, rb;
+        clip((long)i - g - T, (long)i - g, (long)n, &la, &lb);
+        clip((long)i + g + 1, (long)i + g + 1 + T, (long)n, &ra, &rb);
+        int cnt = 0;
+        for (long j = la; j < lb; j++) d->win[cnt++] = env[j];
+        for (long j = ra; j < rb; j++) d->win[cnt++] = env[j];
+
+        float thr = INFINITY;
+        if (cnt > 0) {
+            /* 端で窓が欠けたら順位も同じ割合にする */
+            int r = (int)(((long)rank * cnt) / (2 * T));
+            if (r >= cnt) r = cnt - 1;
+            thr = quickselect(d->win, cnt, r) * k;
+        }
+        size_t e = (i + stride < i1) ? i + stride : i1;
+        for (size_t j = i; j < e; j++) d->thr[j] = thr;
+    }
+    return 0;
+}
+
+/* ---------------- 山の取り出し ---------------- */
+
+/* 放物線補間：頂点のずれ（-0.5..0.5）と高さ */
+static double parabolic(const float* env, size_t n, size_t i, float* amp)
+{
+    *amp = env[i];
+    if (i == 0 || i + 1 >= n) return 0.0;
+    double a = env[i - 1], b = env[i], c = env[i + 1];
+    double den = a - 2.0 * b + c;
+    if (den >= 0.0) return 0.0;   /* 頂点でない（平ら） */
+    double dx = 0.5 * (a - c) / den;
+    if (dx > 0.5) dx = 0.5;
+    if (dx < -0.5) dx = -0.5;
+    *amp = (float)(b - 0.25 * (a - c) * dx);
+    return dx;
+}
+
+int detect_run(detector_t* d, const detect_cfg_t* cfg, const float* env, size_t n,
+               double fs, double c_mps, detect_echo_t* out)
+{
+    if (!d || !cfg || !env || !out || n < 3 || n > d->cap || fs <= 0.0) return -1;
+
+    int g = cfg->guard > 0 ? cfg->guard : 0;
+    int T = cfg->train > 0 ? cfg->train : 1;
+    int K = cfg->max_echoes;
+    if (K <= 0 || K > d->max_echoes) K = d->max_echoes;
+    size_t i0 = cfg->i0;
+    size_t i1 = (cfg->i1 == 0 || cfg->i1 > n) ? n : cfg->i1;
+    if (i0 >= i1) return 0;
+    float k = (float)pow(10.0, cfg->thr_db / 20.0);
+
+    memset(d->thr, 0, sizeof(float) * n);
+    if (cfg->mode == DETECT_OS) {
+        if (noise_os(d, env, n, g, T, cfg->os_rank, i0, i1, k) != 0) return -1;
+    } else {
+        noise_ca(d, env, n, g, T, i0, i1, k);
+    }
+
+    /* 閾値を超えた区間ごとに最大点を1つ（近すぎる区間は強いほうにまとめる） */
+    size_t nc = 0;
+    int in_run = 0;
+    peak_t best = { 0, 0.0f };
+    for (size_t i = i0; i <= i1; i++) {
+        int above = (i < i1) && env[i] > d->thr[i];
+        if (above) {
+            if (!in_run || env[i] > best.v) { best.i = i; best.v = env[i]; }
+            in_run = 1;
+            continue;
+        }
+        if (!in_run) continue;
+        in_run = 0;
+        if (nc > 0 && best.i - d->cand[nc - 1].i < (size_t)(cfg->min_sep > 0 ? cfg->min_sep : 0)) {
+            if (best.v > d->cand[nc - 1].v) d->cand[nc - 1] = best;
+        } else {
+            d->cand[nc++] = best;
+        }
+    }
+
+    /* 振幅上位 K 個（K は小さいので挿入ソート） */
+    int nt = 0;
+    for (size_t c = 0; c < nc; c++) {
+        peak_t p = d->cand[c];
+        if (nt == K && p.v <= d->top[nt - 1].v) continue;
+        int j = (nt < K) ? nt++ : nt - 1;
+        while (j > 0 && d->top[j - 1].v < p.v) {
+            d->top[j] = d->top[j - 1];
+            j--;
+        }
+        d->top[j] = p;
+    }
+
+    /* 距離順に並べ直す */
+    for (int a = 1; a < nt; a++) {
+        peak_t p = d->top[a];
+        int j = a;
+        while (j > 0 && d->top[j - 1].i > p.i) {
+            d->top[j] = d->top[j - 1];
+            j--;
+        }
+        d->top[j] = p;
+    }
+
+    for (int e = 0; e < nt; e++) {
+        size_t i = d->top[e].i;
+        detect_echo_t* o = &out[e];
+        double dx = parabolic(env, n, i, &o->amp);
+        o->index   = (double)i + dx;
+        o->t_s     = o->index / fs;
+        o->range_m = 0.5 * c_mps * o->t_s;
+        o->noise   = d->thr[i] / k;
+        o->snr_db  = (o->noise > 0.0f) ? (float)(20.0 * log10((double)o->amp / (double)o->noise)) : INFINITY;
+    }
+    return nt;
+}
@@ -0,0 +1,396 @@
+#include "doppler.h"
+#include "crosscorr_internal.h"
+#include "ddc.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <fftw3.h>
+
+#define DOPPLER_MAX_THREADS 8
+
+typedef struct {
+    doppler_bank_t* b;
+    int k0, k1;            /* 担当する行 [k0, k1) */
+    fftwf_plan p_inv;      /* 担当行ぶんの many c2c backward */
+    pthread_t th;
+} chunk_t;
+
+struct doppler_bank {
+    int N, NH, K;
+    int cplx;              /* 1 = 複素ベースバンド（N = 間引き後の点数, スペクトルは両側 NH = N 点） */
+    int hpf_bin;
+    double* v;             /* K */
+
+    float*         rec_in; /* N（実数のときだけ） */
+    fftwf_complex* rec;    /* NH: 受信スペクトル（複素のときは入力も兼ねて in-place） */
+    fftwf_complex* refs;   /* K × NH: 参照スペクトル（連続） */
+    fftwf_complex* ana;    /* K × N: 行ごとの解析信号 → 逆FFT後 I+jQ */
+    float*         map;    /* K × N */
+    fftwf_plan p_fwd;      /* 実数: r2c rec_in -> rec / 複素: c2c rec -> rec */
+    arena_t* arena;        /* バッファの確保先（NULL = malloc / fftwf_malloc） */
+
+    chunk_t chunk[DOPPLER_MAX_THREADS];
+    int n_chunks;
+
+    /* ワーカー（chunk[1..]）。chunk[0] は run を呼んだスレッドが受け持つ */
+    pthread_mutex_t mu;
+    pthread_cond_t  cv_go, cv_done;
+    unsigned gen;
+    int pending;
+    int stop;
+    int workers_started;
+};
+
+void doppler_velocities(double vmax, int K, double* v_out)
+{
+    if (!v_out || K <= 0) return;
+    if (K == 1) { v_out[0] = 0.0; return; }
+    for (int k = 0; k < K; k++) v_out[k] = -vmax + 2.0 * vmax * (double)k / (double)(K - 1);
+}
+
+/* 担当行：受信 × conj(参照) → 片側（解析信号）→ 逆FFT → |I+jQ| / N
+   複素ベースバンドは入力がもう解析信号なので、両側そのまま掛ける（HPF・2倍なし。crosscorr と同じ） */
+static void run_chunk(doppler_bank_t* b, const chunk_t* c)
+{
+    const int N = b->N, half = N / 2, h = b->hpf_bin;
+    trace_begin("doppler_rows", (uint32_t)c->k0);
+    for (int k = c->k0; k < c->k1; k++) {
+        const fftwf_complex* r = b->refs + (size_t)k * (size_t)b->NH;
+        fftwf_complex* a = b->ana + (size_t)k * (size_t)N;
+        if (b->cplx) {
+            for (int j = 0; j < N; j++) {
+                float ar = r[j][0], ai = r[j][1], xr = b->rec[j][0], xi = b->rec[j][1];
+                a[j][0] = ar * xr + ai * xi;
+                a[j][1] = ar * xi - ai * xr;
+            }
+            continue;
+        }
+        for (int j = 0; j <= half; j++) {
+            if (j < h) { a[j][0] = 0.0f; a[j][1] = 0.0f; continue; }
+            float ar = r[j][0], ai = r[j][1], xr = b->rec[j][0], xi = b->rec[j][1];
+            float w = (j == 0 || 2 * j == N) ? 1.0f : 2.0f;
+            a[j][0] = w * (ar * xr + ai * xi);
+            a[j][1] = w * (ar * xi - ai * xr);
+        }
+        if (half + 1 < N) memset(a + half + 1, 0, sizeof(fftwf_complex) * (size_t)(N - half - 1));
+    }
+
+    fftwf_execute(c->p_inv);
+
+    const float invN = 1.0f / (float)N;
+    for (int k = c->k0; k < c->k1; k++) {
+        const fftwf_complex* a = b->ana + (size_t)k * (size_t)N;
+        float* m = b->map + (size_t)k * (size_t)N;
+        for (int i = 0; i < N; i++) {
+            float I = a[i][0] * invN, Q = a[i][1] * invN;
+            m[i] = sqrtf(I * I + Q * Q);
+        }
+    }
+    trace_end("doppler_rows", (uint32_t)c->k1);
+}
+
+static void* worker_main(void* arg)
+{
+    chunk_t* c = (chunk_t*)arg;
+    doppler_bank_t* b = c->b;
+    unsigned seen = 0;
+    trace_thread_name("doppler");
+
+    pthread_mutex_lock(&b->mu);
+    for (;;) {
+        while (!b->stop && b->gen == seen) pthread_cond_wait(&b->cv_go, &b->mu);
+        if (b->stop) break;
+        seen = b->gen;
+        pthread_mutex_unlock(&b->mu);
+
+        run_chunk(b, c);
+
+        pthread_mutex_lock(&b->mu);
+        if (--b->pending == 0) pthread_cond_signal(&b->cv_done);
+    }
+    pthread_mutex_unlock(&b->mu);
+    return NULL;
+}
+
+/* 参照を eta 倍速で読んだ波形（線形補間）。エネルギーは元と揃える */
+static void scaled_call(const float* call, size_t call_len, double eta, float* out, int N)
+{
+    memset(out, 0, sizeof(float) * (size_t)N);
+    double e0 = 0.0, e1 = 0.0;
+    for (size_t i = 0; i < call_len; i++) e0 += (double)call[i] * call[i];
+
+    for (int m = 0; m < N; m++) {
+        double u = (double)m * eta;
+        size_t i = (size_t)u;
+        if (i >= call_len) break;
+        double f = u - (double)i;
+        double a = call[i], c = (i + 1 < call_len) ? call[i + 1] : 0.0;
+        out[m] = (float)((1.0 - f) * a + f * c);
+        e1 += (double)out[m] * out[m];
+    }
+    if (e1 > 0.0) {
+        float g = (float)sqrt(e0 / e1);
+        for (int m = 0; m < N; m++) out[m] *= g;
+    }
+}
+
+/* 器とプランだけ作る（参照は呼び出し側が埋めてから start_workers） */
+static doppler_bank_t* bank_new(int N, int cplx, int hpf_bin, const double* v_mps, int K,
+                                int n_threads, const xcorr_opts_t* o)
+{
+    doppler_bank_t* b = (doppler_bank_t*)calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    b->N = N;
+    b->NH = cplx ? N : N / 2 + 1;
+    b->K = K;
+    b->cplx = cplx;
+    b->arena = o->arena;
+    b->hpf_bin = hpf_bin;
+    pthread_mutex_init(&b->mu, NULL);
+    pthread_cond_init(&b->cv_go, NULL);
+    pthread_cond_init(&b->cv_done, NULL);
+
+    size_t n = (size_t)N, nh = (size_t)b->NH, k = (size_t)K;
+    b->v      = (double*)malloc(sizeof(double) * k);
+    b->rec_in = cplx ? NULL : (float*)xcorr_buf_alloc(b->arena, sizeof(float) * n);
+    b->rec    = (fftwf_complex*)xcorr_buf_alloc(b->arena, sizeof(fftwf_complex) * nh);
+    b->refs   = (fftwf_complex*)xcorr_buf_alloc(b->arena, sizeof(fftwf_complex) * nh * k);
+    b->ana    = (fftwf_complex*)xcorr_buf_alloc(b->arena, sizeof(fftwf_complex) * n * k);
+    b->map    = (float*)xcorr_buf_alloc(b->arena, sizeof(float) * n * k);
+    if (!b->v || (!cplx && !b->rec_in) || !b->rec || !b->refs || !b->ana || !b->map) {
+        doppler_bank_destroy(b);
+        return NULL;
+    }
+    memcpy(b->v, v_mps, sizeof(double) * k);
+
+    /* 行をスレッド数で分け、分けた塊ごとに many プランを作る（プラン作成は中身を入れる前） */
+    if (n_threads < 1) n_threads = 1;
+    if (n_threads > DOPPLER_MAX_THREADS) n_threads = DOPPLER_MAX_THREADS;
+    if (n_threads > K) n_threads = K;
+    b->n_chunks = n_threads;
+    for (int t = 0; t < n_threads; t++) {
+        chunk_t* c = &b->chunk[t];
+        c->b = b;
+        c->k0 = (K * t) / n_threads;
+        c->k1 = (K * (t + 1)) / n_threads;
+        c->p_inv = xcorr_plan_many_c2c(N, c->k1 - c->k0, b->ana + (size_t)c->k0 * n, FFTW_BACKWARD, o);
+        if (!c->p_inv) {
+            doppler_bank_destroy(b);
+            return NULL;
+        }
+    }
+    b->p_fwd = cplx ? xcorr_plan_many_c2c(N, 1, b->rec, FFTW_FORWARD, o)
+                    : xcorr_plan_r2c(N, b->rec_in, b->rec, o);
+    if (!b->p_fwd) {
+        doppler_bank_destroy(b);
+        return NULL;
+    }
+    return b;
+}
+
+static int start_workers(doppler_bank_t* b)
+{
+    for (int t = 1; t < b->n_chunks; t++) {
+        if (pthread_create(&b->chunk[t].th, NULL, worker_main, &b->chunk[t]) != 0) return -1;
+        b->workers_started = t;
+    }
+    return 0;
+}
+
+doppler_bank_t* doppler_bank_create(int N, double fs_hz, double hpf_hz,
+                                    const float* call, size_t call_len,
+                                    const double* v_mps, int K, double c_mps,
+                                    int n_threads, const xcorr_opts_t* opt)
+{
+    if (N <= 0 || fs_hz <= 0.0 || !call || call_len == 0 || !v_mps || K <= 0 || c_mps <= 0.0)
+        return NULL;
+
+    xcorr_opts_t o;
+    memset(&o, 0, sizeof(o));
+    if (opt) o = *opt;
+
+    int hpf_bin = (int)ceil(hpf_hz * (double)N / fs_hz);
+    if (hpf_bin < 0) hpf_bin = 0;
+    if (hpf_bin > N / 2) hpf_bin = N / 2;
+    doppler_bank_t* b = bank_new(N, 0, hpf_bin, v_mps, K, n_threads, &o);
+    if (!b) return NULL;
+
+    /* 参照スペクトル（rec_in / rec を作業場所に使って行ごとに控える） */
+    size_t nh = (size_t)b->NH;
+    for (int r = 0; r < K; r++) {
+        double eta = (c_mps + v_mps[r]) / (c_mps - v_mps[r]);
+        scaled_call(call, call_len, eta, b->rec_in, N);
+        fftwf_execute(b->p_fwd);
+        memcpy(b->refs + (size_t)r * nh, b->rec, sizeof(fftwf_complex) * nh);
+    }
+
+    if (start_workers(b) != 0) {
+        doppler_bank_destroy(b);
+        return NULL;
+    }
+    return b;
+}
+
+doppler_bank_t* doppler_bank_create_ddc(int n_in, ddc_t* ddc,
+                                        const float* call, size_t call_len,
+                                        const double* v_mps, int K, double c_mps,
+                                        int n_threads, const xcorr_opts_t* opt)
+{
+    if (n_in <= 0 || !ddc || !call || call_len == 0 || !v_mps || K <= 0 || c_mps <= 0.0)
+        return NULL;
+    int N = (int)ddc_out_len(ddc, (size_t)n_in);
+    if (N <= 0) return NULL;
+
+    xcorr_opts_t o;
+    memset(&o, 0, sizeof(o));
+    if (opt) o = *opt;
+
+    doppler_bank_t* b = bank_new(N, 1, 0, v_mps, K, n_threads, &o);
+    float* tmp = (float*)malloc(sizeof(float) * (size_t)n_in);   /* 伸縮した参照（入力レート, create の間だけ） */
+    if (!b || !tmp) {
+        free(tmp);
+        doppler_bank_destroy(b);
+        return NULL;
+    }
+
+    /* 伸縮は入力レートの実数参照で（搬送波ごと伸びる）→ 受信と同じ DDC → c2c */
+    for (int r = 0; r < K; r++) {
+        double eta = (c_mps + v_mps[r]) / (c_mps - v_mps[r]);
+        scaled_call(call, call_len, eta, tmp, n_in);
+        ddc_process(ddc, tmp, (size_t)n_in, 1, (float*)b->rec);
+        fftwf_execute(b->p_fwd);
+        memcpy(b->refs + (size_t)r * (size_t)N, b->rec, sizeof(fftwf_complex) * (size_t)N);
+    }
+    free(tmp);
+
+    if (start_workers(b) != 0) {
+        doppler_bank_destroy(b);
+        return NULL;
+    }
+    return b;
+}
+
+void doppler_bank_destroy(doppler_bank_t* b)
+{
+    if (!b) return;
+
+    pthread_mutex_lock(&b->mu);
+    b->stop = 1;
+    pthread_cond_broadcast(&b->cv_go);
+    pthread_mutex_unlock(&b->mu);
+    for (int t = 1; t <= b->workers_started; t++) pthread_join(b->chunk[t].th, NULL);
+
+    for (int t = 0; t < b->n_chunks; t++)
+        if (b->chunk[t].p_inv) fftwf_destroy_plan(b->chunk[t].p_inv);
+    if (b->p_fwd) fftwf_destroy_plan(b->p_fwd);
+
+    free(b->v);
+    xcorr_buf_free(b->arena, b->rec_in);
+    xcorr_buf_free(b->arena, b->rec);
+    xcorr_buf_free(b->arena, b->refs);
+    xcorr_buf_free(b->arena, b->ana);
+    xcorr_buf_free(b->arena, b->map);
+
+    pthread_cond_destroy(&b->cv_go);
+    pthread_cond_destroy(&b->cv_done);
+    pthread_mutex_destroy(&b->mu);
+    free(b);
+}
+
+/* 受信スペクトル（rec）が入った状態から全行を回す */
+static void run_rows(doppler_bank_t* b)
+{
+    if (b->n_chunks > 1) {
+        pthread_mutex_lock(&b->mu);
+        b->pending = b->n_chunks - 1;
+        b->gen++;
+        pthread_cond_broadcast(&b->cv_go);
+        pthread_mutex_unlock(&b->mu);
+    }
+
+    run_chunk(b, &b->chunk[0]);
+
+    if (b->n_chunks > 1) {
+        pthread_mutex_lock(&b->mu);
+        while (b->pending > 0) pthread_cond_wait(&b->cv_done, &b->mu);
+        pthread_mutex_unlock(&b->mu);
+    }
+}
+
+int doppler_bank_run(doppler_bank_t* b, const float* x, size_t stride)
+{
+    if (!b || b->cplx || !x || stride == 0) return -1;
+
+    for (int i = 0; i < b->N; i++) b->rec_in[i] = x[(size_t)i * stride];
+    fftwf_execute(b->p_fwd);
+    run_rows(b);
+    return 0;
+}
+
+int doppler_bank_run_complex(doppler_bank_t* b, const float* iq)
+{
+    if (!b || !b->cplx || !iq) return -1;
+
+    memcpy(b->rec, iq, sizeof(fftwf_complex) * (size_t)b->N);
+    fftwf_execute(b->p_fwd);
+    run_rows(b);
+    return 0;
+}
+
+const float* doppler_bank_map(const doppler_bank_t* b)
+{
+    return b ? b->map : NULL;
+}
+
+int doppler_bank_rows(const doppler_bank_t* b)
+{
+    return b ? b->K : 0;
+}
+
+int doppler_bank_best(const doppler_bank_t* b, size_t lag, int halfwidth, doppler_best_t* out)
+{
+    if (!b || !out || lag >= (size_t)b->N) return -1;
+    if (halfwidth < 0) halfwidth = 0;
+
+    size_t i0 = (lag > (size_t)halfwidth) ? lag - (size_t)halfwidth : 0;
+    size_t i1 = lag + (size_t)halfwidth + 1;
+    if (i1 > (size_t)b->N) i1 = (size_t)b->N;
+
+    int bk = 0;
+    size_t bi = i0;
+    float bv = -1.0f;
+    for (int k = 0; k < b->K; k++) {
+        const float* m = b->map + (size_t)k * (size_t)b->N;
+        for (size_t i = i0; i < i1; i++)
+            if (m[i] > bv) { bv = m[i]; bk = k; bi = i; }
+    }
+
+    out->bin = bk;
+    out->v_mps = b->v[bk];
+    out->v_interp = b->v[bk];
+    out->amp = bv;
+    out->lag = bi;
+
+    /* 隣の行の同じ範囲の最大で放物線補間（行の速度が等間隔のとき） */
+    if (bk > 0 && bk + 1 < b->K) {
+        double nb[2];
+        for (int s = 0; s < 2; s++) {
+            const float* m = b->map + (size_t)(bk + (s ? 1 : -1)) * (size_t)b->N;
+            float v = 0.0f;
+            for (size_t i = i0; i < i1; i++) if (m[i] > v) v = m[i];
+            nb[s] = v;
+        }
+        double den = nb[0] - 2.0 * bv + nb[1];
+        if (den < 0.0) {
+            double dx = 0.5 * (nb[0] - nb[1]) / den;
+            if (dx > 0.5) dx = 0.5;
+            if (dx < -0.5) dx = -0.5;
+            double step = 0.5 * (b->v[bk + 1] - b->v[bk - 1]);
+            out->v_interp = b->v[bk] + dx * step;
+        }
+    }
+    return 0;
+}
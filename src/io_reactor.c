@@ -0,0 +1,400 @@
+#include "io_reactor.h"
+#include "config.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+
+enum { K_ADC = 0, K_PULSE = 1, K_NUM };
+
+#define PULSE_CHUNK     4096u
+#define ADC_SCRATCH     4096u
+#define POLL_EVENTS     16
+
+typedef struct {
+    int fd;
+    int old_flags;   /* destroy で戻す */
+} port_fd_t;
+
+typedef struct {
+    port_fd_t port[K_NUM];
+    pulse_port_t* pulse;   /* 安全ゲート（pulse_check）用 */
+
+    /* ADC リング（size は2の累乗, head/tail は単調増加） */
+    uint8_t* ring;
+    size_t   mask;
+    uint64_t head, tail;
+    uint64_t total, dropped;
+    uint32_t n_pulse;             /* トレース：送信した回数（pulse_to_first_byte の id） */
+    int      await_first;         /* トレース：送信後の最初の ADC バイトを待っている */
+
+    /* PULSE 送信中の状態（data か rle のどちらか） */
+    int pulse_state;              /* 1=送信中, 0=完了, -1=エラー */
+    const uint8_t* tx_data;
+    size_t tx_len, tx_off;
+    int tx_rle;
+    pulse_rle_cursor_t tx_cur;
+    uint8_t tx_chunk[PULSE_CHUNK];
+    size_t  tx_chunk_len, tx_chunk_off;
+} board_t;
+
+struct io_reactor {
+    int ep;
+    int n_boards;
+    board_t b[IO_REACTOR_MAX_BOARDS];
+};
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ull + (uint64_t)ts.tv_nsec / 1000000ull;
+}
+
+static size_t round_pow2(size_t n)
+{
+    size_t p = 4096;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+static board_t* board_at(io_reactor_t* r, int board)
+{
+    if (!r || board < 0 || board >= r->n_boards) return NULL;
+    return &r->b[board];
+}
+
+io_reactor_t* io_reactor_create(void)
+{
+    io_reactor_t* r = (io_reactor_t*)calloc(1, sizeof(*r));
+    if (!r) return NULL;
+
+    r->ep = epoll_create1(EPOLL_CLOEXEC);
+    if (r->ep < 0) {
+        perror("epoll_create1");
+        free(r);
+        return NULL;
+    }
+    return r;
+}
+
+void io_reactor_destroy(io_reactor_t* r)
+{
+    if (!r) return;
+    for (int i = 0; i < r->n_boards; i++) {
+        board_t* b = &r->b[i];
+        for (int k = 0; k < K_NUM; k++) {
+            if (b->port[k].fd < 0) continue;
+            epoll_ctl(r->ep, EPOLL_CTL_DEL, b->port[k].fd, NULL);
+            fcntl(b->port[k].fd, F_SETFL, b->port[k].old_flags);
+        }
+        free(b->ring);
+    }
+    close(r->ep);
+    free(r);
+}
+
+/* fd を非ブロッキングにして epoll に登録（data.u64 = 基板番号<<8 | 種類） */
+static int watch_fd(io_reactor_t* r, int board, int kind, int fd, uint32_t events)
+{
+    port_fd_t* pf = &r->b[board].port[kind];
+    pf->fd = -1;
+    if (fd < 0) return 0;
+
+    int fl = fcntl(fd, F_GETFL);
+    if (fl < 0 || fcntl(fd, F_SETFL, fl | O_NONBLOCK) < 0) {
+        perror("fcntl O_NONBLOCK");
+        return -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events | EPOLLET;
+    ev.data.u64 = ((uint64_t)board << 8) | (uint64_t)kind;
+    if (epoll_ctl(r->ep, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl ADD");
+        fcntl(fd, F_SETFL, fl);
+        return -1;
+    }
+    pf->fd = fd;
+    pf->old_flags = fl;
+    return 0;
+}
+
+int io_reactor_add_board(io_reactor_t* r, adc_port_t* adc, pulse_port_t* pulse,
+                         size_t adc_ring_bytes)
+{
+    if (!r || r->n_boards >= IO_REACTOR_MAX_BOARDS) return -1;
+
+    int idx = r->n_boards;
+    board_t* b = &r->b[idx];
+    memset(b, 0, sizeof(*b));
+    for (int k = 0; k < K_NUM; k++) b->port[k].fd = -1;
+    b->pulse = pulse;
+
+    if (adc) {
+        size_t sz = round_pow2(adc_ring_bytes ? adc_ring_bytes : IO_REACTOR_ADC_RING);
+        b->ring = (uint8_t*)malloc(sz);
+        if (!b->ring) return -1;
+        memset(b->ring, 0, sz);   /* 受信中のページフォルト対策 */
+        b->mask = sz - 1;
+    }
+
+    /* 途中で失敗したら登録済みの fd を戻すため、n_boards は先に進めておく */
+    r->n_boards++;
+    if (watch_fd(r, idx, K_ADC,   adc_fd(adc),     EPOLLIN) != 0 ||
+        watch_fd(r, idx, K_PULSE, pulse_fd(pulse), EPOLLOUT) != 0) {
+        for (int k = 0; k < K_NUM; k++) {
+            if (b->port[k].fd < 0) continue;
+            epoll_ctl(r->ep, EPOLL_CTL_DEL, b->port[k].fd, NULL);
+            fcntl(b->port[k].fd, F_SETFL, b->port[k].old_flags);
+        }
+        free(b->ring);
+        r->n_boards--;
+        return -1;
+    }
+    return idx;
+}
+
+/* ===== ADC ===== */
+
+/* EAGAIN まで読む。空きは最大2区間（折り返し）なので readv 1回で埋める */
+static void on_adc(board_t* b)
+{
+    const int fd = b->port[K_ADC].fd;
+    const size_t size = b->mask + 1;
+    uint8_t scratch[ADC_SCRATCH];
+
+    for (;;) {
+        size_t used = (size_t)(b->head - b->tail);
+        size_t room = size - used;
+        ssize_t n;
+
+        if (room == 0) {
+            /* 満杯：取りこぼしとして数えて読み捨てる（fd を詰まらせない） */
+            n = read(fd, scratch, sizeof(scratch));
+            if (n > 0) { b->dropped += (uint64_t)n; continue; }
+        } else {
+            size_t w = (size_t)(b->head & b->mask);
+            size_t first = size - w;
+            if (first > room) first = room;
+            struct iovec iov[2] = {
+                { b->ring + w, first },
+                { b->ring,     room - first },
+            };
+            uint64_t t0 = trace_now();
+            n = readv(fd, iov, (room > first) ? 2 : 1);
+            if (n > 0) {
+                trace_span("adc_read", t0, (uint32_t)n);   /* 最後の EAGAIN は区間にしない */
+                if (b->await_first) {
+                    b->await_first = 0;
+                    trace_async_end("pulse_to_first_byte", b->n_pulse);
+                    trace_instant("adc_first_byte", b->n_pulse);
+                }
+                b->head  += (uint64_t)n;
+                b->total += (uint64_t)n;
+                continue;
+            }
+        }
+        if (n < 0 && errno == EINTR) continue;
+        break;   /* EAGAIN / EOF / エラー */
+    }
+}
+
+size_t io_reactor_adc_available(io_reactor_t* r, int board)
+{
+    board_t* b = board_at(r, board);
+    return (b && b->ring) ? (size_t)(b->head - b->tail) : 0;
+}
+
+size_t io_reactor_adc_read(io_reactor_t* r, int board, uint8_t* dst, size_t n)
+{
+    board_t* b = board_at(r, board);
+    if (!b || !b->ring || !dst) return 0;
+
+    size_t avail = (size_t)(b->head - b->tail);
+    if (n > avail) n = avail;
+
+    size_t size = b->mask + 1;
+    size_t rd = (size_t)(b->tail & b->mask);
+    size_t first = size - rd;
+    if (first > n) first = n;
+    memcpy(dst, b->ring + rd, first);
+    memcpy(dst + first, b->ring, n - first);
+    b->tail += (uint64_t)n;
+    return n;
+}
+
+void io_reactor_adc_discard(io_reactor_t* r, int board)
+{
+    board_t* b = board_at(r, board);
+    if (b) b->tail = b->head;
+}
+
+uint64_t io_reactor_adc_total(io_reactor_t* r, int board)
+{
+    board_t* b = board_at(r, board);
+    return b ? b->total : 0;
+}
+
+uint64_t io_reactor_adc_dropped(io_reactor_t* r, int board)
+{
+    board_t* b = board_at(r, board);
+    return b ? b->dropped : 0;
+}
+
+/* ===== PULSE ===== */
+
+/* 書けるだけ書く。RLE はチャンクごとに展開して書く */
+static void on_pulse(board_t* b)
+{
+    const int fd = b->port[K_PULSE].fd;
+
+    while (b->pulse_state == 1) {
+        const uint8_t* src;
+        size_t left;
+        if (b->tx_rle) {
+            if (b->tx_chunk_off == b->tx_chunk_len) {
+                b->tx_chunk_len = pulse_rle_expand(&b->tx_cur, b->tx_chunk, sizeof(b->tx_chunk));
+                b->tx_chunk_off = 0;
+                if (b->tx_chunk_len == 0) { b->pulse_state = 0; break; }
+            }
+            src  = b->tx_chunk + b->tx_chunk_off;
+            left = b->tx_chunk_len - b->tx_chunk_off;
+        } else {
+            if (b->tx_off == b->tx_len) { b->pulse_state = 0; break; }
+            src  = b->tx_data + b->tx_off;
+            left = b->tx_len - b->tx_off;
+        }
+
+        trace_begin("pulse_write", b->n_pulse);
+        ssize_t w = write(fd, src, left);
+        trace_end("pulse_write", w > 0 ? (uint32_t)w : 0u);
+        if (w > 0) {
+            if (b->tx_rle) b->tx_chunk_off += (size_t)w;
+            else           b->tx_off += (size_t)w;
+            continue;
+        }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;  /* EPOLLOUT 待ち */
+        perror("pulse write");
+        b->pulse_state = -1;
+    }
+}
+
+static board_t* pulse_board(io_reactor_t* r, int board)
+{
+    board_t* b = board_at(r, board);
+    if (!b || b->port[K_PULSE].fd < 0) return NULL;
+    if (b->pulse_state == 1) {
+        fprintf(stderr, "PULSE busy (board %d)\n", board);
+        return NULL;
+    }
+    return b;
+}
+
+int io_reactor_pulse_submit(io_reactor_t* r, int board, const uint8_t* data, size_t len)
+{
+    board_t* b = pulse_board(r, board);
+    if (!b) return -1;
+    /* pulse_write と同じ安全ゲート */
+    if (pulse_check(b->pulse, data, len) != PULSE_OK) return -1;
+
+    b->tx_rle = 0;
+    b->tx_data = data;
+    b->tx_len = len;
+    b->tx_off = 0;
+    b->pulse_state = 1;
+    b->await_first = 1;
+    trace_async_begin("pulse_to_first_byte", ++b->n_pulse);
+    on_pulse(b);   /* 書ける分は今書く（残りは EPOLLOUT で） */
+    return (b->pulse_state < 0) ? -1 : 0;
+}
+
+int io_reactor_pulse_submit_rle(io_reactor_t* r, int board, const pulse_rle_t* rle)
+{
+    board_t* b = pulse_board(r, board);
+    if (!b) return -1;
+    if (pulse_check_rle(b->pulse, rle) != PULSE_OK) return -1;
+
+    b->tx_rle = 1;
+    pulse_rle_cursor_init(&b->tx_cur, rle);
+    b->tx_chunk_len = b->tx_chunk_off = 0;
+    b->pulse_state = 1;
+    b->await_first = 1;
+    trace_async_begin("pulse_to_first_byte", ++b->n_pulse);
+    on_pulse(b);
+    return (b->pulse_state < 0) ? -1 : 0;
+}
+
+int io_reactor_pulse_busy(io_reactor_t* r, int board)
+{
+    board_t* b = board_at(r, board);
+    return b ? b->pulse_state : -1;
+}
+
+/* ===== イベントループ ===== */
+
+int io_reactor_poll(io_reactor_t* r, int timeout_ms)
+{
+    if (!r) return -1;
+
+    struct epoll_event ev[POLL_EVENTS];
+    int n = epoll_wait(r->ep, ev, POLL_EVENTS, timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR) return 0;
+        perror("epoll_wait");
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int board = (int)(ev[i].data.u64 >> 8);
+        int kind  = (int)(ev[i].data.u64 & 0xff);
+        board_t* b = &r->b[board];
+        uint32_t e = ev[i].events;
+
+        switch (kind) {
+        case K_ADC:
+            if (e & (EPOLLIN | EPOLLHUP | EPOLLERR)) on_adc(b);
+            break;
+        case K_PULSE:
+            if (e & (EPOLLOUT | EPOLLERR)) on_pulse(b);
+            break;
+        default:
+            break;
+        }
+    }
+    return n;
+}
+
+int io_reactor_adc_wait(io_reactor_t* r, int board, size_t want,
+                        int start_timeout_ms, int idle_timeout_ms)
+{
+    board_t* b = board_at(r, board);
+    if (!b || !b->ring || want > b->mask + 1) return -1;
+
+    const uint64_t total0 = b->total;
+    uint64_t last_total = total0;
+    uint64_t t_last = now_ms();
+
+    while ((size_t)(b->head - b->tail) < want) {
+        /* まだ1byteも来ていなければ start、来てからは idle で打ち切る */
+        int limit = (b->total == total0) ? start_timeout_ms : idle_timeout_ms;
+        uint64_t now = now_ms();
+        if (b->total != last_total) {
+            last_total = b->total;
+            t_last = now;
+        }
+        if (now - t_last >= (uint64_t)limit) break;
+
+        if (io_reactor_poll(r, (int)((uint64_t)limit - (now - t_last))) < 0) return -1;
+    }
+    return (int)(b->head - b->tail);
+}
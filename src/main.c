@@ -2,19 +2,31 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
 #include <pthread.h>
 
 #include "config.h"
-#include "ctrl_port.h"
+#include "ctrl_session.h"
 #include "pulse_port.h"
 #include "adc_port.h"
-
-/* ====== ADC設定 ======
-   ADC_READ_BYTES は基板側の設定（read_bytes等）と合わせる */
-#ifndef ADC_READ_BYTES
-#define ADC_READ_BYTES (256000)     /* 64ms @ 1MHz, 4byte/sample -> 256000 bytes */
-#endif
-
+#include "adc_source.h"
+#include "io_reactor.h"
+#include "ping_loop.h"
+#include "adc_decode.h"
+#include "crosscorr.h"
+#include "detect.h"
+#include "tdoa.h"
+#include "doppler.h"
+#include "ddc.h"
+#include "capture.h"
+#include "wav_writer.h"
+#include "rt_thread.h"
+#include "arena.h"
+#include "trace.h"
+
+/* ====== ADC設定（ADC_READ_BYTES は config.h） ====== */
 #ifndef ADC_START_TIMEOUT_MS
 #define ADC_START_TIMEOUT_MS (500)  /* 最初の1byte待ち */
 #endif
@@ -23,86 +35,543 @@
 #define ADC_IDLE_TIMEOUT_MS  (2000) /* 途中でデータが途切れたら失敗 */
 #endif
 
-typedef struct {
-    adc_port_t* adc;
-    uint8_t* buf;
-    size_t want;
-    size_t got;
-    int ok;             /* 1=成功 */
-} adc_thread_ctx_t;
-
-/* 指定バイト数を「開始待ち + 活動タイムアウト」で読み切る
-   戻り値: want(成功) / 0..want-1(途中まで) / -1(エラー) */
-static int adc_read_exact(adc_port_t* adc, uint8_t* buf, size_t want,
-                          int start_timeout_ms, int idle_timeout_ms)
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* セッションのバッファ：arena から（足りない / 無いときは calloc。どちらも 0 埋め） */
+static void* session_alloc(arena_t* ar, size_t n)
 {
-    if (!adc || !buf || want == 0) return -1;
+    void* p = arena_alloc(ar, n, 64);
+    return p ? p : calloc(1, n);
+}
 
-    size_t got = 0;
+static void session_free(arena_t* ar, void* p)
+{
+    if (!arena_owns(ar, p)) free(p);
+}
 
-    /* 1) 開始待ち：最初のデータが来るまで */
-    int n = adc_read(adc, buf, want, start_timeout_ms);
-    if (n < 0) return -1;
-    if (n == 0) return 0;          /* 何も来なかった */
-    got += (size_t)n;
+/* 保存ファイル名の時刻部分（例 "20250101_120000"） */
+static void make_stamp(char* out, size_t n)
+{
+    time_t t = time(NULL);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(out, n, "%Y%m%d_%H%M%S", &tm);
+}
 
-    /* 2) 活動タイムアウト：データが来ている間は継続、途切れたら終了 */
-    while (got < want) {
-        int m = adc_read(adc, buf + got, want - got, idle_timeout_ms);
-        if (m < 0) return -1;
-        if (m == 0) return (int)got;  /* 途中で途切れた */
-        got += (size_t)m;
+/* 録音コンテナを時刻入りの名前で開き、送信パルスを登録する（開けなければ NULL：計測は続ける） */
+static capture_writer_t* open_capture(const char* stamp, const capture_pulse_t* cp, int* pulse_id)
+{
+    char path[160];
+    struct timespec rt;
+    clock_gettime(CLOCK_REALTIME, &rt);
+    snprintf(path, sizeof(path), "%s/cap_%s.tpcap", CAPTURE_DIR, stamp);
+
+    capture_session_t s;
+    memset(&s, 0, sizeof(s));
+    s.fs_adc = 1e6;
+    s.capture_bytes = ADC_READ_BYTES;
+    s.compress = CAPTURE_COMPRESS;
+    s.t_open_ns = now_ns();
+    s.t_open_unix_ns = (int64_t)rt.tv_sec * 1000000000ll + rt.tv_nsec;
+    snprintf(s.note, sizeof(s.note), "%s %.0fk->%.0fk %.1fms duty%d",
+             cp->kind == CAPTURE_PULSE_FM ? "FM" : "CF", cp->f_start_hz * 1e-3, cp->f_end_hz * 1e-3,
+             cp->dur_s * 1e3, cp->duty_percent);
+
+    capture_writer_t* w = capture_writer_open(path, &s);
+    if (!w) {
+        printf("capture open failed: %s\n", path);
+        return NULL;
     }
+    *pulse_id = capture_writer_add_pulse(w, cp);
+    printf("capture: %s (compress=%d)\n", path, CAPTURE_COMPRESS);
+    return w;
+}
 
-    return (int)got;
+/* 同じ時刻の名前で WAV（とプレビュー）を開く。reserve_frames = 0 なら 1秒分から広げる */
+static wav_writer_t* open_wav(const char* stamp, uint64_t reserve_frames)
+{
+    char path[160], ppath[160];
+    snprintf(path, sizeof(path), "%s/cap_%s.wav", CAPTURE_DIR, stamp);
+    wav_writer_t* w = wav_writer_open(path, 1000000, reserve_frames);
+    if (!w) {
+        printf("wav open failed: %s\n", path);
+        return NULL;
+    }
+    if (WAV_PREVIEW_DECIM >= 2) {
+        snprintf(ppath, sizeof(ppath), "%s/cap_%s_preview.wav", CAPTURE_DIR, stamp);
+        if (wav_writer_add_preview(w, ppath, WAV_PREVIEW_DECIM) != 0) printf("wav preview failed: %s\n", ppath);
+    }
+    printf("wav: %s\n", path);
+    return w;
 }
 
-static void* adc_reader_thread(void* arg)
+/* 連続ピング中のエラーカウンタ（ctrl_session のコールバックで更新） */
+typedef struct {
+    uint32_t pe0, ae0;   /* ループ開始時 */
+    uint32_t pe, ae;     /* 最新 */
+    int have0, have;
+} ping_err_t;
+
+static void on_ping_errors(void* user, const ctrl_reply_t* rep)
 {
-    adc_thread_ctx_t* ctx = (adc_thread_ctx_t*)arg;
-    ctx->ok = 0;
-    ctx->got = 0;
-
-    int rc = adc_read_exact(ctx->adc, ctx->buf, ctx->want,
-                            ADC_START_TIMEOUT_MS, ADC_IDLE_TIMEOUT_MS);
-
-    if (rc == (int)ctx->want) {  // 成功
-        ctx->ok = 1;
-        ctx->got = ctx->want;
-    } else if (rc >= 0) {        // 未完了（途中まで）
-        ctx->ok = 0;
-        ctx->got = (size_t)rc;
-    } else {                     // エラー
-        ctx->ok = 0;
-        ctx->got = 0;
+    ping_err_t* e = (ping_err_t*)user;
+    uint32_t pe, ae;
+    if (rep->status != 0 || ctrl_parse_errors(rep->line, &pe, &ae) != 0) return;
+    if (!e->have0) { e->pe0 = pe; e->ae0 = ae; e->have0 = 1; }
+    e->pe = pe;
+    e->ae = ae;
+    e->have = 1;
+}
+
+/* 受信元を選ぶ："file:PATH" = 保存済み bin を実時間で再生 / "synth" = 擬似エコー / NULL = 実機 */
+static adc_source_t* open_source(const char* spec, const float* ref, size_t ref_len, double fs)
+{
+    if (!spec) return adc_source_open_tty(ADC_DEVICE_PATH, ADC_BAUDRATE);
+
+    if (strncmp(spec, "file:", 5) == 0)
+        return adc_source_open_file(spec + 5, ADC_READ_BYTES, ADC_SOURCE_REALTIME_BPS, 1);
+
+    if (strcmp(spec, "synth") == 0) {
+        adc_synth_cfg_t sc;
+        memset(&sc, 0, sizeof(sc));
+        sc.chirp = ref;
+        sc.chirp_len = ref_len;
+        sc.fs = fs;
+        sc.capture_bytes = ADC_READ_BYTES;
+        sc.n_echo = 1;
+        sc.echo[0].delay_s = SYNTH_ECHO_DELAY_S;
+        sc.echo[0].itd_s   = SYNTH_ECHO_ITD_S;
+        sc.echo[0].amp_l   = SYNTH_ECHO_AMP;
+        sc.echo[0].amp_r   = SYNTH_ECHO_AMP;
+        sc.snr_db = SYNTH_SNR_DB;
+        sc.bytes_per_s = ADC_SOURCE_REALTIME_BPS;
+        return adc_source_open_synth(&sc);
     }
+    printf("unknown source: %s (file:PATH | synth)\n", spec);
     return NULL;
 }
 
-static int save_bin(const char* path, const uint8_t* data, size_t len)
+/* 実時間モードの結果と遅延ヒストグラムを表示し、RT_HIST_PATH に追記する */
+static void report_rt(const char* stamp, const ping_loop_rt_t* rt)
 {
-    FILE* f = fopen(path, "wb");
-    if (!f) { perror("fopen bin"); return -1; }
-    size_t w = fwrite(data, 1, len, f);
+    static const char* st[] = { "incomplete", "off", "on" };
+    printf("rt: adc=%s pulse=%s\n", st[rt->rt_adc + 1], st[rt->rt_pulse + 1]);
+    rt_hist_print(stdout, "pulse_wake", &rt->pulse_wake);
+    rt_hist_print(stdout, "adc_wake", &rt->adc_wake);
+    rt_hist_print(stdout, "read_gap", &rt->read_gap);
+
+    if (RT_HIST_PATH[0] == '\0') return;
+    FILE* f = fopen(RT_HIST_PATH, "a");
+    if (!f) {
+        perror(RT_HIST_PATH);
+        return;
+    }
+    int header = (ftell(f) == 0);
+    rt_hist_write_csv(f, header, stamp, "pulse_wake", &rt->pulse_wake);
+    rt_hist_write_csv(f, 0, stamp, "adc_wake", &rt->adc_wake);
+    rt_hist_write_csv(f, 0, stamp, "read_gap", &rt->read_gap);
     fclose(f);
-    return (w == len) ? 0 : -1;
 }
 
-int main(void)
+/* Ctrl-C / SIGTERM：フラグを立てるだけ。処理ループが ping_loop_stop に変える（2回目は既定動作で即終了） */
+static volatile sig_atomic_t g_stop_req = 0;
+
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    g_stop_req = 1;
+}
+
+/* SIGINT / SIGTERM のブロック（how = SIG_BLOCK / SIG_UNBLOCK）。
+   ブロック中に作ったスレッド（Doppler・送信・受信）はそれを受け継ぐので、シグナルはメインスレッドにだけ届く */
+static void stop_signals_mask(int how)
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(how, &set, NULL);
+}
+
+static void install_stop_handler(void)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+
+/* TRACE_ENABLE のとき：全スレッドの記録を TRACE_PATH へ書き出して解放（スレッドを止めてから呼ぶ） */
+static void finish_trace(void)
+{
+    if (!trace_enabled()) return;
+    trace_stop();
+    long n = trace_write_json(TRACE_PATH);
+    if (n >= 0) printf("trace: %ld events (dropped %llu) -> %s\n",
+                       n, (unsigned long long)trace_dropped(), TRACE_PATH);
+    else        printf("trace write failed\n");
+    trace_shutdown();
+}
+
+/* 検出したエコーを距離順に1行で（例: "  L: 0.995m/24.1dB 1.731m/15.0dB"）
+   itd / v があれば各エコーの R-L（us）と Doppler 速度も付ける */
+static void print_echoes(const char* ch, const detect_echo_t* e, int n,
+                         const double* itd_us, const double* v_mps)
+{
+    if (n <= 0) return;
+    printf("  %s:", ch);
+    for (int i = 0; i < n; i++) {
+        printf(" %.3fm/%.1fdB", e[i].range_m, e[i].snr_db);
+        if (itd_us) printf("/itd=%+.2fus", itd_us[i]);
+        if (v_mps)  printf("/v=%+.2fm/s", v_mps[i]);
+    }
+    printf("\n");
+}
+
+/* 連続ピング：ポート・スレッド・受信バッファは最初に1回だけ用意する */
+static int run_ping_loop(ctrl_session_t* cs, const uint8_t* pbuf, size_t wbytes,
+                         const pulse_rle_t* prle, long n_pings, double fs_bit, const char* src_spec,
+                         const capture_pulse_t* cpul, int gain, arena_t* ar)
+{
+    /* 相関の準備（プラン作成はスレッド開始前に済ませる） */
+    const int N = (int)(ADC_READ_BYTES / 4);
+    const double FS_ADC = 1e6;
+
+    xcorr_opts_t xo;
+    memset(&xo, 0, sizeof(xo));
+    xo.plan_mode = XCORR_PLAN_MODE;
+    xo.wisdom_only = 1;   /* wisdom が無ければ ESTIMATE（起動を待たせない） */
+    xo.arena = ar;        /* FFT バッファ（相関・TDOA・Doppler）もセッションの arena から */
+    if (xcorr_wisdom_import(XCORR_WISDOM_PATH) != 0)
+        printf("no FFTW wisdom (%s): run build/xcorr_wisdom once\n", XCORR_WISDOM_PATH);
+
+    /* DDC_DECIM > 1 なら L/R を複素ベースバンドに落とし、1/D の点数で相関する */
+    const int D = DDC_DECIM;
+    const int Nc = N / D;           /* 相関・検出の点数 */
+    const double FS_C = FS_ADC / D;
+    ddc_t* ddc = NULL;
+    if (D > 1) {
+        ddc_cfg_t dc;
+        ddc_cfg_default(&dc, FS_ADC);
+        ddc = ddc_create(&dc, (size_t)N);
+    }
+    xcorr_ctx_t* xc = xcorr_create_ex(Nc, FS_C, (D > 1) ? 0.0 : XCORR_HPF_HZ, &xo);
+    float* envL = (float*)session_alloc(ar, sizeof(float) * (size_t)Nc);
+    float* envR = (float*)session_alloc(ar, sizeof(float) * (size_t)Nc);
+    float* ref  = (float*)malloc(sizeof(float) * (size_t)N);   /* 準備の間だけ（DDC の入力が N 点なので N。arena には置かない） */
+    float* lr   = (float*)session_alloc(ar, sizeof(float) * 2 * (size_t)N);   /* xcorr で壊れる前の L/R */
+    float* iqL  = ddc ? (float*)session_alloc(ar, sizeof(float) * 2 * (size_t)Nc) : NULL;   /* L のベースバンド（Doppler 用に残す） */
+    detector_t* det = detect_create((size_t)Nc, DETECT_MAX_ECHOES, DETECT_TRAIN);
+    tdoa_ctx_t* td = tdoa_create(TDOA_WIN, FS_ADC, XCORR_HPF_HZ, 0.0, &xo);
+    if (!xc || !envL || !envR || !ref || !lr || !det || !td || (D > 1 && (!ddc || !iqL))) {
+        printf("xcorr setup failed\n");
+        tdoa_destroy(td);
+        detect_destroy(det);
+        session_free(ar, lr);
+        session_free(ar, iqL);
+        xcorr_destroy(xc);
+        ddc_destroy(ddc);
+        session_free(ar, envL);
+        session_free(ar, envR);
+        free(ref);
+        return 1;
+    }
+    /* 参照 = 送信パルスを ADC レートに落とした波形（synth のエコーにも使う） */
+    size_t ref_len = pulse_bits_to_wave(pbuf, wbytes, (int)(fs_bit / FS_ADC), ref, (size_t)N);
+    if (ddc) {
+        /* 参照も受信と同じ DDC を通す（フィルタの群遅延は相関で打ち消し合う） */
+        ddc_process(ddc, ref, (size_t)N, 1, xcorr_complex_input(xc));
+        xcorr_set_call_complex(xc, xcorr_complex_input(xc));
+        printf("ddc: decim=%d center=%.1fkHz impl=%s\n", D, DDC_CENTER_HZ * 1e-3, ddc_impl());
+    } else {
+        xcorr_set_call_time(xc, ref);
+    }
+    printf("decode impl: %s\n", adc_decode_impl());
+
+    /* 同じ参照を速度ごとに伸縮した Doppler バンク（作れなければ速度は出さない）
+       DDC のときは相関と同じ 1/D の複素ベースバンドで回す（参照も同じ DDC を通す） */
+    double dv[DOPPLER_BINS];
+    doppler_velocities(DOPPLER_VMAX_MPS, DOPPLER_BINS, dv);
+    doppler_bank_t* dop = ddc
+        ? doppler_bank_create_ddc(N, ddc, ref, ref_len, dv, DOPPLER_BINS,
+                                  SOUND_SPEED_MPS, DOPPLER_THREADS, &xo)
+        : doppler_bank_create(N, FS_ADC, XCORR_HPF_HZ, ref, ref_len, dv, DOPPLER_BINS,
+                              SOUND_SPEED_MPS, DOPPLER_THREADS, &xo);
+    if (!dop) printf("doppler bank setup failed (velocity disabled)\n");
+
+    /* 実機のときだけ PULSE を開く（file / synth は受信だけ） */
+    adc_source_t* adc = open_source(src_spec, ref, ref_len, FS_ADC);
+    free(ref);   /* 相関・Doppler・synth とも create でコピー済み */
+    pulse_port_t* pulse = (adc && !src_spec) ? pulse_open(PULSE_DEVICE_PATH, PULSE_BAUDRATE) : NULL;
+    if (!adc || (!src_spec && !pulse)) {
+        printf("port open failed (adc=%s pulse=%s)\n",
+               src_spec ? src_spec : ADC_DEVICE_PATH, PULSE_DEVICE_PATH);
+        adc_source_close(adc);
+        doppler_bank_destroy(dop);
+        tdoa_destroy(td);
+        detect_destroy(det);
+        session_free(ar, lr);
+        session_free(ar, iqL);
+        xcorr_destroy(xc);
+        ddc_destroy(ddc);
+        session_free(ar, envL);
+        session_free(ar, envR);
+        return 1;
+    }
+    printf("adc source: %s\n", adc_source_name(adc));
+    if (adc_source_port(adc))
+        serial_info_print("ADC", ADC_DEVICE_PATH, adc_serial_info(adc_source_port(adc)));
+
+    ping_loop_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.capture_bytes    = ADC_READ_BYTES;
+    cfg.n_slots          = PING_POOL_SLOTS;
+    cfg.period_ms        = PING_PERIOD_MS;
+    cfg.start_timeout_ms = ADC_START_TIMEOUT_MS;
+    cfg.idle_timeout_ms  = ADC_IDLE_TIMEOUT_MS;
+    cfg.max_pings        = n_pings;
+    cfg.ring_mirror      = PING_RING_MIRROR;
+    if (RT_ENABLE) {
+        /* ここまでに確保したもの（相関・Doppler・受信元）ごと固定。受信バッファは create で触る */
+        rt_lock_memory();
+        cfg.rt_adc.prio     = RT_PRIO_ADC;
+        cfg.rt_adc.cpu_mask = (RT_CPU_ADC >= 0) ? (uint64_t)1 << RT_CPU_ADC : 0;
+        cfg.rt_pulse.prio     = RT_PRIO_PULSE;
+        cfg.rt_pulse.cpu_mask = (RT_CPU_PULSE >= 0) ? (uint64_t)1 << RT_CPU_PULSE : 0;
+    }
+
+    ping_loop_t* pl = ping_loop_create(adc, pulse, prle, &cfg);
+    if (!pl || ping_loop_start(pl) != 0) {
+        printf("ping_loop start failed\n");
+        ping_loop_destroy(pl);
+        pulse_close(pulse);
+        adc_source_close(adc);
+        doppler_bank_destroy(dop);
+        tdoa_destroy(td);
+        detect_destroy(det);
+        session_free(ar, lr);
+        session_free(ar, iqL);
+        xcorr_destroy(xc);
+        ddc_destroy(ddc);
+        session_free(ar, envL);
+        session_free(ar, envR);
+        return 1;
+    }
+    stop_signals_mask(SIG_UNBLOCK);   /* スレッドは作り終えた：ここからメインスレッドで受ける */
+    ping_loop_stats_t st;
+    ping_loop_get_stats(pl, &st);
+    printf("ping loop: period=%dms slots=%d pings=%ld ring=%zuKB%s\n",
+           PING_PERIOD_MS, PING_POOL_SLOTS, n_pings, st.ring_bytes / 1024u,
+           st.ring_mirrored ? " (mirrored)" : "");
+
+    char stamp[32];
+    make_stamp(stamp, sizeof(stamp));
+    int cap_pid = -1;
+    capture_writer_t* cap = CAPTURE_LOOP_SAVE ? open_capture(stamp, cpul, &cap_pid) : NULL;
+    wav_writer_t* wav = WAV_LOOP_SAVE ? open_wav(stamp, (uint64_t)n_pings * (ADC_READ_BYTES / 4)) : NULL;
+    ping_err_t cap_prev;   /* 前のピングを記録したときのエラーカウンタ */
+    memset(&cap_prev, 0, sizeof(cap_prev));
+
+    /* 受信済みピングを順に処理（この間に次のピングを受信している） */
+    ping_frame_t f;
+    int r;
+    ping_err_t perr;
+    memset(&perr, 0, sizeof(perr));
+    ctrl_session_req_errors(cs, on_ping_errors, &perr);
+    adc_decode_opt_t dopt = { 1.0f, 0.0f, 0.0f };   /* DC は前ピングの平均で追従 */
+    adc_decode_stat_t dst;
+    detect_cfg_t dcfg;
+    detect_cfg_default(&dcfg);
+    if (D > 1) {
+        /* ガードと山のまとめ幅は時間で同じになるように（訓練セルは数を保つ） */
+        dcfg.guard   = (dcfg.guard / D > 2) ? dcfg.guard / D : 2;
+        dcfg.min_sep = (dcfg.min_sep / D > 1) ? dcfg.min_sep / D : 1;
+    }
+    detect_echo_t echL[DETECT_MAX_ECHOES], echR[DETECT_MAX_ECHOES];
+    double itd_us[DETECT_MAX_ECHOES], v_mps[DETECT_MAX_ECHOES];
+    int stopping = 0;
+    while ((r = ping_loop_acquire(pl, &f, PING_PERIOD_MS * 10)) >= 0) {
+        if (g_stop_req && !stopping) {
+            /* 送信を止める。受信済みのピングは処理し切り、保存・集計はいつもどおり閉じる */
+            printf("stop requested\n");
+            ping_loop_stop(pl);
+            stopping = 1;
+        }
+        ctrl_session_process(cs);   /* 届いている返答だけ拾う（待たない） */
+        if (r == 0) continue;
+        trace_begin("ping", (uint32_t)f.seq);
+
+        /* 生データ → xcorr のステレオ入力へ直接（1パス）。DDC のときは lr へ */
+        float* in = ddc ? lr : xcorr_stereo_input(xc);
+        trace_begin("decode", (uint32_t)f.got);
+        size_t nf = adc_decode_interleaved(f.data, f.got, in, &dopt, &dst);
+        trace_end("decode", (uint32_t)nf);
+        trace_begin("save", (uint32_t)f.got);
+        if (cap) {
+            /* エラーは返答が非同期なので「前のピングの記録時点」と「今届いている値」 */
+            capture_ping_t rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.seq = f.seq;
+            rec.pulse_id = cap_pid;
+            rec.gain = gain;
+            rec.ok = f.ok;
+            rec.have_err_before = cap_prev.have;
+            rec.err_before_pulse = cap_prev.pe;
+            rec.err_before_adc = cap_prev.ae;
+            rec.have_err_after = perr.have;
+            rec.err_after_pulse = perr.pe;
+            rec.err_after_adc = perr.ae;
+            rec.t_pulse_ns = f.t_pulse_ns;
+            rec.t_done_ns = f.t_done_ns;
+            if (capture_writer_add_ping(cap, &rec, f.data, f.got) != 0) {
+                printf("capture write failed (recording stopped)\n");
+                capture_writer_close(cap);
+                cap = NULL;
+            }
+            cap_prev = perr;
+        }
+        if (wav && wav_writer_push_raw(wav, f.data, f.got) != 0) {
+            printf("wav write failed (stopped)\n");
+            wav_writer_close(wav);
+            wav = NULL;
+        }
+        trace_end("save", (uint32_t)f.got);
+        ping_loop_release(pl, &f);   /* 以降は生データ不要：すぐ次の受信に回す */
+        if (nf < (size_t)N) memset(in + 2*nf, 0, sizeof(float) * 2 * ((size_t)N - nf));
+        dopt.dc_l = (float)dst.mean_l;
+        dopt.dc_r = (float)dst.mean_r;
+
+        trace_begin("xcorr", (uint32_t)N);
+        if (ddc) {
+            float* iq = xcorr_complex_input(xc);
+            ddc_process(ddc, lr, (size_t)N, 2, iqL);   /* L は Doppler でも使うので残す */
+            xcorr_run_envelope_complex(xc, iqL, envL);
+            ddc_process(ddc, lr + 1, (size_t)N, 2, iq);
+            xcorr_run_envelope_complex(xc, iq, envR);
+        } else {
+            memcpy(lr, in, sizeof(float) * 2 * (size_t)N);
+            xcorr_run_envelope_stereo_packed(xc, envL, envR);
+        }
+        trace_end("xcorr", (uint32_t)N);
+        /* ピーク・エコーの index は相関の点数（1/D）。TDOA は ×D して 1MHz で使う（Doppler は 1/D のまま） */
+        size_t pkL = xcorr_argmax_range(envL, (size_t)Nc, 0, (size_t)Nc) * (size_t)D;
+        size_t pkR = xcorr_argmax_range(envR, (size_t)Nc, 0, (size_t)Nc) * (size_t)D;
+        trace_begin("detect", (uint32_t)Nc);
+        int neL = detect_run(det, &dcfg, envL, (size_t)Nc, FS_C, SOUND_SPEED_MPS, echL);
+        int neR = detect_run(det, &dcfg, envR, (size_t)Nc, FS_C, SOUND_SPEED_MPS, echR);
+        trace_end("detect", (uint32_t)(neL + neR));
+
+        printf("ping %llu: %s got=%zu latency=%.1fms peakL=%zu peakR=%zu echoes=%d/%d err=+%d/+%d\n",
+               (unsigned long long)f.seq, f.ok ? "OK" : "NG", f.got,
+               (double)(f.t_done_ns - f.t_pulse_ns) * 1e-6, pkL, pkR, neL, neR,
+               perr.have ? (int)(perr.pe - perr.pe0) : 0, perr.have ? (int)(perr.ae - perr.ae0) : 0);
+
+        /* L で見つけたエコーごとに、エコー本体（ラグ + 参照長の中央）で R-L を測る */
+        trace_begin("tdoa", (uint32_t)neL);
+        for (int e = 0; e < neL; e++) {
+            tdoa_result_t tr;
+            size_t center = (size_t)(echL[e].index * D) + ref_len / 2;
+            itd_us[e] = (tdoa_run(td, lr, (size_t)N, center, TDOA_MAX_LAG,
+                                  TDOA_PHAT, TDOA_INTERP_SINC, &tr) == 0) ? tr.delay_s * 1e6 : NAN;
+        }
+        trace_end("tdoa", (uint32_t)neL);
+
+        /* L の受信を1回だけ FFT して全速度の参照と相関 → エコーのラグ付近で一番合った速度
+           （DDC のときは iqL の N/D 点。ラグ・ガードも相関と同じ 1/D 単位） */
+        trace_begin("doppler", (uint32_t)neL);
+        int have_v = (dop && neL > 0 &&
+                      (ddc ? doppler_bank_run_complex(dop, iqL) : doppler_bank_run(dop, lr, 2)) == 0);
+        trace_end("doppler", (uint32_t)have_v);
+        if (have_v) {
+            for (int e = 0; e < neL; e++) {
+                doppler_best_t db;
+                v_mps[e] = (doppler_bank_best(dop, (size_t)(echL[e].index + 0.5), dcfg.guard, &db) == 0)
+                         ? db.v_interp : NAN;
+            }
+        }
+        print_echoes("L", echL, neL, itd_us, have_v ? v_mps : NULL);
+        print_echoes("R", echR, neR, NULL, NULL);
+
+        /* 次のピングのエラー確認を積んでおく（前の返答が残っていれば積まない） */
+        if (ctrl_session_pending(cs) == 0) ctrl_session_req_errors(cs, on_ping_errors, &perr);
+        trace_end("ping", (uint32_t)f.seq);
+    }
+
+    ping_loop_get_stats(pl, &st);
+    printf("ping loop done: fired=%llu captured=%llu incomplete=%llu skipped=%llu pulse_err=%llu late_max=%.2fms\n",
+           (unsigned long long)st.fired, (unsigned long long)st.captured,
+           (unsigned long long)st.incomplete, (unsigned long long)st.skipped,
+           (unsigned long long)st.pulse_errors, (double)st.late_ns_max * 1e-6);
+    ping_loop_rt_t prt;
+    ping_loop_get_rt(pl, &prt);
+    report_rt(stamp, &prt);
+    arena_print(stdout, "session", ar);   /* 開始前と used が同じなら、ピング中の確保は無い */
+    if (cap) {
+        unsigned long long np = (unsigned long long)capture_writer_pings(cap);
+        if (capture_writer_close(cap) != 0) printf("capture close failed\n");
+        else                                printf("capture: %llu pings\n", np);
+    }
+    if (wav) {
+        double sec = (double)wav_writer_frames(wav) * 1e-6;
+        if (wav_writer_close(wav) != 0) printf("wav close failed\n");
+        else                            printf("wav: %.3f s\n", sec);
+    }
+
+    ping_loop_destroy(pl);
+    pulse_close(pulse);
+    adc_source_close(adc);
+    doppler_bank_destroy(dop);
+    tdoa_destroy(td);
+    detect_destroy(det);
+    session_free(ar, lr);
+    session_free(ar, iqL);
+    xcorr_destroy(xc);
+    ddc_destroy(ddc);
+    session_free(ar, envL);
+    session_free(ar, envR);
+    return 0;
+}
+
+int main(int argc, char** argv)
 {
+    /* "loop [N]" で連続ピング（N省略 = 10回, 0 = Ctrl-C / SIGTERM で止めるまで。負は使い方を出して終了） */
+    int loop_mode = (argc > 1 && strcmp(argv[1], "loop") == 0);
+    long n_pings = (argc > 2) ? strtol(argv[2], NULL, 10) : 10;
+    /* "loop N file:PATH" / "loop N synth" で実機なしに再生（省略 = 実機） */
+    const char* src_spec = (argc > 3) ? argv[3] : NULL;
+    if (loop_mode && n_pings < 0) {
+        printf("usage: %s loop [N >= 0 (0 = until Ctrl-C)] [file:PATH | synth]\n", argv[0]);
+        return 1;
+    }
+
     /* (0) 出力フォルダ */
     (void)system("mkdir -p output/pulse_data output/adc_data");
 
+    /* トレース：パルス生成から記録する（書き出しは最後, finish_trace） */
+    trace_thread_name("main");
+    if (TRACE_ENABLE && trace_start(TRACE_EVENTS_PER_THREAD) != 0) printf("trace start failed\n");
+
     /* ===== (A) CTRL：ゲイン設定 ===== */
-    ctrl_port_t* c2 = ctrl_open(CTRL_DEVICE_PATH, CTRL_BAUDRATE);
-    if (!c2) { printf("ctrl_open failed (gain)\n"); return 1; }
-    if (ctrl_send_line(c2, "g 300\n") != CTRL_OK) {
+    /* CTRL は最後まで開きっぱなし。コマンドは積むだけで返答を待たない */
+    /* file / synth 再生（loop N SRC）は基板なしでも動かす */
+    int replay = loop_mode && src_spec;
+    ctrl_session_t* cs = ctrl_session_open(CTRL_DEVICE_PATH, CTRL_BAUDRATE);
+    if (!cs && !replay) { printf("ctrl_open failed (gain)\n"); return 1; }
+    const int gain = 300;
+    if (cs && ctrl_session_set_gain(cs, gain) == 0) {
         printf("gain set failed\n");
-        ctrl_close(c2);
+        ctrl_session_close(cs);
         return 1;
     }
-    ctrl_close(c2);
-    printf("AMP gain set: g=300\n");
+    if (cs) printf("AMP gain set: g=%d\n", gain);
 
     /* ===== (B) PULSE生成（CF/FＭ切替） ===== */
     typedef enum { MODE_CF, MODE_FM } mode_t;
@@ -120,6 +589,9 @@ int main(void)
     /* duty（安全ゲート60%未満で） */
     int duty_percent = 40;
 
+    /* CF設定 */
+    int freq_khz = 40;
+
     size_t pb;
     size_t wbytes = 0;
 
@@ -130,44 +602,53 @@ int main(void)
         pb = pulse_bytes_for_duration(FS_BIT, dur); /* 8ms -> 10000 bytes */
     }
 
-    /* ② 確保 */
-    uint8_t* pbuf = (uint8_t*)malloc(pb);
-    if (!pbuf) { perror("malloc pbuf"); return 1; }
-
-    /* ③ 生成 */
+    /* ② 確保：パルス・受信・デコード・FFT のバッファはセッションの arena から（全ページ触り済み） */
+    arena_t* ar = arena_create(loop_mode ? ARENA_LOOP_BYTES : ARENA_SHOT_BYTES,
+                               ARENA_USE_HUGEPAGES ? ARENA_HUGEPAGES : 0u);
+    if (!ar) printf("arena create failed (using malloc)\n");
+    uint8_t* pbuf = (uint8_t*)session_alloc(ar, pb);
+    if (!pbuf) { perror("malloc pbuf"); arena_destroy(ar); ctrl_session_close(cs); return 1; }
+
+    /* ③ 生成（RLE: On/Off の長さの列。送信時にチャンク展開する） */
+    pulse_rle_t prle;
+    memset(&prle, 0, sizeof(prle));
+    int grc;
     if (mode == MODE_CF) {
-        int freq_khz = 40;
-        wbytes = pulse_gen_pfd(pbuf, pb, freq_khz, duty_percent);
+        grc = pulse_rle_gen_pfd(&prle, pb * 8u, freq_khz, duty_percent);
     } else {
-        wbytes = pulse_gen_exp_chirp(pbuf, pb, FS_BIT, dur,
-                                     f_start, f_end, duty_percent);
+        grc = pulse_rle_gen_exp_chirp(&prle, pb * 8u, FS_BIT, dur,
+                                      f_start, f_end, duty_percent);
     }
 
+    /* バイト列は保存・参照波形・連続ピング用に1回だけ展開 */
+    pulse_rle_cursor_t pcur;
+    pulse_rle_cursor_init(&pcur, &prle);
+    if (grc == 0) wbytes = pulse_rle_expand(&pcur, pbuf, pb);
+
     if (wbytes == 0) {
         printf("pulse_gen failed\n");
-        free(pbuf);
+        session_free(ar, pbuf);
+        pulse_rle_free(&prle);
+        ctrl_session_close(cs);
+        arena_destroy(ar);
         return 1;
     }
 
-    /* duty推定（全体の1比率） */
-    unsigned long ones = 0;
-    for (size_t i = 0; i < wbytes; i++) {
-        uint8_t v = pbuf[i];
-        for (int b = 0; b < 8; b++) ones += (v >> b) & 1u;
-    }
-    unsigned long bits = (unsigned long)wbytes * 8ul;
-    printf("duty_est=%.2f%% (ones=%lu bits=%lu)\n",
-           100.0 * (double)ones / (double)bits, ones, bits);
+    /* duty推定（全体の1比率）：送信前チェックと同じく RLE のまま O(周期数) */
+    pulse_stats_t pst;
+    pulse_rle_analyze(&prle, 0, &pst);
+    printf("duty_est=%.2f%% (ones=%zu bits=%zu max_run=%d)\n",
+           pst.duty_percent, pst.ones, pst.bits, pst.max_run);
 
     /* ==== パルス生データ保存（確認用） ==== */
     FILE* fp = fopen("output/pulse_data/pulse_bytes.bin", "wb");
-    if (!fp) { perror("fopen pulse_bytes.bin"); free(pbuf); return 1; }
+    if (!fp) { perror("fopen pulse_bytes.bin"); session_free(ar, pbuf); pulse_rle_free(&prle); ctrl_session_close(cs); arena_destroy(ar); return 1; }
     fwrite(pbuf, 1, wbytes, fp);
     fclose(fp);
 
     /* ビット列も保存（LSB first） */
     FILE* fb = fopen("output/pulse_data/pulse_bits.txt", "w");
-    if (!fb) { perror("fopen pulse_bits.txt"); free(pbuf); return 1; }
+    if (!fb) { perror("fopen pulse_bits.txt"); session_free(ar, pbuf); pulse_rle_free(&prle); ctrl_session_close(cs); arena_destroy(ar); return 1; }
     for (size_t bit = 0; bit < wbytes * 8; bit++) {
         size_t byte_i = bit / 8;
         int bit_i = (int)(bit % 8);
@@ -181,109 +662,174 @@ int main(void)
     printf("  output/pulse_data/pulse_bytes.bin\n");
     printf("  output/pulse_data/pulse_bits.txt\n");
 
-    /* ===== (C) ADC開始（先に受信スレッド） ===== */
+    /* 録音コンテナに入れるパルス定義（波形は RLE のまま） */
+    capture_pulse_t cpul;
+    memset(&cpul, 0, sizeof(cpul));
+    cpul.kind = (mode == MODE_FM) ? CAPTURE_PULSE_FM : CAPTURE_PULSE_CF;
+    cpul.fs_bit = FS_BIT;
+    cpul.dur_s = (mode == MODE_FM) ? dur : (double)pb * 8.0 / FS_BIT;
+    cpul.f_start_hz = (mode == MODE_FM) ? f_start : freq_khz * 1e3;
+    cpul.f_end_hz = (mode == MODE_FM) ? f_end : freq_khz * 1e3;
+    cpul.duty_percent = duty_percent;
+    cpul.n_bytes = wbytes;
+    cpul.runs = prle.runs;
+    cpul.n_runs = prle.n;
+
+    if (loop_mode) {
+        install_stop_handler();
+        stop_signals_mask(SIG_BLOCK);   /* 受信・送信スレッドを作るまで（run_ping_loop で外す） */
+        int rc = run_ping_loop(cs, pbuf, wbytes, &prle, n_pings, FS_BIT, src_spec, &cpul, gain, ar);
+        finish_trace();   /* 受信・送信・Doppler のスレッドは止まっている */
+        session_free(ar, pbuf);
+        pulse_rle_free(&prle);
+        ctrl_session_close(cs);
+        arena_destroy(ar);
+        return rc;
+    }
+
+    /* ===== (C) ADC / PULSE を開いて reactor に登録（受信スレッドなし） ===== */
     adc_port_t* adc = adc_open(ADC_DEVICE_PATH, ADC_BAUDRATE);
     if (!adc) {
         printf("adc_open failed (dev=%s)\n", ADC_DEVICE_PATH);
-        free(pbuf);
+        session_free(ar, pbuf);
+        pulse_rle_free(&prle);
+        ctrl_session_close(cs);
+        arena_destroy(ar);
         return 1;
     }
-    if (adc_flush(adc) != ADC_OK) {
-        printf("adc_flush failed\n");
+    serial_info_print("ADC", ADC_DEVICE_PATH, adc_serial_info(adc));
+    pulse_port_t* pulse = pulse_open(PULSE_DEVICE_PATH, PULSE_BAUDRATE);
+    if (!pulse) {
+        printf("pulse_open failed (dev=%s)\n", PULSE_DEVICE_PATH);
         adc_close(adc);
-        free(pbuf);
+        session_free(ar, pbuf);
+        pulse_rle_free(&prle);
+        ctrl_session_close(cs);
+        arena_destroy(ar);
         return 1;
     }
-
-    uint8_t* abuf = (uint8_t*)malloc(ADC_READ_BYTES);
-    if (!abuf) {
-        printf("malloc failed (abuf)\n");
+    if (adc_flush(adc) != ADC_OK) {
+        printf("adc_flush failed\n");
+        pulse_close(pulse);
         adc_close(adc);
-        free(pbuf);
+        session_free(ar, pbuf);
+        pulse_rle_free(&prle);
+        ctrl_session_close(cs);
+        arena_destroy(ar);
         return 1;
     }
-    memset(abuf, 0, ADC_READ_BYTES);
 
-    adc_thread_ctx_t actx;
-    memset(&actx, 0, sizeof(actx));
-    actx.adc = adc;
-    actx.buf = abuf;
-    actx.want = ADC_READ_BYTES;
-
-    pthread_t th;
-    if (pthread_create(&th, NULL, adc_reader_thread, &actx) != 0) {
-        printf("pthread_create failed\n");
-        free(abuf);
+    uint8_t* abuf = (uint8_t*)session_alloc(ar, ADC_READ_BYTES);   /* 0 埋め・実ページ割り当て済み */
+    io_reactor_t* rx = io_reactor_create();
+    int bd = rx ? io_reactor_add_board(rx, adc, pulse, ADC_READ_BYTES) : -1;
+    if (!abuf || bd < 0) {
+        printf("reactor setup failed\n");
+        io_reactor_destroy(rx);
+        session_free(ar, abuf);
+        pulse_close(pulse);
         adc_close(adc);
-        free(pbuf);
+        session_free(ar, pbuf);
+        pulse_rle_free(&prle);
+        ctrl_session_close(cs);
+        arena_destroy(ar);
         return 1;
     }
 
-    /* ===== (C2) エラー before ===== */
-    uint32_t pe0=0, ae0=0, pe1=0, ae1=0;
-    ctrl_port_t* ce0 = ctrl_open(CTRL_DEVICE_PATH, CTRL_BAUDRATE);
-    if (ce0 && ctrl_get_errors(ce0, &pe0, &ae0) == CTRL_OK) {
-        printf("ERR(before): pulse=%u adc=%u\n", pe0, ae0);
-    }
-    if (ce0) ctrl_close(ce0);
-
-    /* ===== (D) パルス送信（PortA） ===== */
-    pulse_port_t* pulse = pulse_open(PULSE_DEVICE_PATH, PULSE_BAUDRATE);
-    if (!pulse) {
-        printf("pulse_open failed (dev=%s)\n", PULSE_DEVICE_PATH);
-        pthread_join(th, NULL);
-        free(abuf);
-        adc_close(adc);
-        free(pbuf);
-        return 1;
-    }
+    /* ===== (C2) エラー before（積むだけ。返答は最後にまとめて受け取る） ===== */
+    uint32_t id_before = ctrl_session_req_errors(cs, NULL, NULL);
 
-    pulse_result_t pr = pulse_write(pulse, pbuf, wbytes);
-    if (pr != PULSE_OK) {
+    /* ===== (D) パルス送信（PortA）：書ける分ずつ reactor が書く ===== */
+    uint64_t t_pulse = now_ns();
+    if (io_reactor_pulse_submit_rle(rx, bd, &prle) != 0) {
         printf("pulse_write failed\n");
+        io_reactor_destroy(rx);
+        session_free(ar, abuf);
         pulse_close(pulse);
-        pthread_join(th, NULL);
-        free(abuf);
         adc_close(adc);
-        free(pbuf);
+        session_free(ar, pbuf);
+        pulse_rle_free(&prle);
+        ctrl_session_close(cs);
+        arena_destroy(ar);
         return 1;
     }
 
+    /* ===== (E) ADC完了待ち（送信の残りも同じループで進む） ===== */
+    int got_rc = io_reactor_adc_wait(rx, bd, ADC_READ_BYTES,
+                                     ADC_START_TIMEOUT_MS, ADC_IDLE_TIMEOUT_MS);
+    uint64_t t_done = now_ns();
+    while (io_reactor_pulse_busy(rx, bd) == 1) {
+        if (io_reactor_poll(rx, ADC_IDLE_TIMEOUT_MS) <= 0) break;
+    }
+    if (io_reactor_pulse_busy(rx, bd) == 0) printf("pulse_write OK (%zu bytes)\n", wbytes);
+    else                                    printf("pulse_write NOT complete\n");
+
+    size_t got = (got_rc > 0) ? io_reactor_adc_read(rx, bd, abuf, ADC_READ_BYTES) : 0;
+    if (io_reactor_adc_dropped(rx, bd) > 0)
+        printf("ADC ring overflow: dropped=%llu\n",
+               (unsigned long long)io_reactor_adc_dropped(rx, bd));
+    io_reactor_destroy(rx);
     pulse_close(pulse);
-    printf("pulse_write OK (%zu bytes)\n", wbytes);
-
-    /* ===== (E) ADC完了待ち ===== */
-    pthread_join(th, NULL);
 
     /* ===== (E2) エラー after ===== */
-    ctrl_port_t* ce1 = ctrl_open(CTRL_DEVICE_PATH, CTRL_BAUDRATE);
-    if (ce1 && ctrl_get_errors(ce1, &pe1, &ae1) == CTRL_OK) {
+    uint32_t id_after = ctrl_session_req_errors(cs, NULL, NULL);
+    uint32_t pe0=0, ae0=0, pe1=0, ae1=0;
+    ctrl_reply_t crep;
+    int have0 = (ctrl_session_wait(cs, id_before, &crep, CTRL_TIMEOUT_MS) == 1 && crep.status == 0 &&
+                 ctrl_parse_errors(crep.line, &pe0, &ae0) == 0);
+    if (have0) printf("ERR(before): pulse=%u adc=%u\n", pe0, ae0);
+    int have1 = (ctrl_session_wait(cs, id_after, &crep, CTRL_TIMEOUT_MS) == 1 && crep.status == 0 &&
+                 ctrl_parse_errors(crep.line, &pe1, &ae1) == 0);
+    if (have1) {
         printf("ERR(after):  pulse=%u adc=%u\n", pe1, ae1);
-        printf("ERR(delta):  pulse=%d adc=%d\n", (int)(pe1-pe0), (int)(ae1-ae0));
+        if (have0) printf("ERR(delta):  pulse=%d adc=%d\n", (int)(pe1-pe0), (int)(ae1-ae0));
     }
-    if (ce1) ctrl_close(ce1);
 
-    if (actx.ok) {
-        printf("ADC read OK (%zu bytes)\n", actx.got);
+    if (got == ADC_READ_BYTES) {
+        printf("ADC read OK (%zu bytes)\n", got);
     } else {
-        printf("ADC read NOT complete (got=%zu want=%zu)\n", actx.got, actx.want);
+        printf("ADC read NOT complete (got=%zu want=%zu)\n", got, (size_t)ADC_READ_BYTES);
     }
 
-    /* ===== (F) ADC生データ保存 ===== */
-    if (actx.got > 0) {
-        if (save_bin("output/adc_data/adc_FM_test9.bin", abuf, actx.got) != 0) {
-            printf("save adc_FM_test.bin failed\n");
-        } else {
-            printf("Saved:\n");
-            printf("  output/adc_data/adc_dump.bin\n");
+    /* ===== (F) ADC生データ保存（パルス定義・ゲイン・エラー・時刻と一緒に .tpcap へ） ===== */
+    if (got > 0) {
+        char stamp[32];
+        make_stamp(stamp, sizeof(stamp));
+        int cap_pid = -1;
+        capture_writer_t* cap = open_capture(stamp, &cpul, &cap_pid);
+        capture_ping_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.pulse_id = cap_pid;
+        rec.gain = gain;
+        rec.ok = (got == ADC_READ_BYTES);
+        rec.have_err_before = have0;
+        rec.err_before_pulse = pe0;
+        rec.err_before_adc = ae0;
+        rec.have_err_after = have1;
+        rec.err_after_pulse = pe1;
+        rec.err_after_adc = ae1;
+        rec.t_pulse_ns = t_pulse;
+        rec.t_done_ns = t_done;
+        int wrc = cap ? capture_writer_add_ping(cap, &rec, abuf, got) : -1;
+        if (capture_writer_close(cap) != 0 || wrc != 0) printf("save capture failed\n");
+        else                                            printf("Saved: 1 ping (%zu bytes)\n", got);
+        if (WAV_SAVE) {
+            wav_writer_t* wav = open_wav(stamp, got / 4);
+            int wrc2 = wav_writer_push_raw(wav, abuf, got);
+            if (wav_writer_close(wav) != 0 || wrc2 != 0) printf("save wav failed\n");
         }
     } else {
         printf("ADC got 0 bytes (nothing to save)\n");
     }
 
+    arena_print(stdout, "session", ar);
+    finish_trace();
+
     /* 後片付け */
-    free(abuf);
+    session_free(ar, abuf);
     adc_close(adc);
-    free(pbuf);
+    session_free(ar, pbuf);
+    pulse_rle_free(&prle);
+    ctrl_session_close(cs);
+    arena_destroy(ar);
     return 0;
 }
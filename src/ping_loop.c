@@ -0,0 +1,404 @@
+#include "ping_loop.h"
+#include "spsc_ring.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+#define PING_LOOP_STACK_PREFAULT (64u * 1024u)   /* 実時間モードで先に触るスタック */
+
+typedef struct {
+    uint64_t seq;
+    uint64_t off;        /* リング上のストリーム位置（受信を始めるときに決まる） */
+    int      started;    /* off が決まった */
+    size_t   got;
+    int      ok;
+    uint64_t t_pulse_ns;
+    uint64_t t_done_ns;
+} slot_info_t;
+
+struct ping_loop {
+    adc_source_t*  adc;
+    pulse_port_t*  pulse;
+    const pulse_rle_t* pulse_rle;   /* create で1回だけ安全チェック済み */
+    ping_loop_cfg_t cfg;
+
+    spsc_ring_t* ring;   /* 受信データ（受信スレッドが書き手, 呼び出し側が読み手。create 時に1回だけ確保） */
+    slot_info_t* slots;
+
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;
+    pthread_t th_pulse, th_adc;
+    int started;
+
+    /* 単調増加カウンタ（スロット番号 = カウンタ % n_slots） */
+    uint64_t fired;     /* 送信済み */
+    uint64_t captured;  /* 受信済み */
+    uint64_t acquired;  /* 呼び出し側に渡した */
+    uint64_t released;  /* 呼び出し側から返ってきた */
+
+    int stop;
+    int pulse_done;
+    int adc_done;
+
+    ping_loop_stats_t st;
+    ping_loop_rt_t    rt;   /* ヒストグラムはそれぞれ1スレッドだけが書く */
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static struct timespec ns_to_ts(uint64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec  = (time_t)(ns / 1000000000ull);
+    ts.tv_nsec = (long)(ns % 1000000000ull);
+    return ts;
+}
+
+ping_loop_t* ping_loop_create(adc_source_t* adc, pulse_port_t* pulse,
+                              const pulse_rle_t* pulse_rle,
+                              const ping_loop_cfg_t* cfg)
+{
+    if (!adc || !cfg) return NULL;
+    /* 毎ピング同じパルスなので、安全ゲートはここで1回だけ（送信スレッドは pulse_send_rle） */
+    if (pulse && pulse_check_rle(pulse, pulse_rle) != PULSE_OK) return NULL;
+    if (cfg->capture_bytes == 0 || cfg->n_slots < 2 || cfg->period_ms <= 0) return NULL;
+
+    ping_loop_t* pl = (ping_loop_t*)calloc(1, sizeof(*pl));
+    if (!pl) return NULL;
+
+    pl->adc = adc;
+    pl->pulse = pulse;
+    pl->pulse_rle = pulse_rle;
+    pl->cfg = *cfg;
+
+    /* ミラーなら n_slots ピング分で足りる。普通のリングは末尾で割れないよう詰め物を入れるので +2 ピング分
+       （実ページまでは spsc_ring_create が触る = 受信中のページフォルト対策） */
+    const size_t want = cfg->capture_bytes;
+    if (cfg->ring_mirror) {
+        pl->ring = spsc_ring_create(want * (size_t)cfg->n_slots, SPSC_RING_MIRROR);
+        if (pl->ring && !spsc_ring_mirrored(pl->ring) &&
+            spsc_ring_size(pl->ring) < want * (size_t)(cfg->n_slots + 2)) {
+            spsc_ring_destroy(pl->ring);
+            pl->ring = NULL;
+        }
+    }
+    if (!pl->ring) pl->ring = spsc_ring_create(want * (size_t)(cfg->n_slots + 2), 0);
+    pl->slots = (slot_info_t*)calloc((size_t)cfg->n_slots, sizeof(slot_info_t));
+    if (!pl->ring || !pl->slots) {
+        spsc_ring_destroy(pl->ring);
+        free(pl->slots);
+        free(pl);
+        return NULL;
+    }
+    pl->st.ring_bytes = spsc_ring_size(pl->ring);
+    pl->st.ring_mirrored = spsc_ring_mirrored(pl->ring);
+    adc_source_set_gap_hist(adc, &pl->rt.read_gap);
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&pl->cv, &ca);
+    pthread_condattr_destroy(&ca);
+    pthread_mutex_init(&pl->mu, NULL);
+
+    return pl;
+}
+
+/* 各スレッドの最初に呼ぶ：実時間化 + スタックを先に触る。戻り値は ping_loop_rt_t の rt_adc / rt_pulse */
+static int thread_rt(const char* name, const rt_sched_t* s)
+{
+    if (s->prio <= 0 && s->cpu_mask == 0) return 0;
+    rt_prefault_stack(PING_LOOP_STACK_PREFAULT);
+    return rt_thread_apply(name, s) == 0 ? 1 : -1;
+}
+
+/* 送信スレッド：周期ごとに空きスロットを予約してパルスを送る */
+static void* pulse_thread(void* arg)
+{
+    ping_loop_t* pl = (ping_loop_t*)arg;
+    const uint64_t period = (uint64_t)pl->cfg.period_ms * 1000000ull;
+    trace_thread_name("pulse");
+    int rt = thread_rt("pulse", &pl->cfg.rt_pulse);
+    uint64_t deadline = now_ns();
+
+    pthread_mutex_lock(&pl->mu);
+    pl->rt.rt_pulse = rt;
+    while (!pl->stop) {
+        if (pl->cfg.max_pings > 0 && pl->fired >= (uint64_t)pl->cfg.max_pings) break;
+
+        /* 次の送信時刻まで待つ（stop で即起きる） */
+        struct timespec ts = ns_to_ts(deadline);
+        while (!pl->stop) {
+            int r = pthread_cond_timedwait(&pl->cv, &pl->mu, &ts);
+            if (r == ETIMEDOUT) break;
+        }
+        if (pl->stop) break;
+
+        uint64_t t0 = now_ns();
+        uint64_t late = (t0 > deadline) ? t0 - deadline : 0;
+        if (late > pl->st.late_ns_max) pl->st.late_ns_max = late;
+        rt_hist_add(&pl->rt.pulse_wake, late);
+
+        /* 周期を丸ごと落とすほど遅れたら刻みを今に合わせ直す */
+        deadline += period;
+        if (t0 > deadline) deadline = t0 + period;
+
+        if (pl->fired - pl->released >= (uint64_t)pl->cfg.n_slots) {
+            pl->st.skipped++;
+            continue;
+        }
+
+        /* 受信スレッドを先に起こしてから送信（ADC を取りこぼさない順番） */
+        slot_info_t* s = &pl->slots[pl->fired % (uint64_t)pl->cfg.n_slots];
+        s->seq = pl->fired;
+        s->started = 0;
+        s->t_pulse_ns = t0;
+        uint32_t seq = (uint32_t)pl->fired;
+        pl->fired++;
+        pl->st.fired = pl->fired;
+        pthread_cond_broadcast(&pl->cv);
+        pthread_mutex_unlock(&pl->mu);
+
+        /* 受信スレッドの最初のバイトまで（スレッドをまたぐので async） */
+        trace_async_begin("pulse_to_first_byte", seq);
+
+        /* pulse = NULL（file / synth 再生）は送信したことにして受信だけ回す */
+        pulse_result_t pr = pl->pulse ? pulse_send_rle(pl->pulse, pl->pulse_rle)
+                                      : PULSE_OK;
+
+        pthread_mutex_lock(&pl->mu);
+        if (pr != PULSE_OK) pl->st.pulse_errors++;
+    }
+    pl->pulse_done = 1;
+    pthread_cond_broadcast(&pl->cv);
+    pthread_mutex_unlock(&pl->mu);
+    return NULL;
+}
+
+/* 1ピングを受信する場所を決める：ピングの先頭〜capture_bytes が連続するように。
+   ミラーなら今の head そのまま。普通のリングで末尾に収まらなければ、残りを詰め物として公開して先頭から */
+static int place_ping(ping_loop_t* pl, uint64_t* off)
+{
+    const size_t want = pl->cfg.capture_bytes;
+    size_t space = spsc_ring_write_space(pl->ring, NULL);
+    uint64_t h = spsc_ring_head(pl->ring);
+    size_t pad = 0;
+    if (!spsc_ring_mirrored(pl->ring)) {
+        size_t room = spsc_ring_size(pl->ring) - (size_t)(h & (spsc_ring_size(pl->ring) - 1));
+        if (room < want) pad = room;
+    }
+    /* 未返却は n_slots - 1 ピング以下なので、create の大きさなら必ず入る */
+    if (space < pad + want) return -1;
+    spsc_ring_commit(pl->ring, pad);
+    *off = h + pad;
+    return 0;
+}
+
+/* 受信スレッド：送信済みピングを順番に読み切る。
+   read(2) の行き先はリングそのもの（コピーなし）で、読めた分ずつ commit して公開する
+   （ping_loop_peek で受信中のピングも読める） */
+static void* adc_thread(void* arg)
+{
+    ping_loop_t* pl = (ping_loop_t*)arg;
+    const size_t want = pl->cfg.capture_bytes;
+    trace_thread_name("adc");
+    int rt = thread_rt("adc", &pl->cfg.rt_adc);
+
+    pthread_mutex_lock(&pl->mu);
+    pl->rt.rt_adc = rt;
+    for (;;) {
+        int waited = 0;
+        while (pl->captured == pl->fired && !pl->pulse_done) {
+            pthread_cond_wait(&pl->cv, &pl->mu);
+            waited = 1;
+        }
+        if (pl->captured == pl->fired) break;   /* 送信側が終わって全部読んだ */
+
+        size_t idx = (size_t)(pl->captured % (uint64_t)pl->cfg.n_slots);
+        /* 待っていたときだけ起床遅れ（前のピングを読んでいた分は入れない） */
+        if (waited) {
+            uint64_t t = now_ns(), t0 = pl->slots[idx].t_pulse_ns;
+            rt_hist_add(&pl->rt.adc_wake, t > t0 ? t - t0 : 0);
+        }
+        slot_info_t* s = &pl->slots[idx];
+        const uint32_t seq = (uint32_t)s->seq;
+        pthread_mutex_unlock(&pl->mu);
+
+        trace_begin("adc_ping", seq);
+        uint64_t off = 0;
+        int placed = (place_ping(pl, &off) == 0);
+        pthread_mutex_lock(&pl->mu);   /* off / started は ping_loop_peek が mu の中で読む */
+        s->off = off;
+        s->started = placed;
+        pthread_mutex_unlock(&pl->mu);
+
+        size_t got = 0;
+        if (placed && adc_source_begin(pl->adc) == ADC_OK) {
+            int tmo = pl->cfg.start_timeout_ms;   /* 最初の1byte は開始待ち、あとは活動タイムアウト */
+            while (got < want) {
+                trace_begin("adc_read", seq);
+                int n = adc_source_read(pl->adc, spsc_ring_at(pl->ring, off + got), want - got, tmo);
+                trace_end("adc_read", n > 0 ? (uint32_t)n : 0u);
+                if (n <= 0) break;   /* タイムアウト / エラー / 再生終わり（そこまでを返す） */
+                if (got == 0) {
+                    trace_async_end("pulse_to_first_byte", seq);
+                    trace_instant("adc_first_byte", seq);
+                }
+                got += (size_t)n;
+                spsc_ring_commit(pl->ring, (size_t)n);
+                tmo = pl->cfg.idle_timeout_ms;
+            }
+        }
+        uint64_t t1 = now_ns();
+        trace_end("adc_ping", (uint32_t)got);
+
+        pthread_mutex_lock(&pl->mu);
+        s->ok  = (got == want);
+        s->got = got;
+        s->t_done_ns = t1;
+        if (!s->ok) pl->st.incomplete++;
+        pl->captured++;
+        pl->st.captured = pl->captured;
+        pthread_cond_broadcast(&pl->cv);
+    }
+    pl->adc_done = 1;
+    pthread_cond_broadcast(&pl->cv);
+    pthread_mutex_unlock(&pl->mu);
+    return NULL;
+}
+
+int ping_loop_start(ping_loop_t* pl)
+{
+    if (!pl || pl->started) return -1;
+
+    if (adc_source_flush(pl->adc) != ADC_OK) return -1;
+
+    if (pthread_create(&pl->th_adc, NULL, adc_thread, pl) != 0) return -1;
+    if (pthread_create(&pl->th_pulse, NULL, pulse_thread, pl) != 0) {
+        pthread_mutex_lock(&pl->mu);
+        pl->stop = 1;
+        pl->pulse_done = 1;
+        pthread_cond_broadcast(&pl->cv);
+        pthread_mutex_unlock(&pl->mu);
+        pthread_join(pl->th_adc, NULL);
+        return -1;
+    }
+    pl->started = 1;
+    return 0;
+}
+
+void ping_loop_stop(ping_loop_t* pl)
+{
+    if (!pl || !pl->started) return;
+
+    pthread_mutex_lock(&pl->mu);
+    pl->stop = 1;
+    pthread_cond_broadcast(&pl->cv);
+    pthread_mutex_unlock(&pl->mu);
+
+    pthread_join(pl->th_pulse, NULL);
+    pthread_join(pl->th_adc, NULL);
+    pl->started = 0;
+}
+
+int ping_loop_acquire(ping_loop_t* pl, ping_frame_t* out, int timeout_ms)
+{
+    if (!pl || !out) return -1;
+
+    struct timespec ts = ns_to_ts(now_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ull);
+
+    pthread_mutex_lock(&pl->mu);
+    while (pl->acquired == pl->captured && !pl->adc_done) {
+        if (pthread_cond_timedwait(&pl->cv, &pl->mu, &ts) == ETIMEDOUT) break;
+    }
+
+    int rc;
+    if (pl->acquired < pl->captured) {
+        size_t idx = (size_t)(pl->acquired % (uint64_t)pl->cfg.n_slots);
+        const slot_info_t* s = &pl->slots[idx];
+        out->seq = s->seq;
+        out->data = spsc_ring_at(pl->ring, s->off);
+        out->got = s->got;
+        out->ok = s->ok;
+        out->t_pulse_ns = s->t_pulse_ns;
+        out->t_done_ns = s->t_done_ns;
+        pl->acquired++;
+        rc = 1;
+    } else {
+        rc = pl->adc_done ? -1 : 0;
+    }
+    pthread_mutex_unlock(&pl->mu);
+    return rc;
+}
+
+void ping_loop_release(ping_loop_t* pl, const ping_frame_t* f)
+{
+    if (!pl || !f) return;
+
+    pthread_mutex_lock(&pl->mu);
+    /* リング順で返す前提：古いものから順に空きになる（前の詰め物もここで一緒に返る） */
+    if (pl->released < pl->acquired && f->seq == pl->released) {
+        const slot_info_t* s = &pl->slots[pl->released % (uint64_t)pl->cfg.n_slots];
+        spsc_ring_consume_to(pl->ring, s->off + s->got);
+        pl->released++;
+    }
+    pthread_mutex_unlock(&pl->mu);
+}
+
+size_t ping_loop_peek(ping_loop_t* pl, uint64_t seq, const uint8_t** data, int* done)
+{
+    if (!pl || !data) return 0;
+    size_t n = 0;
+    int fin = 0;
+    *data = NULL;
+
+    pthread_mutex_lock(&pl->mu);
+    const slot_info_t* s = &pl->slots[seq % (uint64_t)pl->cfg.n_slots];
+    if (seq >= pl->released && seq < pl->fired && s->seq == seq && s->started) {
+        fin = (seq < pl->captured);
+        /* 受信中は head まで。受信スレッドが次のピングへ移るのはこの mutex を取ってからなので、
+           ここで読んだ head はこのピングの範囲を越えない */
+        n = fin ? s->got : (size_t)(spsc_ring_head(pl->ring) - s->off);
+        *data = spsc_ring_at(pl->ring, s->off);
+    }
+    pthread_mutex_unlock(&pl->mu);
+    if (done) *done = fin;
+    return n;
+}
+
+void ping_loop_get_stats(ping_loop_t* pl, ping_loop_stats_t* st)
+{
+    if (!pl || !st) return;
+    pthread_mutex_lock(&pl->mu);
+    *st = pl->st;
+    pthread_mutex_unlock(&pl->mu);
+}
+
+void ping_loop_get_rt(ping_loop_t* pl, ping_loop_rt_t* rt)
+{
+    if (!pl || !rt) return;
+    pthread_mutex_lock(&pl->mu);
+    *rt = pl->rt;
+    pthread_mutex_unlock(&pl->mu);
+}
+
+void ping_loop_destroy(ping_loop_t* pl)
+{
+    if (!pl) return;
+    ping_loop_stop(pl);
+    adc_source_set_gap_hist(pl->adc, NULL);
+    pthread_cond_destroy(&pl->cv);
+    pthread_mutex_destroy(&pl->mu);
+    free(pl->slots);
+    spsc_ring_destroy(pl->ring);
+    free(pl);
+}
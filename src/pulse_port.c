@@ -1,9 +1,10 @@
 #include "pulse_port.h"
+#include "serial_setup.h"
+#include "trace.h"
 
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <termios.h>
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
@@ -14,13 +15,8 @@ struct pulse_port {
     char devpath[256];
 };
 
-static speed_t baud_to_flag(int baudrate)// ボーレートを対応するtermiosの速度フラグに変換する関数
-{
-    switch (baudrate) {
-    case 115200: return B115200;
-    default:     return 0;
-    }
-}
+/* 局所 duty を見る窓（10000bit = 1ms @ 10MHz） */
+#define PULSE_SAFETY_WINDOW_BITS 10000u
 
 static int is_safe_devpath(const char* p)
 {
@@ -44,11 +40,56 @@ size_t pulse_bytes_for_duration(double fs_bit, double dur_s)
     return (nbits + 7u) / 8u;
 }
 
+/* 下位 n ビットだけ 1 のバイト（n = 0..8） */
+static const uint8_t LOW_ONES[9] = { 0x00, 0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF };
+
+/* 0 クリア済みの out に、bit から n ビット分の 1 を立てる（LSB first）
+   端はバイトマスク、途中の丸ごと 1 のバイトは memset でまとめて書く */
+static void set_ones_run(uint8_t* out, size_t bit, size_t n)
+{
+    if (n == 0) return;
+
+    size_t b = bit >> 3;
+    unsigned off = (unsigned)(bit & 7u);
+    if (off) {
+        size_t k = 8u - off;
+        if (k > n) k = n;
+        out[b++] |= (uint8_t)(LOW_ONES[k] << off);
+        n -= k;
+    }
+    if (n >= 8) {
+        memset(out + b, 0xFF, n >> 3);
+        b += n >> 3;
+        n &= 7u;
+    }
+    if (n) out[b] |= LOW_ONES[n];
+}
+
+/* 指数チャープの bit 位置での1周期（period_bits）と High 長（on_bits）
+   f(t)=f0*(f1/f0)^(t/T)。バイト版と RLE 版で同じ値になるよう共通化 */
+static void chirp_period_at(size_t bit, double fs_bit, double f_start_hz, double r, double T,
+                            int duty_percent, int* period_out, int* on_out)
+{
+    double t = (double)bit / fs_bit;
+    double f = f_start_hz * pow(r, t / T);
+    if (f < 1.0) f = 1.0;
+
+    int period_bits = (int)llround(fs_bit / f);
+    if (period_bits < 1) period_bits = 1;
+
+    int on_bits = (period_bits * duty_percent + 50) / 100;
+    if (on_bits < 1) on_bits = 1;
+    if (on_bits >= period_bits) on_bits = period_bits - 1;
+
+    *period_out = period_bits;
+    *on_out = on_bits;
+}
+
 /* 10MHzビット列で指数チャープを“周期変化する矩形波”として生成 */
-size_t pulse_gen_exp_chirp(uint8_t* out, size_t out_bytes,
-                           double fs_bit, double dur_s,
-                           double f_start_hz, double f_end_hz,
-                           int duty_percent)
+static size_t gen_exp_chirp(uint8_t* out, size_t out_bytes,
+                            double fs_bit, double dur_s,
+                            double f_start_hz, double f_end_hz,
+                            int duty_percent)
 {
     if (!out || out_bytes == 0) return 0;
     if (fs_bit <= 0.0 || dur_s <= 0.0) return 0;
@@ -68,24 +109,14 @@ size_t pulse_gen_exp_chirp(uint8_t* out, size_t out_bytes,
 
     size_t bit = 0;
     while (bit < chirp_bits) {
-        double t = (double)bit / fs_bit;
-        double f = f_start_hz * pow(r, t / T);
-        if (f < 1.0) f = 1.0;
-
-        int period_bits = (int)llround(fs_bit / f);
-        if (period_bits < 1) period_bits = 1;
-
-        int on_bits = (period_bits * duty_percent + 50) / 100;
-        if (on_bits < 1) on_bits = 1;
-        if (on_bits >= period_bits) on_bits = period_bits - 1;
-
-        for (int p = 0; p < period_bits && bit < chirp_bits; p++, bit++) {
-            if (p < on_bits) {
-                size_t byte_i = bit / 8u;
-                int bit_i = (int)(bit % 8u);
-                out[byte_i] |= (uint8_t)(1u << bit_i);
-            }
-        }
+        int period_bits, on_bits;
+        chirp_period_at(bit, fs_bit, f_start_hz, r, T, duty_percent, &period_bits, &on_bits);
+
+        /* 1周期 = High on_bits + Low 残り（末尾は chirp_bits で切る） */
+        size_t left = chirp_bits - bit;
+        size_t on = (size_t)on_bits < left ? (size_t)on_bits : left;
+        set_ones_run(out, bit, on);
+        bit += (size_t)period_bits < left ? (size_t)period_bits : left;
     }
 
     fprintf(stderr,
@@ -95,41 +126,27 @@ size_t pulse_gen_exp_chirp(uint8_t* out, size_t out_bytes,
     return out_bytes;
 }
 
+size_t pulse_gen_exp_chirp(uint8_t* out, size_t out_bytes,
+                           double fs_bit, double dur_s,
+                           double f_start_hz, double f_end_hz,
+                           int duty_percent)
+{
+    trace_begin("pulse_gen", (uint32_t)out_bytes);
+    size_t r = gen_exp_chirp(out, out_bytes, fs_bit, dur_s, f_start_hz, f_end_hz, duty_percent);
+    trace_end("pulse_gen", (uint32_t)r);
+    return r;
+}
+
 
 pulse_port_t* pulse_open(const char* devpath, int baudrate)
 {
     if (!devpath) return NULL;
 
-    speed_t sp = baud_to_flag(baudrate);
-    if (sp == 0) return NULL;
-
-    int fd = open(devpath, O_RDWR | O_NOCTTY );
+    serial_cfg_t cfg;
+    serial_cfg_default(&cfg, baudrate);
+    int fd = serial_open(devpath, &cfg, NULL);
     if (fd < 0) return NULL;
 
-    struct termios tio;
-    if (tcgetattr(fd, &tio) != 0) {
-        close(fd);
-        return NULL;
-    }
-
-    cfmakeraw(&tio);
-    cfsetispeed(&tio, sp);
-    cfsetospeed(&tio, sp);
-
-    tio.c_cflag |= (CLOCAL | CREAD);
-    tio.c_cflag &= ~PARENB;
-    tio.c_cflag &= ~CSTOPB;
-    tio.c_cflag &= ~CSIZE;
-    tio.c_cflag |= CS8;
-
-    tio.c_cc[VMIN] = 0;
-    tio.c_cc[VTIME] = 0;
-
-    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
-        close(fd);
-        return NULL;
-    }
-
     pulse_port_t* p = (pulse_port_t*)malloc(sizeof(pulse_port_t));
     if (!p) {
         close(fd);
@@ -147,11 +164,26 @@ void pulse_close(pulse_port_t* p)
     free(p);
 }
 
+/* pfd の1周期（tick）と High 長。バイト版と RLE 版で共通 */
+static void pfd_period(int freq_khz, int duty_percent, int* period_out, int* on_out)
+{
+    /* 10MHz基準 → 1周期のtick数は 10000/freq_khz （0.1us単位） */
+    int period_ticks = (10000 + freq_khz/2) / freq_khz;   /* 四捨五入 */
+    if (period_ticks < 1) period_ticks = 1;
+
+    int on_ticks = (period_ticks * duty_percent + 50) / 100;
+    if (on_ticks < 1) on_ticks = 1;
+    if (on_ticks >= period_ticks) on_ticks = period_ticks - 1;
+
+    *period_out = period_ticks;
+    *on_out = on_ticks;
+}
+
 /* pfd相当の矩形波：10MHz(=0.1us)基準で作る。
    freq_khz: 1..5000
    duty%   : 1..99
    1bit = 0.1us, 1byte = 8bit */
-size_t pulse_gen_pfd(uint8_t* out, size_t out_bytes, int freq_khz, int duty_percent)
+static size_t gen_pfd(uint8_t* out, size_t out_bytes, int freq_khz, int duty_percent)
 {
     if (!out || out_bytes == 0) return 0;
     if (freq_khz < 1 || freq_khz > 5000) return 0;
@@ -161,49 +193,174 @@ size_t pulse_gen_pfd(uint8_t* out, size_t out_bytes, int freq_khz, int duty_perc
     memset(out, 0x00, out_bytes);
     return out_bytes;}
 
-    /* 10MHz基準 → 1周期のtick数は 10000/freq_khz （0.1us単位） */
-    int period_ticks = (10000 + freq_khz/2) / freq_khz;   /* 四捨五入 */
-    if (period_ticks < 1) period_ticks = 1;
-
-    int on_ticks = (period_ticks * duty_percent + 50) / 100;
-    if (on_ticks < 1) on_ticks = 1;
-    if (on_ticks >= period_ticks) on_ticks = period_ticks - 1;
+    int period_ticks, on_ticks;
+    pfd_period(freq_khz, duty_percent, &period_ticks, &on_ticks);
     fprintf(stderr, "pulse_gen_pfd: freq_khz=%d period_ticks=%d on_ticks=%d (duty=%.2f%%)\n",freq_khz, period_ticks, on_ticks, 100.0 * (double)on_ticks / (double)period_ticks);
     memset(out, 0x00, out_bytes);
 
-    size_t total_bits = out_bytes * 8;
-    for (size_t bit = 0; bit < total_bits; bit++) {
-        int phase = (int)(bit % (size_t)period_ticks);
-        int v = (phase < on_ticks) ? 1 : 0;
+    /* 波形は lcm(period, 8) ビット = period/gcd(period,8) バイトごとに同じバイト列になる。
+       その1パターン分だけ周期ごとに High を書き、残りはコピーで倍々に埋める */
+    size_t period = (size_t)period_ticks;
+    size_t g = period & (~period + 1u);   /* gcd(period, 8) = 最下位の1ビット（8で頭打ち） */
+    if (g > 8u) g = 8u;
+    size_t pat_bytes = period / g;
+    if (pat_bytes > out_bytes) pat_bytes = out_bytes;
+
+    size_t pat_bits = pat_bytes * 8u;
+    for (size_t bit = 0; bit < pat_bits; bit += period) {
+        size_t left = pat_bits - bit;
+        set_ones_run(out, bit, (size_t)on_ticks < left ? (size_t)on_ticks : left);
+    }
 
-        if (v) {
-            size_t byte_i = bit / 8;
-            int bit_i = (int)(bit % 8);
-            out[byte_i] |= (uint8_t)(1u << bit_i);
-        }
+    size_t done = pat_bytes;
+    while (done < out_bytes) {
+        size_t n = (done < out_bytes - done) ? done : out_bytes - done;
+        memcpy(out + done, out, n);
+        done += n;
     }
     return out_bytes;
 }
 
-/* data内の連続1ビットの最長長を数える（送信前チェック用） */
-static int max_consecutive_ones_bits(const uint8_t* data, size_t len)
+size_t pulse_gen_pfd(uint8_t* out, size_t out_bytes, int freq_khz, int duty_percent)
 {
-    int max_run = 0, run = 0;
-    for (size_t i = 0; i < len; i++) {
-        uint8_t v = data[i];
-        for (int b = 0; b < 8; b++) {
-            int bit = (v >> b) & 1u;
-            if (bit) { run++; if (run > max_run) max_run = run; }
-            else run = 0;
-        }
+    trace_begin("pulse_gen", (uint32_t)out_bytes);
+    size_t r = gen_pfd(out, out_bytes, freq_khz, duty_percent);
+    trace_end("pulse_gen", (uint32_t)r);
+    return r;
+}
+
+size_t pulse_bits_to_wave(const uint8_t* bits, size_t nbytes, int bits_per_sample,
+                          float* out, size_t out_len)
+{
+    if (!bits || !out || out_len == 0 || bits_per_sample < 1) return 0;
+
+    size_t total_bits = nbytes * 8u;
+    size_t n = total_bits / (size_t)bits_per_sample;
+    if (n > out_len) n = out_len;
+
+    double sum = 0.0;
+    size_t bit = 0;
+    for (size_t i = 0; i < n; i++) {
+        int ones = 0;
+        for (int k = 0; k < bits_per_sample; k++, bit++)
+            ones += (bits[bit / 8u] >> (bit % 8u)) & 1u;
+        out[i] = (float)ones / (float)bits_per_sample;
+        sum += out[i];
     }
-    return max_run;
+
+    float mean = n ? (float)(sum / (double)n) : 0.0f;
+    for (size_t i = 0; i < n; i++) out[i] -= mean;
+    for (size_t i = n; i < out_len; i++) out[i] = 0.0f;
+    return n;
+}
+
+/* ===== 送信前チェック（1パス） ===== */
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+/* popcnt 命令があるCPUではそちらを使う版を実行時に選ぶ */
+#define PULSE_POPCNT_CLONES __attribute__((target_clones("popcnt", "default")))
+#else
+#define PULSE_POPCNT_CLONES
+#endif
+
+/* 8バイトを LSB first のビット列として 64bit に詰める（bit0 = 最初のビット） */
+static inline uint64_t load_bits64(const uint8_t* p)
+{
+    uint64_t w;
+    memcpy(&w, p, 8);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+/* w の中で最長の連続1 */
+static inline int longest_ones64(uint64_t w)
+{
+    int k = 0;
+    while (w) { w &= w >> 1; k++; }
+    return k;
 }
 
+PULSE_POPCNT_CLONES
+void pulse_analyze(const uint8_t* data, size_t len, size_t window_bits, pulse_stats_t* st)
+{
+    if (!st) return;
+    memset(st, 0, sizeof(*st));
+    if (!data || len == 0) return;
+
+    /* 窓は 64bit 単位に切り上げ（0 = 全体で1窓） */
+    size_t win_words = window_bits ? (window_bits + 63u) / 64u : (size_t)-1;
+
+    size_t ones = 0;
+    size_t win_ones = 0, win_bits = 0;
+    double max_local = 0.0;
+    size_t run = 0, max_run = 0;
+    size_t words = 0;
+
+    size_t i = 0;
+    while (i < len) {
+        uint64_t w;
+        size_t nbits;
+        if (i + 8 <= len) {
+            w = load_bits64(data + i);
+            nbits = 64;
+            i += 8;
+        } else {
+            /* 端数バイト：後ろは 0（Low）扱いで同じ処理に流す */
+            uint8_t tail[8] = { 0 };
+            memcpy(tail, data + i, len - i);
+            w = load_bits64(tail);
+            nbits = (len - i) * 8u;
+            i = len;
+        }
+
+        size_t pc = (size_t)__builtin_popcountll(w);
+        ones += pc;
+        win_ones += pc;
+        win_bits += nbits;
+
+        /* 連続 High：前の語から続く分（下位の1）+ 語の中 + 次の語へ続く分（上位の1） */
+        if (w == ~(uint64_t)0) {
+            run += 64;
+        } else {
+            run += (size_t)__builtin_ctzll(~w);
+            if (run > max_run) max_run = run;
+            if (pc > max_run) {
+                size_t in = (size_t)longest_ones64(w);
+                if (in > max_run) max_run = in;
+            }
+            run = (size_t)__builtin_clzll(~w);
+        }
+
+        if (++words == win_words) {
+            /* 窓は常に win_words*64 ビットで割る（データが語の途中で終わっても、その先は Low） */
+            double d = 100.0 * (double)win_ones / (double)(win_words * 64u);
+            if (d > max_local) max_local = d;
+            win_ones = win_bits = 0;
+            words = 0;
+        }
+    }
+    if (run > max_run) max_run = run;
+    if (win_bits > 0) {
+        /* 末尾の半端な窓は、送信後を Low とみなして窓の長さで割る */
+        double den = window_bits ? (double)(win_words * 64u) : (double)win_bits;
+        double d = 100.0 * (double)win_ones / den;
+        if (d > max_local) max_local = d;
+    }
+
+    st->bits = len * 8u;
+    st->ones = ones;
+    st->duty_percent = 100.0 * (double)ones / (double)st->bits;
+    st->max_run = (int)max_run;
+    st->max_local_duty = max_local;
+}
 
 pulse_result_t pulse_write_locked(pulse_port_t* p, const uint8_t* data, size_t len)
 {
-    int max_run = max_consecutive_ones_bits(data, len);
+    pulse_stats_t st;
+    pulse_analyze(data, len, 0, &st);
+    int max_run = st.max_run;
     if (max_run >= 200) {
         fprintf(stderr, "PULSE blocked: too long HIGH run=%d bits\n", max_run);
         return PULSE_ERR;
@@ -215,7 +372,42 @@ pulse_result_t pulse_write_locked(pulse_port_t* p, const uint8_t* data, size_t l
 #include <string.h>
 #include <stdlib.h>
 
-pulse_result_t pulse_write(pulse_port_t* p, const uint8_t* data, size_t len)
+/* 安全ゲート本体（バイト列 / RLE 共通）。0: 送信してよい / -1: 拒否 */
+static int safety_gate(const pulse_stats_t* st, size_t len)
+{
+    double duty_est = st->duty_percent;
+    int max_run = st->max_run;
+
+    /* ログ（安全確認の証跡） */
+    fprintf(stderr, "PULSE safety: len=%zu duty_est=%.2f%% local_max=%.2f%% max_run=%d bits\n",
+            len, duty_est, st->max_local_duty, max_run);
+
+    /* 安全: duty 60%以上は拒否（= 59%まで許可） */
+    if (duty_est >= 60.0) {
+        fprintf(stderr, "PULSE blocked: duty >= 60%%\n");
+        return -1;
+    }
+
+    /* 安全: 短い区間に High が集中しているのも拒否（全体 duty が低くても） */
+    if (st->max_local_duty >= 60.0) {
+        fprintf(stderr, "PULSE blocked: local duty >= 60%% (%.2f%%)\n", st->max_local_duty);
+        return -1;
+    }
+
+    /* 安全: 連続Highが長すぎるのも拒否（20us以上の連続Highを止める） */
+    if (max_run >= 200) { /* 200bit = 20us (10MHz基準: 1bit=0.1us) */
+        fprintf(stderr, "PULSE blocked: max_run too long (%d bits)\n", max_run);
+        return -1;
+    }
+    return 0;
+}
+
+int pulse_fd(const pulse_port_t* p)
+{
+    return p ? p->fd : -1;
+}
+
+pulse_result_t pulse_check(const pulse_port_t* p, const uint8_t* data, size_t len)
 {
     if (!p || p->fd < 0 || !data || len == 0) return PULSE_ERR;
 
@@ -233,56 +425,331 @@ pulse_result_t pulse_write(pulse_port_t* p, const uint8_t* data, size_t len)
 
     /* ===== Safety gate ===== */
 
-    /* duty 推定（全ビットの1比率） */
-    unsigned long ones = 0;
-    for (size_t i = 0; i < len; i++) {
-        uint8_t v = data[i];
-        for (int b = 0; b < 8; b++) ones += (v >> b) & 1u;
+    /* duty・連続 High の最大長・窓ごとの duty を1パスで（LSB first） */
+    pulse_stats_t st;
+    trace_begin("safety_check", (uint32_t)len);
+    pulse_analyze(data, len, PULSE_SAFETY_WINDOW_BITS, &st);
+    int gate = safety_gate(&st, len);
+    trace_end("safety_check", (uint32_t)len);
+    if (gate != 0) return PULSE_ERR;
+
+    /* ===== Safety gate end ===== */
+    return PULSE_OK;
+}
+
+pulse_result_t pulse_write(pulse_port_t* p, const uint8_t* data, size_t len)
+{
+    trace_begin("pulse_write", (uint32_t)len);
+    pulse_result_t r = pulse_check(p, data, len);
+    if (r == PULSE_OK) {
+        /* ここまで来たら送信 */
+        ssize_t w = write(p->fd, data, len);
+        if (w != (ssize_t)len) {
+            fprintf(stderr, "PULSE write failed: w=%zd expected=%zu errno=%d\n", w, len, errno);
+            r = PULSE_ERR;
+        }
+    }
+    trace_end("pulse_write", (uint32_t)len);
+    return r;
+}
+
+/* ===== RLE パルス ===== */
+
+/* 送信時の展開チャンク */
+#define PULSE_RLE_CHUNK_BYTES 4096u
+
+void pulse_rle_free(pulse_rle_t* rle)
+{
+    if (!rle) return;
+    free(rle->runs);
+    memset(rle, 0, sizeof(*rle));
+}
+
+static int rle_push(pulse_rle_t* rle, size_t on, size_t off)
+{
+    if (rle->n == rle->cap) {
+        size_t cap = rle->cap ? rle->cap * 2u : 256u;
+        pulse_run_t* nr = (pulse_run_t*)realloc(rle->runs, cap * sizeof(pulse_run_t));
+        if (!nr) return -1;
+        rle->runs = nr;
+        rle->cap = cap;
+    }
+    rle->runs[rle->n].on  = (uint32_t)on;
+    rle->runs[rle->n].off = (uint32_t)off;
+    rle->n++;
+    rle->total_bits += on + off;
+    return 0;
+}
+
+static int rle_gen_pfd(pulse_rle_t* rle, size_t total_bits, int freq_khz, int duty_percent)
+{
+    if (!rle || total_bits == 0) return -1;
+    if (freq_khz < 1 || freq_khz > 5000) return -1;
+    if (duty_percent < 0 || duty_percent > 99) return -1;
+
+    rle->n = 0;
+    rle->total_bits = 0;
+    if (duty_percent == 0) return rle_push(rle, 0, total_bits);
+
+    int period_ticks, on_ticks;
+    pfd_period(freq_khz, duty_percent, &period_ticks, &on_ticks);
+
+    for (size_t bit = 0; bit < total_bits; ) {
+        size_t left = total_bits - bit;
+        size_t len = (size_t)period_ticks < left ? (size_t)period_ticks : left;
+        size_t on  = (size_t)on_ticks < len ? (size_t)on_ticks : len;
+        if (rle_push(rle, on, len - on) != 0) return -1;
+        bit += len;
+    }
+    return 0;
+}
+
+int pulse_rle_gen_pfd(pulse_rle_t* rle, size_t total_bits, int freq_khz, int duty_percent)
+{
+    trace_begin("pulse_gen", (uint32_t)(total_bits / 8u));
+    int r = rle_gen_pfd(rle, total_bits, freq_khz, duty_percent);
+    trace_end("pulse_gen", (uint32_t)(total_bits / 8u));
+    return r;
+}
+
+static int rle_gen_exp_chirp(pulse_rle_t* rle, size_t total_bits,
+                             double fs_bit, double dur_s,
+                             double f_start_hz, double f_end_hz,
+                             int duty_percent)
+{
+    if (!rle || total_bits == 0) return -1;
+    if (fs_bit <= 0.0 || dur_s <= 0.0) return -1;
+    if (f_start_hz <= 0.0 || f_end_hz <= 0.0) return -1;
+    if (duty_percent < 0 || duty_percent > 99) return -1;
+
+    rle->n = 0;
+    rle->total_bits = 0;
+    if (duty_percent == 0) return rle_push(rle, 0, total_bits);
+
+    size_t chirp_bits = (size_t)llround(fs_bit * dur_s);
+    if (chirp_bits > total_bits) chirp_bits = total_bits;
+
+    double r = f_end_hz / f_start_hz;
+    size_t bit = 0;
+    while (bit < chirp_bits) {
+        int period_bits, on_bits;
+        chirp_period_at(bit, fs_bit, f_start_hz, r, dur_s, duty_percent, &period_bits, &on_bits);
+
+        size_t left = chirp_bits - bit;
+        size_t len = (size_t)period_bits < left ? (size_t)period_bits : left;
+        size_t on  = (size_t)on_bits < len ? (size_t)on_bits : len;
+        if (rle_push(rle, on, len - on) != 0) return -1;
+        bit += len;
     }
-    unsigned long bits = (unsigned long)len * 8ul;
-    double duty_est = 100.0 * (double)ones / (double)bits;
-
-    /* 連続 High の最大長（LSB first） */
-    int max_run = 0;
-    int run = 0;
-    for (size_t i = 0; i < len; i++) {
-        uint8_t v = data[i];
-        for (int b = 0; b < 8; b++) {
-            if ((v >> b) & 1u) {
-                run++;
-                if (run > max_run) max_run = run;
-            } else {
-                run = 0;
+
+    /* チャープ後の無音はまとめて最後の Low に足す */
+    size_t tail = total_bits - chirp_bits;
+    if (tail > 0) {
+        if (rle->n > 0 && (size_t)rle->runs[rle->n - 1].off + tail <= UINT32_MAX) {
+            rle->runs[rle->n - 1].off += (uint32_t)tail;
+            rle->total_bits += tail;
+        } else if (rle_push(rle, 0, tail) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int pulse_rle_gen_exp_chirp(pulse_rle_t* rle, size_t total_bits,
+                            double fs_bit, double dur_s,
+                            double f_start_hz, double f_end_hz,
+                            int duty_percent)
+{
+    trace_begin("pulse_gen", (uint32_t)(total_bits / 8u));
+    int r = rle_gen_exp_chirp(rle, total_bits, fs_bit, dur_s, f_start_hz, f_end_hz, duty_percent);
+    trace_end("pulse_gen", (uint32_t)(total_bits / 8u));
+    return r;
+}
+
+void pulse_rle_analyze(const pulse_rle_t* rle, size_t window_bits, pulse_stats_t* st)
+{
+    if (!st) return;
+    memset(st, 0, sizeof(*st));
+    if (!rle || rle->total_bits == 0) return;
+
+    /* バイト列に展開したときと同じ条件：末尾バイトの余りは Low、窓は 64bit 単位 */
+    size_t bits = (rle->total_bits + 7u) / 8u * 8u;
+    size_t W = window_bits ? (window_bits + 63u) / 64u * 64u : bits;
+
+    size_t ones = 0, run = 0, max_run = 0;
+    size_t win = 0, win_ones = 0;
+    double max_local = 0.0;
+    size_t pos = 0;
+
+    for (size_t i = 0; i < rle->n; i++) {
+        size_t on = rle->runs[i].on;
+        size_t off = rle->runs[i].off;
+
+        ones += on;
+        run += on;
+        if (off > 0 || on == 0) {
+            if (run > max_run) max_run = run;
+            if (off > 0) run = 0;
+        }
+
+        /* High 区間を窓に配る（窓をまたぐ分は分割） */
+        while (on > 0) {
+            size_t wend = (win + 1u) * W;
+            if (pos >= wend) {
+                /* 窓を閉じて、High の無い窓（Low が続いた分）は数えずに飛ぶ */
+                double d = 100.0 * (double)win_ones / (double)W;
+                if (d > max_local) max_local = d;
+                win = pos / W;
+                win_ones = 0;
+                continue;
+            }
+            if (pos == win * W && on >= W) {
+                /* 窓を丸ごと埋める High はまとめて（100%） */
+                size_t k = on / W;
+                max_local = 100.0;
+                pos += k * W;
+                on -= k * W;
+                win = pos / W;
+                continue;
             }
+            size_t take = (wend - pos < on) ? wend - pos : on;
+            win_ones += take;
+            pos += take;
+            on -= take;
         }
+        pos += off;
+    }
+    if (run > max_run) max_run = run;
+    {
+        double d = 100.0 * (double)win_ones / (double)W;
+        if (d > max_local) max_local = d;
     }
 
-    /* ログ（安全確認の証跡） */
-    fprintf(stderr, "PULSE safety: len=%zu duty_est=%.2f%% max_run=%d bits\n",
-            len, duty_est, max_run);
+    st->bits = bits;
+    st->ones = ones;
+    st->duty_percent = 100.0 * (double)ones / (double)bits;
+    st->max_run = (int)max_run;
+    st->max_local_duty = max_local;
+}
 
-    /* 安全: duty 60%以上は拒否（= 59%まで許可） */
-    if (duty_est >= 60.0) {
-        fprintf(stderr, "PULSE blocked: duty >= 60%%\n");
+void pulse_rle_cursor_init(pulse_rle_cursor_t* cur, const pulse_rle_t* rle)
+{
+    if (!cur) return;
+    cur->rle = rle;
+    cur->run = 0;
+    cur->in_run = 0;
+}
+
+size_t pulse_rle_expand(pulse_rle_cursor_t* cur, uint8_t* out, size_t out_bytes)
+{
+    if (!cur || !cur->rle || !out || out_bytes == 0) return 0;
+
+    const pulse_rle_t* rle = cur->rle;
+    if (cur->run >= rle->n) return 0;
+
+    memset(out, 0x00, out_bytes);
+    size_t cap = out_bytes * 8u;
+    size_t bit = 0;
+
+    while (bit < cap && cur->run < rle->n) {
+        const pulse_run_t* r = &rle->runs[cur->run];
+        size_t len = (size_t)r->on + r->off;
+
+        if (cur->in_run < r->on) {
+            size_t k = r->on - cur->in_run;
+            if (k > cap - bit) k = cap - bit;
+            set_ones_run(out, bit, k);
+            bit += k;
+            cur->in_run += k;
+        } else {
+            size_t k = len - cur->in_run;
+            if (k > cap - bit) k = cap - bit;
+            bit += k;
+            cur->in_run += k;
+        }
+        if (cur->in_run == len) {
+            cur->run++;
+            cur->in_run = 0;
+        }
+    }
+    return (bit + 7u) / 8u;
+}
+
+pulse_result_t pulse_check_rle(const pulse_port_t* p, const pulse_rle_t* rle)
+{
+    if (!p || p->fd < 0 || !rle || rle->total_bits == 0) return PULSE_ERR;
+
+    /* 実機へは絶対に流さない（仮想ポートのみ） */
+    if (!is_safe_devpath(p->devpath)) {
+        fprintf(stderr, "PULSE locked: devpath=%s\n", p->devpath);
         return PULSE_ERR;
     }
 
-    /* 安全: 連続Highが長すぎるのも拒否（20us以上の連続Highを止める） */
-    if (max_run >= 200) { /* 200bit = 20us (10MHz基準: 1bit=0.1us) */
-        fprintf(stderr, "PULSE blocked: max_run too long (%d bits)\n", max_run);
+    size_t len = (rle->total_bits + 7u) / 8u;
+    if (len > 50000) {
+        fprintf(stderr, "PULSE blocked: len too long (%zu)\n", len);
         return PULSE_ERR;
     }
 
-    /* ===== Safety gate end ===== */
+    /* ===== Safety gate（RLE のまま） ===== */
+    pulse_stats_t st;
+    trace_begin("safety_check", (uint32_t)len);
+    pulse_rle_analyze(rle, PULSE_SAFETY_WINDOW_BITS, &st);
+    int gate = safety_gate(&st, len);
+    trace_end("safety_check", (uint32_t)len);
+    if (gate != 0) return PULSE_ERR;
+    return PULSE_OK;
+}
 
-    /* ここまで来たら送信 */
-    ssize_t w = write(p->fd, data, len);
-    if (w != (ssize_t)len) {
-        fprintf(stderr, "PULSE write failed: w=%zd expected=%zu errno=%d\n", w, len, errno);
-        return PULSE_ERR;
+/* 安全確認済みの RLE を書く（len は展開後のバイト数） */
+static pulse_result_t write_rle(pulse_port_t* p, const pulse_rle_t* rle, size_t len)
+{
+    /* 送信しながら展開 */
+    uint8_t chunk[PULSE_RLE_CHUNK_BYTES];
+    pulse_rle_cursor_t cur;
+    pulse_rle_cursor_init(&cur, rle);
+
+    size_t sent = 0, n;
+    while ((n = pulse_rle_expand(&cur, chunk, sizeof(chunk))) > 0) {
+        size_t off = 0;
+        while (off < n) {
+            ssize_t w = write(p->fd, chunk + off, n - off);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) {
+                fprintf(stderr, "PULSE write failed: sent=%zu expected=%zu errno=%d\n",
+                        sent + off, len, errno);
+                return PULSE_ERR;
+            }
+            off += (size_t)w;
+        }
+        sent += n;
     }
     return PULSE_OK;
 }
 
+pulse_result_t pulse_write_rle(pulse_port_t* p, const pulse_rle_t* rle)
+{
+    size_t len = rle ? (rle->total_bits + 7u) / 8u : 0;
+    trace_begin("pulse_write", (uint32_t)len);
+    pulse_result_t r = pulse_check_rle(p, rle);
+    if (r == PULSE_OK) r = write_rle(p, rle, len);
+    trace_end("pulse_write", (uint32_t)len);
+    return r;
+}
+
+pulse_result_t pulse_send_rle(pulse_port_t* p, const pulse_rle_t* rle)
+{
+    if (!p || p->fd < 0 || !rle || rle->total_bits == 0) return PULSE_ERR;
+    size_t len = (rle->total_bits + 7u) / 8u;
 
+    /* 統計（O(周期数)）は pulse_check_rle で済んでいる。ポートと長さの錠だけは毎回 */
+    if (!is_safe_devpath(p->devpath) || len > 50000) {
+        fprintf(stderr, "PULSE locked: devpath=%s len=%zu\n", p->devpath, len);
+        return PULSE_ERR;
+    }
 
+    trace_begin("pulse_write", (uint32_t)len);
+    pulse_result_t r = write_rle(p, rle, len);
+    trace_end("pulse_write", (uint32_t)len);
+    return r;
+}
@@ -0,0 +1,161 @@
+#define _GNU_SOURCE   /* pthread_setaffinity_np / CPU_SET */
+#include "rt_thread.h"
+
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* ---------------- スケジューリング ---------------- */
+
+int rt_thread_apply(const char* name, const rt_sched_t* s)
+{
+    if (!s) return 0;
+    int rc = 0;
+
+    if (s->cpu_mask) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c = 0; c < 64 && c < CPU_SETSIZE; c++)
+            if (s->cpu_mask & ((uint64_t)1 << c)) CPU_SET(c, &set);
+        int e = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (e != 0) {
+            fprintf(stderr, "rt(%s): affinity 0x%llx failed: %s\n", name ? name : "?",
+                    (unsigned long long)s->cpu_mask, strerror(e));
+            rc = -1;
+        }
+    }
+
+    if (s->prio > 0) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        int lo = sched_get_priority_min(SCHED_FIFO), hi = sched_get_priority_max(SCHED_FIFO);
+        sp.sched_priority = s->prio < lo ? lo : (s->prio > hi ? hi : s->prio);
+        int e = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (e != 0) {
+            fprintf(stderr, "rt(%s): SCHED_FIFO %d failed: %s%s\n", name ? name : "?", sp.sched_priority,
+                    strerror(e), e == EPERM ? " (needs CAP_SYS_NICE or rtprio in limits.conf)" : "");
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+int rt_lock_memory(void)
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fprintf(stderr, "rt: mlockall failed: %s%s\n", strerror(errno),
+                errno == ENOMEM || errno == EPERM ? " (raise memlock in limits.conf)" : "");
+        return -1;
+    }
+    return 0;
+}
+
+void rt_prefault(void* p, size_t n)
+{
+    if (!p || n == 0) return;
+    long pg = sysconf(_SC_PAGESIZE);
+    size_t step = (pg > 0) ? (size_t)pg : 4096u;
+    volatile uint8_t* b = (volatile uint8_t*)p;
+    for (size_t i = 0; i < n; i += step) b[i] = b[i];
+    b[n - 1] = b[n - 1];
+}
+
+void rt_prefault_stack(size_t bytes)
+{
+    /* 16KB ずつ再帰して深い方から触る（触るのを呼び出しの後にして末尾呼び出しにさせない） */
+    volatile uint8_t buf[16384];
+    if (bytes > sizeof(buf)) rt_prefault_stack(bytes - sizeof(buf));
+    size_t n = bytes < sizeof(buf) ? bytes : sizeof(buf);
+    for (size_t i = 0; i < n; i += 1024) buf[i] = 0;
+}
+
+/* ---------------- ヒストグラム ---------------- */
+
+static int bucket_of(uint64_t ns)
+{
+    uint64_t us = ns / 1000u;
+    if (us == 0) return 0;
+    int b = 64 - __builtin_clzll(us);   /* 1 → 1, 2〜3 → 2, 4〜7 → 3 ... */
+    return b < RT_HIST_BUCKETS ? b : RT_HIST_BUCKETS - 1;
+}
+
+/* ビン b の範囲 [lo, hi) us（hi = 0 は上限なし） */
+static void bucket_range(int b, uint64_t* lo, uint64_t* hi)
+{
+    *lo = (b == 0) ? 0 : (uint64_t)1 << (b - 1);
+    *hi = (b == RT_HIST_BUCKETS - 1) ? 0 : (uint64_t)1 << b;
+}
+
+void rt_hist_reset(rt_hist_t* h)
+{
+    if (!h) return;
+    memset(h, 0, sizeof(*h));
+}
+
+void rt_hist_add(rt_hist_t* h, uint64_t ns)
+{
+    if (!h) return;
+    if (h->count == 0 || ns < h->min_ns) h->min_ns = ns;
+    if (ns > h->max_ns) h->max_ns = ns;
+    h->count++;
+    h->sum_ns += ns;
+    h->bucket[bucket_of(ns)]++;
+}
+
+uint64_t rt_hist_quantile_ns(const rt_hist_t* h, double q)
+{
+    if (!h || h->count == 0) return 0;
+    uint64_t target = (uint64_t)(q * (double)h->count + 0.5);
+    if (target < 1) target = 1;
+    uint64_t acc = 0;
+    for (int b = 0; b < RT_HIST_BUCKETS; b++) {
+        acc += h->bucket[b];
+        if (acc >= target) {
+            uint64_t lo, hi;
+            bucket_range(b, &lo, &hi);
+            uint64_t edge = hi ? hi * 1000u : h->max_ns;
+            return edge < h->max_ns ? edge : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+void rt_hist_print(FILE* f, const char* name, const rt_hist_t* h)
+{
+    if (!f || !h) return;
+    if (h->count == 0) {
+        fprintf(f, "  %-10s: n=0\n", name);
+        return;
+    }
+    fprintf(f, "  %-10s: n=%llu min=%.1fus avg=%.1fus p50<=%.1fus p99<=%.1fus p99.9<=%.1fus max=%.1fus\n",
+            name, (unsigned long long)h->count, h->min_ns * 1e-3,
+            (double)h->sum_ns / (double)h->count * 1e-3,
+            rt_hist_quantile_ns(h, 0.5) * 1e-3, rt_hist_quantile_ns(h, 0.99) * 1e-3,
+            rt_hist_quantile_ns(h, 0.999) * 1e-3, h->max_ns * 1e-3);
+    fprintf(f, "  %-10s ", "");
+    for (int b = 0; b < RT_HIST_BUCKETS; b++) {
+        if (h->bucket[b] == 0) continue;
+        uint64_t lo, hi;
+        bucket_range(b, &lo, &hi);
+        if (hi) fprintf(f, " <%lluus:%llu", (unsigned long long)hi, (unsigned long long)h->bucket[b]);
+        else    fprintf(f, " >=%lluus:%llu", (unsigned long long)lo, (unsigned long long)h->bucket[b]);
+    }
+    fprintf(f, "\n");
+}
+
+void rt_hist_write_csv(FILE* f, int header, const char* session, const char* name, const rt_hist_t* h)
+{
+    if (!f || !h) return;
+    if (header) fprintf(f, "session,name,lo_us,hi_us,count\n");
+    for (int b = 0; b < RT_HIST_BUCKETS; b++) {
+        if (h->bucket[b] == 0) continue;
+        uint64_t lo, hi;
+        bucket_range(b, &lo, &hi);
+        fprintf(f, "%s,%s,%llu,", session, name, (unsigned long long)lo);
+        if (hi) fprintf(f, "%llu", (unsigned long long)hi);
+        fprintf(f, ",%llu\n", (unsigned long long)h->bucket[b]);
+    }
+}
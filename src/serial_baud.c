@@ -0,0 +1,35 @@
+/* serial_baud: termios2 + BOTHER で任意のボーレートを設定する
+ *
+ * <asm/termbits.h> の struct termios と glibc の <termios.h> は同じ名前で
+ * 衝突するので、この部分だけ別ファイルにしている（serial_setup.c から呼ぶ）。
+ */
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+
+int serial_baud_apply(int fd, int baudrate, int* actual);
+int serial_baud_read(int fd, int* actual);
+
+int serial_baud_apply(int fd, int baudrate, int* actual)
+{
+    struct termios2 t2;
+    if (ioctl(fd, TCGETS2, &t2) != 0) return -1;
+
+    t2.c_cflag &= ~(tcflag_t)CBAUD;
+    t2.c_cflag |= BOTHER;
+    t2.c_cflag &= ~(tcflag_t)(CBAUD << IBSHIFT);
+    t2.c_cflag |= (tcflag_t)(BOTHER << IBSHIFT);
+    t2.c_ispeed = (speed_t)baudrate;
+    t2.c_ospeed = (speed_t)baudrate;
+    if (ioctl(fd, TCSETS2, &t2) != 0) return -1;
+
+    return serial_baud_read(fd, actual);
+}
+
+/* ドライバが実際に採用した速度（分周の丸め後）を読み戻す */
+int serial_baud_read(int fd, int* actual)
+{
+    struct termios2 t2;
+    if (ioctl(fd, TCGETS2, &t2) != 0) return -1;
+    if (actual) *actual = (int)t2.c_ospeed;
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include "serial_setup.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+
+/* serial_baud.c（<termios.h> と同居できないので別ファイル） */
+int serial_baud_apply(int fd, int baudrate, int* actual);
+int serial_baud_read(int fd, int* actual);
+
+typedef struct {
+    int     rate;
+    speed_t flag;
+} baud_entry_t;
+
+static const baud_entry_t BAUD_TABLE[] = {
+    { 9600, B9600 },       { 19200, B19200 },     { 38400, B38400 },
+    { 57600, B57600 },     { 115200, B115200 },   { 230400, B230400 },
+    { 460800, B460800 },   { 500000, B500000 },   { 576000, B576000 },
+    { 921600, B921600 },   { 1000000, B1000000 }, { 1152000, B1152000 },
+    { 1500000, B1500000 }, { 2000000, B2000000 }, { 2500000, B2500000 },
+    { 3000000, B3000000 }, { 3500000, B3500000 }, { 4000000, B4000000 },
+};
+
+static speed_t baud_to_flag(int baudrate)
+{
+    for (size_t i = 0; i < sizeof(BAUD_TABLE) / sizeof(BAUD_TABLE[0]); i++)
+        if (BAUD_TABLE[i].rate == baudrate) return BAUD_TABLE[i].flag;
+    return 0;   /* 表にない → BOTHER */
+}
+
+void serial_cfg_default(serial_cfg_t* cfg, int baudrate)
+{
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->baudrate = baudrate;
+    cfg->low_latency = SERIAL_LOW_LATENCY;
+    cfg->ftdi_latency_ms = SERIAL_FTDI_LATENCY_MS;
+}
+
+/* /dev/ttyUSB0 → /sys/class/tty/ttyUSB0/device/latency_timer（シンボリックリンクも辿る） */
+static int ftdi_latency_path(const char* devpath, char* out, size_t outlen)
+{
+    if (!devpath) return -1;
+    char real[PATH_MAX];
+    const char* p = realpath(devpath, real) ? real : devpath;
+    const char* name = strrchr(p, '/');
+    name = name ? name + 1 : p;
+    if (*name == '\0') return -1;
+
+    snprintf(out, outlen, "/sys/class/tty/%s/device/latency_timer", name);
+    return (access(out, F_OK) == 0) ? 0 : -1;
+}
+
+static int ftdi_latency(const char* devpath, int set_ms)
+{
+    char path[PATH_MAX];
+    if (ftdi_latency_path(devpath, path, sizeof(path)) != 0) return -1;
+
+    if (set_ms > 0) {
+        FILE* f = fopen(path, "w");
+        if (!f || fprintf(f, "%d\n", set_ms) < 0) perror("ftdi latency_timer");
+        if (f) fclose(f);   /* 書けなくても（権限）現在値は報告する */
+    }
+
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    int v = -1;
+    if (fscanf(f, "%d", &v) != 1) v = -1;
+    fclose(f);
+    return v;
+}
+
+/* ASYNC_LOW_LATENCY / xmit_fifo_size（TIOCGSERIAL が通らないドライバは -1） */
+static void serial_struct_tune(int fd, const serial_cfg_t* cfg, serial_info_t* info)
+{
+    struct serial_struct ss;
+    if (ioctl(fd, TIOCGSERIAL, &ss) != 0) {
+        info->low_latency = -1;
+        info->xmit_fifo_size = -1;
+        return;
+    }
+
+    int want_ll = cfg->low_latency ? 1 : 0;
+    int cur_ll = (ss.flags & ASYNC_LOW_LATENCY) ? 1 : 0;
+    int change = (want_ll && !cur_ll) || (cfg->xmit_fifo_size > 0 && ss.xmit_fifo_size != cfg->xmit_fifo_size);
+    if (change) {
+        if (want_ll) ss.flags |= ASYNC_LOW_LATENCY;
+        if (cfg->xmit_fifo_size > 0) ss.xmit_fifo_size = cfg->xmit_fifo_size;
+        if (ioctl(fd, TIOCSSERIAL, &ss) != 0) perror("TIOCSSERIAL");
+        if (ioctl(fd, TIOCGSERIAL, &ss) != 0) {
+            info->low_latency = -1;
+            info->xmit_fifo_size = -1;
+            return;
+        }
+    }
+    info->low_latency = (ss.flags & ASYNC_LOW_LATENCY) ? 1 : 0;
+    info->xmit_fifo_size = ss.xmit_fifo_size;
+}
+
+int serial_configure(int fd, const char* devpath, const serial_cfg_t* cfg, serial_info_t* info)
+{
+    if (fd < 0 || !cfg || cfg->baudrate <= 0) return -1;
+
+    serial_info_t tmp;
+    if (!info) info = &tmp;
+    memset(info, 0, sizeof(*info));
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) return -1;
+
+    cfmakeraw(&tio);
+    speed_t sp = baud_to_flag(cfg->baudrate);
+    if (sp != 0) {
+        cfsetispeed(&tio, sp);
+        cfsetospeed(&tio, sp);
+    }
+
+    tio.c_cflag |= (CLOCAL | CREAD);
+    tio.c_cflag &= ~PARENB;
+    tio.c_cflag &= ~CSTOPB;
+    tio.c_cflag &= ~CSIZE;
+    tio.c_cflag |= CS8;
+
+    /* 受信待ちは select / poll / epoll で制御するので 0/0 */
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) return -1;
+
+    /* 表にないレートは termios2 で直接指定 */
+    if (sp == 0) {
+        if (serial_baud_apply(fd, cfg->baudrate, &info->baud_actual) != 0) {
+            fprintf(stderr, "serial: baud %d not accepted (BOTHER)\n", cfg->baudrate);
+            return -1;
+        }
+        info->custom_baud = 1;
+    } else if (serial_baud_read(fd, &info->baud_actual) != 0) {
+        info->baud_actual = 0;
+    }
+
+    serial_struct_tune(fd, cfg, info);
+    info->ftdi_latency_ms = ftdi_latency(devpath, cfg->ftdi_latency_ms);
+    return 0;
+}
+
+int serial_open(const char* devpath, const serial_cfg_t* cfg, serial_info_t* info)
+{
+    if (!devpath || !cfg) return -1;
+
+    int fd = open(devpath, O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+
+    if (serial_configure(fd, devpath, cfg, info) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void serial_info_print(const char* name, const char* devpath, const serial_info_t* info)
+{
+    if (!info) return;
+
+    char ll[16], ftdi[16], fifo[16];
+    snprintf(ll, sizeof(ll), "%s", info->low_latency < 0 ? "n/a" : (info->low_latency ? "on" : "off"));
+    if (info->ftdi_latency_ms < 0) snprintf(ftdi, sizeof(ftdi), "n/a");
+    else                           snprintf(ftdi, sizeof(ftdi), "%dms", info->ftdi_latency_ms);
+    if (info->xmit_fifo_size < 0) snprintf(fifo, sizeof(fifo), "n/a");
+    else                          snprintf(fifo, sizeof(fifo), "%d", info->xmit_fifo_size);
+
+    printf("%s %s: baud=%d%s low_latency=%s ftdi_latency=%s xmit_fifo=%s\n",
+           name ? name : "serial", devpath ? devpath : "?",
+           info->baud_actual, info->custom_baud ? "(custom)" : "",
+           ll, ftdi, fifo);
+}
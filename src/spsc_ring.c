@@ -0,0 +1,215 @@
+#define _GNU_SOURCE   /* memfd_create */
+#include "spsc_ring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define CACHE_LINE 64
+
+struct spsc_ring {
+    /* 書き手だけが書く */
+    _Alignas(CACHE_LINE) _Atomic uint64_t head;
+    /* 読み手だけが書く */
+    _Alignas(CACHE_LINE) _Atomic uint64_t tail;
+    /* 作ったあとは読むだけ */
+    _Alignas(CACHE_LINE) uint8_t* buf;
+    size_t size;
+    size_t mask;
+    int    mirrored;
+};
+
+static size_t round_pow2(size_t n)
+{
+    size_t p = CACHE_LINE;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+/* memfd を [base, base+size) と [base+size, base+2*size) に続けて map。できなければ NULL */
+static uint8_t* map_mirror(size_t size)
+{
+    int fd = memfd_create("spsc_ring", MFD_CLOEXEC);
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return NULL;
+    }
+    /* 先に2倍の範囲をまとめて予約してから、その上に重ねる（間に他の map が入らない） */
+    void* base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    uint8_t* b = (uint8_t*)base;
+    if (mmap(b, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(b + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * size);
+        close(fd);
+        return NULL;
+    }
+    close(fd);   /* map が残っている間は実体も残る */
+    return b;
+}
+
+spsc_ring_t* spsc_ring_create(size_t bytes, unsigned flags)
+{
+    if (bytes == 0) return NULL;
+    size_t size = round_pow2(bytes);
+
+    spsc_ring_t* r = (spsc_ring_t*)aligned_alloc(CACHE_LINE, sizeof(*r));
+    if (!r) return NULL;
+    memset(r, 0, sizeof(*r));
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+
+    if (flags & SPSC_RING_MIRROR) {
+        long pg = sysconf(_SC_PAGESIZE);
+        size_t ms = size;
+        if (pg > 0 && ms < (size_t)pg) ms = (size_t)pg;   /* ページも2の累乗なので2の累乗のまま */
+        r->buf = map_mirror(ms);
+        if (r->buf) {
+            size = ms;
+            r->mirrored = 1;
+        } else {
+            fprintf(stderr, "spsc_ring: mirrored map unavailable, using a plain buffer\n");
+        }
+    }
+    if (!r->buf) {
+        r->buf = (uint8_t*)aligned_alloc(CACHE_LINE, size);
+        if (!r->buf) {
+            free(r);
+            return NULL;
+        }
+    }
+    r->size = size;
+    r->mask = size - 1;
+    /* 受信中のページフォルトを避けるため、ここで実ページまで割り当てる */
+    memset(r->buf, 0, size);
+    return r;
+}
+
+void spsc_ring_destroy(spsc_ring_t* r)
+{
+    if (!r) return;
+    if (r->mirrored) munmap(r->buf, 2 * r->size);
+    else             free(r->buf);
+    free(r);
+}
+
+size_t spsc_ring_size(const spsc_ring_t* r)
+{
+    return r ? r->size : 0;
+}
+
+int spsc_ring_mirrored(const spsc_ring_t* r)
+{
+    return r ? r->mirrored : 0;
+}
+
+/* ストリーム位置 pos から n バイトを iov に分ける（ミラー時は常に1本） */
+static void fill_iov(const spsc_ring_t* r, uint64_t pos, size_t n, struct iovec iov[2])
+{
+    if (!iov) return;
+    size_t off = (size_t)(pos & r->mask);
+    size_t first = n;
+    if (!r->mirrored && off + n > r->size) first = r->size - off;
+    iov[0].iov_base = r->buf + off;
+    iov[0].iov_len  = first;
+    iov[1].iov_base = r->buf;
+    iov[1].iov_len  = n - first;
+}
+
+/* ---------------- 書き手 ---------------- */
+
+size_t spsc_ring_write_space(spsc_ring_t* r, struct iovec iov[2])
+{
+    if (!r) return 0;
+    uint64_t h = atomic_load_explicit(&r->head, memory_order_relaxed);   /* 自分しか書かない */
+    uint64_t t = atomic_load_explicit(&r->tail, memory_order_acquire);   /* 読み手が読み終えてから上書きする */
+    size_t n = r->size - (size_t)(h - t);
+    fill_iov(r, h, n, iov);
+    return n;
+}
+
+void spsc_ring_commit(spsc_ring_t* r, size_t n)
+{
+    if (!r || n == 0) return;
+    uint64_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    atomic_store_explicit(&r->head, h + n, memory_order_release);
+}
+
+size_t spsc_ring_write(spsc_ring_t* r, const void* src, size_t n)
+{
+    struct iovec iov[2];
+    size_t space = spsc_ring_write_space(r, iov);
+    if (!src || space == 0) return 0;
+    if (n > space) n = space;
+    size_t a = n < iov[0].iov_len ? n : iov[0].iov_len;
+    memcpy(iov[0].iov_base, src, a);
+    if (n > a) memcpy(iov[1].iov_base, (const uint8_t*)src + a, n - a);
+    spsc_ring_commit(r, n);
+    return n;
+}
+
+/* ---------------- 読み手 ---------------- */
+
+size_t spsc_ring_read_avail(spsc_ring_t* r, struct iovec iov[2])
+{
+    if (!r) return 0;
+    uint64_t t = atomic_load_explicit(&r->tail, memory_order_relaxed);   /* 自分しか書かない */
+    uint64_t h = atomic_load_explicit(&r->head, memory_order_acquire);   /* commit 前の書き込みが見える */
+    size_t n = (size_t)(h - t);
+    fill_iov(r, t, n, iov);
+    return n;
+}
+
+void spsc_ring_consume(spsc_ring_t* r, size_t n)
+{
+    if (!r || n == 0) return;
+    uint64_t t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    spsc_ring_consume_to(r, t + n);
+}
+
+void spsc_ring_consume_to(spsc_ring_t* r, uint64_t pos)
+{
+    if (!r) return;
+    uint64_t t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint64_t h = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (pos < t) return;       /* 戻しはしない */
+    if (pos > h) pos = h;      /* まだ書かれていない所までは返さない */
+    atomic_store_explicit(&r->tail, pos, memory_order_release);
+}
+
+size_t spsc_ring_read(spsc_ring_t* r, void* dst, size_t n)
+{
+    struct iovec iov[2];
+    size_t avail = spsc_ring_read_avail(r, iov);
+    if (!dst || avail == 0) return 0;
+    if (n > avail) n = avail;
+    size_t a = n < iov[0].iov_len ? n : iov[0].iov_len;
+    memcpy(dst, iov[0].iov_base, a);
+    if (n > a) memcpy((uint8_t*)dst + a, iov[1].iov_base, n - a);
+    spsc_ring_consume(r, n);
+    return n;
+}
+
+/* ---------------- 位置 ---------------- */
+
+uint64_t spsc_ring_head(const spsc_ring_t* r)
+{
+    return r ? atomic_load_explicit(&((spsc_ring_t*)r)->head, memory_order_acquire) : 0;
+}
+
+uint64_t spsc_ring_tail(const spsc_ring_t* r)
+{
+    return r ? atomic_load_explicit(&((spsc_ring_t*)r)->tail, memory_order_acquire) : 0;
+}
+
+uint8_t* spsc_ring_at(const spsc_ring_t* r, uint64_t pos)
+{
+    return r ? r->buf + (size_t)(pos & r->mask) : NULL;
+}
@@ -0,0 +1,224 @@
+#include "tdoa.h"
+#include "crosscorr_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fftw3.h>
+
+struct tdoa_ctx {
+    int    win, nfft, nh;
+    double fs;
+    int    k_lo, k_hi;     /* 使う bin [k_lo, k_hi] */
+
+    float*         hann;   /* win */
+    float*         in_l;   /* nfft（後ろは 0 埋め） */
+    float*         in_r;
+    fftwf_complex* spec_l; /* nh */
+    fftwf_complex* spec_r;
+    fftwf_complex* cross;  /* nh: 重み付き相互スペクトル（c2r で壊れるので g に控える） */
+    double*        g;      /* 2*nh: sinc 補間用の控え（re, im） */
+    float*         corr;   /* nfft: 粗い相関（循環, 負のラグは後ろ） */
+
+    fftwf_plan p_fwd;      /* r2c: in_l -> spec_l（R は new-array execute） */
+    fftwf_plan p_inv;      /* c2r: cross -> corr */
+
+    arena_t* arena;        /* バッファの確保先（NULL = malloc / fftwf_malloc） */
+};
+
+static int next_pow2(int n)
+{
+    int p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+tdoa_ctx_t* tdoa_create(int win, double fs, double f_lo, double f_hi, const xcorr_opts_t* opt)
+{
+    if (win < 8 || fs <= 0.0) return NULL;
+
+    xcorr_opts_t o;
+    memset(&o, 0, sizeof(o));
+    if (opt) o = *opt;
+
+    tdoa_ctx_t* t = (tdoa_ctx_t*)calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    t->win  = win;
+    t->nfft = next_pow2(2 * win);   /* ±win の線形相関が折り返さない長さ */
+    t->nh   = t->nfft / 2 + 1;
+    t->fs   = fs;
+    t->arena = o.arena;
+
+    if (f_hi <= 0.0 || f_hi > fs * 0.5) f_hi = fs * 0.5;
+    t->k_lo = (int)ceil(f_lo * (double)t->nfft / fs);
+    t->k_hi = (int)floor(f_hi * (double)t->nfft / fs);
+    if (t->k_lo < 0) t->k_lo = 0;
+    if (t->k_hi > t->nh - 1) t->k_hi = t->nh - 1;
+
+    size_t nf = (size_t)t->nfft, nh = (size_t)t->nh;
+    t->hann   = (float*)xcorr_buf_alloc(t->arena, sizeof(float) * (size_t)win);
+    t->in_l   = (float*)xcorr_buf_alloc(t->arena, sizeof(float) * nf);
+    t->in_r   = (float*)xcorr_buf_alloc(t->arena, sizeof(float) * nf);
+    t->spec_l = (fftwf_complex*)xcorr_buf_alloc(t->arena, sizeof(fftwf_complex) * nh);
+    t->spec_r = (fftwf_complex*)xcorr_buf_alloc(t->arena, sizeof(fftwf_complex) * nh);
+    t->cross  = (fftwf_complex*)xcorr_buf_alloc(t->arena, sizeof(fftwf_complex) * nh);
+    t->g      = (double*)xcorr_buf_alloc(t->arena, sizeof(double) * 2 * nh);
+    t->corr   = (float*)xcorr_buf_alloc(t->arena, sizeof(float) * nf);
+    if (!t->hann || !t->in_l || !t->in_r || !t->spec_l || !t->spec_r ||
+        !t->cross || !t->g || !t->corr) {
+        tdoa_destroy(t);
+        return NULL;
+    }
+
+    /* MEASURE/PATIENT は配列を書き潰すので中身を入れる前に作る */
+    t->p_fwd = xcorr_plan_r2c(t->nfft, t->in_l, t->spec_l, &o);
+    t->p_inv = xcorr_plan_c2r(t->nfft, t->cross, t->corr, &o);
+    if (!t->p_fwd || !t->p_inv) {
+        tdoa_destroy(t);
+        return NULL;
+    }
+
+    for (int i = 0; i < win; i++)
+        t->hann[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * (double)i / (double)(win - 1)));
+    return t;
+}
+
+void tdoa_destroy(tdoa_ctx_t* t)
+{
+    if (!t) return;
+    if (t->p_fwd) fftwf_destroy_plan(t->p_fwd);
+    if (t->p_inv) fftwf_destroy_plan(t->p_inv);
+    xcorr_buf_free(t->arena, t->hann);
+    xcorr_buf_free(t->arena, t->in_l);
+    xcorr_buf_free(t->arena, t->in_r);
+    xcorr_buf_free(t->arena, t->spec_l);
+    xcorr_buf_free(t->arena, t->spec_r);
+    xcorr_buf_free(t->arena, t->cross);
+    xcorr_buf_free(t->arena, t->g);
+    xcorr_buf_free(t->arena, t->corr);
+    free(t);
+}
+
+int tdoa_nfft(const tdoa_ctx_t* t)
+{
+    return t ? t->nfft : 0;
+}
+
+/* 窓を切り出して平均を引き Hann を掛ける（残りは 0） */
+static void load_window(tdoa_ctx_t* t, const float* lr, size_t start, size_t len)
+{
+    double ml = 0.0, mr = 0.0;
+    for (size_t i = 0; i < len; i++) {
+        ml += lr[2 * (start + i)];
+        mr += lr[2 * (start + i) + 1];
+    }
+    ml /= (double)len;
+    mr /= (double)len;
+
+    /* 窓が短いとき（端）は Hann を len 点に縮めて掛ける（win 点の表を間引いて引く） */
+    for (size_t i = 0; i < len; i++) {
+        float h = t->hann[i * (size_t)t->win / len];
+        t->in_l[i] = (lr[2 * (start + i)]     - (float)ml) * h;
+        t->in_r[i] = (lr[2 * (start + i) + 1] - (float)mr) * h;
+    }
+    memset(t->in_l + len, 0, sizeof(float) * ((size_t)t->nfft - len));
+    memset(t->in_r + len, 0, sizeof(float) * ((size_t)t->nfft - len));
+}
+
+/* 帯域制限した相関を任意の τ（サンプル）で評価：r(τ) = Σ w_k Re(G_k e^{j2πkτ/nfft}) */
+static double corr_at(const tdoa_ctx_t* t, double tau)
+{
+    double th = 2.0 * M_PI * tau / (double)t->nfft;
+    double wr = cos(th), wi = sin(th);
+    /* e^{j k th} を漸化式で回す（k_lo から開始） */
+    double zr = cos(th * t->k_lo), zi = sin(th * t->k_lo);
+    double s = 0.0;
+    for (int k = t->k_lo; k <= t->k_hi; k++) {
+        double gr = t->g[2 * k], gi = t->g[2 * k + 1];
+        double w = (k == 0 || k == t->nh - 1) ? 1.0 : 2.0;
+        s += w * (gr * zr - gi * zi);
+        double nr = zr * wr - zi * wi;
+        zi = zr * wi + zi * wr;
+        zr = nr;
+    }
+    return s;
+}
+
+int tdoa_run(tdoa_ctx_t* t, const float* lr, size_t n_frames, size_t center, int max_lag,
+             tdoa_weight_t w, tdoa_interp_t interp, tdoa_result_t* out)
+{
+    if (!t || !lr || !out || n_frames < 8) return -1;
+    if (max_lag <= 0 || max_lag >= t->win) max_lag = t->win - 1;
+
+    size_t len = (n_frames < (size_t)t->win) ? n_frames : (size_t)t->win;
+    size_t start = (center > len / 2) ? center - len / 2 : 0;
+    if (start + len > n_frames) start = n_frames - len;
+    load_window(t, lr, start, len);
+
+    fftwf_execute_dft_r2c(t->p_fwd, t->in_l, t->spec_l);
+    fftwf_execute_dft_r2c(t->p_fwd, t->in_r, t->spec_r);
+
+    /* G = conj(L) R（R が遅れると正のラグに山）。PHAT は |G| で割って位相だけ残す */
+    double norm = 0.0;
+    for (int k = 0; k < t->nh; k++) {
+        double gr = 0.0, gi = 0.0;
+        if (k >= t->k_lo && k <= t->k_hi) {
+            double lr_ = t->spec_l[k][0], li = t->spec_l[k][1];
+            double rr = t->spec_r[k][0],  ri = t->spec_r[k][1];
+            gr = lr_ * rr + li * ri;
+            gi = lr_ * ri - li * rr;
+            double mag = sqrt(gr * gr + gi * gi);
+            if (w == TDOA_PHAT) {
+                if (mag > 1e-20) { gr /= mag; gi /= mag; mag = 1.0; }
+                else             { gr = gi = mag = 0.0; }
+            }
+            norm += ((k == 0 || k == t->nh - 1) ? 1.0 : 2.0) * mag;
+        }
+        t->g[2 * k] = gr;
+        t->g[2 * k + 1] = gi;
+        t->cross[k][0] = (float)gr;
+        t->cross[k][1] = (float)gi;
+    }
+    if (norm <= 0.0) return -1;
+
+    fftwf_execute(t->p_inv);
+
+    /* 粗い最大値（±max_lag, 負のラグは配列の後ろ） */
+    int best = 0;
+    float bv = -INFINITY;
+    for (int lag = -max_lag; lag <= max_lag; lag++) {
+        float v = t->corr[(lag + t->nfft) % t->nfft];
+        if (v > bv) { bv = v; best = lag; }
+    }
+
+    double d = (double)best;
+    double pk = bv;
+    if (interp == TDOA_INTERP_PARABOLIC) {
+        double a = t->corr[(best - 1 + t->nfft) % t->nfft];
+        double c = t->corr[(best + 1 + t->nfft) % t->nfft];
+        double den = a - 2.0 * pk + c;
+        if (den < 0.0) {
+            double dx = 0.5 * (a - c) / den;
+            d += dx;
+            pk -= 0.25 * (a - c) * dx;
+        }
+    } else {
+        /* 黄金分割で [best-1, best+1] の最大（帯域制限なので山は滑らか） */
+        const double gr = 0.6180339887498949;
+        double lo = d - 1.0, hi = d + 1.0;
+        double x1 = hi - gr * (hi - lo), x2 = lo + gr * (hi - lo);
+        double f1 = corr_at(t, x1), f2 = corr_at(t, x2);
+        while (hi - lo > 1e-4) {
+            if (f1 < f2) { lo = x1; x1 = x2; f1 = f2; x2 = lo + gr * (hi - lo); f2 = corr_at(t, x2); }
+            else         { hi = x2; x2 = x1; f2 = f1; x1 = hi - gr * (hi - lo); f1 = corr_at(t, x1); }
+        }
+        d = 0.5 * (lo + hi);
+        pk = corr_at(t, d);
+    }
+
+    out->delay_samples = d;
+    out->delay_s = d / t->fs;
+    out->peak = (float)(pk / norm);
+    out->start = start;
+    return 0;
+}
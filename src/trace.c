@@ -0,0 +1,221 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+typedef struct {
+    uint64_t    t_ns;
+    const char* name;
+    uint32_t    arg;
+    char        ph;     /* 'B' 'E' 'i' 'b' 'e' */
+} trace_ev_t;
+
+typedef struct trace_buf {
+    struct trace_buf* next;
+    const char* thread;
+    int         tid;
+    uint64_t    n;      /* 書いた総数（持ち主のスレッドだけが書く） */
+    size_t      mask;
+    trace_ev_t  ev[];
+} trace_buf_t;
+
+static atomic_int      g_on;
+static atomic_uint     g_gen;    /* trace_start ごとに変わる（古いリングを指すスレッドを見分ける） */
+static pthread_mutex_t g_mu = PTHREAD_MUTEX_INITIALIZER;
+static trace_buf_t*    g_bufs;   /* 登録順の逆 */
+static size_t          g_cap;
+static uint64_t        g_t0;
+static int             g_next_tid;
+
+static _Thread_local trace_buf_t* tl_buf;
+static _Thread_local unsigned     tl_gen;
+static _Thread_local const char*  tl_name;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void free_bufs(void)
+{
+    while (g_bufs) {
+        trace_buf_t* b = g_bufs;
+        g_bufs = b->next;
+        free(b);
+    }
+}
+
+/* 呼んだスレッドのリング（無ければ作って登録する）。作れなければ NULL */
+static trace_buf_t* this_buf(void)
+{
+    unsigned gen = atomic_load_explicit(&g_gen, memory_order_acquire);
+    if (tl_buf && tl_gen == gen) return tl_buf;
+
+    pthread_mutex_lock(&g_mu);
+    trace_buf_t* b = NULL;
+    if (g_cap > 0) b = (trace_buf_t*)malloc(sizeof(*b) + sizeof(trace_ev_t) * g_cap);
+    if (b) {
+        /* 記録中にページフォルトが起きないよう、ここで全部触る */
+        memset(b->ev, 0, sizeof(trace_ev_t) * g_cap);
+        b->thread = tl_name;
+        b->tid = ++g_next_tid;
+        b->n = 0;
+        b->mask = g_cap - 1;
+        b->next = g_bufs;
+        g_bufs = b;
+    }
+    pthread_mutex_unlock(&g_mu);
+    tl_buf = b;
+    tl_gen = gen;
+    return b;
+}
+
+static void put_at(uint64_t t_ns, char ph, const char* name, uint32_t arg)
+{
+    trace_buf_t* b = this_buf();
+    if (!b) return;
+    trace_ev_t* e = &b->ev[b->n & b->mask];
+    e->t_ns = t_ns;
+    e->name = name;
+    e->arg  = arg;
+    e->ph   = ph;
+    b->n++;
+}
+
+static void put(char ph, const char* name, uint32_t arg)
+{
+    if (!atomic_load_explicit(&g_on, memory_order_relaxed)) return;
+    put_at(now_ns(), ph, name, arg);
+}
+
+int trace_start(size_t events_per_thread)
+{
+    if (events_per_thread == 0) return -1;
+    size_t cap = 1;
+    while (cap < events_per_thread) cap <<= 1;
+
+    pthread_mutex_lock(&g_mu);
+    atomic_store(&g_on, 0);
+    free_bufs();
+    g_cap = cap;
+    g_next_tid = 0;
+    g_t0 = now_ns();
+    atomic_fetch_add_explicit(&g_gen, 1u, memory_order_release);
+    pthread_mutex_unlock(&g_mu);
+
+    atomic_store(&g_on, 1);
+    if (tl_name) this_buf();   /* 名前を付け済みのスレッド（main など）はここで用意 */
+    return 0;
+}
+
+void trace_stop(void)
+{
+    atomic_store(&g_on, 0);
+}
+
+int trace_enabled(void)
+{
+    return atomic_load_explicit(&g_on, memory_order_relaxed);
+}
+
+void trace_thread_name(const char* name)
+{
+    tl_name = name;
+    if (!atomic_load_explicit(&g_on, memory_order_relaxed)) return;
+    trace_buf_t* b = this_buf();
+    if (b) b->thread = name;
+}
+
+void trace_begin(const char* name, uint32_t arg)       { put('B', name, arg); }
+void trace_end(const char* name, uint32_t arg)         { put('E', name, arg); }
+void trace_instant(const char* name, uint32_t arg)     { put('i', name, arg); }
+void trace_async_begin(const char* name, uint32_t id)  { put('b', name, id); }
+void trace_async_end(const char* name, uint32_t id)    { put('e', name, id); }
+
+uint64_t trace_now(void)
+{
+    return atomic_load_explicit(&g_on, memory_order_relaxed) ? now_ns() : 0;
+}
+
+void trace_span(const char* name, uint64_t t0, uint32_t arg)
+{
+    if (t0 == 0 || !atomic_load_explicit(&g_on, memory_order_relaxed)) return;
+    put_at(t0, 'B', name, arg);
+    put_at(now_ns(), 'E', name, arg);
+}
+
+/* ---------------- 書き出し ---------------- */
+
+static long write_buf(FILE* f, const trace_buf_t* b, int pid, int* first)
+{
+    uint64_t i0 = (b->n > (uint64_t)(b->mask + 1)) ? b->n - (uint64_t)(b->mask + 1) : 0;
+    long cnt = 0;
+    int depth = 0;   /* 上書きで B が消えた E は出さない */
+
+    fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            *first ? "" : ",", pid, b->tid, b->thread ? b->thread : "thread");
+    *first = 0;
+    for (uint64_t i = i0; i < b->n; i++) {
+        const trace_ev_t* e = &b->ev[i & b->mask];
+        if (e->ph == 'B') depth++;
+        if (e->ph == 'E') {
+            if (depth == 0) continue;
+            depth--;
+        }
+        double ts = (e->t_ns > g_t0) ? (double)(e->t_ns - g_t0) * 1e-3 : 0.0;   /* us */
+        fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"tp\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+                e->name, e->ph, ts, pid, b->tid);
+        if (e->ph == 'b' || e->ph == 'e') fprintf(f, ",\"id\":%u}", e->arg);
+        else if (e->ph == 'i')            fprintf(f, ",\"s\":\"t\",\"args\":{\"arg\":%u}}", e->arg);
+        else                              fprintf(f, ",\"args\":{\"arg\":%u}}", e->arg);
+        cnt++;
+    }
+    return cnt;
+}
+
+long trace_write_json(const char* path)
+{
+    if (!path) return -1;
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    int pid = (int)getpid(), first = 1;
+    long cnt = 0;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    pthread_mutex_lock(&g_mu);
+    for (const trace_buf_t* b = g_bufs; b; b = b->next) cnt += write_buf(f, b, pid, &first);
+    pthread_mutex_unlock(&g_mu);
+    fprintf(f, "\n]}\n");
+    if (ferror(f)) cnt = -1;
+    if (fclose(f) != 0) cnt = -1;
+    return cnt;
+}
+
+uint64_t trace_dropped(void)
+{
+    uint64_t d = 0;
+    pthread_mutex_lock(&g_mu);
+    for (const trace_buf_t* b = g_bufs; b; b = b->next)
+        if (b->n > (uint64_t)(b->mask + 1)) d += b->n - (uint64_t)(b->mask + 1);
+    pthread_mutex_unlock(&g_mu);
+    return d;
+}
+
+void trace_shutdown(void)
+{
+    pthread_mutex_lock(&g_mu);
+    atomic_store(&g_on, 0);
+    free_bufs();
+    g_cap = 0;
+    atomic_fetch_add_explicit(&g_gen, 1u, memory_order_release);
+    pthread_mutex_unlock(&g_mu);
+}
@@ -0,0 +1,219 @@
+#include "wav_writer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define WAV_HDR        44u
+#define PREVIEW_CHUNK  1024u   /* プレビューはこのフレーム数ずつまとめて push */
+
+struct wav_writer {
+    int       fd;
+    uint8_t*  map;
+    size_t    map_len;
+    uint64_t  cap_frames;   /* 今の map に入るフレーム数 */
+    uint64_t  frames;       /* 書いたフレーム数 */
+    uint32_t  rate;
+    uint8_t   carry[4];     /* push_raw の端数フレーム */
+    size_t    n_carry;
+    int       err;
+
+    /* プレビュー（decim 点平均 → 別の writer） */
+    wav_writer_t* prev;
+    uint32_t  decim;
+    int32_t   acc_l, acc_r;
+    uint32_t  acc_n;
+    int16_t   pbuf[2 * PREVIEW_CHUNK];
+    size_t    pn;
+};
+
+static void put_le16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_le32(uint8_t* p, uint32_t v) { put_le16(p, (uint16_t)v); put_le16(p + 2, (uint16_t)(v >> 16)); }
+
+static void write_header(uint8_t* h, uint32_t rate, uint64_t frames)
+{
+    uint64_t data = frames * 4u;
+    uint32_t d32 = (data > 0xFFFFFFFFu - 36u) ? 0xFFFFFFFFu - 36u : (uint32_t)data;
+    memcpy(h, "RIFF", 4);  put_le32(h + 4, 36u + d32);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_le32(h + 16, 16);  put_le16(h + 20, 1);  put_le16(h + 22, 2);
+    put_le32(h + 24, rate);
+    put_le32(h + 28, rate * 4u);
+    put_le16(h + 32, 4);   put_le16(h + 34, 16);
+    memcpy(h + 36, "data", 4);  put_le32(h + 40, d32);
+}
+
+/* cap_frames 分の領域を確保して map し直す（中身はファイルに残っている） */
+static int remap(wav_writer_t* w, uint64_t cap_frames)
+{
+    size_t len = (size_t)(WAV_HDR + cap_frames * 4u);
+    if (w->map) {
+        munmap(w->map, w->map_len);
+        w->map = NULL;
+    }
+    int rc = posix_fallocate(w->fd, 0, (off_t)len);
+    if (rc == EINVAL || rc == EOPNOTSUPP) rc = ftruncate(w->fd, (off_t)len) == 0 ? 0 : errno;
+    if (rc != 0) {
+        fprintf(stderr, "wav_writer: cannot reserve %zu bytes: %s\n", len, strerror(rc));
+        return -1;
+    }
+    void* m = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+    if (m == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    w->map = (uint8_t*)m;
+    w->map_len = len;
+    w->cap_frames = cap_frames;
+    return 0;
+}
+
+static int reserve(wav_writer_t* w, uint64_t need)
+{
+    if (need <= w->cap_frames) return 0;
+    uint64_t nc = w->cap_frames * 2u;
+    if (nc < need) nc = need;
+    if (remap(w, nc) != 0) {
+        w->err = 1;
+        return -1;
+    }
+    return 0;
+}
+
+wav_writer_t* wav_writer_open(const char* path, uint32_t sample_rate, uint64_t reserve_frames)
+{
+    if (!path || sample_rate == 0) return NULL;
+    wav_writer_t* w = (wav_writer_t*)calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->rate = sample_rate;
+    w->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) {
+        perror(path);
+        free(w);
+        return NULL;
+    }
+    if (remap(w, reserve_frames ? reserve_frames : sample_rate) != 0) {
+        close(w->fd);
+        free(w);
+        return NULL;
+    }
+    write_header(w->map, w->rate, 0);   /* 大きさは close で確定 */
+    return w;
+}
+
+int wav_writer_add_preview(wav_writer_t* w, const char* path, uint32_t decim)
+{
+    if (!w || w->prev || decim < 2 || w->frames > 0) return -1;
+    uint32_t rate = w->rate / decim;
+    w->prev = wav_writer_open(path, rate ? rate : 1, w->cap_frames / decim + 1);
+    if (!w->prev) return -1;
+    w->decim = decim;
+    return 0;
+}
+
+static void preview_flush(wav_writer_t* w)
+{
+    if (w->pn == 0) return;
+    if (wav_writer_push_i16(w->prev, w->pbuf, w->pn) != 0) w->err = 1;
+    w->pn = 0;
+}
+
+static void preview_frame(wav_writer_t* w, int l, int r)
+{
+    w->acc_l += l;
+    w->acc_r += r;
+    if (++w->acc_n < w->decim) return;
+    w->pbuf[2 * w->pn]     = (int16_t)lround((double)w->acc_l / w->decim);
+    w->pbuf[2 * w->pn + 1] = (int16_t)lround((double)w->acc_r / w->decim);
+    w->acc_l = w->acc_r = 0;
+    w->acc_n = 0;
+    if (++w->pn == PREVIEW_CHUNK) preview_flush(w);
+}
+
+/* [LH, LL, RH, RL] → [LL, LH, RL, RH]：16bit ごとの入れ替えなのでホストのエンディアンに依らない */
+static void swap_frames(const uint8_t* src, size_t n, uint8_t* dst)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint32_t x;
+        memcpy(&x, src + 4 * i, 4);
+        x = ((x & 0x00FF00FFu) << 8) | ((x >> 8) & 0x00FF00FFu);
+        memcpy(dst + 4 * i, &x, 4);
+    }
+}
+
+static int push_frames_raw(wav_writer_t* w, const uint8_t* raw, size_t n)
+{
+    if (reserve(w, w->frames + n) != 0) return -1;
+    swap_frames(raw, n, w->map + WAV_HDR + w->frames * 4u);
+    w->frames += n;
+    if (w->prev) {
+        for (size_t i = 0; i < n; i++)
+            preview_frame(w, (int16_t)(uint16_t)((raw[4 * i] << 8) | raw[4 * i + 1]),
+                             (int16_t)(uint16_t)((raw[4 * i + 2] << 8) | raw[4 * i + 3]));
+    }
+    return 0;
+}
+
+int wav_writer_push_raw(wav_writer_t* w, const uint8_t* raw, size_t nbytes)
+{
+    if (!w || (!raw && nbytes) || w->err) return -1;
+    if (w->n_carry) {
+        size_t k = 4u - w->n_carry;
+        if (k > nbytes) k = nbytes;
+        memcpy(w->carry + w->n_carry, raw, k);
+        w->n_carry += k;
+        raw += k;
+        nbytes -= k;
+        if (w->n_carry < 4) return 0;
+        w->n_carry = 0;
+        if (push_frames_raw(w, w->carry, 1) != 0) return -1;
+    }
+    size_t n = nbytes / 4u;
+    if (n && push_frames_raw(w, raw, n) != 0) return -1;
+    w->n_carry = nbytes % 4u;
+    memcpy(w->carry, raw + 4 * n, w->n_carry);
+    if (w->prev) preview_flush(w);
+    return w->err ? -1 : 0;
+}
+
+int wav_writer_push_i16(wav_writer_t* w, const int16_t* lr, size_t n_frames)
+{
+    if (!w || (!lr && n_frames) || w->err) return -1;
+    if (reserve(w, w->frames + n_frames) != 0) return -1;
+    uint8_t* dst = w->map + WAV_HDR + w->frames * 4u;
+    for (size_t i = 0; i < 2 * n_frames; i++) put_le16(dst + 2 * i, (uint16_t)lr[i]);
+    w->frames += n_frames;
+    if (w->prev) {
+        for (size_t i = 0; i < n_frames; i++) preview_frame(w, lr[2 * i], lr[2 * i + 1]);
+        preview_flush(w);
+    }
+    return w->err ? -1 : 0;
+}
+
+uint64_t wav_writer_frames(const wav_writer_t* w)
+{
+    return w ? w->frames : 0;
+}
+
+int wav_writer_close(wav_writer_t* w)
+{
+    if (!w) return 0;
+    if (w->prev) preview_flush(w);   /* decim に満たない端数は捨てる。失敗は err に入るので rc より先に */
+    int rc = w->err ? -1 : 0;
+    if (w->prev && wav_writer_close(w->prev) != 0) rc = -1;
+    if (w->map) {
+        write_header(w->map, w->rate, w->frames);
+        munmap(w->map, w->map_len);
+    } else {
+        rc = -1;   /* 広げるのに失敗した */
+    }
+    if (ftruncate(w->fd, (off_t)(WAV_HDR + w->frames * 4u)) != 0) rc = -1;
+    if (close(w->fd) != 0) rc = -1;
+    free(w);
+    return rc;
+}
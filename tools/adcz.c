@@ -0,0 +1,278 @@
+/* adcz: ADC 録音（.bin / .wav）⇔ 可逆圧縮 .adcz の変換
+ *
+ *   ./build/adcz enc output/adc_data/adc_FM_test9.bin out.adcz     （-v で書いた後に照合）
+ *   ./build/adcz enc in.wav out.adcz -b 8192
+ *   ./build/adcz dec out.adcz back.bin                              （拡張子 .wav なら WAV）
+ *   ./build/adcz info out.adcz
+ *
+ * .bin は [LH, LL, RH, RL]（1MHz 想定, -r で変更）、.wav は 16bit ステレオ PCM。
+ * enc は 1ピング分（256000 バイト）ずつ push して、実機の録音と同じ流れで速度を測る。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "config.h"
+#include "adcz.h"
+#include "wav_writer.h"
+
+#define PUSH_BYTES 256000u   /* 64ms @ 1MHz × 4byte */
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int has_ext(const char* path, const char* ext)
+{
+    size_t n = strlen(path), e = strlen(ext);
+    return n >= e && strcmp(path + n - e, ext) == 0;
+}
+
+static uint32_t le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static const uint8_t* map_file(const char* path, size_t* len)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "%s: empty\n", path);
+        close(fd);
+        return NULL;
+    }
+    *len = (size_t)st.st_size;
+    void* m = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    madvise(m, *len, MADV_SEQUENTIAL);
+    return (const uint8_t*)m;
+}
+
+/* 16bit ステレオ PCM の data チャンクを探す */
+static const uint8_t* wav_data(const uint8_t* m, size_t len, size_t* n_bytes, uint32_t* fs)
+{
+    if (len < 12 || memcmp(m, "RIFF", 4) != 0 || memcmp(m + 8, "WAVE", 4) != 0) return NULL;
+    int fmt_ok = 0;
+    size_t o = 12;
+    while (o + 8 <= len) {
+        uint32_t sz = le32(m + o + 4);
+        const uint8_t* body = m + o + 8;
+        if (memcmp(m + o, "fmt ", 4) == 0 && sz >= 16 && o + 8 + 16 <= len) {
+            unsigned tag = body[0] | (body[1] << 8), ch = body[2] | (body[3] << 8);
+            unsigned bits = body[14] | (body[15] << 8);
+            *fs = le32(body + 4);
+            fmt_ok = (tag == 1 || tag == 0xFFFE) && ch == 2 && bits == 16;
+        } else if (memcmp(m + o, "data", 4) == 0) {
+            if (!fmt_ok) return NULL;
+            size_t avail = len - (o + 8);
+            *n_bytes = (sz < avail) ? sz : avail;
+            return body;
+        }
+        o += 8 + (size_t)sz + (sz & 1u);
+    }
+    return NULL;
+}
+
+static int cmd_enc(const char* in, const char* out, uint32_t fs, uint32_t bf, int verify)
+{
+    size_t len = 0;
+    const uint8_t* m = map_file(in, &len);
+    if (!m) return 1;
+
+    int is_wav = has_ext(in, ".wav");
+    const uint8_t* pcm = m;
+    size_t n_bytes = len;
+    if (is_wav && !(pcm = wav_data(m, len, &n_bytes, &fs))) {
+        fprintf(stderr, "%s: not a 16bit stereo PCM wav\n", in);
+        munmap((void*)m, len);
+        return 1;
+    }
+
+    adcz_writer_t* w = adcz_writer_open(out, fs, bf);
+    if (!w) {
+        munmap((void*)m, len);
+        return 1;
+    }
+
+    int16_t* tmp = is_wav ? (int16_t*)malloc(PUSH_BYTES) : NULL;
+    double t0 = now_s();
+    int rc = 0;
+    for (size_t o = 0; o < n_bytes && rc == 0; o += PUSH_BYTES) {
+        size_t n = (n_bytes - o < PUSH_BYTES) ? n_bytes - o : PUSH_BYTES;
+        if (!is_wav) {
+            rc = adcz_writer_push_raw(w, pcm + o, n);
+        } else {
+            if (!tmp) { rc = -1; break; }
+            size_t nf = n / 4u;
+            for (size_t i = 0; i < 2 * nf; i++)
+                tmp[i] = (int16_t)(uint16_t)(pcm[o + 2 * i] | (pcm[o + 2 * i + 1] << 8));
+            rc = adcz_writer_push_i16(w, tmp, nf);
+        }
+    }
+    adcz_stats_t st;
+    if (adcz_writer_close(w, &st) != 0) rc = -1;
+    double dt = now_s() - t0;
+    free(tmp);
+
+    if (st.dropped)
+        fprintf(stderr, "%s: input is not a whole number of frames (%llu trailing bytes dropped)\n",
+                in, (unsigned long long)st.dropped);
+    if (rc != 0) {
+        fprintf(stderr, "encode failed\n");
+        munmap((void*)m, len);
+        return 1;
+    }
+    printf("%s -> %s: frames=%llu blocks=%llu raw_ch=%llu\n", in, out,
+           (unsigned long long)st.frames, (unsigned long long)st.blocks, (unsigned long long)st.verbatim);
+    printf("  %llu -> %llu bytes (%.1f%%)  encode %.1f ms = %.1f MB/s (realtime 4.0 MB/s)\n",
+           (unsigned long long)st.in_bytes, (unsigned long long)st.out_bytes,
+           st.in_bytes ? 100.0 * (double)st.out_bytes / (double)st.in_bytes : 0.0,
+           dt * 1e3, dt > 0.0 ? (double)st.in_bytes / dt / 1e6 : 0.0);
+
+    if (verify) {
+        adcz_reader_t* r = adcz_reader_open(out);
+        uint8_t* back = (uint8_t*)malloc(4u * (size_t)st.frames + 4u);
+        size_t got = (r && back) ? adcz_reader_read_raw(r, 0, (size_t)st.frames, back) : 0;
+        int same = (got == st.frames);
+        if (same && !is_wav) {
+            same = memcmp(back, pcm, 4u * got) == 0;
+        } else if (same) {
+            /* WAV は LE の int16 なので .bin の並びに直して比べる */
+            for (size_t i = 0; i < got && same; i++)
+                same = back[4 * i] == pcm[4 * i + 1] && back[4 * i + 1] == pcm[4 * i] &&
+                       back[4 * i + 2] == pcm[4 * i + 3] && back[4 * i + 3] == pcm[4 * i + 2];
+        }
+        printf("  verify: %s (%zu frames)\n", same ? "OK" : "MISMATCH", got);
+        free(back);
+        adcz_reader_close(r);
+        if (!same) rc = -1;
+    }
+    munmap((void*)m, len);
+    return rc == 0 ? 0 : 1;
+}
+
+static int cmd_dec(const char* in, const char* out)
+{
+    adcz_reader_t* r = adcz_reader_open(in);
+    if (!r) return 1;
+    adcz_info_t info;
+    adcz_reader_get_info(r, &info);
+
+    /* .wav は wav_writer（ブロックをそのまま LE で map へ）, .bin は従来の並びで fwrite */
+    int is_wav = has_ext(out, ".wav");
+    wav_writer_t* wav = is_wav ? wav_writer_open(out, info.sample_rate, info.total_frames) : NULL;
+    FILE* f = is_wav ? NULL : fopen(out, "wb");
+    int16_t* blk = (int16_t*)malloc(sizeof(int16_t) * 2 * info.block_frames);
+    uint8_t* bytes = (uint8_t*)malloc(4u * info.block_frames);
+    if ((!wav && !f) || !blk || !bytes) {
+        if (!is_wav && !f) perror(out);
+        if (f) fclose(f);
+        wav_writer_close(wav);
+        free(blk);
+        free(bytes);
+        adcz_reader_close(r);
+        return 1;
+    }
+
+    double t0 = now_s();
+    uint64_t frames = 0;
+    int rc = 0;
+    for (size_t b = 0; b < info.n_blocks; b++) {
+        int n = adcz_reader_block(r, b, blk);
+        if (n < 0) {
+            fprintf(stderr, "block %zu: corrupt\n", b);
+            rc = 1;
+            break;
+        }
+        if (is_wav) {
+            if (wav_writer_push_i16(wav, blk, (size_t)n) != 0) {
+                rc = 1;
+                break;
+            }
+        } else {
+            adcz_i16_to_raw(blk, (size_t)n, bytes);
+            if (fwrite(bytes, 4, (size_t)n, f) != (size_t)n) {
+                perror("fwrite");
+                rc = 1;
+                break;
+            }
+        }
+        frames += (uint64_t)n;
+    }
+    if (f && fclose(f) != 0) rc = 1;
+    if (wav && wav_writer_close(wav) != 0) rc = 1;
+    double dt = now_s() - t0;
+
+    printf("%s -> %s: frames=%llu (%s)  decode %.1f ms = %.1f MB/s\n", in, out,
+           (unsigned long long)frames, is_wav ? "wav" : "bin", dt * 1e3,
+           dt > 0.0 ? (double)frames * 4.0 / dt / 1e6 : 0.0);
+    free(blk);
+    free(bytes);
+    adcz_reader_close(r);
+    return rc;
+}
+
+static int cmd_info(const char* in)
+{
+    adcz_reader_t* r = adcz_reader_open(in);
+    if (!r) return 1;
+    adcz_info_t info;
+    adcz_reader_get_info(r, &info);
+    printf("%s: fs=%u block=%u frames=%llu (%.3f s) blocks=%zu index=%s\n", in,
+           info.sample_rate, info.block_frames, (unsigned long long)info.total_frames,
+           info.sample_rate ? (double)info.total_frames / info.sample_rate : 0.0,
+           info.n_blocks, info.indexed ? "yes" : "no (scanned)");
+    adcz_reader_close(r);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr,
+                "usage: %s enc IN.bin|IN.wav OUT.adcz [-r fs] [-b block_frames] [-v]\n"
+                "       %s dec IN.adcz OUT.bin|OUT.wav\n"
+                "       %s info IN.adcz\n", argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    if (strcmp(argv[1], "info") == 0) return cmd_info(argv[2]);
+    if (argc < 4) {
+        fprintf(stderr, "missing output path\n");
+        return 1;
+    }
+    if (strcmp(argv[1], "dec") == 0) return cmd_dec(argv[2], argv[3]);
+    if (strcmp(argv[1], "enc") != 0) {
+        fprintf(stderr, "unknown command: %s\n", argv[1]);
+        return 1;
+    }
+
+    uint32_t fs = 1000000, bf = ADCZ_BLOCK_FRAMES;
+    int verify = 0;
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) verify = 1;
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) fs = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) bf = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    return cmd_enc(argv[2], argv[3], fs, bf, verify);
+}
@@ -0,0 +1,92 @@
+/* bin2wav: ADC 生データ（.bin の [LH, LL, RH, RL]）→ 16bit ステレオ WAV
+ *
+ *   ./build/bin2wav output/adc_data/adc_FM_test9.bin out.wav
+ *   ./build/bin2wav in.bin out.wav -r 1000000 -p preview.wav -d 20   （50kHz のプレビューも）
+ *
+ * 入力は mmap して 1ピング分（256000 バイト）ずつ wav_writer に push する（実機の受信と同じ流れ）。
+ * 旧 tools/bin2wav.py（numpy で全体を読み直す）の置き換え。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wav_writer.h"
+
+#define PUSH_BYTES 256000u   /* 64ms @ 1MHz × 4byte */
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s IN.bin OUT.wav [-r fs] [-p PREVIEW.wav] [-d decim]\n", argv[0]);
+        return 1;
+    }
+    const char* in = argv[1];
+    const char* out = argv[2];
+    const char* preview = NULL;
+    uint32_t fs = 1000000, decim = 20;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)      fs = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) preview = argv[++i];
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) decim = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    int fd = open(in, O_RDONLY);
+    if (fd < 0) {
+        perror(in);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "%s: empty\n", in);
+        close(fd);
+        return 1;
+    }
+    size_t len = (size_t)st.st_size;
+    void* m = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    madvise(m, len, MADV_SEQUENTIAL);
+    if (len % 4u) printf("[warn] input bytes=%zu not multiple of 4, trimming to %zu\n", len, len - len % 4u);
+
+    double t0 = now_s();
+    wav_writer_t* w = wav_writer_open(out, fs, len / 4u);
+    int rc = w ? 0 : -1;
+    if (w && preview && wav_writer_add_preview(w, preview, decim) != 0) rc = -1;
+    for (size_t o = 0; o < len && rc == 0; o += PUSH_BYTES) {
+        size_t n = (len - o < PUSH_BYTES) ? len - o : PUSH_BYTES;
+        rc = wav_writer_push_raw(w, (const uint8_t*)m + o, n);
+    }
+    uint64_t frames = wav_writer_frames(w);
+    if (wav_writer_close(w) != 0) rc = -1;
+    double dt = now_s() - t0;
+    munmap(m, len);
+
+    if (rc != 0) {
+        fprintf(stderr, "write failed\n");
+        return 1;
+    }
+    printf("%s -> %s: frames=%llu duration=%.6fs rate=%u  %.1f ms = %.1f MB/s\n", in, out,
+           (unsigned long long)frames, (double)frames / fs, fs, dt * 1e3,
+           dt > 0.0 ? (double)frames * 4.0 / dt / 1e6 : 0.0);
+    if (preview) printf("  preview: %s (rate=%u)\n", preview, fs / decim);
+    return 0;
+}
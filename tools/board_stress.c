@@ -0,0 +1,254 @@
+/* board_stress: board_sim（プロセス内の疑似基板）から ADC を流し続けて受信側を試す
+ *
+ *   ./build/board_stress                          （4MB/s, 10秒, adc_read ループ）
+ *   ./build/board_stress -r 4000000 -t 300        （5分間の連続受信）
+ *   ./build/board_stress -m exact -c 256000       （adc_read_exact で 256000byte ずつ）
+ *   ./build/board_stress -m reactor               （io_reactor 経由）
+ *   ./build/board_stress -S 1000:30 -D 1000000:64 （1秒ごと 30ms 止める / 1MB ごと 64byte 飛ばす）
+ *   ./build/board_stress -R 80 -C 3 -t 300        （受信を SCHED_FIFO 80 + CPU3 固定 + mlockall で）
+ *
+ * ADC の中身は 4byte ごとの通し番号なので、受信側で欠けたバイト数を数えて
+ * board_sim 側で入れた drop + overrun と突き合わせる。
+ * 結果：持続 MB/s / 最長の途切れ / 欠けたバイト数 / read 間隔のヒストグラム（read / exact）。
+ * 負荷をかけながら（stress-ng など）-R の有無で比べれば、取りこぼしが無いことを示せる。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "board_sim.h"
+#include "adc_port.h"
+#include "ctrl_port.h"
+#include "io_reactor.h"
+#include "rt_thread.h"
+
+typedef enum { MODE_READ, MODE_EXACT, MODE_REACTOR } reader_mode_t;
+
+typedef struct {
+    uint8_t  carry[4];
+    size_t   carry_len;
+    int      synced;
+    uint64_t expect;     /* 次に来るはずのフレーム番号 */
+    uint64_t frames;
+    uint64_t lost_bytes; /* 番号の飛びから数えた（開始前に捨てられた分も含む） */
+    uint64_t reorder;    /* 番号が戻った（あってはいけない） */
+} checker_t;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void check_frame(checker_t* ck, const uint8_t* f)
+{
+    uint64_t s = board_sim_frame_seq(f);
+    /* 32bit で一周しても続けて数えられるように上位を補う */
+    s |= ck->expect & ~(uint64_t)0xffffffffu;
+    if (s < ck->expect) s += (uint64_t)1 << 32;
+
+    if (!ck->synced) {
+        ck->synced = 1;
+        ck->lost_bytes += s * 4u;
+    } else if (s != ck->expect) {
+        if (s > ck->expect) ck->lost_bytes += (s - ck->expect) * 4u;
+        else                ck->reorder++;
+    }
+    ck->expect = s + 1;
+    ck->frames++;
+}
+
+static void check_bytes(checker_t* ck, const uint8_t* p, size_t n)
+{
+    while (n > 0 && ck->carry_len > 0) {
+        ck->carry[ck->carry_len++] = *p++;
+        n--;
+        if (ck->carry_len == 4) {
+            check_frame(ck, ck->carry);
+            ck->carry_len = 0;
+        }
+    }
+    for (; n >= 4; p += 4, n -= 4) check_frame(ck, p);
+    for (; n > 0; n--) ck->carry[ck->carry_len++] = *p++;
+}
+
+static int parse_pair(const char* s, long* a, long* b)
+{
+    char* end = NULL;
+    *a = strtol(s, &end, 10);
+    if (!end || *end != ':') return -1;
+    *b = strtol(end + 1, NULL, 10);
+    return 0;
+}
+
+/* CTRL が返事をするかだけ先に確かめる */
+static void ctrl_smoke(const char* path)
+{
+    ctrl_port_t* c = ctrl_open(path, CTRL_BAUDRATE);
+    if (!c) {
+        fprintf(stderr, "ctrl_open failed: %s\n", path);
+        return;
+    }
+    uint32_t hz = 0, pe = 0, ae = 0;
+    int enq = (ctrl_enq(c) == CTRL_OK);
+    int f = (ctrl_get_sampling_hz(c, &hz) == CTRL_OK);
+    int e = (ctrl_get_errors(c, &pe, &ae) == CTRL_OK);
+    printf("ctrl: enq=%s f=%s(%u) e=%s(%u %u)\n",
+           enq ? "ok" : "NG", f ? "ok" : "NG", hz, e ? "ok" : "NG", pe, ae);
+    ctrl_close(c);
+}
+
+int main(int argc, char** argv)
+{
+    board_sim_cfg_t sc;
+    memset(&sc, 0, sizeof(sc));
+    sc.adc_bytes_per_s = 4e6;
+    sc.adc_link = "/tmp/ADC_SIM";
+    sc.pulse_link = "/tmp/PULSE_SIM";
+    sc.ctrl_link = "/tmp/CTRL_SIM";
+
+    double duration = 10.0;
+    size_t chunk = 256000;
+    reader_mode_t mode = MODE_READ;
+    rt_sched_t rt;
+    memset(&rt, 0, sizeof(rt));
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        long a = 0, b = 0;
+        if (strcmp(argv[i], "-r") == 0)      sc.adc_bytes_per_s = strtod(argv[i + 1], NULL);
+        else if (strcmp(argv[i], "-t") == 0) duration = strtod(argv[i + 1], NULL);
+        else if (strcmp(argv[i], "-c") == 0) chunk = (size_t)strtoul(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "-m") == 0) {
+            if (strcmp(argv[i + 1], "exact") == 0)        mode = MODE_EXACT;
+            else if (strcmp(argv[i + 1], "reactor") == 0) mode = MODE_REACTOR;
+            else                                          mode = MODE_READ;
+        } else if (strcmp(argv[i], "-R") == 0) {
+            rt.prio = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-C") == 0) {
+            rt.cpu_mask = (uint64_t)1 << atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-S") == 0 && parse_pair(argv[i + 1], &a, &b) == 0) {
+            sc.stall_every_ms = (int)a;
+            sc.stall_ms = (int)b;
+        } else if (strcmp(argv[i], "-D") == 0 && parse_pair(argv[i + 1], &a, &b) == 0) {
+            sc.drop_every_bytes = (size_t)a;
+            sc.drop_bytes = (size_t)b;
+        } else {
+            fprintf(stderr, "usage: %s [-r bytes/s] [-t sec] [-m read|exact|reactor] [-c chunk]"
+                            " [-S every_ms:stall_ms] [-D every_bytes:drop_bytes] [-R fifo_prio] [-C cpu]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (chunk < 4 || duration <= 0.0) return 1;
+
+    board_sim_t* sim = board_sim_start(&sc);
+    if (!sim) {
+        fprintf(stderr, "board_sim_start failed\n");
+        return 1;
+    }
+    printf("board_sim: adc=%s pulse=%s ctrl=%s rate=%.2f MB/s\n",
+           board_sim_path(sim, BOARD_SIM_ADC), board_sim_path(sim, BOARD_SIM_PULSE),
+           board_sim_path(sim, BOARD_SIM_CTRL), sc.adc_bytes_per_s / 1e6);
+    ctrl_smoke(board_sim_path(sim, BOARD_SIM_CTRL));
+
+    adc_port_t* adc = adc_open(board_sim_path(sim, BOARD_SIM_ADC), ADC_BAUDRATE);
+    io_reactor_t* r = NULL;
+    int rb = -1;
+    if (adc && mode == MODE_REACTOR) {
+        r = io_reactor_create();
+        rb = r ? io_reactor_add_board(r, adc, NULL, 0) : -1;
+    }
+    uint8_t* buf = (uint8_t*)malloc(chunk);
+    if (!adc || !buf || (mode == MODE_REACTOR && rb < 0)) {
+        fprintf(stderr, "reader setup failed\n");
+        io_reactor_destroy(r);
+        adc_close(adc);
+        board_sim_stop(sim);
+        free(buf);
+        return 1;
+    }
+
+    /* 受信（このスレッド）の実時間化。board_sim のスレッドは通常のまま */
+    const char* rt_state = "off";
+    if (rt.prio > 0 || rt.cpu_mask) {
+        int ok = (rt_lock_memory() == 0);
+        ok &= (rt_thread_apply("reader", &rt) == 0);
+        rt_prefault(buf, chunk);
+        rt_prefault_stack(64u * 1024u);
+        rt_state = ok ? "on" : "partial";
+    }
+    rt_hist_t gap;
+    rt_hist_reset(&gap);
+    adc_set_gap_hist(adc, &gap);
+
+    const char* mode_name[] = { "read", "exact", "reactor" };
+    printf("reader: mode=%s chunk=%zu duration=%.0fs rt=%s\n", mode_name[mode], chunk, duration, rt_state);
+
+    checker_t ck;
+    memset(&ck, 0, sizeof(ck));
+    uint64_t bytes = 0;
+    double t_start = now_s(), t_last = t_start, t_report = t_start, max_gap = 0.0;
+    uint64_t bytes_report = 0;
+
+    for (;;) {
+        double t = now_s();
+        if (t - t_start >= duration) break;
+
+        size_t got = 0;
+        if (mode == MODE_READ) {
+            int n = adc_read(adc, buf, chunk, 100);
+            if (n < 0) break;
+            got = (size_t)n;
+        } else if (mode == MODE_EXACT) {
+            int n = adc_read_exact(adc, buf, chunk, 1000, 200);
+            if (n < 0) break;
+            got = (size_t)n;
+        } else {
+            if (io_reactor_poll(r, 100) < 0) break;
+            got = io_reactor_adc_read(r, rb, buf, chunk);
+        }
+
+        t = now_s();
+        if (got > 0) {
+            /* exact は1チャンク分の所要時間から名目時間を引いたものを途切れとみなす */
+            double gap = t - t_last;
+            if (mode == MODE_EXACT) gap -= (double)got / sc.adc_bytes_per_s;
+            if (gap > max_gap) max_gap = gap;
+            t_last = t;
+            check_bytes(&ck, buf, got);
+            bytes += got;
+        }
+
+        if (t - t_report >= 10.0) {
+            printf("  %5.0fs  %7.3f MB/s  lost=%llu\n", t - t_start,
+                   (double)(bytes - bytes_report) / (t - t_report) / 1e6,
+                   (unsigned long long)ck.lost_bytes);
+            t_report = t;
+            bytes_report = bytes;
+        }
+    }
+    double elapsed = now_s() - t_start;
+
+    board_sim_stats_t st;
+    board_sim_get_stats(sim, &st);
+
+    printf("received : %llu bytes in %.2fs = %.3f MB/s (target %.3f)\n",
+           (unsigned long long)bytes, elapsed, (double)bytes / elapsed / 1e6, sc.adc_bytes_per_s / 1e6);
+    printf("max gap  : %.1f ms\n", max_gap * 1e3);
+    printf("lost     : %llu bytes (detected)  reorder=%llu\n",
+           (unsigned long long)ck.lost_bytes, (unsigned long long)ck.reorder);
+    printf("sim      : written=%llu dropped=%llu overrun=%llu stalls=%llu ctrl_cmds=%llu\n",
+           (unsigned long long)st.adc_bytes, (unsigned long long)st.adc_dropped,
+           (unsigned long long)st.adc_overrun, (unsigned long long)st.stalls,
+           (unsigned long long)st.ctrl_cmds);
+    if (r) printf("reactor  : ring_dropped=%llu\n", (unsigned long long)io_reactor_adc_dropped(r, rb));
+    else   rt_hist_print(stdout, "read_gap", &gap);
+
+    io_reactor_destroy(r);
+    adc_close(adc);
+    board_sim_stop(sim);
+    free(buf);
+    return (ck.reorder == 0) ? 0 : 2;
+}
@@ -0,0 +1,197 @@
+/* capture: 録音コンテナ（.tpcap）の中身を見る・取り出す
+ *
+ *   ./build/capture info output/adc_data/cap_20250101_120000.tpcap
+ *   ./build/capture list CAP.tpcap                  （ピングごとの時刻・エラー・大きさ）
+ *   ./build/capture extract CAP.tpcap K out.bin     （K 番目を従来の .bin の並びで。.wav なら WAV）
+ *   ./build/capture pulse CAP.tpcap ID out.bin      （送信パルスのバイト列）
+ *
+ * info は全ピングを1回ずつ取り出して読み出し速度も測る。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "capture.h"
+#include "pulse_port.h"
+#include "wav_writer.h"
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int write_file(const char* path, const uint8_t* data, size_t len)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    size_t w = fwrite(data, 1, len, f);
+    if (fclose(f) != 0) w = 0;
+    return (w == len) ? 0 : -1;
+}
+
+static int cmd_info(capture_reader_t* r, const char* path)
+{
+    capture_session_t s;
+    capture_reader_session(r, &s);
+    time_t t = (time_t)(s.t_open_unix_ns / 1000000000ll);
+    char stamp[32];
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    printf("%s: opened %s  fs=%.0f capture=%u compress=%d  pings=%zu pulses=%zu index=%s\n",
+           path, stamp, s.fs_adc, s.capture_bytes, s.compress, capture_reader_pings(r),
+           capture_reader_pulses(r), capture_reader_indexed(r) ? "yes" : "no (scanned)");
+    if (s.note[0]) printf("  note: %s\n", s.note);
+
+    for (size_t i = 0; i < capture_reader_pulses(r); i++) {
+        capture_pulse_t p;
+        if (capture_reader_pulse(r, (int)i, &p) != 0) continue;
+        printf("  pulse %zu: %s %.1fk->%.1fkHz %.2fms duty=%d%% bytes=%zu %s\n", i,
+               p.kind == CAPTURE_PULSE_FM ? "FM" : "CF", p.f_start_hz * 1e-3, p.f_end_hz * 1e-3,
+               p.dur_s * 1e3, p.duty_percent, p.n_bytes, p.runs ? "(rle)" : "(bytes)");
+    }
+
+    /* 全ピングを取り出して合計の大きさと速度 */
+    size_t np = capture_reader_pings(r);
+    uint64_t raw = 0, stored = 0;
+    uint8_t* buf = (uint8_t*)malloc(s.capture_bytes ? s.capture_bytes : 1);
+    size_t cap = s.capture_bytes;
+    int bad = 0;
+    double t0 = now_s();
+    for (size_t k = 0; k < np; k++) {
+        capture_ping_t pg;
+        if (capture_reader_ping(r, k, &pg) != 0) { bad++; continue; }
+        if (pg.raw_bytes > cap) {
+            uint8_t* nb = (uint8_t*)realloc(buf, pg.raw_bytes);
+            if (!nb) { bad++; continue; }
+            buf = nb;
+            cap = pg.raw_bytes;
+        }
+        if (pg.raw_bytes && capture_reader_ping_raw(r, k, buf, cap) != pg.raw_bytes) bad++;
+        raw += pg.raw_bytes;
+        stored += pg.data_len;
+    }
+    double dt = now_s() - t0;
+    free(buf);
+    printf("  data: %llu -> %llu bytes (%.1f%%)  read all %.1f ms = %.1f MB/s  bad=%d\n",
+           (unsigned long long)raw, (unsigned long long)stored,
+           raw ? 100.0 * (double)stored / (double)raw : 0.0, dt * 1e3,
+           dt > 0.0 ? (double)raw / dt / 1e6 : 0.0, bad);
+    return bad ? 1 : 0;
+}
+
+static int cmd_list(capture_reader_t* r)
+{
+    capture_session_t s;
+    capture_reader_session(r, &s);
+    for (size_t k = 0; k < capture_reader_pings(r); k++) {
+        capture_ping_t pg;
+        if (capture_reader_ping(r, k, &pg) != 0) {
+            printf("%zu: broken\n", k);
+            continue;
+        }
+        printf("%zu: seq=%llu %s t=%+.3fs latency=%.1fms pulse=%d gain=%d bytes=%zu->%zu", k,
+               (unsigned long long)pg.seq, pg.ok ? "OK" : "NG",
+               (double)(int64_t)(pg.t_pulse_ns - s.t_open_ns) * 1e-9,
+               (double)(pg.t_done_ns - pg.t_pulse_ns) * 1e-6, pg.pulse_id, pg.gain,
+               pg.raw_bytes, pg.data_len);
+        if (pg.have_err_before) printf(" err0=%u/%u", pg.err_before_pulse, pg.err_before_adc);
+        if (pg.have_err_after)  printf(" err1=%u/%u", pg.err_after_pulse, pg.err_after_adc);
+        printf("\n");
+    }
+    return 0;
+}
+
+static int cmd_extract(capture_reader_t* r, size_t k, const char* out)
+{
+    capture_ping_t pg;
+    if (capture_reader_ping(r, k, &pg) != 0) {
+        fprintf(stderr, "no ping %zu (pings=%zu)\n", k, capture_reader_pings(r));
+        return 1;
+    }
+    uint8_t* buf = (uint8_t*)malloc(pg.raw_bytes ? pg.raw_bytes : 1);
+    if (!buf) return 1;
+    size_t n = capture_reader_ping_raw(r, k, buf, pg.raw_bytes);
+    int rc = (n == pg.raw_bytes) ? 0 : 1;
+    size_t len = strlen(out);
+    if (rc == 0 && len >= 4 && strcmp(out + len - 4, ".wav") == 0) {
+        capture_session_t s;
+        capture_reader_session(r, &s);
+        wav_writer_t* w = wav_writer_open(out, (uint32_t)s.fs_adc, n / 4u);
+        if (wav_writer_push_raw(w, buf, n) != 0) rc = 1;
+        if (!w || wav_writer_close(w) != 0) rc = 1;
+    } else if (rc == 0) {
+        rc = (write_file(out, buf, n) == 0) ? 0 : 1;
+    }
+    if (rc == 0) printf("ping %zu (seq=%llu) -> %s: %zu bytes\n", k, (unsigned long long)pg.seq, out, n);
+    else         fprintf(stderr, "extract failed\n");
+    free(buf);
+    return rc;
+}
+
+static int cmd_pulse(capture_reader_t* r, int id, const char* out)
+{
+    capture_pulse_t p;
+    if (capture_reader_pulse(r, id, &p) != 0) {
+        fprintf(stderr, "no pulse %d\n", id);
+        return 1;
+    }
+    const uint8_t* bytes = p.bytes;
+    uint8_t* buf = NULL;
+    size_t n = p.n_bytes;
+    if (p.runs) {
+        /* RLE を展開（pulse_rle_t は読むだけなので const を外して渡す） */
+        pulse_rle_t rle;
+        memset(&rle, 0, sizeof(rle));
+        rle.runs = (pulse_run_t*)p.runs;
+        rle.n = rle.cap = p.n_runs;
+        for (size_t i = 0; i < p.n_runs; i++) rle.total_bits += (size_t)p.runs[i].on + p.runs[i].off;
+        buf = (uint8_t*)malloc(n ? n : 1);
+        if (!buf) return 1;
+        pulse_rle_cursor_t cur;
+        pulse_rle_cursor_init(&cur, &rle);
+        n = pulse_rle_expand(&cur, buf, p.n_bytes);
+        bytes = buf;
+    }
+    int rc = (write_file(out, bytes, n) == 0) ? 0 : 1;
+    if (rc == 0) printf("pulse %d -> %s: %zu bytes\n", id, out, n);
+    free(buf);
+    return rc;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr,
+                "usage: %s info CAP.tpcap\n"
+                "       %s list CAP.tpcap\n"
+                "       %s extract CAP.tpcap K OUT.bin|OUT.wav\n"
+                "       %s pulse CAP.tpcap ID OUT.bin\n", argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    int need = (strcmp(argv[1], "extract") == 0 || strcmp(argv[1], "pulse") == 0) ? 5 : 3;
+    if (argc < need) {
+        fprintf(stderr, "missing arguments\n");
+        return 1;
+    }
+    capture_reader_t* r = capture_reader_open(argv[2]);
+    if (!r) return 1;
+
+    int rc;
+    if (strcmp(argv[1], "info") == 0)         rc = cmd_info(r, argv[2]);
+    else if (strcmp(argv[1], "list") == 0)    rc = cmd_list(r);
+    else if (strcmp(argv[1], "extract") == 0) rc = cmd_extract(r, (size_t)strtoul(argv[3], NULL, 10), argv[4]);
+    else if (strcmp(argv[1], "pulse") == 0)   rc = cmd_pulse(r, atoi(argv[3]), argv[4]);
+    else {
+        fprintf(stderr, "unknown command: %s\n", argv[1]);
+        rc = 1;
+    }
+    capture_reader_close(r);
+    return rc;
+}
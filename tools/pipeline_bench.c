@@ -0,0 +1,230 @@
+/* pipeline_bench: adc_source → adc_decode → xcorr → detect の処理速度を実機なしで測る
+ *
+ *   ./build/pipeline_bench synth                  （擬似エコー, 全速, 100ピング）
+ *   ./build/pipeline_bench file:output/adc_data/adc_FM_test9.bin -n 50
+ *   ./build/pipeline_bench synth -b 64000 -s 3    （短い窓 / seed 指定）
+ *   ./build/pipeline_bench synth -d os            （CFAR を OS にする。既定 CA）
+ *   ./build/pipeline_bench synth -D 8             （DDC で 1/8 の複素ベースバンドにしてから相関）
+ *
+ * 受信元は全速（待ちなし）で回すので、同じ入力なら毎回同じ仕事量になる。
+ * 段ごと（read / decode / ddc / xcorr / detect）の時間と MB/s を出すので、変更前後で比べられる。
+ * 参照チャープは main と同じ FM（95→50kHz, 2ms, duty 40%）。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "pulse_port.h"
+#include "adc_source.h"
+#include "adc_decode.h"
+#include "crosscorr.h"
+#include "detect.h"
+#include "ddc.h"
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s synth|file:PATH [-n pings] [-b capture_bytes] [-s seed] [-d ca|os] [-D decim]\n", argv[0]);
+        return 1;
+    }
+    const char* spec = argv[1];
+    long n_pings = 100;
+    size_t cap = 256000;
+    uint64_t seed = 1;
+    int D = 1;
+    detect_cfg_t dcfg;
+    detect_cfg_default(&dcfg);
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0)      n_pings = strtol(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "-b") == 0) cap = (size_t)strtoul(argv[i + 1], NULL, 10) & ~(size_t)3;
+        else if (strcmp(argv[i], "-s") == 0) seed = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "-d") == 0) dcfg.mode = (strcmp(argv[i + 1], "os") == 0) ? DETECT_OS : DETECT_CA;
+        else if (strcmp(argv[i], "-D") == 0) D = (int)strtol(argv[i + 1], NULL, 10);
+        else {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (n_pings <= 0 || cap < 4 || D < 1) return 1;
+
+    const double FS_BIT = 10e6, FS_ADC = 1e6;
+    const int N = (int)(cap / 4u);
+    const int Nc = N / D;
+    const double FS_C = FS_ADC / D;
+    if (D > 1) {
+        /* main と同じく、ガードとまとめ幅は時間で揃える */
+        dcfg.guard   = (dcfg.guard / D > 2) ? dcfg.guard / D : 2;
+        dcfg.min_sep = (dcfg.min_sep / D > 1) ? dcfg.min_sep / D : 1;
+    }
+
+    /* 参照チャープ（main と同じ作り方） */
+    size_t pb = pulse_bytes_for_duration(FS_BIT, 0.002);
+    uint8_t* pbuf = (uint8_t*)malloc(pb);
+    float* ref = (float*)malloc(sizeof(float) * (size_t)N);
+    uint8_t* raw = (uint8_t*)malloc(cap);
+    float* lr = (float*)malloc(sizeof(float) * 2 * (size_t)N);
+    float* envL = (float*)malloc(sizeof(float) * (size_t)N);
+    float* envR = (float*)malloc(sizeof(float) * (size_t)N);
+    detector_t* det = detect_create((size_t)N, DETECT_MAX_ECHOES, DETECT_TRAIN);
+    detect_echo_t ech[DETECT_MAX_ECHOES];
+    pulse_rle_t rle;
+    memset(&rle, 0, sizeof(rle));
+    if (!pbuf || !ref || !raw || !lr || !envL || !envR || !det ||
+        pulse_rle_gen_exp_chirp(&rle, pb * 8u, FS_BIT, 0.002, 95000.0, 50000.0, 40) != 0) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+    pulse_rle_cursor_t cur;
+    pulse_rle_cursor_init(&cur, &rle);
+    size_t wbytes = pulse_rle_expand(&cur, pbuf, pb);
+    size_t ref_len = pulse_bits_to_wave(pbuf, wbytes, (int)(FS_BIT / FS_ADC), ref, (size_t)N);
+
+    adc_source_t* src = NULL;
+    if (strcmp(spec, "synth") == 0) {
+        adc_synth_cfg_t sc;
+        memset(&sc, 0, sizeof(sc));
+        sc.chirp = ref;
+        sc.chirp_len = ref_len;
+        sc.fs = FS_ADC;
+        sc.capture_bytes = cap;
+        sc.n_echo = 1;
+        sc.echo[0].delay_s = SYNTH_ECHO_DELAY_S;
+        sc.echo[0].itd_s   = SYNTH_ECHO_ITD_S;
+        sc.echo[0].amp_l   = SYNTH_ECHO_AMP;
+        sc.echo[0].amp_r   = SYNTH_ECHO_AMP;
+        sc.snr_db = SYNTH_SNR_DB;
+        sc.seed = seed;
+        src = adc_source_open_synth(&sc);
+    } else if (strncmp(spec, "file:", 5) == 0) {
+        src = adc_source_open_file(spec + 5, cap, 0.0, 1);
+    }
+    if (!src) {
+        fprintf(stderr, "source open failed: %s\n", spec);
+        return 1;
+    }
+
+    xcorr_opts_t xo;
+    memset(&xo, 0, sizeof(xo));
+    xo.plan_mode = XCORR_PLAN_MODE;
+    xo.wisdom_only = 1;
+    xcorr_wisdom_import(XCORR_WISDOM_PATH);
+    xcorr_ctx_t* xc = xcorr_create_ex(Nc, FS_C, (D > 1) ? 0.0 : XCORR_HPF_HZ, &xo);
+    ddc_t* ddc = NULL;
+    if (D > 1) {
+        ddc_cfg_t dc;
+        ddc_cfg_default(&dc, FS_ADC);
+        dc.decim = D;
+        ddc = ddc_create(&dc, (size_t)N);
+    }
+    if (!xc || (D > 1 && !ddc)) {
+        fprintf(stderr, "xcorr/ddc setup failed\n");
+        return 1;
+    }
+    if (ddc) {
+        ddc_process(ddc, ref, (size_t)N, 1, xcorr_complex_input(xc));
+        xcorr_set_call_complex(xc, xcorr_complex_input(xc));
+    } else {
+        xcorr_set_call_time(xc, ref);
+    }
+
+    printf("source=%s capture=%zu bytes pings=%ld decode=%s decim=%d%s%s\n",
+           adc_source_name(src), cap, n_pings, adc_decode_impl(), D,
+           ddc ? " ddc=" : "", ddc ? ddc_impl() : "");
+
+    double t_read = 0.0, t_dec = 0.0, t_ddc = 0.0, t_xc = 0.0, t_det = 0.0;
+    size_t pk0L = 0, pk0R = 0, bytes = 0;
+    int n0 = 0;
+    detect_echo_t ech0[DETECT_MAX_ECHOES];
+    adc_decode_opt_t dopt = { 1.0f, 0.0f, 0.0f };
+    adc_decode_stat_t dst;
+
+    for (long p = 0; p < n_pings; p++) {
+        double t0 = now_s();
+        if (adc_source_begin(src) != ADC_OK) break;
+        int got = adc_source_read_exact(src, raw, cap, 0, 0);
+        if (got <= 0) break;
+        double t1 = now_s();
+
+        float* in = ddc ? lr : xcorr_stereo_input(xc);
+        size_t nf = adc_decode_interleaved(raw, (size_t)got, in, &dopt, &dst);
+        if (nf < (size_t)N) memset(in + 2*nf, 0, sizeof(float) * 2 * ((size_t)N - nf));
+        dopt.dc_l = (float)dst.mean_l;
+        dopt.dc_r = (float)dst.mean_r;
+        double t2 = now_s();
+
+        /* DDC は L/R を順に同じ複素入力へ落として、それぞれ相関する */
+        size_t pkL, pkR;
+        double t_d = 0.0;
+        if (ddc) {
+            float* iq = xcorr_complex_input(xc);
+            double a = now_s();
+            ddc_process(ddc, lr, (size_t)N, 2, iq);
+            t_d += now_s() - a;
+            xcorr_run_envelope_complex(xc, iq, envL);
+            a = now_s();
+            ddc_process(ddc, lr + 1, (size_t)N, 2, iq);
+            t_d += now_s() - a;
+            xcorr_run_envelope_complex(xc, iq, envR);
+        } else {
+            xcorr_run_envelope_stereo_packed(xc, envL, envR);
+        }
+        pkL = xcorr_argmax_range(envL, (size_t)Nc, 0, (size_t)Nc) * (size_t)D;
+        pkR = xcorr_argmax_range(envR, (size_t)Nc, 0, (size_t)Nc) * (size_t)D;
+        double t3 = now_s();
+
+        int ne = detect_run(det, &dcfg, envL, (size_t)Nc, FS_C, SOUND_SPEED_MPS, ech);
+        if (p == 0 && ne > 0) memcpy(ech0, ech, sizeof(ech0));
+        detect_run(det, &dcfg, envR, (size_t)Nc, FS_C, SOUND_SPEED_MPS, ech);
+        double t4 = now_s();
+
+        if (p == 0) {
+            pk0L = pkL;
+            pk0R = pkR;
+            n0 = ne;
+        }
+        t_read += t1 - t0;
+        t_dec  += t2 - t1;
+        t_ddc  += t_d;
+        t_xc   += t3 - t2 - t_d;
+        t_det  += t4 - t3;
+        bytes  += (size_t)got;
+    }
+
+    double total = t_read + t_dec + t_ddc + t_xc + t_det;
+    double mb = (double)bytes / 1e6;
+    printf("peak(ping0): L=%zu R=%zu\n", pk0L, pk0R);
+    for (int e = 0; e < n0; e++)
+        printf("echo(ping0,L) %d: index=%.2f (x%d) range=%.3fm snr=%.1fdB\n",
+               e, ech0[e].index, D, ech0[e].range_m, ech0[e].snr_db);
+    printf("read   : %8.3f ms/ping  %9.1f MB/s\n", t_read * 1e3 / (double)n_pings, mb / t_read);
+    printf("decode : %8.3f ms/ping  %9.1f MB/s\n", t_dec  * 1e3 / (double)n_pings, mb / t_dec);
+    if (ddc)
+        printf("ddc    : %8.3f ms/ping  %9.1f MB/s\n", t_ddc * 1e3 / (double)n_pings, mb / t_ddc);
+    printf("xcorr  : %8.3f ms/ping  %9.1f MB/s\n", t_xc   * 1e3 / (double)n_pings, mb / t_xc);
+    printf("detect : %8.3f ms/ping  %9.1f MB/s  (%s, L+R)\n", t_det * 1e3 / (double)n_pings, mb / t_det,
+           dcfg.mode == DETECT_OS ? "OS" : "CA");
+    printf("total  : %8.3f ms/ping  %9.1f MB/s  (realtime needs %.1f MB/s)\n",
+           total * 1e3 / (double)n_pings, mb / total, ADC_SOURCE_REALTIME_BPS / 1e6);
+
+    detect_destroy(det);
+    xcorr_destroy(xc);
+    ddc_destroy(ddc);
+    adc_source_close(src);
+    pulse_rle_free(&rle);
+    free(pbuf);
+    free(ref);
+    free(raw);
+    free(lr);
+    free(envL);
+    free(envR);
+    return 0;
+}
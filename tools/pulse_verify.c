@@ -0,0 +1,292 @@
+/* pulse_verify: パルス生成を元の1ビットずつの実装と突き合わせる（回帰チェック）
+ *
+ *   ./build/pulse_verify        （全部。1つでも違えば終了コード 1）
+ *
+ * ・CF（pulse_gen_pfd）・FM（pulse_gen_exp_chirp）をパラメータを振って生成し、
+ *   元の1ビットずつ書く実装（下の ref_*。置き換え前のコードそのまま）とバイト単位で比べる
+ *   - 周波数 1〜5000kHz、duty 0〜99%、バイト数は 1 / 奇数 / 周期で割り切れない長さ
+ *   - FM は上り・下り・一定、チャープがバッファより長い / 短い / ビット数が 8 の倍数でない
+ * ・RLE 版（pulse_rle_gen_*）も半端な大きさのチャンクで展開して同じ比較をする
+ * ・安全ゲートの統計（pulse_analyze / pulse_rle_analyze）を1ビットずつ数える実装と比べる
+ *   窓は 64bit 単位に切り上げ、どの窓も（データが語の途中で終わる最後の窓も）窓の長さで割る
+ *   例：1255 バイト・窓 10000bit は、最後の語（7バイト）で 157 語目の窓が閉じる境界
+ * 違ったときは最初の数件について、パラメータと最初に違うバイトを出す。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "pulse_port.h"
+
+#define MAX_BYTES   12500u   /* 10ms @ 10MHz */
+#define EXPAND_STEP 777u     /* RLE 展開のチャンク（周期にもバイトにも揃わない大きさ） */
+#define MAX_REPORT  5
+
+/* ---------------- 元の実装（1ビットずつ） ---------------- */
+
+static size_t ref_gen_pfd(uint8_t* out, size_t out_bytes, int freq_khz, int duty_percent)
+{
+    if (!out || out_bytes == 0) return 0;
+    if (freq_khz < 1 || freq_khz > 5000) return 0;
+    if (duty_percent < 0 || duty_percent > 99) return 0;
+
+    memset(out, 0x00, out_bytes);
+    if (duty_percent == 0) return out_bytes;
+
+    int period_ticks = (10000 + freq_khz/2) / freq_khz;
+    if (period_ticks < 1) period_ticks = 1;
+    int on_ticks = (period_ticks * duty_percent + 50) / 100;
+    if (on_ticks < 1) on_ticks = 1;
+    if (on_ticks >= period_ticks) on_ticks = period_ticks - 1;
+
+    size_t total_bits = out_bytes * 8;
+    for (size_t bit = 0; bit < total_bits; bit++) {
+        int phase = (int)(bit % (size_t)period_ticks);
+        if (phase < on_ticks) out[bit / 8] |= (uint8_t)(1u << (bit % 8));
+    }
+    return out_bytes;
+}
+
+static size_t ref_gen_exp_chirp(uint8_t* out, size_t out_bytes,
+                                double fs_bit, double dur_s,
+                                double f_start_hz, double f_end_hz,
+                                int duty_percent)
+{
+    if (!out || out_bytes == 0) return 0;
+    if (fs_bit <= 0.0 || dur_s <= 0.0) return 0;
+    if (f_start_hz <= 0.0 || f_end_hz <= 0.0) return 0;
+    if (duty_percent < 0 || duty_percent > 99) return 0;
+
+    memset(out, 0x00, out_bytes);
+    if (duty_percent == 0) return out_bytes;
+
+    size_t total_bits = out_bytes * 8u;
+    size_t chirp_bits = (size_t)llround(fs_bit * dur_s);
+    if (chirp_bits > total_bits) chirp_bits = total_bits;
+
+    double r = f_end_hz / f_start_hz;
+    double T = dur_s;
+    size_t bit = 0;
+    while (bit < chirp_bits) {
+        double t = (double)bit / fs_bit;
+        double f = f_start_hz * pow(r, t / T);
+        if (f < 1.0) f = 1.0;
+
+        int period_bits = (int)llround(fs_bit / f);
+        if (period_bits < 1) period_bits = 1;
+        int on_bits = (period_bits * duty_percent + 50) / 100;
+        if (on_bits < 1) on_bits = 1;
+        if (on_bits >= period_bits) on_bits = period_bits - 1;
+
+        for (int p = 0; p < period_bits && bit < chirp_bits; p++, bit++)
+            if (p < on_bits) out[bit / 8u] |= (uint8_t)(1u << (bit % 8u));
+    }
+    return out_bytes;
+}
+
+/* 安全ゲートの統計を1ビットずつ（窓 = window_bits を 64 の倍数に切り上げ, 0 = 全体で1窓。後ろは Low） */
+static void ref_analyze(const uint8_t* data, size_t len, size_t window_bits, pulse_stats_t* st)
+{
+    memset(st, 0, sizeof(*st));
+    size_t bits = len * 8u;
+    size_t W = window_bits ? (window_bits + 63u) / 64u * 64u : bits;
+    size_t ones = 0, win_ones = 0, run = 0, max_run = 0;
+    double max_local = 0.0;
+    for (size_t b = 0; b < bits; b++) {
+        int v = (data[b / 8u] >> (b % 8u)) & 1;
+        ones += (size_t)v;
+        win_ones += (size_t)v;
+        run = v ? run + 1 : 0;
+        if (run > max_run) max_run = run;
+        if ((b + 1) % W == 0 || b + 1 == bits) {
+            double d = 100.0 * (double)win_ones / (double)W;
+            if (d > max_local) max_local = d;
+            win_ones = 0;
+        }
+    }
+    st->bits = bits;
+    st->ones = ones;
+    st->duty_percent = 100.0 * (double)ones / (double)bits;
+    st->max_run = (int)max_run;
+    st->max_local_duty = max_local;
+}
+
+/* ---------------- 比較 ---------------- */
+
+typedef struct {
+    const char* name;
+    unsigned long cases, bad;
+} tally_t;
+
+static uint8_t want[MAX_BYTES], got[MAX_BYTES];
+
+static void check(tally_t* t, size_t rw, size_t rg, size_t n, const char* what)
+{
+    t->cases++;
+    if (rw == rg && memcmp(want, got, n) == 0) return;
+    if (t->bad++ >= MAX_REPORT) return;
+    size_t i = 0;
+    while (i < n && want[i] == got[i]) i++;
+    printf("  MISMATCH %s %s: ret %zu/%zu", t->name, what, rw, rg);
+    if (i < n) printf(", byte %zu: ref=0x%02x new=0x%02x", i, want[i], got[i]);
+    printf("\n");
+}
+
+/* RLE を半端なチャンクで展開して got へ（戻り値は展開したバイト数） */
+static size_t expand_rle(const pulse_rle_t* rle, size_t n)
+{
+    pulse_rle_cursor_t cur;
+    pulse_rle_cursor_init(&cur, rle);
+    size_t done = 0, k;
+    memset(got, 0xA5, n);
+    while (done < n && (k = pulse_rle_expand(&cur, got + done, (n - done < EXPAND_STEP) ? n - done : EXPAND_STEP)) > 0)
+        done += k;
+    return done;
+}
+
+static const size_t SIZES[] = { 1, 3, 7, 8, 125, 1001, 5003 };
+static const int    DUTIES[] = { 0, 1, 33, 40, 50, 99 };
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static void sweep_pfd(tally_t* tb, tally_t* tr)
+{
+    for (int fk = 1; fk <= 5000; fk += (fk < 300) ? 1 : 7) {
+        for (size_t d = 0; d < COUNT(DUTIES); d++) {
+            for (size_t s = 0; s < COUNT(SIZES); s++) {
+                size_t n = SIZES[s];
+                char what[64];
+                snprintf(what, sizeof(what), "freq=%dkHz duty=%d bytes=%zu", fk, DUTIES[d], n);
+
+                size_t rw = ref_gen_pfd(want, n, fk, DUTIES[d]);
+                memset(got, 0xA5, n);
+                check(tb, rw, pulse_gen_pfd(got, n, fk, DUTIES[d]), n, what);
+
+                pulse_rle_t rle;
+                memset(&rle, 0, sizeof(rle));
+                size_t rg = (pulse_rle_gen_pfd(&rle, n * 8u, fk, DUTIES[d]) == 0) ? expand_rle(&rle, n) : 0;
+                check(tr, rw, rg, n, what);
+                pulse_rle_free(&rle);
+            }
+        }
+    }
+}
+
+static void sweep_chirp(tally_t* tb, tally_t* tr)
+{
+    static const double FS[]  = { 10e6, 7.5e6 };
+    static const double DUR[] = { 1e-7, 0.0001, 0.00123457, 0.002, 0.008 };
+    static const double F[][2] = { { 95e3, 50e3 }, { 50e3, 95e3 }, { 40e3, 40e3 }, { 200e3, 20e3 }, { 2e6, 0.5 } };
+
+    for (size_t a = 0; a < COUNT(FS); a++)
+    for (size_t b = 0; b < COUNT(DUR); b++)
+    for (size_t c = 0; c < COUNT(F); c++)
+    for (size_t d = 0; d < COUNT(DUTIES); d++) {
+        size_t nb = pulse_bytes_for_duration(FS[a], DUR[b]);
+        /* ちょうど / 後ろに無音 / チャープの途中で切れる */
+        const size_t sizes[3] = { nb, nb + 3, nb / 2 + 1 };
+        for (int k = 0; k < 3; k++) {
+            size_t n = sizes[k];
+            if (n == 0 || n > MAX_BYTES) continue;
+            char what[128];
+            snprintf(what, sizeof(what), "fs=%.1fM dur=%.8gs f=%.0f->%.1f duty=%d bytes=%zu",
+                     FS[a] * 1e-6, DUR[b], F[c][0], F[c][1], DUTIES[d], n);
+
+            size_t rw = ref_gen_exp_chirp(want, n, FS[a], DUR[b], F[c][0], F[c][1], DUTIES[d]);
+            memset(got, 0xA5, n);
+            check(tb, rw, pulse_gen_exp_chirp(got, n, FS[a], DUR[b], F[c][0], F[c][1], DUTIES[d]), n, what);
+
+            pulse_rle_t rle;
+            memset(&rle, 0, sizeof(rle));
+            size_t rg = (pulse_rle_gen_exp_chirp(&rle, n * 8u, FS[a], DUR[b], F[c][0], F[c][1], DUTIES[d]) == 0)
+                      ? expand_rle(&rle, n) : 0;
+            check(tr, rw, rg, n, what);
+            pulse_rle_free(&rle);
+        }
+    }
+}
+
+static void check_stats(tally_t* t, const pulse_stats_t* a, const pulse_stats_t* b, const char* what)
+{
+    t->cases++;
+    if (a->bits == b->bits && a->ones == b->ones && a->max_run == b->max_run &&
+        a->duty_percent == b->duty_percent && a->max_local_duty == b->max_local_duty)
+        return;
+    if (t->bad++ >= MAX_REPORT) return;
+    printf("  MISMATCH %s %s: ones %zu/%zu max_run %d/%d local %.4f%%/%.4f%%\n", t->name, what,
+           a->ones, b->ones, a->max_run, b->max_run, a->max_local_duty, b->max_local_duty);
+}
+
+/* 生成した波形と乱数のバイト列で、窓の大きさを振って pulse_analyze / pulse_rle_analyze を比べる
+   （3kHz 75% は High 2500bit / Low 833bit：窓をまるごと埋める High と、High の無い窓の両方が出る。
+    短いチャープは後ろが長い Low） */
+static void sweep_analyze(tally_t* tb, tally_t* tr)
+{
+    static const size_t LENS[] = { 1, 7, 8, 9, 1001, 1255, 1256, 5003 };
+    static const size_t WINS[] = { 0, 1, 63, 64, 65, 1000, 10000 };
+    static const int    KHZ[]  = { 40, 3, 333 };
+    unsigned seed = 12345u;
+
+    for (int kind = 0; kind < 6; kind++) {
+        for (size_t l = 0; l < COUNT(LENS); l++) {
+            size_t n = LENS[l];
+            pulse_rle_t rle;
+            memset(&rle, 0, sizeof(rle));
+            int has_rle = 1;
+            if (kind < 3) {
+                pulse_gen_pfd(want, n, KHZ[kind], 75);   /* 75%：ゲートの 60% をまたぐ */
+                has_rle = (pulse_rle_gen_pfd(&rle, n * 8u, KHZ[kind], 75) == 0);
+            } else if (kind < 5) {
+                double dur = (kind == 3) ? 0.002 : 0.0001;
+                pulse_gen_exp_chirp(want, n, 10e6, dur, 95e3, 50e3, 59);
+                has_rle = (pulse_rle_gen_exp_chirp(&rle, n * 8u, 10e6, dur, 95e3, 50e3, 59) == 0);
+            } else {
+                for (size_t i = 0; i < n; i++) want[i] = (uint8_t)((seed = seed * 1103515245u + 12345u) >> 16);
+                has_rle = 0;
+            }
+            for (size_t w = 0; w < COUNT(WINS); w++) {
+                char what[64];
+                snprintf(what, sizeof(what), "wave=%d bytes=%zu window=%zu", kind, n, WINS[w]);
+                pulse_stats_t a, b;
+                ref_analyze(want, n, WINS[w], &a);
+                pulse_analyze(want, n, WINS[w], &b);
+                check_stats(tb, &a, &b, what);
+                if (!has_rle) continue;
+                pulse_rle_analyze(&rle, WINS[w], &b);
+                check_stats(tr, &a, &b, what);
+            }
+            pulse_rle_free(&rle);
+        }
+    }
+}
+
+static int report(const tally_t* t)
+{
+    printf("%-12s %7lu cases  %s", t->name, t->cases, t->bad ? "FAIL" : "OK");
+    if (t->bad) printf(" (%lu mismatches)", t->bad);
+    printf("\n");
+    return t->bad ? 1 : 0;
+}
+
+int main(void)
+{
+    /* 生成関数が1回ごとに stderr へ出す1行ログを黙らせる（結果は stdout） */
+    fflush(stderr);
+    if (!freopen("/dev/null", "w", stderr)) return 1;
+
+    tally_t pfd = { "pfd", 0, 0 }, pfd_rle = { "pfd_rle", 0, 0 };
+    tally_t fm = { "chirp", 0, 0 }, fm_rle = { "chirp_rle", 0, 0 };
+    sweep_pfd(&pfd, &pfd_rle);
+    sweep_chirp(&fm, &fm_rle);
+    tally_t an = { "analyze", 0, 0 }, an_rle = { "analyze_rle", 0, 0 };
+    sweep_analyze(&an, &an_rle);
+
+    int rc = 0;
+    rc |= report(&pfd);
+    rc |= report(&pfd_rle);
+    rc |= report(&fm);
+    rc |= report(&fm_rle);
+    rc |= report(&an);
+    rc |= report(&an_rle);
+    return rc;
+}
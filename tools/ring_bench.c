@@ -0,0 +1,235 @@
+/* ring_bench: spsc_ring（受信スレッド → 処理スレッドのバイトリング）の速さと、受信しながらの処理を測る
+ *
+ *   ./build/ring_bench                 （両方：リング単体 + ping_loop で受信途中からデコード）
+ *   ./build/ring_bench -r 64           （リング単体だけ, 64MB 流す）
+ *   ./build/ring_bench -p 20           （ping_loop だけ, 20ピング）
+ *
+ * 1) リング単体：書き手スレッドが read(2) と同じように空きへ直接書いて commit、
+ *    読み手スレッドが 1ピング（256000 バイト）ずつ取り出す。
+ *    その場で読む（コピーなし）/ spsc_ring_read でコピー、ミラーあり / なし で MB/s を比べる。
+ *    ミラーなしだと末尾で割れるピングが出る（split = その数。処理側で繋ぎ直しが要る）。
+ * 2) ping_loop：synth を実機と同じ 4MB/s で受信し、ping_loop_peek で届いた分から adc_decode していく。
+ *    受信完了からデコード完了までの遅れを、acquire してから全部デコードする場合と比べる。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "spsc_ring.h"
+#include "ping_loop.h"
+#include "adc_source.h"
+#include "adc_decode.h"
+
+#define FRAME_BYTES 256000u   /* 64ms @ 1MHz × 4byte */
+#define WRITE_CHUNK 4096u     /* tty の read 1回分くらい */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* ---------------- 1) リング単体 ---------------- */
+
+typedef struct {
+    spsc_ring_t* ring;
+    uint64_t     total;
+} producer_arg_t;
+
+/* バイト位置から決まる値（読み手で検算する）。周期 2048 なので表からまとめて写せる */
+#define PATTERN_PERIOD 2048u
+static uint8_t pattern(uint64_t pos) { return (uint8_t)(pos * 131u >> 3); }
+static uint8_t pattern_tab[PATTERN_PERIOD + WRITE_CHUNK];
+
+static void* producer(void* arg)
+{
+    producer_arg_t* a = (producer_arg_t*)arg;
+    uint64_t pos = 0;
+    while (pos < a->total) {
+        struct iovec iov[2];
+        size_t n = spsc_ring_write_space(a->ring, iov);
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        if (n > WRITE_CHUNK) n = WRITE_CHUNK;
+        if (n > a->total - pos) n = (size_t)(a->total - pos);
+        /* 受信（read(2) が空きへ直接書く）の代わり */
+        size_t a0 = (n < iov[0].iov_len) ? n : iov[0].iov_len;
+        memcpy(iov[0].iov_base, pattern_tab + pos % PATTERN_PERIOD, a0);
+        if (n > a0) memcpy(iov[1].iov_base, pattern_tab + (pos + a0) % PATTERN_PERIOD, n - a0);
+        spsc_ring_commit(a->ring, n);
+        pos += n;
+    }
+    return NULL;
+}
+
+static int run_ring(size_t ring_bytes, unsigned flags, int copy, uint64_t total)
+{
+    spsc_ring_t* r = spsc_ring_create(ring_bytes, flags);
+    if (!r) return -1;
+    uint8_t* buf = (uint8_t*)malloc(FRAME_BYTES);
+    producer_arg_t pa = { r, total };
+    pthread_t th;
+    uint64_t t0 = now_ns();
+    if (!buf || pthread_create(&th, NULL, producer, &pa) != 0) {
+        free(buf);
+        spsc_ring_destroy(r);
+        return -1;
+    }
+
+    uint64_t pos = 0, frames = 0, split = 0, bad = 0, sum = 0;
+    while (pos < total) {
+        size_t want = (total - pos < FRAME_BYTES) ? (size_t)(total - pos) : FRAME_BYTES;
+        struct iovec iov[2];
+        if (spsc_ring_read_avail(r, iov) < want) {
+            sched_yield();
+            continue;
+        }
+        const uint8_t* f;
+        if (copy) {
+            spsc_ring_read(r, buf, want);
+            f = buf;
+        } else if (iov[0].iov_len >= want) {
+            f = (const uint8_t*)iov[0].iov_base;   /* リング上のまま */
+        } else {
+            /* ミラーなしで末尾をまたいだ：繋ぎ直す */
+            memcpy(buf, iov[0].iov_base, iov[0].iov_len);
+            memcpy(buf + iov[0].iov_len, iov[1].iov_base, want - iov[0].iov_len);
+            f = buf;
+            split++;
+        }
+        /* 処理の代わり：検算 + 和（先頭・中央・末尾は値も確かめる） */
+        for (size_t i = 0; i < want; i += 64) sum += f[i];
+        if (f[0] != pattern(pos) || f[want / 2] != pattern(pos + want / 2) || f[want - 1] != pattern(pos + want - 1))
+            bad++;
+        if (!copy) spsc_ring_consume(r, want);
+        pos += want;
+        frames++;
+    }
+    pthread_join(th, NULL);
+    double dt = (double)(now_ns() - t0) * 1e-9;
+
+    printf("  %-6s %-9s ring=%7zuKB frames=%llu split=%llu bad=%llu  %.1f ms = %.1f MB/s (sum %llu)\n",
+           spsc_ring_mirrored(r) ? "mirror" : "plain", copy ? "copy" : "zero-copy",
+           spsc_ring_size(r) / 1024u, (unsigned long long)frames, (unsigned long long)split,
+           (unsigned long long)bad, dt * 1e3, dt > 0.0 ? (double)total / dt / 1e6 : 0.0,
+           (unsigned long long)sum);
+    free(buf);
+    spsc_ring_destroy(r);
+    return bad ? -1 : 0;
+}
+
+/* ---------------- 2) ping_loop で受信途中からデコード ---------------- */
+
+static int run_stream(long n_pings, int stream)
+{
+    /* エコーの形は問わないので短い矩形波 */
+    enum { CHIRP_LEN = 2000 };
+    static float chirp[CHIRP_LEN];
+    for (int i = 0; i < CHIRP_LEN; i++) chirp[i] = (float)((i % 14) < 7 ? 1.0 : -1.0);
+
+    adc_synth_cfg_t sc;
+    memset(&sc, 0, sizeof(sc));
+    sc.chirp = chirp;
+    sc.chirp_len = CHIRP_LEN;
+    sc.fs = 1e6;
+    sc.capture_bytes = FRAME_BYTES;
+    sc.echo[0].delay_s = 0.0058;
+    sc.echo[0].amp_l = sc.echo[0].amp_r = 2000.0;
+    sc.n_echo = 1;
+    sc.snr_db = 10.0;
+    sc.bytes_per_s = ADC_SOURCE_REALTIME_BPS;
+    adc_source_t* src = adc_source_open_synth(&sc);
+
+    ping_loop_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.capture_bytes = FRAME_BYTES;
+    cfg.n_slots = 4;
+    cfg.period_ms = 100;
+    cfg.start_timeout_ms = 1000;
+    cfg.idle_timeout_ms = 100;
+    cfg.max_pings = n_pings;
+    cfg.ring_mirror = 1;
+    float* lr = (float*)malloc(sizeof(float) * 2 * (FRAME_BYTES / 4u));
+    ping_loop_t* pl = src ? ping_loop_create(src, NULL, NULL, &cfg) : NULL;
+    if (!pl || !lr || ping_loop_start(pl) != 0) {
+        ping_loop_destroy(pl);
+        adc_source_close(src);
+        free(lr);
+        return -1;
+    }
+
+    uint64_t next = 0, lag_sum = 0, lag_max = 0, n = 0, chunks = 0;
+    size_t dec = 0;   /* 今のピングでデコード済みのバイト数（4 の倍数） */
+    for (;;) {
+        if (stream) {
+            /* 届いた分だけデコードしておく（完了を待たない） */
+            const uint8_t* d;
+            int done;
+            size_t have = ping_loop_peek(pl, next, &d, &done) & ~(size_t)3;
+            if (have > dec) {
+                adc_decode_interleaved(d + dec, have - dec, lr + dec / 2u, NULL, NULL);
+                dec = have;
+                chunks++;
+            }
+        }
+        ping_frame_t f;
+        int r = ping_loop_acquire(pl, &f, stream ? 1 : 1000);
+        if (r < 0) break;
+        if (r == 0) continue;
+        size_t all = f.got & ~(size_t)3;
+        if (all > dec) adc_decode_interleaved(f.data + dec, all - dec, lr + dec / 2u, NULL, NULL);
+        uint64_t t = now_ns(), lag = t > f.t_done_ns ? t - f.t_done_ns : 0;
+        lag_sum += lag;
+        if (lag > lag_max) lag_max = lag;
+        n++;
+        dec = 0;
+        next = f.seq + 1;
+        ping_loop_release(pl, &f);
+    }
+    ping_loop_stats_t st;
+    ping_loop_get_stats(pl, &st);
+    printf("  %-9s pings=%llu incomplete=%llu chunks/ping=%.1f  done->decoded avg=%.3fms max=%.3fms\n",
+           stream ? "streaming" : "on-acquire", (unsigned long long)n, (unsigned long long)st.incomplete,
+           n ? (double)chunks / (double)n : 0.0, n ? (double)lag_sum / (double)n * 1e-6 : 0.0,
+           (double)lag_max * 1e-6);
+    ping_loop_destroy(pl);
+    adc_source_close(src);
+    free(lr);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    long ring_mb = 256, n_pings = 10;
+    int do_ring = 1, do_stream = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-r") == 0)      { ring_mb = strtol(argv[i + 1], NULL, 10); do_stream = 0; }
+        else if (strcmp(argv[i], "-p") == 0) { n_pings = strtol(argv[i + 1], NULL, 10); do_ring = 0; }
+        else {
+            fprintf(stderr, "usage: %s [-r MB] [-p pings]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (ring_mb <= 0 || n_pings <= 0) return 1;
+
+    int rc = 0;
+    if (do_ring) {
+        uint64_t total = (uint64_t)ring_mb * 1000000u;
+        for (size_t i = 0; i < sizeof(pattern_tab); i++) pattern_tab[i] = pattern(i);
+        printf("spsc_ring: %ld MB, frame=%u bytes, write chunk=%u bytes\n", ring_mb, FRAME_BYTES, WRITE_CHUNK);
+        for (int m = 0; m < 2; m++)
+            for (int c = 0; c < 2; c++)
+                if (run_ring(4u * FRAME_BYTES, m ? SPSC_RING_MIRROR : 0, c, total) != 0) rc = 1;
+    }
+    if (do_stream) {
+        printf("ping_loop (synth, 4MB/s, decode=%s): %ld pings\n", adc_decode_impl(), n_pings);
+        if (run_stream(n_pings, 0) != 0 || run_stream(n_pings, 1) != 0) rc = 1;
+    }
+    return rc;
+}
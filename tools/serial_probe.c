@@ -0,0 +1,54 @@
+/* serial_probe: シリアルポートを serial_setup で開いて、実際に効いた設定を表示する
+ *
+ *   ./build/serial_probe /dev/ttyUSB1 4000000
+ *   ./build/serial_probe /dev/ttyUSB1 3000000 -l 2      （FTDI latency_timer = 2ms）
+ *   ./build/serial_probe /tmp/ADC_A 3333333             （pty でも BOTHER を確認できる）
+ *
+ * baud が要求と違う / low_latency=off / ftdi_latency が 16ms のままなら、
+ * ホスト側が帯域や初回バイト遅延を律速している可能性がある。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "serial_setup.h"
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s DEV [baud] [-l latency_ms] [-f xmit_fifo]\n", argv[0]);
+        return 1;
+    }
+    const char* dev = argv[1];
+    int baud = ADC_BAUDRATE;
+    int next = 2;
+    if (argc > 2 && argv[2][0] != '-') {
+        baud = atoi(argv[2]);
+        next = 3;
+    }
+
+    serial_cfg_t cfg;
+    serial_cfg_default(&cfg, baud);
+    for (int i = next; i < argc; i++) {
+        if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)      cfg.ftdi_latency_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) cfg.xmit_fifo_size = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    serial_info_t info;
+    int fd = serial_open(dev, &cfg, &info);
+    if (fd < 0) {
+        perror(dev);
+        return 1;
+    }
+    serial_info_print("probe", dev, &info);
+    if (info.baud_actual != baud)
+        printf("warning: requested baud=%d, driver reports %d\n", baud, info.baud_actual);
+    close(fd);
+    return 0;
+}
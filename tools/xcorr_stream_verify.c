@@ -0,0 +1,279 @@
+/* xcorr_stream_verify: ストリーミング相関（xcorr_stream_*）を一括計算と突き合わせる（回帰チェック）
+ *
+ *   ./build/xcorr_stream_verify        （全部。1つでも違えば終了コード 1）
+ *
+ * ・合成録音（チャープ + エコー数個 + 雑音）を半端な大きさのブロックで push → flush し、
+ *   同じ録音を1本の xcorr_ctx（録音長 + 参照長以上を0埋め = 循環なし）で
+ *   xcorr_run_envelope したものと比べる
+ *   - エコーはブロック境界ちょうど / 1点手前 / ブロックの真ん中 / flush の0埋めにかかる末尾に置く
+ *   - ブロックは 1 / 奇数 / step±1 / 録音全体、nfft は自動（2のべき）と 2のべきでない大きさ
+ * ・許容差
+ *   - cb の pos は 0 から隙間なく続き、合計が録音長と同じ（lags）
+ *   - 同じ nfft ならブロックの切り方に関係なくエンベロープはビット単位で同じ（exact）
+ *   - 各エコーのピーク位置（真の遅延 ±call_len/2 の範囲の最大）は一括計算と同じ点、
+ *     ピーク値の差は PEAK_TOL 以内（peak）
+ *   - 全ラグ（ブロック端を含む）で |ストリーム - 一括| が一括の最大ピークの EDGE_TOL 以内（edge）
+ *     実部（相関そのもの）は各ブロックの出力範囲で一括と同じ。違いは虚部（ヒルベルト変換）で、
+ *     参照の解析信号が nfft で循環する分と、HPF の bin の刻み（nfft と一括 N で違う）の分。
+ *     帯域の狭い参照（ここでは 40→60kHz の Hann 窓チャープ）なら裾は小さく、実測は 1e-6 未満
+ * 違ったときは最初の数件について、条件と値を出す。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "crosscorr.h"
+
+#define FS_HZ       1e6
+#define CALL_LEN    1000
+#define REC_LEN     261000      /* 0埋め後の一括 N = 262144 */
+#define WHOLE_N     262144
+#define PEAK_TOL    1e-4        /* ピーク値の相対差 */
+#define EDGE_TOL    1e-5        /* 全ラグの差（一括の最大ピーク比） */
+#define MAX_REPORT  5
+
+typedef struct {
+    const char* name;
+    unsigned long cases;
+    unsigned long bad;
+} tally_t;
+
+/* cb で受け取ったエンベロープを録音と同じ並びにためる */
+typedef struct {
+    float* env;
+    uint64_t next;     /* 次に来るはずの pos */
+    int gap;           /* pos が飛んだ / 戻った */
+} sink_t;
+
+static void on_env(void* user, uint64_t pos, const float* env, size_t n)
+{
+    sink_t* s = (sink_t*)user;
+    if (pos != s->next || pos + n > REC_LEN) {
+        s->gap = 1;
+        return;
+    }
+    memcpy(s->env + pos, env, sizeof(float) * n);
+    s->next = pos + n;
+}
+
+/* 40kHz → 60kHz の線形チャープ（Hann 窓） */
+static void make_call(float* call)
+{
+    const double f0 = 40e3, f1 = 60e3;
+    const double T = (double)CALL_LEN / FS_HZ;
+    for (int i = 0; i < CALL_LEN; i++) {
+        double t = (double)i / FS_HZ;
+        double ph = 2.0 * M_PI * (f0 * t + 0.5 * (f1 - f0) / T * t * t);
+        double w = 0.5 - 0.5 * cos(2.0 * M_PI * (double)i / (double)(CALL_LEN - 1));
+        call[i] = (float)(w * sin(ph));
+    }
+}
+
+/* 再現できる一様乱数 [-1, 1) */
+static float lcg(uint32_t* st)
+{
+    *st = *st * 1664525u + 1013904223u;
+    return (float)((double)(*st >> 8) / 8388608.0 - 1.0);
+}
+
+/* ストリームの出力ブロック（step 点）の境界まわりにエコーを置く */
+static int make_delays(size_t step, size_t* d, float* a)
+{
+    int n = 0;
+    d[n] = 5 * step;                  a[n++] = 1.0f;    /* 境界ちょうど */
+    d[n] = 12 * step - 1;             a[n++] = 0.5f;    /* 境界の1点手前 */
+    d[n] = 30 * step + step / 2;      a[n++] = 0.25f;   /* ブロックの真ん中 */
+    d[n] = REC_LEN - CALL_LEN - 3;    a[n++] = 0.5f;    /* flush の0埋めにかかる */
+    return n;
+}
+
+static void make_rec(float* rec, const float* call, const size_t* d, const float* a, int n_echo)
+{
+    uint32_t st = 12345u;
+    for (size_t i = 0; i < REC_LEN; i++) rec[i] = 0.05f * lcg(&st);
+    for (int e = 0; e < n_echo; e++)
+        for (int i = 0; i < CALL_LEN && d[e] + (size_t)i < REC_LEN; i++)
+            rec[d[e] + (size_t)i] += a[e] * call[i];
+}
+
+/* 一括：WHOLE_N 点（録音の後ろは0）で1回だけ相関 */
+static int run_whole(const float* call, const float* rec, double hpf_hz, float* env)
+{
+    xcorr_ctx_t* c = xcorr_create_ex(WHOLE_N, FS_HZ, hpf_hz, NULL);
+    if (!c) return -1;
+
+    float* in = xcorr_input(c);
+    memcpy(in, call, sizeof(float) * CALL_LEN);
+    memset(in + CALL_LEN, 0, sizeof(float) * (WHOLE_N - CALL_LEN));
+    xcorr_set_call_time(c, in);
+
+    memcpy(in, rec, sizeof(float) * REC_LEN);
+    memset(in + REC_LEN, 0, sizeof(float) * (WHOLE_N - REC_LEN));
+    xcorr_run_envelope(c, in, env);
+    xcorr_destroy(c);
+    return 0;
+}
+
+/* ストリーム：block 点ずつ push して flush。rounds 回くり返して（flush 後の状態の戻りも見る）
+   最後の回のエンベロープを env に残す */
+static int run_stream(const float* call, const float* rec, double hpf_hz, int nfft,
+                      size_t block, int rounds, float* env, size_t* step_out)
+{
+    sink_t sk = { env, 0, 0 };
+    xcorr_stream_t* s = xcorr_stream_create(call, CALL_LEN, FS_HZ, hpf_hz, nfft, NULL, on_env, &sk);
+    if (!s) return -1;
+    *step_out = xcorr_stream_step(s);
+
+    int rc = 0;
+    for (int r = 0; r < rounds && rc == 0; r++) {
+        sk.next = 0;
+        for (size_t i = 0; i < REC_LEN; i += block) {
+            size_t n = (REC_LEN - i < block) ? REC_LEN - i : block;
+            if (xcorr_stream_push(s, rec + i, n) != 0) rc = -1;
+        }
+        if (xcorr_stream_flush(s) != 0) rc = -1;
+        if (sk.gap || sk.next != REC_LEN) rc = -1;
+    }
+    xcorr_stream_destroy(s);
+    return rc;
+}
+
+static size_t stream_step(const float* call, int nfft)
+{
+    sink_t sk = { NULL, 0, 0 };
+    xcorr_stream_t* s = xcorr_stream_create(call, CALL_LEN, FS_HZ, 0.0, nfft, NULL, on_env, &sk);
+    size_t step = xcorr_stream_step(s);
+    xcorr_stream_destroy(s);
+    return step;
+}
+
+static int bad(tally_t* t)
+{
+    return t->bad++ < MAX_REPORT;
+}
+
+static void sweep(tally_t* tl, tally_t* tx, tally_t* tp, tally_t* te, double* edge_max)
+{
+    static const double HPFS[] = { 0.0, XCORR_HPF_HZ };
+    static const int NFFTS[] = { 0, 3000 };
+
+    float* call = (float*)malloc(sizeof(float) * CALL_LEN);
+    float* rec = (float*)malloc(sizeof(float) * REC_LEN);
+    float* whole = (float*)malloc(sizeof(float) * WHOLE_N);
+    float* ref = (float*)malloc(sizeof(float) * REC_LEN);
+    float* got = (float*)malloc(sizeof(float) * REC_LEN);
+    if (!call || !rec || !whole || !ref || !got) {
+        tl->bad++;
+        goto out;
+    }
+    make_call(call);
+
+    for (size_t ni = 0; ni < sizeof(NFFTS) / sizeof(NFFTS[0]); ni++) {
+        /* エコーの位置は step に合わせるので、先に step を知る */
+        size_t step = stream_step(call, NFFTS[ni]);
+        if (step < 2) {
+            tl->bad++;
+            continue;
+        }
+        size_t d[8];
+        float a[8];
+        int n_echo = make_delays(step, d, a);
+        make_rec(rec, call, d, a, n_echo);
+
+        for (size_t hi = 0; hi < sizeof(HPFS) / sizeof(HPFS[0]); hi++) {
+            const double hpf = HPFS[hi];
+            if (run_whole(call, rec, hpf, whole) != 0) {
+                tl->bad++;
+                continue;
+            }
+
+            /* 録音全体を1回で push したものを基準に、ブロックの切り方を変える */
+            size_t s0;
+            tl->cases++;
+            if (run_stream(call, rec, hpf, NFFTS[ni], REC_LEN, 1, ref, &s0) != 0) {
+                if (bad(tl)) printf("  lags: nfft=%d hpf=%.0f block=all\n", NFFTS[ni], hpf);
+                continue;
+            }
+
+            const size_t BLOCKS[] = { 1, 7, 333, 4099, step - 1, step, step + 1 };
+            for (size_t bi = 0; bi < sizeof(BLOCKS) / sizeof(BLOCKS[0]); bi++) {
+                tl->cases++;
+                if (run_stream(call, rec, hpf, NFFTS[ni], BLOCKS[bi], 2, got, &s0) != 0) {
+                    if (bad(tl)) printf("  lags: nfft=%d hpf=%.0f block=%zu\n", NFFTS[ni], hpf, BLOCKS[bi]);
+                    continue;
+                }
+                tx->cases++;
+                if (memcmp(ref, got, sizeof(float) * REC_LEN) != 0 && bad(tx)) {
+                    size_t i = 0;
+                    while (ref[i] == got[i]) i++;
+                    printf("  exact: nfft=%d hpf=%.0f block=%zu lag=%zu all=%g got=%g\n",
+                           NFFTS[ni], hpf, BLOCKS[bi], i, ref[i], got[i]);
+                }
+            }
+
+            /* 一括との比較：エコーごとのピーク */
+            float peak_all = 0.0f;
+            for (int e = 0; e < n_echo; e++) {
+                size_t i0 = (d[e] > CALL_LEN / 2) ? d[e] - CALL_LEN / 2 : 0;
+                size_t i1 = d[e] + CALL_LEN / 2;
+                size_t pw = xcorr_argmax_range(whole, REC_LEN, i0, i1);
+                size_t ps = xcorr_argmax_range(ref, REC_LEN, i0, i1);
+                double rel = fabs((double)ref[ps] - (double)whole[pw]) / (double)whole[pw];
+                if (whole[pw] > peak_all) peak_all = whole[pw];
+
+                tp->cases++;
+                if ((pw != ps || rel > PEAK_TOL) && bad(tp))
+                    printf("  peak: nfft=%d hpf=%.0f echo@%zu whole=%zu (%g) stream=%zu (%g) rel=%.2e\n",
+                           NFFTS[ni], hpf, d[e], pw, whole[pw], ps, ref[ps], rel);
+            }
+
+            /* 全ラグの差 */
+            double dmax = 0.0;
+            size_t imax = 0;
+            for (size_t i = 0; i < REC_LEN; i++) {
+                double df = fabs((double)ref[i] - (double)whole[i]);
+                if (df > dmax) { dmax = df; imax = i; }
+            }
+            dmax /= (double)peak_all;
+            if (dmax > *edge_max) *edge_max = dmax;
+
+            te->cases++;
+            if (dmax > EDGE_TOL && bad(te))
+                printf("  edge: nfft=%d hpf=%.0f lag=%zu (block offset %zu/%zu) diff=%.2e of peak\n",
+                       NFFTS[ni], hpf, imax, imax % step, step, dmax);
+        }
+    }
+
+out:
+    free(call);
+    free(rec);
+    free(whole);
+    free(ref);
+    free(got);
+}
+
+static int report(const tally_t* t)
+{
+    printf("%-12s %7lu cases  %s", t->name, t->cases, t->bad ? "FAIL" : "OK");
+    if (t->bad) printf(" (%lu mismatches)", t->bad);
+    printf("\n");
+    return t->bad ? 1 : 0;
+}
+
+int main(void)
+{
+    tally_t lags = { "lags", 0, 0 }, exact = { "exact", 0, 0 };
+    tally_t peak = { "peak", 0, 0 }, edge = { "edge", 0, 0 };
+    double edge_max = 0.0;
+    sweep(&lags, &exact, &peak, &edge, &edge_max);
+
+    int rc = 0;
+    rc |= report(&lags);
+    rc |= report(&exact);
+    rc |= report(&peak);
+    rc |= report(&edge);
+    printf("max |stream - whole| = %.2e of peak (EDGE_TOL %.0e)\n", edge_max, EDGE_TOL);
+    return rc;
+}
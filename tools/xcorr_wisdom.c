@@ -0,0 +1,135 @@
+/* xcorr_wisdom: よく使う N の FFTW プランを測定して wisdom ファイルに保存する
+ *
+ *   ./build/xcorr_wisdom                      → 既定サイズ（config.h の ADC_READ_BYTES / DDC_DECIM から）, MEASURE, config.h のパス
+ *   ./build/xcorr_wisdom -m patient 64000 16000
+ *   ./build/xcorr_wisdom -o /path/to/wisdom.dat 32768
+ *
+ * tdoa の窓と Doppler バンク（連続ピングと同じ形）のプランもいつも一緒に作る。
+ * 既存の wisdom は読み込んでから追記するので、何度実行してもよい。
+ * マシン（Pi / PC）ごとに1回実行しておけば、以降の xcorr_create_ex / tdoa_create は速い。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "crosscorr.h"
+#include "tdoa.h"
+#include "ddc.h"
+#include "doppler.h"
+
+/* 既定サイズは連続ピング（run_ping_loop）と同じ決め方：1ピング全体 N = ADC_READ_BYTES/4 と、
+   DDC_DECIM > 1 なら相関が実際に使う N/D（r2c / c2c とも xcorr_create_ex が作る） */
+#define LOOP_N  ((int)(ADC_READ_BYTES / 4))
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int parse_mode(const char* s, xcorr_plan_mode_t* out)
+{
+    if (strcmp(s, "estimate") == 0) { *out = XCORR_PLAN_ESTIMATE; return 0; }
+    if (strcmp(s, "measure") == 0)  { *out = XCORR_PLAN_MEASURE;  return 0; }
+    if (strcmp(s, "patient") == 0)  { *out = XCORR_PLAN_PATIENT;  return 0; }
+    return -1;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = XCORR_WISDOM_PATH;
+    xcorr_opts_t opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.plan_mode = XCORR_PLAN_MEASURE;
+
+    int sizes[64];
+    int n_sizes = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            if (parse_mode(argv[++i], &opt.plan_mode) != 0) {
+                fprintf(stderr, "unknown mode: %s (estimate|measure|patient)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            int n = atoi(argv[i]);
+            if (n <= 0 || n_sizes >= (int)(sizeof(sizes) / sizeof(sizes[0]))) {
+                fprintf(stderr, "usage: %s [-m estimate|measure|patient] [-o path] [N ...]\n", argv[0]);
+                return 1;
+            }
+            sizes[n_sizes++] = n;
+        }
+    }
+    if (n_sizes == 0) {
+        sizes[n_sizes++] = LOOP_N;
+        if (DDC_DECIM > 1) sizes[n_sizes++] = LOOP_N / DDC_DECIM;
+    }
+
+    if (xcorr_wisdom_import(path) == 0) printf("wisdom loaded: %s\n", path);
+
+    for (int i = 0; i < n_sizes; i++) {
+        double t0 = now_s();
+        xcorr_ctx_t* c = xcorr_create_ex(sizes[i], 1e6, 0.0, &opt);
+        double t1 = now_s();
+        if (!c) {
+            fprintf(stderr, "xcorr_create_ex failed (N=%d)\n", sizes[i]);
+            return 1;
+        }
+        xcorr_destroy(c);
+        printf("N=%d planned in %.3f s\n", sizes[i], t1 - t0);
+    }
+
+    /* tdoa の窓（r2c / c2r）も同じ wisdom に入れておく */
+    double t0 = now_s();
+    tdoa_ctx_t* td = tdoa_create(TDOA_WIN, 1e6, 0.0, 0.0, &opt);
+    if (!td) {
+        fprintf(stderr, "tdoa_create failed (win=%d)\n", TDOA_WIN);
+        return 1;
+    }
+    printf("tdoa nfft=%d planned in %.3f s\n", tdoa_nfft(td), now_s() - t0);
+    tdoa_destroy(td);
+
+    /* Doppler バンク：run_ping_loop と同じ N・行数・スレッド数で作って壊す
+       （ワーカーごとの行の束の逆 c2c（howmany = 行の分け方）と順変換を wisdom に入れる） */
+    static float call[256];   /* プランは中身によらないので、参照は適当なインパルス */
+    const size_t call_len = sizeof(call) / sizeof(call[0]);
+    call[0] = 1.0f;
+    double dv[DOPPLER_BINS];
+    doppler_velocities(DOPPLER_VMAX_MPS, DOPPLER_BINS, dv);
+    ddc_t* ddc = NULL;
+    if (DDC_DECIM > 1) {
+        ddc_cfg_t dc;
+        ddc_cfg_default(&dc, 1e6);
+        ddc = ddc_create(&dc, (size_t)LOOP_N);
+        if (!ddc) {
+            fprintf(stderr, "ddc_create failed\n");
+            return 1;
+        }
+    }
+    t0 = now_s();
+    doppler_bank_t* dop = ddc
+        ? doppler_bank_create_ddc(LOOP_N, ddc, call, call_len, dv, DOPPLER_BINS,
+                                  SOUND_SPEED_MPS, DOPPLER_THREADS, &opt)
+        : doppler_bank_create(LOOP_N, 1e6, 0.0, call, call_len, dv, DOPPLER_BINS,
+                              SOUND_SPEED_MPS, DOPPLER_THREADS, &opt);
+    ddc_destroy(ddc);
+    if (!dop) {
+        fprintf(stderr, "doppler_bank_create failed (N=%d)\n", LOOP_N);
+        return 1;
+    }
+    printf("doppler N=%d x %d rows (%d threads) planned in %.3f s\n",
+           LOOP_N / DDC_DECIM, DOPPLER_BINS, DOPPLER_THREADS, now_s() - t0);
+    doppler_bank_destroy(dop);
+
+    if (xcorr_wisdom_export(path) != 0) {
+        fprintf(stderr, "wisdom export failed: %s\n", path);
+        return 1;
+    }
+    printf("wisdom saved: %s\n", path);
+    return 0;
+}